@@ -0,0 +1,135 @@
+/*
+ * fork() benchmark for a zygote-like process
+ *
+ * Maps a file privately, reads all of it and dirties a part of it the way
+ * relocations dirty a library, allocates and touches an anonymous heap,
+ * then times fork() followed by an immediate _exit() in the child, and
+ * fork() followed by an exec() of a trivial program, as app launches do.
+ * Run it with both settings of vm.fork_lazy_file_ptes to compare:
+ *
+ *	dd if=/dev/zero of=/data/local/tmp/fb bs=1M count=64
+ *	echo 0 > /proc/sys/vm/fork_lazy_file_ptes
+ *	fork-bench /data/local/tmp/fb 16 100
+ *	echo 1 > /proc/sys/vm/fork_lazy_file_ptes
+ *	fork-bench /data/local/tmp/fb 16 100
+ *
+ * The arguments are the file to map, the heap size in MiB and the number
+ * of iterations.  The times are the parent's, from fork() to the child
+ * being reaped.
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+
+#define PAGE		4096
+#define DIRTY_EVERY	8	/* private copy of one in so many file pages */
+
+struct result {
+	long min, max;
+	long long sum;
+};
+
+static long now_us(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec * 1000000L + tv.tv_usec;
+}
+
+static void add(struct result *r, long us)
+{
+	if (!r->sum || us < r->min)
+		r->min = us;
+	if (us > r->max)
+		r->max = us;
+	r->sum += us;
+}
+
+static void report(const char *name, struct result *r, int iterations)
+{
+	printf("%-12s avg %6lld us  min %6ld us  max %6ld us\n",
+	       name, r->sum / iterations, r->min, r->max);
+}
+
+static void run(char *self, int exec, struct result *r)
+{
+	long t0 = now_us();
+	pid_t pid = fork();
+
+	if (pid < 0) {
+		perror("fork");
+		exit(1);
+	}
+	if (!pid) {
+		if (exec)
+			execl(self, self, NULL);
+		_exit(0);
+	}
+	waitpid(pid, NULL, 0);
+	add(r, now_us() - t0);
+}
+
+int main(int argc, char **argv)
+{
+	struct result plain = { 0, 0, 0 }, exec = { 0, 0, 0 };
+	volatile char *file;
+	char *heap;
+	unsigned long size, heap_size, off;
+	struct stat st;
+	int fd, i, iterations;
+
+	/* the exec'ed child is this program without arguments */
+	if (argc == 1)
+		return 0;
+	if (argc != 4) {
+		fprintf(stderr, "usage: %s <file> <heap MiB> <iterations>\n",
+			argv[0]);
+		return 1;
+	}
+	heap_size = strtoul(argv[2], NULL, 0) << 20;
+	iterations = atoi(argv[3]);
+	if (iterations <= 0)
+		return 1;
+
+	fd = open(argv[1], O_RDONLY);
+	if (fd < 0 || fstat(fd, &st) < 0) {
+		perror(argv[1]);
+		return 1;
+	}
+	size = st.st_size & ~(PAGE - 1UL);
+	file = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+	if (file == MAP_FAILED) {
+		perror("mmap");
+		return 1;
+	}
+	for (off = 0; off < size; off += PAGE) {
+		(void)file[off];
+		if (!(off / PAGE % DIRTY_EVERY))
+			file[off] = 1;
+	}
+
+	heap = malloc(heap_size);
+	if (heap_size && !heap) {
+		perror("malloc");
+		return 1;
+	}
+	memset(heap, 1, heap_size);
+
+	printf("%lu KiB file mapping, %lu KiB heap, %d iterations\n",
+	       size >> 10, heap_size >> 10, iterations);
+
+	for (i = 0; i < iterations; i++) {
+		run(argv[0], 0, &plain);
+		run(argv[0], 1, &exec);
+	}
+	report("fork+exit", &plain, iterations);
+	report("fork+exec", &exec, iterations);
+	return 0;
+}
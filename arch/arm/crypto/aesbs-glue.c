@@ -0,0 +1,695 @@
+/*
+ * Glue code for the bit sliced NEON AES in aesbs-core.S.
+ *
+ * The NEON code works on eight blocks at a time, so it only helps the
+ * modes that can run blocks in parallel: CBC decryption, CTR and XTS.
+ * CBC encryption, the XTS tweak and short tails use the scalar ARM
+ * code.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#include <linux/hardirq.h>
+#include <linux/types.h>
+#include <linux/crypto.h>
+#include <linux/err.h>
+#include <linux/module.h>
+#include <crypto/algapi.h>
+#include <crypto/aes.h>
+#include <crypto/b128ops.h>
+#include <crypto/cryptd.h>
+#include <crypto/gf128mul.h>
+#include <asm/aes.h>
+#include <asm/neon.h>
+
+#if defined(CONFIG_CRYPTO_CTR) || defined(CONFIG_CRYPTO_CTR_MODULE)
+#define HAS_CTR
+#endif
+
+#if defined(CONFIG_CRYPTO_XTS) || defined(CONFIG_CRYPTO_XTS_MODULE)
+#define HAS_XTS
+#endif
+
+#define AESBS_BLOCKS	8
+#define AESBS_BATCH	(AESBS_BLOCKS * AES_BLOCK_SIZE)
+
+/*
+ * A padded eight block batch costs about as much as four blocks done
+ * by the scalar code, so fewer blocks than this go the scalar way.
+ */
+#define AESBS_MIN_BLOCKS	4
+
+asmlinkage void aesbs_encrypt8(u8 out[], const u8 in[], const u8 *bskey,
+			       int rounds);
+asmlinkage void aesbs_decrypt8(u8 out[], const u8 in[], const u8 *bskey,
+			       int rounds);
+
+struct aesbs_ctx {
+	struct crypto_aes_ctx	aes;
+	int			rounds;
+	u8			bskey[AES_MAX_KEYLENGTH_U32 / 4 * 128];
+};
+
+struct aesbs_xts_ctx {
+	struct aesbs_ctx	key;
+	struct crypto_aes_ctx	twkey;
+};
+
+struct async_aes_ctx {
+	struct cryptd_ablkcipher *cryptd_tfm;
+};
+
+/*
+ * Build the bit sliced schedule from ctx->aes.key_enc: 128 bytes per
+ * round key, where byte j of the i'th 16 bytes is 0xff if bit i of
+ * state byte j is set.  State bytes are in row major order, and round
+ * keys 1..Nr carry the S-box constant 0x63 (see aesbs-core.S).
+ */
+static void aesbs_convert_key(struct aesbs_ctx *ctx)
+{
+	u8 *p = ctx->bskey;
+	int r, i, j;
+
+	for (r = 0; r <= ctx->rounds; r++) {
+		const u32 *rk = ctx->aes.key_enc + 4 * r;
+
+		for (i = 0; i < 8; i++)
+			for (j = 0; j < 16; j++) {
+				u8 b = rk[j % 4] >> (8 * (j / 4));
+
+				if (r)
+					b ^= 0x63;
+				*p++ = (b >> i) & 1 ? 0xff : 0;
+			}
+	}
+}
+
+static int aesbs_expand_key(struct aesbs_ctx *ctx, u32 *flags,
+			    const u8 *in_key, unsigned int key_len)
+{
+	int err;
+
+	err = crypto_aes_expand_key(&ctx->aes, in_key, key_len);
+	if (err) {
+		*flags |= CRYPTO_TFM_RES_BAD_KEY_LEN;
+		return err;
+	}
+	ctx->rounds = key_len / 4 + 6;
+	aesbs_convert_key(ctx);
+	return 0;
+}
+
+static int aesbs_set_key(struct crypto_tfm *tfm, const u8 *in_key,
+			 unsigned int key_len)
+{
+	return aesbs_expand_key(crypto_tfm_ctx(tfm), &tfm->crt_flags,
+				in_key, key_len);
+}
+
+/*
+ * Up to AESBS_BLOCKS blocks; must run between kernel_neon_begin() and
+ * kernel_neon_end().  dst and src may be the same.
+ */
+static void aesbs_encrypt_blocks(struct aesbs_ctx *ctx, u8 *dst,
+				 const u8 *src, unsigned int blocks)
+{
+	u8 buf[AESBS_BATCH];
+
+	if (blocks == AESBS_BLOCKS) {
+		aesbs_encrypt8(dst, src, ctx->bskey, ctx->rounds);
+	} else if (blocks >= AESBS_MIN_BLOCKS) {
+		memcpy(buf, src, blocks * AES_BLOCK_SIZE);
+		aesbs_encrypt8(buf, buf, ctx->bskey, ctx->rounds);
+		memcpy(dst, buf, blocks * AES_BLOCK_SIZE);
+	} else {
+		for (; blocks; blocks--) {
+			crypto_aes_encrypt_arm(&ctx->aes, dst, src);
+			src += AES_BLOCK_SIZE;
+			dst += AES_BLOCK_SIZE;
+		}
+	}
+}
+
+static void aesbs_decrypt_blocks(struct aesbs_ctx *ctx, u8 *dst,
+				 const u8 *src, unsigned int blocks)
+{
+	u8 buf[AESBS_BATCH];
+
+	if (blocks == AESBS_BLOCKS) {
+		aesbs_decrypt8(dst, src, ctx->bskey, ctx->rounds);
+	} else if (blocks >= AESBS_MIN_BLOCKS) {
+		memcpy(buf, src, blocks * AES_BLOCK_SIZE);
+		aesbs_decrypt8(buf, buf, ctx->bskey, ctx->rounds);
+		memcpy(dst, buf, blocks * AES_BLOCK_SIZE);
+	} else {
+		for (; blocks; blocks--) {
+			crypto_aes_decrypt_arm(&ctx->aes, dst, src);
+			src += AES_BLOCK_SIZE;
+			dst += AES_BLOCK_SIZE;
+		}
+	}
+}
+
+static int cbc_encrypt(struct blkcipher_desc *desc,
+		       struct scatterlist *dst, struct scatterlist *src,
+		       unsigned int nbytes)
+{
+	struct aesbs_ctx *ctx = crypto_blkcipher_ctx(desc->tfm);
+	struct blkcipher_walk walk;
+	int err;
+
+	blkcipher_walk_init(&walk, dst, src, nbytes);
+	err = blkcipher_walk_virt(desc, &walk);
+
+	while ((nbytes = walk.nbytes)) {
+		u8 *s = walk.src.virt.addr;
+		u8 *d = walk.dst.virt.addr;
+		u8 *iv = walk.iv;
+
+		do {
+			crypto_xor(iv, s, AES_BLOCK_SIZE);
+			crypto_aes_encrypt_arm(&ctx->aes, d, iv);
+			iv = d;
+			s += AES_BLOCK_SIZE;
+			d += AES_BLOCK_SIZE;
+		} while ((nbytes -= AES_BLOCK_SIZE) >= AES_BLOCK_SIZE);
+
+		memcpy(walk.iv, iv, AES_BLOCK_SIZE);
+		err = blkcipher_walk_done(desc, &walk, nbytes);
+	}
+
+	return err;
+}
+
+static int cbc_decrypt(struct blkcipher_desc *desc,
+		       struct scatterlist *dst, struct scatterlist *src,
+		       unsigned int nbytes)
+{
+	struct aesbs_ctx *ctx = crypto_blkcipher_ctx(desc->tfm);
+	struct blkcipher_walk walk;
+	u8 cbuf[AESBS_BATCH];
+	int err;
+
+	blkcipher_walk_init(&walk, dst, src, nbytes);
+	err = blkcipher_walk_virt(desc, &walk);
+
+	while ((nbytes = walk.nbytes)) {
+		u8 *s = walk.src.virt.addr;
+		u8 *d = walk.dst.virt.addr;
+
+		kernel_neon_begin();
+		while (nbytes >= AES_BLOCK_SIZE) {
+			unsigned int blocks = min_t(unsigned int,
+						    nbytes / AES_BLOCK_SIZE,
+						    AESBS_BLOCKS);
+			unsigned int len = blocks * AES_BLOCK_SIZE;
+
+			/* keep the ciphertext, d may be s */
+			memcpy(cbuf, s, len);
+			aesbs_decrypt_blocks(ctx, d, s, blocks);
+			crypto_xor(d, walk.iv, AES_BLOCK_SIZE);
+			crypto_xor(d + AES_BLOCK_SIZE, cbuf,
+				   len - AES_BLOCK_SIZE);
+			memcpy(walk.iv, cbuf + len - AES_BLOCK_SIZE,
+			       AES_BLOCK_SIZE);
+			s += len;
+			d += len;
+			nbytes -= len;
+		}
+		kernel_neon_end();
+		err = blkcipher_walk_done(desc, &walk, nbytes);
+	}
+
+	return err;
+}
+
+static struct crypto_alg blk_cbc_alg = {
+	.cra_name		= "__cbc-aes-neonbs",
+	.cra_driver_name	= "__driver-cbc-aes-neonbs",
+	.cra_priority		= 0,
+	.cra_flags		= CRYPTO_ALG_TYPE_BLKCIPHER,
+	.cra_blocksize		= AES_BLOCK_SIZE,
+	.cra_ctxsize		= sizeof(struct aesbs_ctx),
+	.cra_alignmask		= 0,
+	.cra_type		= &crypto_blkcipher_type,
+	.cra_module		= THIS_MODULE,
+	.cra_list		= LIST_HEAD_INIT(blk_cbc_alg.cra_list),
+	.cra_u = {
+		.blkcipher = {
+			.min_keysize	= AES_MIN_KEY_SIZE,
+			.max_keysize	= AES_MAX_KEY_SIZE,
+			.ivsize		= AES_BLOCK_SIZE,
+			.setkey		= aesbs_set_key,
+			.encrypt	= cbc_encrypt,
+			.decrypt	= cbc_decrypt,
+		},
+	},
+};
+
+#ifdef HAS_CTR
+static int ctr_crypt(struct blkcipher_desc *desc,
+		     struct scatterlist *dst, struct scatterlist *src,
+		     unsigned int nbytes)
+{
+	struct aesbs_ctx *ctx = crypto_blkcipher_ctx(desc->tfm);
+	struct blkcipher_walk walk;
+	u8 ks[AESBS_BATCH];
+	int err;
+
+	blkcipher_walk_init(&walk, dst, src, nbytes);
+	err = blkcipher_walk_virt_block(desc, &walk, AES_BLOCK_SIZE);
+
+	while ((nbytes = walk.nbytes) >= AES_BLOCK_SIZE) {
+		u8 *s = walk.src.virt.addr;
+		u8 *d = walk.dst.virt.addr;
+
+		kernel_neon_begin();
+		while (nbytes >= AES_BLOCK_SIZE) {
+			unsigned int blocks = min_t(unsigned int,
+						    nbytes / AES_BLOCK_SIZE,
+						    AESBS_BLOCKS);
+			unsigned int len = blocks * AES_BLOCK_SIZE;
+			unsigned int i;
+
+			for (i = 0; i < len; i += AES_BLOCK_SIZE) {
+				memcpy(ks + i, walk.iv, AES_BLOCK_SIZE);
+				crypto_inc(walk.iv, AES_BLOCK_SIZE);
+			}
+			aesbs_encrypt_blocks(ctx, ks, ks, blocks);
+			crypto_xor(ks, s, len);
+			memcpy(d, ks, len);
+			s += len;
+			d += len;
+			nbytes -= len;
+		}
+		kernel_neon_end();
+		err = blkcipher_walk_done(desc, &walk, nbytes);
+	}
+
+	if (walk.nbytes) {
+		crypto_aes_encrypt_arm(&ctx->aes, ks, walk.iv);
+		crypto_xor(ks, walk.src.virt.addr, walk.nbytes);
+		memcpy(walk.dst.virt.addr, ks, walk.nbytes);
+		crypto_inc(walk.iv, AES_BLOCK_SIZE);
+		err = blkcipher_walk_done(desc, &walk, 0);
+	}
+
+	return err;
+}
+
+static struct crypto_alg blk_ctr_alg = {
+	.cra_name		= "__ctr-aes-neonbs",
+	.cra_driver_name	= "__driver-ctr-aes-neonbs",
+	.cra_priority		= 0,
+	.cra_flags		= CRYPTO_ALG_TYPE_BLKCIPHER,
+	.cra_blocksize		= 1,
+	.cra_ctxsize		= sizeof(struct aesbs_ctx),
+	.cra_alignmask		= 0,
+	.cra_type		= &crypto_blkcipher_type,
+	.cra_module		= THIS_MODULE,
+	.cra_list		= LIST_HEAD_INIT(blk_ctr_alg.cra_list),
+	.cra_u = {
+		.blkcipher = {
+			.min_keysize	= AES_MIN_KEY_SIZE,
+			.max_keysize	= AES_MAX_KEY_SIZE,
+			.ivsize		= AES_BLOCK_SIZE,
+			.setkey		= aesbs_set_key,
+			.encrypt	= ctr_crypt,
+			.decrypt	= ctr_crypt,
+		},
+	},
+};
+#endif
+
+#ifdef HAS_XTS
+static int xts_set_key(struct crypto_tfm *tfm, const u8 *in_key,
+		       unsigned int key_len)
+{
+	struct aesbs_xts_ctx *ctx = crypto_tfm_ctx(tfm);
+	u32 *flags = &tfm->crt_flags;
+	int err;
+
+	/* key consists of keys of equal size concatenated */
+	if (key_len % 2) {
+		*flags |= CRYPTO_TFM_RES_BAD_KEY_LEN;
+		return -EINVAL;
+	}
+	key_len /= 2;
+
+	err = crypto_aes_expand_key(&ctx->twkey, in_key + key_len, key_len);
+	if (err) {
+		*flags |= CRYPTO_TFM_RES_BAD_KEY_LEN;
+		return err;
+	}
+	return aesbs_expand_key(&ctx->key, flags, in_key, key_len);
+}
+
+static int xts_crypt(struct blkcipher_desc *desc,
+		     struct scatterlist *dst, struct scatterlist *src,
+		     unsigned int nbytes, int enc)
+{
+	struct aesbs_xts_ctx *ctx = crypto_blkcipher_ctx(desc->tfm);
+	struct blkcipher_walk walk;
+	u8 buf[AESBS_BATCH];
+	be128 t[AESBS_BLOCKS];
+	be128 tw;
+	int err;
+
+	blkcipher_walk_init(&walk, dst, src, nbytes);
+	err = blkcipher_walk_virt(desc, &walk);
+	if (!walk.nbytes)
+		return err;
+
+	/* first tweak; walk.iv may not be aligned, so work on a copy */
+	crypto_aes_encrypt_arm(&ctx->twkey, (u8 *)&tw, walk.iv);
+
+	while ((nbytes = walk.nbytes)) {
+		u8 *s = walk.src.virt.addr;
+		u8 *d = walk.dst.virt.addr;
+
+		kernel_neon_begin();
+		while (nbytes >= AES_BLOCK_SIZE) {
+			unsigned int blocks = min_t(unsigned int,
+						    nbytes / AES_BLOCK_SIZE,
+						    AESBS_BLOCKS);
+			unsigned int len = blocks * AES_BLOCK_SIZE;
+			unsigned int i;
+
+			for (i = 0; i < blocks; i++) {
+				t[i] = tw;
+				gf128mul_x_ble(&tw, &t[i]);
+			}
+			memcpy(buf, s, len);
+			crypto_xor(buf, (u8 *)t, len);
+			if (enc)
+				aesbs_encrypt_blocks(&ctx->key, buf, buf, blocks);
+			else
+				aesbs_decrypt_blocks(&ctx->key, buf, buf, blocks);
+			crypto_xor(buf, (u8 *)t, len);
+			memcpy(d, buf, len);
+			s += len;
+			d += len;
+			nbytes -= len;
+		}
+		kernel_neon_end();
+		err = blkcipher_walk_done(desc, &walk, nbytes);
+	}
+
+	return err;
+}
+
+static int xts_encrypt(struct blkcipher_desc *desc,
+		       struct scatterlist *dst, struct scatterlist *src,
+		       unsigned int nbytes)
+{
+	return xts_crypt(desc, dst, src, nbytes, 1);
+}
+
+static int xts_decrypt(struct blkcipher_desc *desc,
+		       struct scatterlist *dst, struct scatterlist *src,
+		       unsigned int nbytes)
+{
+	return xts_crypt(desc, dst, src, nbytes, 0);
+}
+
+static struct crypto_alg blk_xts_alg = {
+	.cra_name		= "__xts-aes-neonbs",
+	.cra_driver_name	= "__driver-xts-aes-neonbs",
+	.cra_priority		= 0,
+	.cra_flags		= CRYPTO_ALG_TYPE_BLKCIPHER,
+	.cra_blocksize		= AES_BLOCK_SIZE,
+	.cra_ctxsize		= sizeof(struct aesbs_xts_ctx),
+	.cra_alignmask		= 0,
+	.cra_type		= &crypto_blkcipher_type,
+	.cra_module		= THIS_MODULE,
+	.cra_list		= LIST_HEAD_INIT(blk_xts_alg.cra_list),
+	.cra_u = {
+		.blkcipher = {
+			.min_keysize	= 2 * AES_MIN_KEY_SIZE,
+			.max_keysize	= 2 * AES_MAX_KEY_SIZE,
+			.ivsize		= AES_BLOCK_SIZE,
+			.setkey		= xts_set_key,
+			.encrypt	= xts_encrypt,
+			.decrypt	= xts_decrypt,
+		},
+	},
+};
+#endif
+
+/*
+ * The async wrappers below call the NEON blkciphers directly in process
+ * context, and go through cryptd otherwise, since NEON is not usable
+ * from interrupts.
+ */
+static int ablk_set_key(struct crypto_ablkcipher *tfm, const u8 *key,
+			unsigned int key_len)
+{
+	struct async_aes_ctx *ctx = crypto_ablkcipher_ctx(tfm);
+	struct crypto_ablkcipher *child = &ctx->cryptd_tfm->base;
+	int err;
+
+	crypto_ablkcipher_clear_flags(child, CRYPTO_TFM_REQ_MASK);
+	crypto_ablkcipher_set_flags(child, crypto_ablkcipher_get_flags(tfm)
+				    & CRYPTO_TFM_REQ_MASK);
+	err = crypto_ablkcipher_setkey(child, key, key_len);
+	crypto_ablkcipher_set_flags(tfm, crypto_ablkcipher_get_flags(child)
+				    & CRYPTO_TFM_RES_MASK);
+	return err;
+}
+
+static int ablk_encrypt(struct ablkcipher_request *req)
+{
+	struct crypto_ablkcipher *tfm = crypto_ablkcipher_reqtfm(req);
+	struct async_aes_ctx *ctx = crypto_ablkcipher_ctx(tfm);
+
+	if (in_interrupt()) {
+		struct ablkcipher_request *cryptd_req =
+			ablkcipher_request_ctx(req);
+		memcpy(cryptd_req, req, sizeof(*req));
+		ablkcipher_request_set_tfm(cryptd_req, &ctx->cryptd_tfm->base);
+		return crypto_ablkcipher_encrypt(cryptd_req);
+	} else {
+		struct blkcipher_desc desc;
+		desc.tfm = cryptd_ablkcipher_child(ctx->cryptd_tfm);
+		desc.info = req->info;
+		desc.flags = 0;
+		return crypto_blkcipher_crt(desc.tfm)->encrypt(
+			&desc, req->dst, req->src, req->nbytes);
+	}
+}
+
+static int ablk_decrypt(struct ablkcipher_request *req)
+{
+	struct crypto_ablkcipher *tfm = crypto_ablkcipher_reqtfm(req);
+	struct async_aes_ctx *ctx = crypto_ablkcipher_ctx(tfm);
+
+	if (in_interrupt()) {
+		struct ablkcipher_request *cryptd_req =
+			ablkcipher_request_ctx(req);
+		memcpy(cryptd_req, req, sizeof(*req));
+		ablkcipher_request_set_tfm(cryptd_req, &ctx->cryptd_tfm->base);
+		return crypto_ablkcipher_decrypt(cryptd_req);
+	} else {
+		struct blkcipher_desc desc;
+		desc.tfm = cryptd_ablkcipher_child(ctx->cryptd_tfm);
+		desc.info = req->info;
+		desc.flags = 0;
+		return crypto_blkcipher_crt(desc.tfm)->decrypt(
+			&desc, req->dst, req->src, req->nbytes);
+	}
+}
+
+static void ablk_exit(struct crypto_tfm *tfm)
+{
+	struct async_aes_ctx *ctx = crypto_tfm_ctx(tfm);
+
+	cryptd_free_ablkcipher(ctx->cryptd_tfm);
+}
+
+static int ablk_init_common(struct crypto_tfm *tfm, const char *drv_name)
+{
+	struct async_aes_ctx *ctx = crypto_tfm_ctx(tfm);
+	struct cryptd_ablkcipher *cryptd_tfm;
+
+	cryptd_tfm = cryptd_alloc_ablkcipher(drv_name, 0, 0);
+	if (IS_ERR(cryptd_tfm))
+		return PTR_ERR(cryptd_tfm);
+
+	ctx->cryptd_tfm = cryptd_tfm;
+	tfm->crt_ablkcipher.reqsize = sizeof(struct ablkcipher_request) +
+		crypto_ablkcipher_reqsize(&cryptd_tfm->base);
+	return 0;
+}
+
+static int ablk_cbc_init(struct crypto_tfm *tfm)
+{
+	return ablk_init_common(tfm, "__driver-cbc-aes-neonbs");
+}
+
+static struct crypto_alg ablk_cbc_alg = {
+	.cra_name		= "cbc(aes)",
+	.cra_driver_name	= "cbc-aes-neonbs",
+	.cra_priority		= 300,
+	.cra_flags		= CRYPTO_ALG_TYPE_ABLKCIPHER|CRYPTO_ALG_ASYNC,
+	.cra_blocksize		= AES_BLOCK_SIZE,
+	.cra_ctxsize		= sizeof(struct async_aes_ctx),
+	.cra_alignmask		= 0,
+	.cra_type		= &crypto_ablkcipher_type,
+	.cra_module		= THIS_MODULE,
+	.cra_list		= LIST_HEAD_INIT(ablk_cbc_alg.cra_list),
+	.cra_init		= ablk_cbc_init,
+	.cra_exit		= ablk_exit,
+	.cra_u = {
+		.ablkcipher = {
+			.min_keysize	= AES_MIN_KEY_SIZE,
+			.max_keysize	= AES_MAX_KEY_SIZE,
+			.ivsize		= AES_BLOCK_SIZE,
+			.setkey		= ablk_set_key,
+			.encrypt	= ablk_encrypt,
+			.decrypt	= ablk_decrypt,
+		},
+	},
+};
+
+#ifdef HAS_CTR
+static int ablk_ctr_init(struct crypto_tfm *tfm)
+{
+	return ablk_init_common(tfm, "__driver-ctr-aes-neonbs");
+}
+
+static struct crypto_alg ablk_ctr_alg = {
+	.cra_name		= "ctr(aes)",
+	.cra_driver_name	= "ctr-aes-neonbs",
+	.cra_priority		= 300,
+	.cra_flags		= CRYPTO_ALG_TYPE_ABLKCIPHER|CRYPTO_ALG_ASYNC,
+	.cra_blocksize		= 1,
+	.cra_ctxsize		= sizeof(struct async_aes_ctx),
+	.cra_alignmask		= 0,
+	.cra_type		= &crypto_ablkcipher_type,
+	.cra_module		= THIS_MODULE,
+	.cra_list		= LIST_HEAD_INIT(ablk_ctr_alg.cra_list),
+	.cra_init		= ablk_ctr_init,
+	.cra_exit		= ablk_exit,
+	.cra_u = {
+		.ablkcipher = {
+			.min_keysize	= AES_MIN_KEY_SIZE,
+			.max_keysize	= AES_MAX_KEY_SIZE,
+			.ivsize		= AES_BLOCK_SIZE,
+			.setkey		= ablk_set_key,
+			.encrypt	= ablk_encrypt,
+			.decrypt	= ablk_decrypt,
+			.geniv		= "chainiv",
+		},
+	},
+};
+#endif
+
+#ifdef HAS_XTS
+static int ablk_xts_init(struct crypto_tfm *tfm)
+{
+	return ablk_init_common(tfm, "__driver-xts-aes-neonbs");
+}
+
+static struct crypto_alg ablk_xts_alg = {
+	.cra_name		= "xts(aes)",
+	.cra_driver_name	= "xts-aes-neonbs",
+	.cra_priority		= 300,
+	.cra_flags		= CRYPTO_ALG_TYPE_ABLKCIPHER|CRYPTO_ALG_ASYNC,
+	.cra_blocksize		= AES_BLOCK_SIZE,
+	.cra_ctxsize		= sizeof(struct async_aes_ctx),
+	.cra_alignmask		= 0,
+	.cra_type		= &crypto_ablkcipher_type,
+	.cra_module		= THIS_MODULE,
+	.cra_list		= LIST_HEAD_INIT(ablk_xts_alg.cra_list),
+	.cra_init		= ablk_xts_init,
+	.cra_exit		= ablk_exit,
+	.cra_u = {
+		.ablkcipher = {
+			.min_keysize	= 2 * AES_MIN_KEY_SIZE,
+			.max_keysize	= 2 * AES_MAX_KEY_SIZE,
+			.ivsize		= AES_BLOCK_SIZE,
+			.setkey		= ablk_set_key,
+			.encrypt	= ablk_encrypt,
+			.decrypt	= ablk_decrypt,
+		},
+	},
+};
+#endif
+
+static int __init aesbs_init(void)
+{
+	int err;
+
+	if (!cpu_has_neon())
+		return -ENODEV;
+
+	if ((err = crypto_register_alg(&blk_cbc_alg)))
+		goto blk_cbc_err;
+#ifdef HAS_CTR
+	if ((err = crypto_register_alg(&blk_ctr_alg)))
+		goto blk_ctr_err;
+#endif
+#ifdef HAS_XTS
+	if ((err = crypto_register_alg(&blk_xts_alg)))
+		goto blk_xts_err;
+#endif
+	if ((err = crypto_register_alg(&ablk_cbc_alg)))
+		goto ablk_cbc_err;
+#ifdef HAS_CTR
+	if ((err = crypto_register_alg(&ablk_ctr_alg)))
+		goto ablk_ctr_err;
+#endif
+#ifdef HAS_XTS
+	if ((err = crypto_register_alg(&ablk_xts_alg)))
+		goto ablk_xts_err;
+#endif
+
+	return err;
+
+#ifdef HAS_XTS
+ablk_xts_err:
+#endif
+#ifdef HAS_CTR
+	crypto_unregister_alg(&ablk_ctr_alg);
+ablk_ctr_err:
+#endif
+	crypto_unregister_alg(&ablk_cbc_alg);
+ablk_cbc_err:
+#ifdef HAS_XTS
+	crypto_unregister_alg(&blk_xts_alg);
+blk_xts_err:
+#endif
+#ifdef HAS_CTR
+	crypto_unregister_alg(&blk_ctr_alg);
+blk_ctr_err:
+#endif
+	crypto_unregister_alg(&blk_cbc_alg);
+blk_cbc_err:
+	return err;
+}
+
+static void __exit aesbs_exit(void)
+{
+#ifdef HAS_XTS
+	crypto_unregister_alg(&ablk_xts_alg);
+#endif
+#ifdef HAS_CTR
+	crypto_unregister_alg(&ablk_ctr_alg);
+#endif
+	crypto_unregister_alg(&ablk_cbc_alg);
+#ifdef HAS_XTS
+	crypto_unregister_alg(&blk_xts_alg);
+#endif
+#ifdef HAS_CTR
+	crypto_unregister_alg(&blk_ctr_alg);
+#endif
+	crypto_unregister_alg(&blk_cbc_alg);
+}
+
+module_init(aesbs_init);
+module_exit(aesbs_exit);
+
+MODULE_DESCRIPTION("Rijndael (AES) Cipher Algorithm, bit sliced NEON (CBC, CTR, XTS)");
+MODULE_LICENSE("GPL");
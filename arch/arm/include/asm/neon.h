@@ -0,0 +1,36 @@
+/*
+ * linux/arch/arm/include/asm/neon.h
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+#ifndef __ASM_ARM_NEON_H
+#define __ASM_ARM_NEON_H
+
+#include <linux/percpu.h>
+#include <asm/hwcap.h>
+
+#define cpu_has_neon()		(!!(elf_hwcap & HWCAP_NEON))
+
+/*
+ * Kernel code may use NEON only between kernel_neon_begin() and
+ * kernel_neon_end(), in process context. kernel_neon_begin() saves the
+ * user VFP/NEON state owned by this CPU and disables preemption until
+ * kernel_neon_end(), so the section must not sleep. The NEON registers
+ * do not survive kernel_neon_end().
+ */
+void kernel_neon_begin(void);
+void kernel_neon_end(void);
+
+/*
+ * Sections may nest, but an inner one clobbers the NEON registers of the
+ * outer one. Code which does not own the registers, like the NEON copy
+ * routines, checks this first and does without NEON if it is set. Since
+ * a section runs with preemption disabled, the answer cannot change under
+ * a caller which is not in one.
+ */
+DECLARE_PER_CPU(unsigned int, kernel_neon_depth);
+#define kernel_neon_busy()	(__raw_get_cpu_var(kernel_neon_depth) != 0)
+
+#endif /* __ASM_ARM_NEON_H */
@@ -0,0 +1,172 @@
+/*
+ *  linux/arch/arm/lib/copy_neon_glue.c
+ *
+ *  Dispatch of large copies to NEON.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * memcpy(), copy_page(), __copy_to_user() and __copy_from_user() branch
+ * here when the size is at least neon_copy_threshold, which stays ~0UL
+ * (never) until the CPU has been found to have NEON. Everything not
+ * copied in 64 byte NEON blocks, including whatever is left after a user
+ * fault, is finished by the plain ARM routines. So is any copy made from
+ * interrupt context or from inside another kernel mode NEON section, whose
+ * registers must not be clobbered.
+ *
+ * A NEON section holds off preemption, so long copies leave it every
+ * NEON_COPY_CHUNK bytes to let a waiting task in.
+ */
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/init.h>
+#include <linux/hardirq.h>
+#include <linux/suspend.h>
+#include <linux/uaccess.h>
+#include <asm/neon.h>
+
+#undef MODULE_PARAM_PREFIX
+#define MODULE_PARAM_PREFIX "neon_copy."
+
+#define NEON_COPY_CHUNK		4096
+
+unsigned long neon_copy_threshold = ~0UL;
+
+static unsigned long threshold = 1024;
+module_param(threshold, ulong, 0444);
+MODULE_PARM_DESC(threshold, "Smallest copy done with NEON, in bytes");
+
+extern size_t __neon_copy_blocks(void *to, const void *from, size_t n);
+extern void *__memcpy_arm(void *to, const void *from, size_t n);
+extern void __copy_page_arm(void *to, const void *from);
+extern unsigned long __copy_to_user_std(void __user *to, const void *from,
+					unsigned long n);
+extern unsigned long __copy_from_user_std(void *to, const void __user *from,
+					  unsigned long n);
+
+/*
+ * Copies in NEON sections of at most NEON_COPY_CHUNK bytes. Returns how
+ * much is left for the ARM routine: the tail below a block, or everything
+ * from a block which faulted. A fault cannot be serviced inside the NEON
+ * section, so for user copies page faults are disabled along with it.
+ */
+static size_t neon_copy_chunks(void *to, const void *from, size_t n,
+			       int user)
+{
+	size_t chunk, done;
+
+	while (n >= 64) {
+		chunk = min_t(size_t, n, NEON_COPY_CHUNK);
+
+		if (user)
+			pagefault_disable();
+		kernel_neon_begin();
+		done = chunk - __neon_copy_blocks(to, from, chunk);
+		kernel_neon_end();
+		if (user)
+			pagefault_enable();
+
+		to += done;
+		from += done;
+		n -= done;
+		if (done != chunk)
+			break;
+	}
+	return n;
+}
+
+void *memcpy_neon(void *to, const void *from, size_t n)
+{
+	size_t left;
+
+	if (in_interrupt() || kernel_neon_busy())
+		return __memcpy_arm(to, from, n);
+
+	left = neon_copy_chunks(to, from, n, 0);
+	if (left)
+		__memcpy_arm(to + n - left, from + n - left, left);
+	return to;
+}
+
+void copy_page_neon(void *to, const void *from)
+{
+	if (in_interrupt() || kernel_neon_busy()) {
+		__copy_page_arm(to, from);
+		return;
+	}
+
+	kernel_neon_begin();
+	__neon_copy_blocks(to, from, PAGE_SIZE);
+	kernel_neon_end();
+}
+
+/*
+ * After a fault the ARM routine takes over from the faulting block, this
+ * time able to sleep, fault pages in and zero a failed tail.
+ */
+unsigned long copy_to_user_neon(void __user *to, const void *from,
+				unsigned long n)
+{
+	unsigned long left;
+
+	if (in_interrupt() || kernel_neon_busy())
+		return __copy_to_user_std(to, from, n);
+
+	left = neon_copy_chunks((void __force *)to, from, n, 1);
+	if (left)
+		left = __copy_to_user_std(to + n - left, from + n - left, left);
+	return left;
+}
+
+unsigned long copy_from_user_neon(void *to, const void __user *from,
+				  unsigned long n)
+{
+	unsigned long left;
+
+	if (in_interrupt() || kernel_neon_busy())
+		return __copy_from_user_std(to, from, n);
+
+	left = neon_copy_chunks(to, (const void __force *)from, n, 1);
+	if (left)
+		left = __copy_from_user_std(to + n - left, from + n - left, left);
+	return left;
+}
+
+/*
+ * VFP access is only restored by the VFP resume hook, so keep to the ARM
+ * routines for the whole suspend/resume cycle.
+ */
+static int neon_copy_pm_notify(struct notifier_block *nb,
+			       unsigned long event, void *unused)
+{
+	switch (event) {
+	case PM_HIBERNATION_PREPARE:
+	case PM_SUSPEND_PREPARE:
+		neon_copy_threshold = ~0UL;
+		break;
+	case PM_POST_HIBERNATION:
+	case PM_POST_SUSPEND:
+		neon_copy_threshold = max(threshold, 64UL);
+		break;
+	}
+	return NOTIFY_DONE;
+}
+
+static struct notifier_block neon_copy_pm_nb = {
+	.notifier_call	= neon_copy_pm_notify,
+};
+
+static int __init neon_copy_init(void)
+{
+	if (!cpu_has_neon())
+		return 0;
+
+	neon_copy_threshold = max(threshold, 64UL);
+	register_pm_notifier(&neon_copy_pm_nb);
+	printk(KERN_INFO "NEON: using NEON for copies of %lu bytes and up\n",
+	       neon_copy_threshold);
+	return 0;
+}
+/* HWCAP_NEON is set by vfp_init(), a plain late_initcall */
+late_initcall_sync(neon_copy_init);
@@ -37,6 +37,8 @@ extern bool dbll_get_c_addr(struct dbll_library_obj *lib, char *name,
 extern dsp_status dbll_get_sect(struct dbll_library_obj *lib, char *name,
 				u32 *paddr, u32 *psize);
 extern bool dbll_init(void);
+extern void dbll_invalidate(struct dbll_tar_obj *target, u32 addr,
+			    u32 size);
 extern dsp_status dbll_load(struct dbll_library_obj *lib,
 			    dbll_flags flags,
 			    struct dbll_attrs *attrs, u32 * pEntry);
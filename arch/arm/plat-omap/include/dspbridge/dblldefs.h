@@ -96,6 +96,25 @@ typedef bool(*dbll_free_fxn) (void *hdl, u32 addr, s32 space, u32 size,
  */
 typedef void *(*dbll_f_open_fxn) (const char *, const char *);
 
+/*
+ *  ======== dbll_file_stamp ========
+ *  Identity of the contents of an open file: changes whenever the file is
+ *  replaced or rewritten.
+ */
+struct dbll_file_stamp {
+	u32 ino;
+	u32 size;
+	u32 mtime_sec;
+	u32 mtime_nsec;
+};
+
+/*
+ *  ======== dbll_f_stamp_fxn ========
+ *  Fill in the stamp of an open file. Returns 0 on success. Can be NULL,
+ *  in which case no relocated images are cached.
+ */
+typedef s32(*dbll_f_stamp_fxn) (void *, struct dbll_file_stamp *);
+
 /*
  *  ======== dbll_log_write_fxn ========
  *  Function to call when writing data from a section, to log the info.
@@ -173,6 +192,7 @@ struct dbll_attrs {
 	 s32(*ftell) (void *);
 	 s32(*fclose) (void *);
 	void *(*fopen) (const char *, const char *);
+	dbll_f_stamp_fxn fstamp;
 };
 
 /*
@@ -326,6 +346,24 @@ typedef dsp_status(*dbll_get_sect_fxn) (struct dbll_library_obj *lib,
  */
 typedef bool(*dbll_init_fxn) (void);
 
+/*
+ *  ======== dbll_invalidate ========
+ *  Drop the cached, relocated library images that write to target memory
+ *  in [addr, addr + size), e.g. because that memory has been reassigned
+ *  to an overlay.
+ *  Parameters:
+ *      target          - Handle returned from dbll_create().
+ *      addr            - Start of the reassigned target memory.
+ *      size            - Size of the reassigned target memory.
+ *  Returns:
+ *  Requires:
+ *      DBL initialized.
+ *      Valid target.
+ *  Ensures:
+ */
+typedef void (*dbll_invalidate_fxn) (struct dbll_tar_obj *target,
+				     u32 addr, u32 size);
+
 /*
  *  ======== dbll_load ========
  *  Load library onto the target.
@@ -494,6 +532,7 @@ struct dbll_fxns {
 	dbll_set_attrs_fxn set_attrs_fxn;
 	dbll_unload_fxn unload_fxn;
 	dbll_unload_sect_fxn unload_sect_fxn;
+	dbll_invalidate_fxn invalidate_fxn;
 };
 
 #endif /* DBLDEFS_ */
@@ -489,6 +489,26 @@ struct dynamic_loader_initialize {
     ************************************************************************ */
 	void (*release) (struct dynamic_loader_initialize *thisptr);
 
+    /*************************************************************************
+    * Function cached_image
+    *
+    * Parameters:
+    *   done        FALSE before the image data is read, TRUE afterwards
+    *
+    * Effect:
+    *   Called with done == FALSE once all sections are allocated and all
+    * symbols are resolved, just before the image packets are read.  If the
+    * client already holds the relocated image for this module at these
+    * addresses and has written it to the target, it returns TRUE and the
+    * loader skips reading, relocating and writing the image.  Called again
+    * with done == TRUE when the image has been placed either way.
+    *
+    * Notes:
+    *   This function is optional and may be NULL.
+    ************************************************************************ */
+	int (*cached_image) (struct dynamic_loader_initialize *thisptr,
+			     int done);
+
 };				/* class dynamic_loader_initialize */
 
 #endif /* _DYNAMIC_LOADER_H_ */
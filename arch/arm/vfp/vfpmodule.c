@@ -17,6 +17,7 @@
 
 #include <asm/thread_notify.h>
 #include <asm/vfp.h>
+#include <asm/neon.h>
 
 #include "vfpinstr.h"
 #include "vfp.h"
@@ -474,6 +475,67 @@ out:
 }
 #endif
 
+#ifdef CONFIG_KERNEL_MODE_NEON
+
+/*
+ * Kernel-side NEON support functions
+ */
+
+/* Nesting depth of kernel mode NEON sections on each CPU */
+DEFINE_PER_CPU(unsigned int, kernel_neon_depth);
+EXPORT_PER_CPU_SYMBOL(kernel_neon_depth);
+
+void kernel_neon_begin(void)
+{
+	unsigned int cpu;
+	u32 fpexc;
+
+	/*
+	 * Kernel mode NEON is only allowed outside of interrupt context
+	 * and with preemption disabled, so the kernel's own register
+	 * contents never have to be preserved.
+	 */
+	BUG_ON(in_interrupt());
+	cpu = get_cpu();
+
+	/* An inner section finds the unit enabled and the state saved */
+	if (per_cpu(kernel_neon_depth, cpu)++)
+		return;
+
+	fpexc = fmrx(FPEXC) | FPEXC_EN;
+	fmxr(FPEXC, fpexc);
+
+	/*
+	 * Save the state loaded on this CPU (on UP it may belong to a
+	 * thread other than current) and force a reload on its next use.
+	 */
+	if (last_VFP_context[cpu]) {
+		vfp_save_state(last_VFP_context[cpu], fpexc);
+#ifdef CONFIG_SMP
+		last_VFP_context[cpu]->hard.cpu = cpu;
+#endif
+		last_VFP_context[cpu] = NULL;
+	}
+
+	/* run without any pending user exception state */
+	fmxr(FPEXC, FPEXC_EN);
+}
+EXPORT_SYMBOL(kernel_neon_begin);
+
+void kernel_neon_end(void)
+{
+	/*
+	 * Once the outermost section ends, disable the unit so that the
+	 * next user access reloads its state.
+	 */
+	if (!--__get_cpu_var(kernel_neon_depth))
+		fmxr(FPEXC, fmrx(FPEXC) & ~FPEXC_EN);
+	put_cpu();
+}
+EXPORT_SYMBOL(kernel_neon_end);
+
+#endif /* CONFIG_KERNEL_MODE_NEON */
+
 #include <linux/smp.h>
 
 /*
@@ -0,0 +1,495 @@
+/*
+ *  Flash i/o scheduler.
+ *
+ *  Based on the deadline i/o scheduler,
+ *  Copyright (C) 2002 Jens Axboe <axboe@kernel.dk>
+ *
+ *  Flash has no seek penalty, so there is nothing to gain from idling or
+ *  from sorting reads, but writes are much slower than reads and the
+ *  translation layer underneath does best when writes arrive grouped by
+ *  erase block. This scheduler keeps two classes of requests:
+ *
+ *  - sync requests (reads and synchronous writes) are served in FIFO
+ *    order, ahead of
+ *  - async writes, which are dispatched in batches, each batch covering
+ *    one erase block in ascending sector order, sweeping upwards through
+ *    the device.
+ *
+ *  Writes are never starved for longer than writes_starved sync requests
+ *  or write_expire, whichever comes first.
+ */
+#include <linux/kernel.h>
+#include <linux/fs.h>
+#include <linux/blkdev.h>
+#include <linux/elevator.h>
+#include <linux/bio.h>
+#include <linux/module.h>
+#include <linux/slab.h>
+#include <linux/init.h>
+#include <linux/compiler.h>
+#include <linux/rbtree.h>
+
+/*
+ * See Documentation/block/flash-iosched.txt
+ */
+static const int write_expire = HZ;	/* max time before an async write is submitted */
+static const int writes_starved = 16;	/* max sync requests served while writes wait */
+static const int write_batch = 32;	/* max writes dispatched per erase block batch */
+static const int erase_block_kb = 128;	/* used if the queue gives no io_opt */
+
+enum { FLASH_SYNC, FLASH_ASYNC };
+
+struct flash_data {
+	/*
+	 * run time data
+	 */
+
+	/*
+	 * requests are present on both sort_list and fifo_list of their class
+	 */
+	struct rb_root sort_list[2];
+	struct list_head fifo_list[2];
+
+	/*
+	 * next async write in sort order, NULL if none beyond the last one
+	 */
+	struct request *next_write;
+	sector_t batch_block;		/* erase block of the current batch */
+	unsigned int write_batching;	/* writes dispatched in this batch */
+	unsigned int starved;		/* sync requests served while writes waited */
+
+	/*
+	 * settings that change how the i/o scheduler behaves
+	 */
+	int write_expire;
+	int writes_starved;
+	int write_batch;
+	int erase_block_kb;
+	int front_merges;
+};
+
+static inline int flash_rq_class(struct request *rq)
+{
+	return rq_is_sync(rq) ? FLASH_SYNC : FLASH_ASYNC;
+}
+
+static inline int flash_bio_class(struct bio *bio)
+{
+	if (bio_data_dir(bio) == READ || bio_rw_flagged(bio, BIO_RW_SYNCIO))
+		return FLASH_SYNC;
+	return FLASH_ASYNC;
+}
+
+static inline struct rb_root *
+flash_rb_root(struct flash_data *fd, struct request *rq)
+{
+	return &fd->sort_list[flash_rq_class(rq)];
+}
+
+/*
+ * get the request after `rq' in sector-sorted order
+ */
+static inline struct request *
+flash_latter_request(struct request *rq)
+{
+	struct rb_node *node = rb_next(&rq->rb_node);
+
+	if (node)
+		return rb_entry_rq(node);
+
+	return NULL;
+}
+
+static inline struct request *
+flash_former_request(struct request *rq)
+{
+	struct rb_node *node = rb_prev(&rq->rb_node);
+
+	if (node)
+		return rb_entry_rq(node);
+
+	return NULL;
+}
+
+/*
+ * erase block number of a sector
+ */
+static inline sector_t flash_erase_block(struct flash_data *fd, sector_t sector)
+{
+	sector_div(sector, fd->erase_block_kb << 1);
+	return sector;
+}
+
+static void flash_move_to_dispatch(struct flash_data *fd, struct request *rq);
+
+static void
+flash_add_rq_rb(struct flash_data *fd, struct request *rq)
+{
+	struct rb_root *root = flash_rb_root(fd, rq);
+	struct request *__alias;
+
+	while (unlikely(__alias = elv_rb_add(root, rq)))
+		flash_move_to_dispatch(fd, __alias);
+}
+
+static inline void
+flash_del_rq_rb(struct flash_data *fd, struct request *rq)
+{
+	if (fd->next_write == rq)
+		fd->next_write = flash_latter_request(rq);
+
+	elv_rb_del(flash_rb_root(fd, rq), rq);
+}
+
+/*
+ * add rq to rbtree and fifo
+ */
+static void
+flash_add_request(struct request_queue *q, struct request *rq)
+{
+	struct flash_data *fd = q->elevator->elevator_data;
+	const int class = flash_rq_class(rq);
+
+	flash_add_rq_rb(fd, rq);
+
+	/*
+	 * set expire time and add to fifo list; sync requests are served
+	 * in fifo order, so their expire time is only informative
+	 */
+	rq_set_fifo_time(rq, jiffies + fd->write_expire);
+	list_add_tail(&rq->queuelist, &fd->fifo_list[class]);
+}
+
+/*
+ * remove rq from rbtree and fifo.
+ */
+static void flash_remove_request(struct request_queue *q, struct request *rq)
+{
+	struct flash_data *fd = q->elevator->elevator_data;
+
+	rq_fifo_clear(rq);
+	flash_del_rq_rb(fd, rq);
+}
+
+static int
+flash_merge(struct request_queue *q, struct request **req, struct bio *bio)
+{
+	struct flash_data *fd = q->elevator->elevator_data;
+	struct request *__rq;
+
+	/*
+	 * check for front merge
+	 */
+	if (fd->front_merges) {
+		sector_t sector = bio->bi_sector + bio_sectors(bio);
+
+		__rq = elv_rb_find(&fd->sort_list[flash_bio_class(bio)], sector);
+		if (__rq) {
+			BUG_ON(sector != blk_rq_pos(__rq));
+
+			if (elv_rq_merge_ok(__rq, bio)) {
+				*req = __rq;
+				return ELEVATOR_FRONT_MERGE;
+			}
+		}
+	}
+
+	return ELEVATOR_NO_MERGE;
+}
+
+/*
+ * Keep classes apart, or a sync bio could wait behind an async batch.
+ */
+static int flash_allow_merge(struct request_queue *q, struct request *rq,
+			     struct bio *bio)
+{
+	return flash_bio_class(bio) == flash_rq_class(rq);
+}
+
+static void flash_merged_request(struct request_queue *q,
+				 struct request *req, int type)
+{
+	struct flash_data *fd = q->elevator->elevator_data;
+
+	/*
+	 * if the merge was a front merge, we need to reposition request
+	 */
+	if (type == ELEVATOR_FRONT_MERGE) {
+		flash_del_rq_rb(fd, req);
+		flash_add_rq_rb(fd, req);
+	}
+}
+
+static void
+flash_merged_requests(struct request_queue *q, struct request *req,
+		      struct request *next)
+{
+	/*
+	 * if next expires before rq, assign its expire time to rq
+	 * and move into next position (next will be deleted) in fifo
+	 */
+	if (!list_empty(&req->queuelist) && !list_empty(&next->queuelist) &&
+	    flash_rq_class(req) == flash_rq_class(next)) {
+		if (time_before(rq_fifo_time(next), rq_fifo_time(req))) {
+			list_move(&req->queuelist, &next->queuelist);
+			rq_set_fifo_time(req, rq_fifo_time(next));
+		}
+	}
+
+	/*
+	 * kill knowledge of next, this one is a goner
+	 */
+	flash_remove_request(q, next);
+}
+
+/*
+ * move request from sort list to dispatch queue.
+ */
+static void
+flash_move_to_dispatch(struct flash_data *fd, struct request *rq)
+{
+	struct request_queue *q = rq->q;
+
+	if (flash_rq_class(rq) == FLASH_ASYNC)
+		fd->next_write = flash_latter_request(rq);
+
+	flash_remove_request(q, rq);
+	elv_dispatch_add_tail(q, rq);
+}
+
+/*
+ * Pick the first write of a new batch: the oldest write if it has
+ * expired, else the next one up from the previous batch, wrapping to the
+ * lowest sector. Start at the beginning of that write's erase block.
+ */
+static struct request *flash_start_write_batch(struct flash_data *fd)
+{
+	struct request *rq = rq_entry_fifo(fd->fifo_list[FLASH_ASYNC].next);
+	struct request *prev;
+
+	if (!time_after(jiffies, rq_fifo_time(rq))) {
+		if (fd->next_write)
+			rq = fd->next_write;
+		else
+			rq = rb_entry_rq(rb_first(&fd->sort_list[FLASH_ASYNC]));
+	}
+
+	fd->batch_block = flash_erase_block(fd, blk_rq_pos(rq));
+	while ((prev = flash_former_request(rq)) &&
+	       flash_erase_block(fd, blk_rq_pos(prev)) == fd->batch_block)
+		rq = prev;
+
+	fd->starved = 0;
+	fd->write_batching = 0;
+
+	return rq;
+}
+
+/*
+ * flash_dispatch_requests selects the next request: the rest of the
+ * current erase block batch, else a sync request unless writes have
+ * waited long enough, else a new write batch.
+ */
+static int flash_dispatch_requests(struct request_queue *q, int force)
+{
+	struct flash_data *fd = q->elevator->elevator_data;
+	const int syncs = !list_empty(&fd->fifo_list[FLASH_SYNC]);
+	const int writes = !list_empty(&fd->fifo_list[FLASH_ASYNC]);
+	struct request *rq;
+
+	/*
+	 * continue the write batch while it stays in its erase block
+	 */
+	rq = fd->next_write;
+	if (fd->write_batching && rq && fd->write_batching < fd->write_batch &&
+	    flash_erase_block(fd, blk_rq_pos(rq)) == fd->batch_block)
+		goto dispatch_write;
+
+	fd->write_batching = 0;
+
+	if (syncs) {
+		if (writes &&
+		    (fd->starved >= fd->writes_starved ||
+		     time_after(jiffies, rq_fifo_time(rq_entry_fifo(
+				fd->fifo_list[FLASH_ASYNC].next)))))
+			goto start_write_batch;
+
+		if (writes)
+			fd->starved++;
+
+		rq = rq_entry_fifo(fd->fifo_list[FLASH_SYNC].next);
+		flash_move_to_dispatch(fd, rq);
+		return 1;
+	}
+
+	if (!writes)
+		return 0;
+
+start_write_batch:
+	rq = flash_start_write_batch(fd);
+
+dispatch_write:
+	fd->write_batching++;
+	flash_move_to_dispatch(fd, rq);
+
+	return 1;
+}
+
+static int flash_queue_empty(struct request_queue *q)
+{
+	struct flash_data *fd = q->elevator->elevator_data;
+
+	return list_empty(&fd->fifo_list[FLASH_SYNC])
+		&& list_empty(&fd->fifo_list[FLASH_ASYNC]);
+}
+
+static void flash_exit_queue(struct elevator_queue *e)
+{
+	struct flash_data *fd = e->elevator_data;
+
+	BUG_ON(!list_empty(&fd->fifo_list[FLASH_SYNC]));
+	BUG_ON(!list_empty(&fd->fifo_list[FLASH_ASYNC]));
+
+	kfree(fd);
+}
+
+/*
+ * initialize elevator private data (flash_data).
+ */
+static void *flash_init_queue(struct request_queue *q)
+{
+	struct flash_data *fd;
+
+	fd = kmalloc_node(sizeof(*fd), GFP_KERNEL | __GFP_ZERO, q->node);
+	if (!fd)
+		return NULL;
+
+	INIT_LIST_HEAD(&fd->fifo_list[FLASH_SYNC]);
+	INIT_LIST_HEAD(&fd->fifo_list[FLASH_ASYNC]);
+	fd->sort_list[FLASH_SYNC] = RB_ROOT;
+	fd->sort_list[FLASH_ASYNC] = RB_ROOT;
+	fd->write_expire = write_expire;
+	fd->writes_starved = writes_starved;
+	fd->write_batch = write_batch;
+	fd->front_merges = 1;
+
+	/*
+	 * the driver's optimal i/o size is the best hint we have of its
+	 * erase block size
+	 */
+	if (queue_io_opt(q) >= 1024)
+		fd->erase_block_kb = queue_io_opt(q) >> 10;
+	else
+		fd->erase_block_kb = erase_block_kb;
+
+	return fd;
+}
+
+/*
+ * sysfs parts below
+ */
+
+static ssize_t
+flash_var_show(int var, char *page)
+{
+	return sprintf(page, "%d\n", var);
+}
+
+static ssize_t
+flash_var_store(int *var, const char *page, size_t count)
+{
+	char *p = (char *) page;
+
+	*var = simple_strtol(p, &p, 10);
+	return count;
+}
+
+#define SHOW_FUNCTION(__FUNC, __VAR, __CONV)				\
+static ssize_t __FUNC(struct elevator_queue *e, char *page)		\
+{									\
+	struct flash_data *fd = e->elevator_data;			\
+	int __data = __VAR;						\
+	if (__CONV)							\
+		__data = jiffies_to_msecs(__data);			\
+	return flash_var_show(__data, (page));				\
+}
+SHOW_FUNCTION(flash_write_expire_show, fd->write_expire, 1);
+SHOW_FUNCTION(flash_writes_starved_show, fd->writes_starved, 0);
+SHOW_FUNCTION(flash_write_batch_show, fd->write_batch, 0);
+SHOW_FUNCTION(flash_erase_block_kb_show, fd->erase_block_kb, 0);
+SHOW_FUNCTION(flash_front_merges_show, fd->front_merges, 0);
+#undef SHOW_FUNCTION
+
+#define STORE_FUNCTION(__FUNC, __PTR, MIN, MAX, __CONV)			\
+static ssize_t __FUNC(struct elevator_queue *e, const char *page, size_t count)	\
+{									\
+	struct flash_data *fd = e->elevator_data;			\
+	int __data;							\
+	int ret = flash_var_store(&__data, (page), count);		\
+	if (__data < (MIN))						\
+		__data = (MIN);						\
+	else if (__data > (MAX))					\
+		__data = (MAX);						\
+	if (__CONV)							\
+		*(__PTR) = msecs_to_jiffies(__data);			\
+	else								\
+		*(__PTR) = __data;					\
+	return ret;							\
+}
+STORE_FUNCTION(flash_write_expire_store, &fd->write_expire, 0, INT_MAX, 1);
+STORE_FUNCTION(flash_writes_starved_store, &fd->writes_starved, 0, INT_MAX, 0);
+STORE_FUNCTION(flash_write_batch_store, &fd->write_batch, 1, INT_MAX, 0);
+STORE_FUNCTION(flash_erase_block_kb_store, &fd->erase_block_kb, 4, INT_MAX / 2, 0);
+STORE_FUNCTION(flash_front_merges_store, &fd->front_merges, 0, 1, 0);
+#undef STORE_FUNCTION
+
+#define FD_ATTR(name) \
+	__ATTR(name, S_IRUGO|S_IWUSR, flash_##name##_show, \
+				      flash_##name##_store)
+
+static struct elv_fs_entry flash_attrs[] = {
+	FD_ATTR(write_expire),
+	FD_ATTR(writes_starved),
+	FD_ATTR(write_batch),
+	FD_ATTR(erase_block_kb),
+	FD_ATTR(front_merges),
+	__ATTR_NULL
+};
+
+static struct elevator_type iosched_flash = {
+	.ops = {
+		.elevator_merge_fn = 		flash_merge,
+		.elevator_merged_fn =		flash_merged_request,
+		.elevator_merge_req_fn =	flash_merged_requests,
+		.elevator_allow_merge_fn =	flash_allow_merge,
+		.elevator_dispatch_fn =		flash_dispatch_requests,
+		.elevator_add_req_fn =		flash_add_request,
+		.elevator_queue_empty_fn =	flash_queue_empty,
+		.elevator_former_req_fn =	elv_rb_former_request,
+		.elevator_latter_req_fn =	elv_rb_latter_request,
+		.elevator_init_fn =		flash_init_queue,
+		.elevator_exit_fn =		flash_exit_queue,
+	},
+
+	.elevator_attrs = flash_attrs,
+	.elevator_name = "flash",
+	.elevator_owner = THIS_MODULE,
+};
+
+static int __init flash_init(void)
+{
+	elv_register(&iosched_flash);
+
+	return 0;
+}
+
+static void __exit flash_exit(void)
+{
+	elv_unregister(&iosched_flash);
+}
+
+module_init(flash_init);
+module_exit(flash_exit);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("flash IO scheduler");
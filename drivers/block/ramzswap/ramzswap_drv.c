@@ -0,0 +1,587 @@
+/*
+ * Compressed RAM based swap device
+ *
+ * Copyright (C) 2010 Samsung Electronics
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * Pages written to /dev/ramzswapN are compressed with LZO and kept in a
+ * size-class pool (zs_alloc.c). Zero filled pages take no pool memory at
+ * all. The swap code tells us through swap_slot_free_notify when a slot
+ * is no longer used, so its memory goes back to the system without
+ * waiting for the slot to be overwritten.
+ *
+ * See Documentation/blockdev/ramzswap.txt.
+ */
+
+#define KMSG_COMPONENT "ramzswap"
+#define pr_fmt(fmt) KMSG_COMPONENT ": " fmt
+
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/bio.h>
+#include <linux/blkdev.h>
+#include <linux/genhd.h>
+#include <linux/highmem.h>
+#include <linux/lzo.h>
+#include <linux/string.h>
+#include <linux/swap.h>
+#include <linux/vmalloc.h>
+
+#include "ramzswap_drv.h"
+
+static int ramzswap_major;
+static struct ramzswap *devices;
+
+/* Module params, see the end of this file */
+static unsigned int num_devices = 1;
+static unsigned long disksize_kb;
+
+static void rzs_set_flag(struct ramzswap *rzs, u32 index,
+			 enum rzs_pageflags flag)
+{
+	rzs->table[index].flags |= BIT(flag);
+}
+
+static int page_zero_filled(void *ptr)
+{
+	unsigned int pos;
+	unsigned long *page = ptr;
+
+	for (pos = 0; pos != PAGE_SIZE / sizeof(*page); pos++) {
+		if (page[pos])
+			return 0;
+	}
+
+	return 1;
+}
+
+/* Called with stat_lock held */
+static struct table rzs_take_slot(struct ramzswap *rzs, u32 index)
+{
+	struct table old = rzs->table[index];
+
+	if (!(old.flags & BIT(RZS_PRESENT)))
+		return old;
+
+	if (old.flags & BIT(RZS_ZERO)) {
+		rzs->stats.pages_zero--;
+	} else {
+		rzs->stats.pages_stored--;
+		rzs->stats.compr_size -= old.size;
+		if (old.flags & BIT(RZS_UNCOMPRESSED))
+			rzs->stats.pages_expand--;
+	}
+
+	memset(&rzs->table[index], 0, sizeof(rzs->table[index]));
+
+	return old;
+}
+
+/* May be called with spinlocks held, see swap_entry_free() */
+static void ramzswap_free_page(struct ramzswap *rzs, u32 index)
+{
+	struct table old;
+
+	spin_lock(&rzs->stat_lock);
+	old = rzs_take_slot(rzs, index);
+	spin_unlock(&rzs->stat_lock);
+
+	if ((old.flags & BIT(RZS_PRESENT)) && !(old.flags & BIT(RZS_ZERO)))
+		zs_free(rzs->mem_pool, &old.handle);
+}
+
+static int ramzswap_read(struct ramzswap *rzs, struct page *page, u32 index)
+{
+	struct table entry;
+	unsigned char *user_mem;
+	void *cmem;
+	size_t clen = PAGE_SIZE;
+	int ret = LZO_E_OK;
+
+	spin_lock(&rzs->stat_lock);
+	entry = rzs->table[index];
+	spin_unlock(&rzs->stat_lock);
+
+	/* Never written, or all zeros */
+	if (!(entry.flags & BIT(RZS_PRESENT)) ||
+	    (entry.flags & BIT(RZS_ZERO))) {
+		user_mem = kmap_atomic(page, KM_USER0);
+		memset(user_mem, 0, PAGE_SIZE);
+		kunmap_atomic(user_mem, KM_USER0);
+		flush_dcache_page(page);
+		return 0;
+	}
+
+	mutex_lock(&rzs->lock);
+	cmem = zs_map_object(&entry.handle, entry.size, rzs->compress_buffer);
+
+	user_mem = kmap_atomic(page, KM_USER0);
+	if (entry.flags & BIT(RZS_UNCOMPRESSED))
+		memcpy(user_mem, cmem, PAGE_SIZE);
+	else
+		ret = lzo1x_decompress_safe(cmem, entry.size, user_mem, &clen);
+	kunmap_atomic(user_mem, KM_USER0);
+	mutex_unlock(&rzs->lock);
+
+	if (unlikely(ret != LZO_E_OK || clen != PAGE_SIZE)) {
+		pr_err("Decompression failed! err=%d, page=%u\n", ret, index);
+		return -EIO;
+	}
+
+	flush_dcache_page(page);
+	return 0;
+}
+
+static int ramzswap_write(struct ramzswap *rzs, struct page *page, u32 index)
+{
+	struct zs_handle handle;
+	unsigned char *user_mem;
+	void *src;
+	size_t clen;
+	int ret;
+
+	/* The slot may still hold the previous page written there */
+	ramzswap_free_page(rzs, index);
+
+	user_mem = kmap_atomic(page, KM_USER0);
+	if (page_zero_filled(user_mem)) {
+		kunmap_atomic(user_mem, KM_USER0);
+		spin_lock(&rzs->stat_lock);
+		rzs->stats.pages_zero++;
+		rzs_set_flag(rzs, index, RZS_ZERO);
+		rzs_set_flag(rzs, index, RZS_PRESENT);
+		spin_unlock(&rzs->stat_lock);
+		return 0;
+	}
+	kunmap_atomic(user_mem, KM_USER0);
+
+	mutex_lock(&rzs->lock);
+
+	user_mem = kmap_atomic(page, KM_USER0);
+	ret = lzo1x_1_compress(user_mem, PAGE_SIZE, rzs->compress_buffer,
+			       &clen, rzs->compress_workmem);
+	kunmap_atomic(user_mem, KM_USER0);
+
+	if (unlikely(ret != LZO_E_OK)) {
+		mutex_unlock(&rzs->lock);
+		pr_err("Compression failed! err=%d\n", ret);
+		return -EIO;
+	}
+
+	src = rzs->compress_buffer;
+	if (unlikely(clen > MAX_CPAGE_SIZE)) {
+		clen = PAGE_SIZE;
+		src = NULL;
+	}
+
+	if (zs_malloc(rzs->mem_pool, clen, &handle)) {
+		mutex_unlock(&rzs->lock);
+		pr_info("Error allocating memory for compressed page: %u, "
+			"size=%zu\n", index, clen);
+		return -ENOMEM;
+	}
+
+	if (src) {
+		zs_write_object(&handle, src, clen);
+	} else {
+		user_mem = kmap_atomic(page, KM_USER0);
+		zs_write_object(&handle, user_mem, PAGE_SIZE);
+		kunmap_atomic(user_mem, KM_USER0);
+	}
+
+	mutex_unlock(&rzs->lock);
+
+	spin_lock(&rzs->stat_lock);
+	rzs->table[index].handle = handle;
+	rzs->table[index].size = clen;
+	rzs_set_flag(rzs, index, RZS_PRESENT);
+	if (!src) {
+		rzs_set_flag(rzs, index, RZS_UNCOMPRESSED);
+		rzs->stats.pages_expand++;
+	}
+	rzs->stats.pages_stored++;
+	rzs->stats.compr_size += clen;
+	spin_unlock(&rzs->stat_lock);
+
+	return 0;
+}
+
+static void ramzswap_stat_inc(struct ramzswap *rzs, u64 *v)
+{
+	spin_lock(&rzs->stat_lock);
+	*v += 1;
+	spin_unlock(&rzs->stat_lock);
+}
+
+/* Swap only ever does whole, page aligned pages */
+static int valid_swap_request(struct ramzswap *rzs, struct bio *bio)
+{
+	if (unlikely(bio->bi_sector & (SECTORS_PER_PAGE - 1) ||
+		     bio->bi_size & (PAGE_SIZE - 1) ||
+		     (bio->bi_sector << SECTOR_SHIFT) + bio->bi_size >
+		     rzs->disksize))
+		return 0;
+
+	return 1;
+}
+
+static int ramzswap_make_request(struct request_queue *queue, struct bio *bio)
+{
+	struct ramzswap *rzs = queue->queuedata;
+	struct bio_vec *bvec;
+	u32 index;
+	int i;
+	int ret = 0;
+
+	if (!valid_swap_request(rzs, bio)) {
+		ramzswap_stat_inc(rzs, &rzs->stats.invalid_io);
+		bio_io_error(bio);
+		return 0;
+	}
+
+	index = bio->bi_sector >> SECTORS_PER_PAGE_SHIFT;
+
+	bio_for_each_segment(bvec, bio, i) {
+		if (unlikely(bvec->bv_len != PAGE_SIZE || bvec->bv_offset)) {
+			ramzswap_stat_inc(rzs, &rzs->stats.invalid_io);
+			ret = -EINVAL;
+			break;
+		}
+
+		if (bio_data_dir(bio) == READ) {
+			ramzswap_stat_inc(rzs, &rzs->stats.num_reads);
+			ret = ramzswap_read(rzs, bvec->bv_page, index);
+			if (ret)
+				ramzswap_stat_inc(rzs,
+						  &rzs->stats.failed_reads);
+		} else {
+			ramzswap_stat_inc(rzs, &rzs->stats.num_writes);
+			ret = ramzswap_write(rzs, bvec->bv_page, index);
+			if (ret)
+				ramzswap_stat_inc(rzs,
+						  &rzs->stats.failed_writes);
+		}
+		if (ret)
+			break;
+		index++;
+	}
+
+	bio_endio(bio, ret);
+	return 0;
+}
+
+static void ramzswap_slot_free_notify(struct block_device *bdev,
+				      unsigned long index)
+{
+	struct ramzswap *rzs = bdev->bd_disk->private_data;
+
+	ramzswap_free_page(rzs, index);
+	ramzswap_stat_inc(rzs, &rzs->stats.notify_free);
+}
+
+static struct block_device_operations ramzswap_devops = {
+	.swap_slot_free_notify = ramzswap_slot_free_notify,
+	.owner = THIS_MODULE,
+};
+
+/* sysfs: /sys/block/ramzswapN/ */
+
+static struct ramzswap *dev_to_rzs(struct device *dev)
+{
+	return dev_to_disk(dev)->private_data;
+}
+
+static u64 rzs_stat_read(struct ramzswap *rzs, u64 *v)
+{
+	u64 val;
+
+	spin_lock(&rzs->stat_lock);
+	val = *v;
+	spin_unlock(&rzs->stat_lock);
+
+	return val;
+}
+
+#define RZS_STAT_ATTR(name)						\
+static ssize_t name##_show(struct device *dev,				\
+			   struct device_attribute *attr, char *buf)	\
+{									\
+	struct ramzswap *rzs = dev_to_rzs(dev);				\
+									\
+	return sprintf(buf, "%llu\n", (unsigned long long)		\
+		       rzs_stat_read(rzs, &rzs->stats.name));		\
+}									\
+static DEVICE_ATTR(name, S_IRUGO, name##_show, NULL)
+
+RZS_STAT_ATTR(num_reads);
+RZS_STAT_ATTR(num_writes);
+RZS_STAT_ATTR(failed_reads);
+RZS_STAT_ATTR(failed_writes);
+RZS_STAT_ATTR(invalid_io);
+RZS_STAT_ATTR(notify_free);
+
+static ssize_t disksize_show(struct device *dev,
+			     struct device_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%llu\n",
+		       (unsigned long long)dev_to_rzs(dev)->disksize);
+}
+static DEVICE_ATTR(disksize, S_IRUGO, disksize_show, NULL);
+
+static ssize_t zero_pages_show(struct device *dev,
+			       struct device_attribute *attr, char *buf)
+{
+	struct ramzswap *rzs = dev_to_rzs(dev);
+	u32 val;
+
+	spin_lock(&rzs->stat_lock);
+	val = rzs->stats.pages_zero;
+	spin_unlock(&rzs->stat_lock);
+
+	return sprintf(buf, "%u\n", val);
+}
+static DEVICE_ATTR(zero_pages, S_IRUGO, zero_pages_show, NULL);
+
+/* Pages that did not compress below MAX_CPAGE_SIZE and are kept as is */
+static ssize_t failed_compress_show(struct device *dev,
+				    struct device_attribute *attr, char *buf)
+{
+	struct ramzswap *rzs = dev_to_rzs(dev);
+	u32 val;
+
+	spin_lock(&rzs->stat_lock);
+	val = rzs->stats.pages_expand;
+	spin_unlock(&rzs->stat_lock);
+
+	return sprintf(buf, "%u\n", val);
+}
+static DEVICE_ATTR(failed_compress, S_IRUGO, failed_compress_show, NULL);
+
+/* Bytes of swapped data held, zero pages included */
+static ssize_t orig_data_size_show(struct device *dev,
+				   struct device_attribute *attr, char *buf)
+{
+	struct ramzswap *rzs = dev_to_rzs(dev);
+	u64 val;
+
+	spin_lock(&rzs->stat_lock);
+	val = (u64)(rzs->stats.pages_stored + rzs->stats.pages_zero) <<
+	      PAGE_SHIFT;
+	spin_unlock(&rzs->stat_lock);
+
+	return sprintf(buf, "%llu\n", (unsigned long long)val);
+}
+static DEVICE_ATTR(orig_data_size, S_IRUGO, orig_data_size_show, NULL);
+
+static ssize_t compr_data_size_show(struct device *dev,
+				    struct device_attribute *attr, char *buf)
+{
+	struct ramzswap *rzs = dev_to_rzs(dev);
+
+	return sprintf(buf, "%llu\n", (unsigned long long)
+		       rzs_stat_read(rzs, &rzs->stats.compr_size));
+}
+static DEVICE_ATTR(compr_data_size, S_IRUGO, compr_data_size_show, NULL);
+
+/* Pool memory, including size class rounding and partly used zspages */
+static ssize_t mem_used_total_show(struct device *dev,
+				   struct device_attribute *attr, char *buf)
+{
+	struct ramzswap *rzs = dev_to_rzs(dev);
+
+	return sprintf(buf, "%llu\n", (unsigned long long)
+		       zs_get_total_size_bytes(rzs->mem_pool));
+}
+static DEVICE_ATTR(mem_used_total, S_IRUGO, mem_used_total_show, NULL);
+
+/* Percentage of the original size used by the pool */
+static ssize_t compr_ratio_show(struct device *dev,
+				struct device_attribute *attr, char *buf)
+{
+	struct ramzswap *rzs = dev_to_rzs(dev);
+	u64 orig, used;
+
+	spin_lock(&rzs->stat_lock);
+	orig = (u64)(rzs->stats.pages_stored + rzs->stats.pages_zero) <<
+	       PAGE_SHIFT;
+	spin_unlock(&rzs->stat_lock);
+	used = zs_get_total_size_bytes(rzs->mem_pool);
+
+	return sprintf(buf, "%u\n",
+		       orig ? (unsigned int)div64_u64(used * 100, orig) : 0);
+}
+static DEVICE_ATTR(compr_ratio, S_IRUGO, compr_ratio_show, NULL);
+
+static struct attribute *ramzswap_disk_attrs[] = {
+	&dev_attr_disksize.attr,
+	&dev_attr_num_reads.attr,
+	&dev_attr_num_writes.attr,
+	&dev_attr_failed_reads.attr,
+	&dev_attr_failed_writes.attr,
+	&dev_attr_invalid_io.attr,
+	&dev_attr_notify_free.attr,
+	&dev_attr_zero_pages.attr,
+	&dev_attr_failed_compress.attr,
+	&dev_attr_orig_data_size.attr,
+	&dev_attr_compr_data_size.attr,
+	&dev_attr_mem_used_total.attr,
+	&dev_attr_compr_ratio.attr,
+	NULL,
+};
+
+static struct attribute_group ramzswap_disk_attr_group = {
+	.attrs = ramzswap_disk_attrs,
+};
+
+static void destroy_device(struct ramzswap *rzs)
+{
+	if (rzs->disk) {
+		sysfs_remove_group(&disk_to_dev(rzs->disk)->kobj,
+				   &ramzswap_disk_attr_group);
+		del_gendisk(rzs->disk);
+		put_disk(rzs->disk);
+	}
+
+	if (rzs->queue)
+		blk_cleanup_queue(rzs->queue);
+
+	if (rzs->table) {
+		u32 index;
+
+		for (index = 0; index < rzs->disksize >> PAGE_SHIFT; index++)
+			ramzswap_free_page(rzs, index);
+		vfree(rzs->table);
+	}
+
+	if (rzs->mem_pool)
+		zs_destroy_pool(rzs->mem_pool);
+
+	kfree(rzs->compress_workmem);
+	free_pages((unsigned long)rzs->compress_buffer, 1);
+}
+
+static int create_device(struct ramzswap *rzs, int device_id)
+{
+	size_t num_pages;
+
+	mutex_init(&rzs->lock);
+	spin_lock_init(&rzs->stat_lock);
+
+	rzs->disksize = (u64)disksize_kb << 10;
+	rzs->disksize &= PAGE_MASK;
+	num_pages = rzs->disksize >> PAGE_SHIFT;
+
+	rzs->compress_workmem = kzalloc(LZO1X_MEM_COMPRESS, GFP_KERNEL);
+	/* lzo1x_worst_compress(PAGE_SIZE) does not fit in one page */
+	rzs->compress_buffer = (void *)__get_free_pages(GFP_KERNEL, 1);
+	rzs->table = vmalloc(num_pages * sizeof(*rzs->table));
+	/* GFP_NOIO: we are allocating on the swap out path */
+	rzs->mem_pool = zs_create_pool(GFP_NOIO | __GFP_NOWARN);
+	if (!rzs->compress_workmem || !rzs->compress_buffer ||
+	    !rzs->table || !rzs->mem_pool)
+		return -ENOMEM;
+	memset(rzs->table, 0, num_pages * sizeof(*rzs->table));
+
+	rzs->queue = blk_alloc_queue(GFP_KERNEL);
+	if (!rzs->queue)
+		return -ENOMEM;
+
+	blk_queue_make_request(rzs->queue, ramzswap_make_request);
+	rzs->queue->queuedata = rzs;
+	blk_queue_logical_block_size(rzs->queue, PAGE_SIZE);
+	blk_queue_physical_block_size(rzs->queue, PAGE_SIZE);
+	/* Tell swap there are no seeks to avoid */
+	queue_flag_set_unlocked(QUEUE_FLAG_NONROT, rzs->queue);
+
+	rzs->disk = alloc_disk(1);
+	if (!rzs->disk)
+		return -ENOMEM;
+
+	rzs->disk->major = ramzswap_major;
+	rzs->disk->first_minor = device_id;
+	rzs->disk->fops = &ramzswap_devops;
+	rzs->disk->queue = rzs->queue;
+	rzs->disk->private_data = rzs;
+	sprintf(rzs->disk->disk_name, "ramzswap%d", device_id);
+	set_capacity(rzs->disk, rzs->disksize >> SECTOR_SHIFT);
+
+	add_disk(rzs->disk);
+
+	if (sysfs_create_group(&disk_to_dev(rzs->disk)->kobj,
+			       &ramzswap_disk_attr_group))
+		pr_warning("Error creating sysfs group for %s\n",
+			   rzs->disk->disk_name);
+
+	return 0;
+}
+
+static int __init ramzswap_init(void)
+{
+	int ret;
+	int dev_id;
+
+	if (!num_devices || num_devices > 32) {
+		pr_err("Invalid value for num_devices: %u\n", num_devices);
+		return -EINVAL;
+	}
+
+	if (!disksize_kb) {
+		disksize_kb = (totalram_pages << (PAGE_SHIFT - 10)) *
+			      DEFAULT_DISKSIZE_PERC_RAM / 100;
+		pr_info("disksize_kb not given, using %lu kB\n", disksize_kb);
+	}
+
+	ramzswap_major = register_blkdev(0, "ramzswap");
+	if (ramzswap_major <= 0)
+		return -EBUSY;
+
+	devices = kzalloc(num_devices * sizeof(*devices), GFP_KERNEL);
+	if (!devices) {
+		ret = -ENOMEM;
+		goto out_unregister;
+	}
+
+	for (dev_id = 0; dev_id < num_devices; dev_id++) {
+		ret = create_device(&devices[dev_id], dev_id);
+		if (ret) {
+			pr_err("Error creating ramzswap%d\n", dev_id);
+			goto out_destroy;
+		}
+	}
+
+	return 0;
+
+out_destroy:
+	while (dev_id >= 0)
+		destroy_device(&devices[dev_id--]);
+	kfree(devices);
+out_unregister:
+	unregister_blkdev(ramzswap_major, "ramzswap");
+	return ret;
+}
+
+static void __exit ramzswap_exit(void)
+{
+	int i;
+
+	for (i = 0; i < num_devices; i++)
+		destroy_device(&devices[i]);
+
+	unregister_blkdev(ramzswap_major, "ramzswap");
+	kfree(devices);
+}
+
+module_param(num_devices, uint, 0);
+MODULE_PARM_DESC(num_devices, "Number of ramzswap devices");
+module_param(disksize_kb, ulong, 0);
+MODULE_PARM_DESC(disksize_kb, "Size of each device in kB "
+		 "(default: 25% of RAM)");
+
+module_init(ramzswap_init);
+module_exit(ramzswap_exit);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("Compressed RAM Based Swap Device");
@@ -0,0 +1,73 @@
+/*
+ * Compressed RAM based swap device
+ *
+ * Copyright (C) 2010 Samsung Electronics
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#ifndef _RAMZSWAP_DRV_H_
+#define _RAMZSWAP_DRV_H_
+
+#include <linux/spinlock.h>
+#include <linux/mutex.h>
+
+#include "zs_alloc.h"
+
+#define SECTOR_SHIFT		9
+#define SECTORS_PER_PAGE_SHIFT	(PAGE_SHIFT - SECTOR_SHIFT)
+#define SECTORS_PER_PAGE	(1 << SECTORS_PER_PAGE_SHIFT)
+
+/* Default disk size as a percentage of RAM */
+#define DEFAULT_DISKSIZE_PERC_RAM	25
+
+/*
+ * Pages that compress to more than this are stored uncompressed: the
+ * saving would not pay for the decompression.
+ */
+#define MAX_CPAGE_SIZE		(PAGE_SIZE / 4 * 3)
+
+/* Flags for struct table */
+enum rzs_pageflags {
+	RZS_ZERO,		/* page is all zeros, nothing stored */
+	RZS_UNCOMPRESSED,	/* page stored as is */
+	RZS_PRESENT,		/* slot holds data */
+};
+
+/* One entry per PAGE_SIZE slot of the disk */
+struct table {
+	struct zs_handle handle;
+	u16 size;		/* compressed size */
+	u8 flags;
+} __attribute__((aligned(4)));
+
+struct ramzswap_stats {
+	u64 num_reads;		/* failed + successful */
+	u64 num_writes;		/* --do-- */
+	u64 failed_reads;
+	u64 failed_writes;
+	u64 invalid_io;		/* non-page-aligned I/O requests */
+	u64 notify_free;	/* slots freed by swap_slot_free_notify */
+	u64 compr_size;		/* compressed size of pages stored */
+	u32 pages_zero;		/* zero filled pages */
+	u32 pages_stored;	/* pages currently stored */
+	u32 pages_expand;	/* pages stored uncompressed */
+};
+
+struct ramzswap {
+	struct zs_pool *mem_pool;
+	void *compress_workmem;
+	void *compress_buffer;	/* compressed page, or bounce for reads */
+	struct table *table;
+	struct mutex lock;	/* protects compress_workmem and buffer */
+	spinlock_t stat_lock;	/* protects stats and table flags */
+	struct request_queue *queue;
+	struct gendisk *disk;
+	u64 disksize;		/* bytes */
+
+	struct ramzswap_stats stats;
+};
+
+#endif
@@ -0,0 +1,322 @@
+/*
+ * Size-class allocator for compressed pages
+ *
+ * Copyright (C) 2010 Samsung Electronics
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * Objects are rounded up to a multiple of ZS_ALIGN and packed into
+ * "zspages" of one to ZS_MAX_PAGES_PER_ZSPAGE order-0 pages holding
+ * objects of a single size class. The number of pages in a zspage is
+ * chosen per class to waste as little of the tail as possible, so an
+ * object may straddle two pages; zs_map_object() copies such objects
+ * into a caller supplied bounce buffer. Free objects of a zspage are
+ * chained through their first two bytes.
+ *
+ * Pages come from lowmem so they can be addressed without kmap.
+ */
+
+#include <linux/kernel.h>
+#include <linux/slab.h>
+#include <linux/mm.h>
+#include <linux/list.h>
+#include <linux/spinlock.h>
+#include <linux/string.h>
+
+#include "zs_alloc.h"
+
+#define ZS_ALIGN		16
+#define ZS_MIN_ALLOC_SIZE	32
+#define ZS_MAX_ALLOC_SIZE	PAGE_SIZE
+#define ZS_MAX_PAGES_PER_ZSPAGE	4
+#define ZS_NR_CLASSES	\
+	((ZS_MAX_ALLOC_SIZE - ZS_MIN_ALLOC_SIZE) / ZS_ALIGN + 1)
+#define ZS_END_OF_LIST		0xffff
+
+struct zs_class {
+	unsigned int size;
+	unsigned int pages_per_zspage;
+	unsigned int objs_per_zspage;
+	struct list_head partial;	/* zspages with free objects */
+};
+
+struct zs_zspage {
+	struct list_head list;		/* on class->partial unless full */
+	struct zs_class *class;
+	struct page *pages[ZS_MAX_PAGES_PER_ZSPAGE];
+	unsigned int inuse;
+	u16 freelist;
+};
+
+struct zs_pool {
+	spinlock_t lock;
+	gfp_t flags;
+	unsigned long pages;
+	struct zs_class classes[ZS_NR_CLASSES];
+};
+
+static unsigned int zs_pages_per_zspage(unsigned int size)
+{
+	unsigned int k;
+	unsigned int best = 1;
+	unsigned int best_used = 0;
+
+	for (k = 1; k <= ZS_MAX_PAGES_PER_ZSPAGE; k++) {
+		unsigned int zspage_size = k * PAGE_SIZE;
+		unsigned int used = (zspage_size / size) * size;
+
+		/* compare used / zspage_size without dividing */
+		if (used * best * PAGE_SIZE > best_used * zspage_size) {
+			best = k;
+			best_used = used;
+		}
+	}
+
+	return best;
+}
+
+static void *zs_object_addr(struct zs_zspage *zspage, unsigned int index,
+			    unsigned int *room)
+{
+	unsigned long offset = index * zspage->class->size;
+	void *page = page_address(zspage->pages[offset >> PAGE_SHIFT]);
+
+	offset &= ~PAGE_MASK;
+	if (room)
+		*room = PAGE_SIZE - offset;
+
+	return page + offset;
+}
+
+/* Start of the part of an object that spilled into the next page */
+static void *zs_object_tail(struct zs_handle *handle, unsigned int room)
+{
+	unsigned long offset = handle->index * handle->zspage->class->size;
+
+	return page_address(handle->zspage->pages[(offset + room) >> PAGE_SHIFT]);
+}
+
+/* Objects start ZS_ALIGN aligned, so the link never straddles a page */
+static u16 *zs_object_link(struct zs_zspage *zspage, unsigned int index)
+{
+	return zs_object_addr(zspage, index, NULL);
+}
+
+static void zs_free_zspage(struct zs_zspage *zspage)
+{
+	unsigned int i;
+
+	for (i = 0; i < zspage->class->pages_per_zspage; i++)
+		if (zspage->pages[i])
+			__free_page(zspage->pages[i]);
+	kfree(zspage);
+}
+
+static struct zs_zspage *zs_alloc_zspage(struct zs_pool *pool,
+					 struct zs_class *class)
+{
+	struct zs_zspage *zspage;
+	unsigned int i;
+
+	zspage = kzalloc(sizeof(*zspage), pool->flags);
+	if (!zspage)
+		return NULL;
+
+	zspage->class = class;
+	INIT_LIST_HEAD(&zspage->list);
+
+	for (i = 0; i < class->pages_per_zspage; i++) {
+		zspage->pages[i] = alloc_page(pool->flags);
+		if (!zspage->pages[i]) {
+			zs_free_zspage(zspage);
+			return NULL;
+		}
+	}
+
+	for (i = 0; i < class->objs_per_zspage; i++)
+		*zs_object_link(zspage, i) = (i + 1 < class->objs_per_zspage) ?
+						i + 1 : ZS_END_OF_LIST;
+	zspage->freelist = 0;
+
+	return zspage;
+}
+
+/**
+ * zs_create_pool - create a pool for compressed objects
+ * @flags: allocation flags for the pool's pages; must not include
+ *	__GFP_HIGHMEM
+ */
+struct zs_pool *zs_create_pool(gfp_t flags)
+{
+	struct zs_pool *pool;
+	unsigned int i;
+
+	BUG_ON(flags & __GFP_HIGHMEM);
+
+	pool = kzalloc(sizeof(*pool), GFP_KERNEL);
+	if (!pool)
+		return NULL;
+
+	spin_lock_init(&pool->lock);
+	pool->flags = flags;
+
+	for (i = 0; i < ZS_NR_CLASSES; i++) {
+		struct zs_class *class = &pool->classes[i];
+
+		class->size = ZS_MIN_ALLOC_SIZE + i * ZS_ALIGN;
+		class->pages_per_zspage = zs_pages_per_zspage(class->size);
+		class->objs_per_zspage = class->pages_per_zspage * PAGE_SIZE /
+					 class->size;
+		INIT_LIST_HEAD(&class->partial);
+	}
+
+	return pool;
+}
+
+/**
+ * zs_destroy_pool - free a pool
+ * @pool: pool to free
+ *
+ * All objects must have been freed, so only partial zspages can remain;
+ * anything else is leaked and reported.
+ */
+void zs_destroy_pool(struct zs_pool *pool)
+{
+	unsigned int i;
+
+	for (i = 0; i < ZS_NR_CLASSES; i++) {
+		struct zs_class *class = &pool->classes[i];
+		struct zs_zspage *zspage, *next;
+
+		list_for_each_entry_safe(zspage, next, &class->partial, list) {
+			pool->pages -= class->pages_per_zspage;
+			zs_free_zspage(zspage);
+		}
+	}
+
+	WARN(pool->pages, "zs_alloc: %lu pages still in use\n", pool->pages);
+	kfree(pool);
+}
+
+/**
+ * zs_malloc - allocate an object
+ * @pool: pool to allocate from
+ * @size: object size, at most PAGE_SIZE
+ * @handle: filled in with the object's location
+ *
+ * May sleep if the pool's flags allow it. Returns 0 or -ENOMEM.
+ */
+int zs_malloc(struct zs_pool *pool, size_t size, struct zs_handle *handle)
+{
+	struct zs_class *class;
+	struct zs_zspage *zspage;
+
+	if (unlikely(!size || size > ZS_MAX_ALLOC_SIZE))
+		return -EINVAL;
+
+	if (size < ZS_MIN_ALLOC_SIZE)
+		size = ZS_MIN_ALLOC_SIZE;
+	class = &pool->classes[DIV_ROUND_UP(size - ZS_MIN_ALLOC_SIZE,
+					    ZS_ALIGN)];
+
+	spin_lock(&pool->lock);
+	if (list_empty(&class->partial)) {
+		spin_unlock(&pool->lock);
+		zspage = zs_alloc_zspage(pool, class);
+		if (!zspage)
+			return -ENOMEM;
+		spin_lock(&pool->lock);
+		list_add(&zspage->list, &class->partial);
+		pool->pages += class->pages_per_zspage;
+	}
+
+	zspage = list_first_entry(&class->partial, struct zs_zspage, list);
+	handle->zspage = zspage;
+	handle->index = zspage->freelist;
+	zspage->freelist = *zs_object_link(zspage, handle->index);
+	if (++zspage->inuse == class->objs_per_zspage)
+		list_del_init(&zspage->list);
+	spin_unlock(&pool->lock);
+
+	return 0;
+}
+
+/**
+ * zs_free - free an object
+ * @pool: pool the object was allocated from
+ * @handle: the object
+ *
+ * Does not sleep and may be called with spinlocks held.
+ */
+void zs_free(struct zs_pool *pool, struct zs_handle *handle)
+{
+	struct zs_zspage *zspage = handle->zspage;
+	struct zs_class *class = zspage->class;
+
+	spin_lock(&pool->lock);
+	*zs_object_link(zspage, handle->index) = zspage->freelist;
+	zspage->freelist = handle->index;
+
+	if (zspage->inuse-- == class->objs_per_zspage)
+		list_add(&zspage->list, &class->partial);
+
+	if (zspage->inuse) {
+		spin_unlock(&pool->lock);
+		return;
+	}
+
+	list_del(&zspage->list);
+	pool->pages -= class->pages_per_zspage;
+	spin_unlock(&pool->lock);
+
+	zs_free_zspage(zspage);
+}
+
+/**
+ * zs_write_object - copy data into an object
+ * @handle: the object
+ * @src: data to copy
+ * @size: bytes to copy, at most the size it was allocated with
+ */
+void zs_write_object(struct zs_handle *handle, const void *src, size_t size)
+{
+	unsigned int room;
+	void *dst = zs_object_addr(handle->zspage, handle->index, &room);
+
+	if (size <= room) {
+		memcpy(dst, src, size);
+		return;
+	}
+
+	memcpy(dst, src, room);
+	memcpy(zs_object_tail(handle, room), src + room, size - room);
+}
+
+/**
+ * zs_map_object - get a contiguous view of an object
+ * @handle: the object
+ * @size: bytes needed
+ * @bounce: at least @size bytes, used if the object straddles two pages
+ *
+ * Returns a pointer to the object's data, or to @bounce holding a copy.
+ */
+void *zs_map_object(struct zs_handle *handle, size_t size, void *bounce)
+{
+	unsigned int room;
+	void *src = zs_object_addr(handle->zspage, handle->index, &room);
+
+	if (size <= room)
+		return src;
+
+	memcpy(bounce, src, room);
+	memcpy(bounce + room, zs_object_tail(handle, room), size - room);
+
+	return bounce;
+}
+
+u64 zs_get_total_size_bytes(struct zs_pool *pool)
+{
+	return (u64)pool->pages << PAGE_SHIFT;
+}
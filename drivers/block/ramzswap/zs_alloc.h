@@ -0,0 +1,36 @@
+/*
+ * Size-class allocator for compressed pages
+ *
+ * Copyright (C) 2010 Samsung Electronics
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#ifndef _ZS_ALLOC_H_
+#define _ZS_ALLOC_H_
+
+#include <linux/types.h>
+
+struct zs_pool;
+struct zs_zspage;
+
+/* Where an object lives: its zspage and its index within it */
+struct zs_handle {
+	struct zs_zspage *zspage;
+	u16 index;
+};
+
+struct zs_pool *zs_create_pool(gfp_t flags);
+void zs_destroy_pool(struct zs_pool *pool);
+
+int zs_malloc(struct zs_pool *pool, size_t size, struct zs_handle *handle);
+void zs_free(struct zs_pool *pool, struct zs_handle *handle);
+
+void zs_write_object(struct zs_handle *handle, const void *src, size_t size);
+void *zs_map_object(struct zs_handle *handle, size_t size, void *bounce);
+
+u64 zs_get_total_size_bytes(struct zs_pool *pool);
+
+#endif
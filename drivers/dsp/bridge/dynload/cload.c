@@ -172,8 +172,14 @@ int dynamic_load_module(struct dynamic_loader_stream *module,
 			dload_symbols(&dl_state);
 		}
 
-		if (init && !dl_state.dload_errcount)
-			dload_data(&dl_state);
+		if (init && !dl_state.dload_errcount) {
+			/* the client may already hold the relocated image */
+			if (!init->cached_image ||
+			    !init->cached_image(init, false))
+				dload_data(&dl_state);
+			if (init->cached_image)
+				init->cached_image(init, true);
+		}
 
 		init_module_handle(&dl_state);
 
@@ -15,6 +15,14 @@
  * Memory is coelesced back to the appropriate heap when a buffer is
  * freed.
  *
+ * Each allocator keeps its free blocks in power-of-two size bins, each a
+ * tree ordered by size, for allocation and in a tree ordered by physical
+ * address for coalescing;
+ * blocks in use are kept in a second address tree.  Allocation, free and
+ * coalescing are therefore O(log n) in the number of blocks, and each
+ * segment has its own lock so that allocations from different segments
+ * do not serialize on the CMM manager lock.
+ *
  * Notes:
  *   Va: Virtual address.
  *   Pa: Physical or kernel system address.
@@ -30,6 +38,9 @@
  * WARRANTIES OF MERCHANTIBILITY AND FITNESS FOR A PARTICULAR PURPOSE.
  */
 
+/*  ----------------------------------- Host OS */
+#include <linux/rbtree.h>
+
 /*  ----------------------------------- DSP/BIOS Bridge */
 #include <dspbridge/std.h>
 #include <dspbridge/dbdefs.h>
@@ -54,6 +65,10 @@
 /*  ----------------------------------- Defines, Data Structures, Typedefs */
 #define NEXT_PA(pnode)   (pnode->dw_pa + pnode->ul_size)
 
+/* Free blocks are binned by the position of their highest set size bit */
+#define CMM_NUM_BINS	32
+#define SIZE_TO_BIN(size)	(fls(size) - 1)
+
 /* Other bus/platform translations */
 #define DSPPA2GPPPA(base, x, y)  ((x)+(y))
 #define GPPPA2DSPPA(base, x, y)  ((x)-(y))
@@ -75,10 +90,18 @@ struct cmm_allocator {		/* sma */
 	unsigned int dw_dsp_base;	/* DSP virt base byte address */
 	u32 ul_dsp_size;	/* DSP seg size in bytes */
 	struct cmm_object *hcmm_mgr;	/* back ref to parent mgr */
-	/* node list of available memory */
-	struct lst_list *free_list_head;
-	/* node list of memory in use */
-	struct lst_list *in_use_list_head;
+	/* Serializes allocations and frees in this segment */
+	struct mutex sm_lock;
+	/* available memory, by size; bit n of bin_map set if bin n in use */
+	struct rb_root free_bins[CMM_NUM_BINS];
+	unsigned long bin_map;
+	/* available memory, by physical address */
+	struct rb_root free_tree;
+	/* memory in use, by physical address */
+	struct rb_root in_use_tree;
+	u32 ul_in_use_cnt;
+	/* Free list of memory nodes */
+	struct lst_list node_free_list;
 };
 
 struct cmm_xlator {		/* Pa<->Va translator object */
@@ -100,7 +123,6 @@ struct cmm_object {
 	 * Cmm Lock is used to serialize access mem manager for multi-threads.
 	 */
 	struct mutex cmm_lock;	/* Lock to access cmm mgr */
-	struct lst_list *node_free_list_head;	/* Free list of memory nodes */
 	u32 ul_min_block_size;	/* Min SM block; default 16 bytes */
 	u32 dw_page_size;	/* Memory Page size (1k/4k) */
 	/* GPP SM segment ptrs */
@@ -131,6 +153,8 @@ static struct cmm_xlatorattrs cmm_dfltxlatorattrs = {
 /* SM node representing a block of memory. */
 struct cmm_mnode {
 	struct list_head link;	/* must be 1st element */
+	struct rb_node rb_link;	/* free or in-use tree, keyed by dw_pa */
+	struct rb_node size_link;	/* free bin tree, keyed by ul_size */
 	u32 dw_pa;		/* Phys addr */
 	u32 dw_va;		/* Virtual address in device process context */
 	u32 ul_size;		/* SM block size in bytes */
@@ -147,8 +171,10 @@ static struct cmm_allocator *get_allocator(struct cmm_object *cmm_mgr_obj,
 					   u32 ul_seg_id);
 static struct cmm_mnode *get_free_block(struct cmm_allocator *allocator,
 					u32 usize);
-static struct cmm_mnode *get_node(struct cmm_object *cmm_mgr_obj, u32 dw_pa,
+static struct cmm_mnode *get_node(struct cmm_allocator *allocator, u32 dw_pa,
 				  u32 dw_va, u32 ul_size);
+static void insert_node(struct rb_root *root, struct cmm_mnode *pnode);
+static struct cmm_mnode *find_node(struct rb_root *root, u32 dw_pa);
 /* get available slot for new allocator */
 static s32 get_slot(struct cmm_object *hcmm_mgr);
 static void un_register_gppsm_seg(struct cmm_allocator *psma);
@@ -159,22 +185,25 @@ static void un_register_gppsm_seg(struct cmm_allocator *psma);
  *      Allocate a SM buffer, zero contents, and return the physical address
  *      and optional driver context virtual address(pp_buf_va).
  *
- *      The freelist is sorted in increasing size order. Get the first
- *      block that satifies the request and sort the remaining back on
- *      the freelist; if large enough. The kept block is placed on the
- *      inUseList.
+ *      Free blocks are binned by size.  Take the smallest block of the
+ *      request's own size bin that satisfies it, or else the smallest block
+ *      of the next non-empty larger bin, and put the remainder back on the
+ *      free lists if large enough.  The kept block is placed in the in-use
+ *      tree.  The segment's lock is taken under the cmm lock, which keeps
+ *      the segment from being unregistered, and only the segment's lock is
+ *      held while the block is carved out; no lock is held while clearing
+ *      memory.
  */
 void *cmm_calloc_buf(struct cmm_object *hcmm_mgr, u32 usize,
 		     struct cmm_attrs *pattrs, OUT void **pp_buf_va)
 {
 	struct cmm_object *cmm_mgr_obj = (struct cmm_object *)hcmm_mgr;
 	void *buf_pa = NULL;
+	void *buf_va = NULL;
 	struct cmm_mnode *pnode = NULL;
 	struct cmm_mnode *new_node = NULL;
 	struct cmm_allocator *allocator = NULL;
 	u32 delta_size;
-	u8 *pbyte = NULL;
-	s32 cnt;
 
 	if (pattrs == NULL)
 		pattrs = &cmm_dfltalctattrs;
@@ -182,58 +211,61 @@ void *cmm_calloc_buf(struct cmm_object *hcmm_mgr, u32 usize,
 	if (pp_buf_va != NULL)
 		*pp_buf_va = NULL;
 
-	if (cmm_mgr_obj && (usize != 0)) {
-		if (pattrs->ul_seg_id > 0) {
-			/* SegId > 0 is SM */
-			/* get the allocator object for this segment id */
-			allocator =
-			    get_allocator(cmm_mgr_obj, pattrs->ul_seg_id);
-			/* keep block size a multiple of ul_min_block_size */
-			usize =
-			    ((usize - 1) & ~(cmm_mgr_obj->ul_min_block_size -
-					     1))
-			    + cmm_mgr_obj->ul_min_block_size;
-			mutex_lock(&cmm_mgr_obj->cmm_lock);
-			pnode = get_free_block(allocator, usize);
-		}
-		if (pnode) {
-			delta_size = (pnode->ul_size - usize);
-			if (delta_size >= cmm_mgr_obj->ul_min_block_size) {
-				/* create a new block with the leftovers and
-				 * add to freelist */
-				new_node =
-				    get_node(cmm_mgr_obj, pnode->dw_pa + usize,
-					     pnode->dw_va + usize,
-					     (u32) delta_size);
-				if (new_node) {
-					/* leftovers go free */
-					add_to_free_list(allocator, new_node);
-				}
+	/* SegId > 0 is SM */
+	if (!cmm_mgr_obj || usize == 0 || pattrs->ul_seg_id == 0)
+		return NULL;
+
+	/* keep block size a multiple of ul_min_block_size */
+	usize = ((usize - 1) & ~(cmm_mgr_obj->ul_min_block_size - 1))
+	    + cmm_mgr_obj->ul_min_block_size;
+
+	/* get the allocator object for this segment id */
+	mutex_lock(&cmm_mgr_obj->cmm_lock);
+	allocator = get_allocator(cmm_mgr_obj, pattrs->ul_seg_id);
+	if (allocator == NULL) {
+		mutex_unlock(&cmm_mgr_obj->cmm_lock);
+		return NULL;
+	}
+	mutex_lock(&allocator->sm_lock);
+	mutex_unlock(&cmm_mgr_obj->cmm_lock);
+
+	pnode = get_free_block(allocator, usize);
+	if (pnode) {
+		delta_size = (pnode->ul_size - usize);
+		if (delta_size >= cmm_mgr_obj->ul_min_block_size) {
+			/* create a new block with the leftovers and
+			 * add to freelist */
+			new_node =
+			    get_node(allocator, pnode->dw_pa + usize,
+				     pnode->dw_va + usize, (u32) delta_size);
+			if (new_node) {
+				/* leftovers go free */
+				add_to_free_list(allocator, new_node);
 				/* adjust our node's size */
 				pnode->ul_size = usize;
 			}
-			/* Tag node with client process requesting allocation
-			 * We'll need to free up a process's alloc'd SM if the
-			 * client process goes away.
-			 */
-			/* Return TGID instead of process handle */
-			pnode->client_proc = current->tgid;
-
-			/* put our node on InUse list */
-			lst_put_tail(allocator->in_use_list_head,
-				     (struct list_head *)pnode);
-			buf_pa = (void *)pnode->dw_pa;	/* physical address */
-			/* clear mem */
-			pbyte = (u8 *) pnode->dw_va;
-			for (cnt = 0; cnt < (s32) usize; cnt++, pbyte++)
-				*pbyte = 0;
-
-			if (pp_buf_va != NULL) {
-				/* Virtual address */
-				*pp_buf_va = (void *)pnode->dw_va;
-			}
 		}
-		mutex_unlock(&cmm_mgr_obj->cmm_lock);
+		/* Tag node with client process requesting allocation
+		 * We'll need to free up a process's alloc'd SM if the
+		 * client process goes away.
+		 */
+		/* Return TGID instead of process handle */
+		pnode->client_proc = current->tgid;
+
+		/* put our node in the InUse tree */
+		insert_node(&allocator->in_use_tree, pnode);
+		allocator->ul_in_use_cnt++;
+		buf_pa = (void *)pnode->dw_pa;	/* physical address */
+		buf_va = (void *)pnode->dw_va;	/* virtual address */
+	}
+	mutex_unlock(&allocator->sm_lock);
+
+	if (buf_pa) {
+		/* clear mem */
+		memset(buf_va, 0, usize);
+
+		if (pp_buf_va != NULL)
+			*pp_buf_va = buf_va;
 	}
 	return buf_pa;
 }
@@ -277,17 +309,6 @@ dsp_status cmm_create(OUT struct cmm_object **ph_cmm_mgr,
 		}
 		/* Note: DSP SM seg table(aDSPSMSegTab[]) zero'd by
 		 * MEM_ALLOC_OBJECT */
-		if (DSP_SUCCEEDED(status)) {
-			/* create node free list */
-			cmm_obj->node_free_list_head =
-					kzalloc(sizeof(struct lst_list),
-							GFP_KERNEL);
-			if (cmm_obj->node_free_list_head == NULL)
-				status = -ENOMEM;
-			else
-				INIT_LIST_HEAD(&cmm_obj->
-					       node_free_list_head->head);
-		}
 		if (DSP_SUCCEEDED(status))
 			mutex_init(&cmm_obj->cmm_lock);
 
@@ -313,7 +334,6 @@ dsp_status cmm_destroy(struct cmm_object *hcmm_mgr, bool bForce)
 	struct cmm_info temp_info;
 	dsp_status status = DSP_SOK;
 	s32 slot_seg;
-	struct cmm_mnode *pnode;
 
 	DBC_REQUIRE(refs > 0);
 	if (!hcmm_mgr) {
@@ -343,16 +363,6 @@ dsp_status cmm_destroy(struct cmm_object *hcmm_mgr, bool bForce)
 			}
 		}
 	}
-	if (cmm_mgr_obj->node_free_list_head != NULL) {
-		/* Free the free nodes */
-		while (!LST_IS_EMPTY(cmm_mgr_obj->node_free_list_head)) {
-			pnode = (struct cmm_mnode *)
-			    lst_get_head(cmm_mgr_obj->node_free_list_head);
-			kfree(pnode);
-		}
-		/* delete NodeFreeList list */
-		kfree(cmm_mgr_obj->node_free_list_head);
-	}
 	mutex_unlock(&cmm_mgr_obj->cmm_lock);
 	if (DSP_SUCCEEDED(status)) {
 		/* delete CS & cmm mgr object */
@@ -401,27 +411,22 @@ dsp_status cmm_free_buf(struct cmm_object *hcmm_mgr, void *buf_pa,
 		return status;
 	}
 	/* get the allocator for this segment id */
+	mutex_lock(&cmm_mgr_obj->cmm_lock);
 	allocator = get_allocator(cmm_mgr_obj, ul_seg_id);
+	if (allocator != NULL)
+		mutex_lock(&allocator->sm_lock);
+	mutex_unlock(&cmm_mgr_obj->cmm_lock);
 	if (allocator != NULL) {
-		mutex_lock(&cmm_mgr_obj->cmm_lock);
-		mnode_obj =
-		    (struct cmm_mnode *)lst_first(allocator->in_use_list_head);
-		while (mnode_obj) {
-			if ((u32) buf_pa == mnode_obj->dw_pa) {
-				/* Found it */
-				lst_remove_elem(allocator->in_use_list_head,
-						(struct list_head *)mnode_obj);
-				/* back to freelist */
-				add_to_free_list(allocator, mnode_obj);
-				status = DSP_SOK;	/* all right! */
-				break;
-			}
-			/* next node. */
-			mnode_obj = (struct cmm_mnode *)
-			    lst_next(allocator->in_use_list_head,
-				     (struct list_head *)mnode_obj);
+		mnode_obj = find_node(&allocator->in_use_tree, (u32) buf_pa);
+		if (mnode_obj) {
+			/* Found it */
+			rb_erase(&mnode_obj->rb_link, &allocator->in_use_tree);
+			allocator->ul_in_use_cnt--;
+			/* back to freelist */
+			add_to_free_list(allocator, mnode_obj);
+			status = DSP_SOK;	/* all right! */
 		}
-		mutex_unlock(&cmm_mgr_obj->cmm_lock);
+		mutex_unlock(&allocator->sm_lock);
 	}
 	return status;
 }
@@ -462,7 +467,6 @@ dsp_status cmm_get_info(struct cmm_object *hcmm_mgr,
 	u32 ul_seg;
 	dsp_status status = DSP_SOK;
 	struct cmm_allocator *altr;
-	struct cmm_mnode *mnode_obj = NULL;
 
 	DBC_REQUIRE(cmm_info_obj != NULL);
 
@@ -496,19 +500,13 @@ dsp_status cmm_get_info(struct cmm_object *hcmm_mgr,
 			    altr->ul_dsp_size;
 			cmm_info_obj->seg_info[ul_seg - 1].dw_seg_base_va =
 			    altr->dw_vm_base - altr->ul_dsp_size;
-			cmm_info_obj->seg_info[ul_seg - 1].ul_in_use_cnt = 0;
-			mnode_obj = (struct cmm_mnode *)
-			    lst_first(altr->in_use_list_head);
 			/* Count inUse blocks */
-			while (mnode_obj) {
-				cmm_info_obj->ul_total_in_use_cnt++;
-				cmm_info_obj->seg_info[ul_seg -
-						       1].ul_in_use_cnt++;
-				/* next node. */
-				mnode_obj = (struct cmm_mnode *)
-				    lst_next(altr->in_use_list_head,
-					     (struct list_head *)mnode_obj);
-			}
+			mutex_lock(&altr->sm_lock);
+			cmm_info_obj->seg_info[ul_seg - 1].ul_in_use_cnt =
+			    altr->ul_in_use_cnt;
+			cmm_info_obj->ul_total_in_use_cnt +=
+			    altr->ul_in_use_cnt;
+			mutex_unlock(&altr->sm_lock);
 		}
 	}			/* end for */
 	mutex_unlock(&cmm_mgr_obj->cmm_lock);
@@ -550,6 +548,7 @@ dsp_status cmm_register_gppsm_seg(struct cmm_object *hcmm_mgr,
 	dsp_status status = DSP_SOK;
 	struct cmm_mnode *new_node;
 	s32 slot_seg;
+	u32 bin;
 
 	DBC_REQUIRE(ul_size > 0);
 	DBC_REQUIRE(pulSegId != NULL);
@@ -600,35 +599,24 @@ dsp_status cmm_register_gppsm_seg(struct cmm_object *hcmm_mgr,
 		if (DSP_SUCCEEDED(status)) {
 			/* return the actual segment identifier */
 			*pulSegId = (u32) slot_seg + 1;
-			/* create memory free list */
-			psma->free_list_head = kzalloc(sizeof(struct lst_list),
-								GFP_KERNEL);
-			if (psma->free_list_head == NULL) {
-				status = -ENOMEM;
-				goto func_end;
-			}
-			INIT_LIST_HEAD(&psma->free_list_head->head);
-		}
-		if (DSP_SUCCEEDED(status)) {
-			/* create memory in-use list */
-			psma->in_use_list_head = kzalloc(sizeof(struct
-							lst_list), GFP_KERNEL);
-			if (psma->in_use_list_head == NULL) {
-				status = -ENOMEM;
-				goto func_end;
-			}
-			INIT_LIST_HEAD(&psma->in_use_list_head->head);
+			/* create memory free lists, in-use tree & node list */
+			mutex_init(&psma->sm_lock);
+			for (bin = 0; bin < CMM_NUM_BINS; bin++)
+				psma->free_bins[bin] = RB_ROOT;
+			psma->free_tree = RB_ROOT;
+			psma->in_use_tree = RB_ROOT;
+			INIT_LIST_HEAD(&psma->node_free_list.head);
 		}
 		if (DSP_SUCCEEDED(status)) {
 			/* Get a mem node for this hunk-o-memory */
-			new_node = get_node(cmm_mgr_obj, dw_gpp_base_pa,
+			new_node = get_node(psma, dw_gpp_base_pa,
 					    psma->dw_vm_base, ul_size);
 			/* Place node on the SM allocator's free list */
 			if (new_node) {
-				lst_put_tail(psma->free_list_head,
-					     (struct list_head *)new_node);
+				add_to_free_list(psma, new_node);
 			} else {
 				status = -ENOMEM;
+				un_register_gppsm_seg(psma);
 				goto func_end;
 			}
 		}
@@ -702,49 +690,39 @@ dsp_status cmm_un_register_gppsm_seg(struct cmm_object *hcmm_mgr,
  *      UnRegister the SM allocator by freeing all its resources and
  *      nulling cmm mgr table entry.
  *  Note:
- *      This routine is always called within cmm lock crit sect.
+ *      This routine is always called within cmm lock crit sect.  Taking
+ *      the segment's lock waits for allocations and frees already past
+ *      the lookup; no new ones can find the segment under the cmm lock.
  */
 static void un_register_gppsm_seg(struct cmm_allocator *psma)
 {
 	struct cmm_mnode *mnode_obj = NULL;
-	struct cmm_mnode *next_node = NULL;
+	struct rb_node *rb;
 
 	DBC_REQUIRE(psma != NULL);
-	if (psma->free_list_head != NULL) {
-		/* free nodes on free list */
-		mnode_obj = (struct cmm_mnode *)lst_first(psma->free_list_head);
-		while (mnode_obj) {
-			next_node =
-			    (struct cmm_mnode *)lst_next(psma->free_list_head,
-							 (struct list_head *)
-							 mnode_obj);
-			lst_remove_elem(psma->free_list_head,
-					(struct list_head *)mnode_obj);
-			kfree((void *)mnode_obj);
-			/* next node. */
-			mnode_obj = next_node;
-		}
-		kfree(psma->free_list_head);	/* delete freelist */
-		/* free nodes on InUse list */
-		mnode_obj =
-		    (struct cmm_mnode *)lst_first(psma->in_use_list_head);
-		while (mnode_obj) {
-			next_node =
-			    (struct cmm_mnode *)lst_next(psma->in_use_list_head,
-							 (struct list_head *)
-							 mnode_obj);
-			lst_remove_elem(psma->in_use_list_head,
-					(struct list_head *)mnode_obj);
-			kfree((void *)mnode_obj);
-			/* next node. */
-			mnode_obj = next_node;
-		}
-		kfree(psma->in_use_list_head);	/* delete InUse list */
+	mutex_lock(&psma->sm_lock);
+	/* free nodes on free tree */
+	while ((rb = rb_first(&psma->free_tree)) != NULL) {
+		rb_erase(rb, &psma->free_tree);
+		kfree(rb_entry(rb, struct cmm_mnode, rb_link));
+	}
+	/* free nodes on InUse tree */
+	while ((rb = rb_first(&psma->in_use_tree)) != NULL) {
+		rb_erase(rb, &psma->in_use_tree);
+		kfree(rb_entry(rb, struct cmm_mnode, rb_link));
+	}
+	/* Free the free nodes */
+	while (!LST_IS_EMPTY(&psma->node_free_list)) {
+		mnode_obj = (struct cmm_mnode *)
+		    lst_get_head(&psma->node_free_list);
+		kfree(mnode_obj);
 	}
 	if ((void *)psma->dw_vm_base != NULL)
 		MEM_UNMAP_LINEAR_ADDRESS((void *)psma->dw_vm_base);
+	mutex_unlock(&psma->sm_lock);
 
 	/* Free allocator itself */
+	mutex_destroy(&psma->sm_lock);
 	kfree(psma);
 }
 
@@ -774,22 +752,22 @@ static s32 get_slot(struct cmm_object *cmm_mgr_obj)
  *  Purpose:
  *      Get a memory node from freelist or create a new one.
  */
-static struct cmm_mnode *get_node(struct cmm_object *cmm_mgr_obj, u32 dw_pa,
+static struct cmm_mnode *get_node(struct cmm_allocator *allocator, u32 dw_pa,
 				  u32 dw_va, u32 ul_size)
 {
 	struct cmm_mnode *pnode = NULL;
 
-	DBC_REQUIRE(cmm_mgr_obj != NULL);
+	DBC_REQUIRE(allocator != NULL);
 	DBC_REQUIRE(dw_pa != 0);
 	DBC_REQUIRE(dw_va != 0);
 	DBC_REQUIRE(ul_size != 0);
-	/* Check cmm mgr's node freelist */
-	if (LST_IS_EMPTY(cmm_mgr_obj->node_free_list_head)) {
+	/* Check allocator's node freelist */
+	if (LST_IS_EMPTY(&allocator->node_free_list)) {
 		pnode = kzalloc(sizeof(struct cmm_mnode), GFP_KERNEL);
 	} else {
 		/* surely a valid element */
 		pnode = (struct cmm_mnode *)
-		    lst_get_head(cmm_mgr_obj->node_free_list_head);
+		    lst_get_head(&allocator->node_free_list);
 	}
 	if (pnode) {
 		lst_init_elem((struct list_head *)pnode);	/* set self */
@@ -803,123 +781,223 @@ static struct cmm_mnode *get_node(struct cmm_object *cmm_mgr_obj, u32 dw_pa,
 /*
  *  ======== delete_node ========
  *  Purpose:
- *      Put a memory node on the cmm nodelist for later use.
+ *      Put a memory node on the allocator's nodelist for later use.
  *      Doesn't actually delete the node. Heap thrashing friendly.
  */
-static void delete_node(struct cmm_object *cmm_mgr_obj, struct cmm_mnode *pnode)
+static void delete_node(struct cmm_allocator *allocator,
+			struct cmm_mnode *pnode)
 {
 	DBC_REQUIRE(pnode != NULL);
 	lst_init_elem((struct list_head *)pnode);	/* init .self ptr */
-	lst_put_tail(cmm_mgr_obj->node_free_list_head,
-		     (struct list_head *)pnode);
+	lst_put_tail(&allocator->node_free_list, (struct list_head *)pnode);
+}
+
+/*
+ *  ======== insert_node ========
+ *  Purpose:
+ *      Insert a node into an address ordered tree of nodes.
+ */
+static void insert_node(struct rb_root *root, struct cmm_mnode *pnode)
+{
+	struct rb_node **p = &root->rb_node;
+	struct rb_node *parent = NULL;
+	struct cmm_mnode *mnode_obj;
+
+	while (*p) {
+		parent = *p;
+		mnode_obj = rb_entry(parent, struct cmm_mnode, rb_link);
+		if (pnode->dw_pa < mnode_obj->dw_pa)
+			p = &(*p)->rb_left;
+		else
+			p = &(*p)->rb_right;
+	}
+	rb_link_node(&pnode->rb_link, parent, p);
+	rb_insert_color(&pnode->rb_link, root);
+}
+
+/*
+ *  ======== find_node ========
+ *  Purpose:
+ *      Return the node starting at dw_pa in an address ordered tree.
+ */
+static struct cmm_mnode *find_node(struct rb_root *root, u32 dw_pa)
+{
+	struct rb_node *n = root->rb_node;
+	struct cmm_mnode *mnode_obj;
+
+	while (n) {
+		mnode_obj = rb_entry(n, struct cmm_mnode, rb_link);
+		if (dw_pa < mnode_obj->dw_pa)
+			n = n->rb_left;
+		else if (dw_pa > mnode_obj->dw_pa)
+			n = n->rb_right;
+		else
+			return mnode_obj;
+	}
+	return NULL;
+}
+
+/*
+ *  ======== find_prev_node ========
+ *  Purpose:
+ *      Return the node with the highest address below dw_pa in an address
+ *      ordered tree.
+ */
+static struct cmm_mnode *find_prev_node(struct rb_root *root, u32 dw_pa)
+{
+	struct rb_node *n = root->rb_node;
+	struct cmm_mnode *mnode_obj;
+	struct cmm_mnode *prev = NULL;
+
+	while (n) {
+		mnode_obj = rb_entry(n, struct cmm_mnode, rb_link);
+		if (mnode_obj->dw_pa < dw_pa) {
+			prev = mnode_obj;
+			n = n->rb_right;
+		} else {
+			n = n->rb_left;
+		}
+	}
+	return prev;
+}
+
+/*
+ *  ======== insert_size_node ========
+ *  Purpose:
+ *      Insert a node into a free bin tree, ordered by size and then by
+ *      address.
+ */
+static void insert_size_node(struct rb_root *root, struct cmm_mnode *pnode)
+{
+	struct rb_node **p = &root->rb_node;
+	struct rb_node *parent = NULL;
+	struct cmm_mnode *mnode_obj;
+
+	while (*p) {
+		parent = *p;
+		mnode_obj = rb_entry(parent, struct cmm_mnode, size_link);
+		if (pnode->ul_size < mnode_obj->ul_size ||
+		    (pnode->ul_size == mnode_obj->ul_size &&
+		     pnode->dw_pa < mnode_obj->dw_pa))
+			p = &(*p)->rb_left;
+		else
+			p = &(*p)->rb_right;
+	}
+	rb_link_node(&pnode->size_link, parent, p);
+	rb_insert_color(&pnode->size_link, root);
+}
+
+/*
+ *  ======== find_fit_node ========
+ *  Purpose:
+ *      Return the smallest node of at least usize bytes in a free bin tree.
+ */
+static struct cmm_mnode *find_fit_node(struct rb_root *root, u32 usize)
+{
+	struct rb_node *n = root->rb_node;
+	struct cmm_mnode *mnode_obj;
+	struct cmm_mnode *fit = NULL;
+
+	while (n) {
+		mnode_obj = rb_entry(n, struct cmm_mnode, size_link);
+		if (mnode_obj->ul_size >= usize) {
+			fit = mnode_obj;
+			n = n->rb_left;
+		} else {
+			n = n->rb_right;
+		}
+	}
+	return fit;
+}
+
+/*
+ *  ======== remove_free_node ========
+ *  Purpose:
+ *      Take a node off the allocator's free bins and free tree.
+ */
+static void remove_free_node(struct cmm_allocator *allocator,
+			     struct cmm_mnode *pnode)
+{
+	u32 bin = SIZE_TO_BIN(pnode->ul_size);
+
+	rb_erase(&pnode->size_link, &allocator->free_bins[bin]);
+	if (RB_EMPTY_ROOT(&allocator->free_bins[bin]))
+		__clear_bit(bin, &allocator->bin_map);
+	rb_erase(&pnode->rb_link, &allocator->free_tree);
 }
 
 /*
  * ====== get_free_block ========
  *  Purpose:
- *      Scan the free block list and return the first block that satisfies
- *      the size.
+ *      Return a free block that satisfies the size: the smallest fitting
+ *      block in the size's own bin, else the smallest block of the next
+ *      non-empty bin, all of whose blocks are large enough.  Either is a
+ *      single tree lookup.
  */
 static struct cmm_mnode *get_free_block(struct cmm_allocator *allocator,
 					u32 usize)
 {
-	if (allocator) {
-		struct cmm_mnode *mnode_obj = (struct cmm_mnode *)
-		    lst_first(allocator->free_list_head);
-		while (mnode_obj) {
-			if (usize <= (u32) mnode_obj->ul_size) {
-				lst_remove_elem(allocator->free_list_head,
-						(struct list_head *)mnode_obj);
-				return mnode_obj;
-			}
-			/* next node. */
-			mnode_obj = (struct cmm_mnode *)
-			    lst_next(allocator->free_list_head,
-				     (struct list_head *)mnode_obj);
-		}
+	struct cmm_mnode *mnode_obj;
+	u32 bin;
+
+	if (!allocator)
+		return NULL;
+
+	bin = SIZE_TO_BIN(usize);
+	mnode_obj = find_fit_node(&allocator->free_bins[bin], usize);
+	if (!mnode_obj) {
+		bin = find_next_bit(&allocator->bin_map, CMM_NUM_BINS,
+				    bin + 1);
+		if (bin >= CMM_NUM_BINS)
+			return NULL;
+
+		mnode_obj = rb_entry(rb_first(&allocator->free_bins[bin]),
+				     struct cmm_mnode, size_link);
 	}
-	return NULL;
+	remove_free_node(allocator, mnode_obj);
+	return mnode_obj;
 }
 
 /*
  *  ======== add_to_free_list ========
  *  Purpose:
- *      Coelesce node into the freelist in ascending size order.
+ *      Coelesce node with its free neighbours, found in the address tree,
+ *      and put the result on the free bin for its size.
  */
 static void add_to_free_list(struct cmm_allocator *allocator,
 			     struct cmm_mnode *pnode)
 {
-	struct cmm_mnode *node_prev = NULL;
-	struct cmm_mnode *node_next = NULL;
-	struct cmm_mnode *mnode_obj;
-	u32 dw_this_pa;
-	u32 dw_next_pa;
+	struct cmm_mnode *node_prev;
+	struct cmm_mnode *node_next;
+	u32 bin;
 
 	DBC_REQUIRE(pnode != NULL);
 	DBC_REQUIRE(allocator != NULL);
-	dw_this_pa = pnode->dw_pa;
-	dw_next_pa = NEXT_PA(pnode);
-	mnode_obj = (struct cmm_mnode *)lst_first(allocator->free_list_head);
-	while (mnode_obj) {
-		if (dw_this_pa == NEXT_PA(mnode_obj)) {
-			/* found the block ahead of this one */
-			node_prev = mnode_obj;
-		} else if (dw_next_pa == mnode_obj->dw_pa) {
-			node_next = mnode_obj;
-		}
-		if ((node_prev == NULL) || (node_next == NULL)) {
-			/* next node. */
-			mnode_obj = (struct cmm_mnode *)
-			    lst_next(allocator->free_list_head,
-				     (struct list_head *)mnode_obj);
-		} else {
-			/* got 'em */
-			break;
-		}
-	}			/* while */
-	if (node_prev != NULL) {
+	node_prev = find_prev_node(&allocator->free_tree, pnode->dw_pa);
+	if (node_prev != NULL && NEXT_PA(node_prev) == pnode->dw_pa) {
 		/* combine with previous block */
-		lst_remove_elem(allocator->free_list_head,
-				(struct list_head *)node_prev);
+		remove_free_node(allocator, node_prev);
 		/* grow node to hold both */
 		pnode->ul_size += node_prev->ul_size;
 		pnode->dw_pa = node_prev->dw_pa;
 		pnode->dw_va = node_prev->dw_va;
-		/* place node on mgr nodeFreeList */
-		delete_node((struct cmm_object *)allocator->hcmm_mgr,
-			    node_prev);
+		/* place node on allocator nodeFreeList */
+		delete_node(allocator, node_prev);
 	}
+	node_next = find_node(&allocator->free_tree, NEXT_PA(pnode));
 	if (node_next != NULL) {
 		/* combine with next block */
-		lst_remove_elem(allocator->free_list_head,
-				(struct list_head *)node_next);
+		remove_free_node(allocator, node_next);
 		/* grow da node */
 		pnode->ul_size += node_next->ul_size;
-		/* place node on mgr nodeFreeList */
-		delete_node((struct cmm_object *)allocator->hcmm_mgr,
-			    node_next);
-	}
-	/* Now, let's add to freelist in increasing size order */
-	mnode_obj = (struct cmm_mnode *)lst_first(allocator->free_list_head);
-	while (mnode_obj) {
-		if (pnode->ul_size <= mnode_obj->ul_size)
-			break;
-
-		/* next node. */
-		mnode_obj =
-		    (struct cmm_mnode *)lst_next(allocator->free_list_head,
-						 (struct list_head *)mnode_obj);
-	}
-	/* if mnode_obj is NULL then add our pnode to the end of the freelist */
-	if (mnode_obj == NULL) {
-		lst_put_tail(allocator->free_list_head,
-			     (struct list_head *)pnode);
-	} else {
-		/* insert our node before the current traversed node */
-		lst_insert_before(allocator->free_list_head,
-				  (struct list_head *)pnode,
-				  (struct list_head *)mnode_obj);
+		/* place node on allocator nodeFreeList */
+		delete_node(allocator, node_next);
 	}
+	/* Now, let's add to the bin for its size and the address tree */
+	bin = SIZE_TO_BIN(pnode->ul_size);
+	insert_size_node(&allocator->free_bins[bin], pnode);
+	__set_bit(bin, &allocator->bin_map);
+	insert_node(&allocator->free_tree, pnode);
 }
 
 /*
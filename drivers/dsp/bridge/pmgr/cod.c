@@ -91,6 +91,7 @@ static struct dbll_fxns ldr_fxns = {
 	(dbll_set_attrs_fxn) dbll_set_attrs,
 	(dbll_unload_fxn) dbll_unload,
 	(dbll_unload_sect_fxn) dbll_unload_sect,
+	(dbll_invalidate_fxn) dbll_invalidate,
 };
 
 static bool no_op(void);
@@ -174,6 +175,24 @@ static s32 cod_f_seek(struct file *filp, s32 lOffset, s32 cOrigin)
 	return 0;
 }
 
+static s32 cod_f_stamp(struct file *filp, struct dbll_file_stamp *stamp)
+{
+	struct inode *inode;
+
+	/* check for valid file handle */
+	if (!filp)
+		return -EFAULT;
+
+	inode = filp->f_path.dentry->d_inode;
+	stamp->ino = (u32) inode->i_ino;
+	stamp->size = (u32) i_size_read(inode);
+	stamp->mtime_sec = (u32) inode->i_mtime.tv_sec;
+	stamp->mtime_nsec = (u32) inode->i_mtime.tv_nsec;
+
+	/* we can't use DSP_SOK here */
+	return 0;
+}
+
 static s32 cod_f_tell(struct file *filp)
 {
 	loff_t dw_cur_pos;
@@ -252,6 +271,7 @@ dsp_status cod_create(OUT struct cod_manager **phMgr, char *pstrDummyFile,
 	zl_attrs.ftell = (dbll_tell_fxn) cod_f_tell;
 	zl_attrs.fclose = (dbll_f_close_fxn) cod_f_close;
 	zl_attrs.fopen = (dbll_f_open_fxn) cod_f_open;
+	zl_attrs.fstamp = (dbll_f_stamp_fxn) cod_f_stamp;
 	zl_attrs.sym_lookup = NULL;
 	zl_attrs.base_image = true;
 	zl_attrs.log_write = NULL;
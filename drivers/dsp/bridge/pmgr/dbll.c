@@ -37,7 +37,7 @@
 #include <dspbridge/rmm.h>
 
 /* Number of buckets for symbol hash table */
-#define MAXBUCKETS 211
+#define MAXBUCKETS 1021
 
 /* Max buffer length */
 #define MAXEXPR 128
@@ -47,6 +47,56 @@
 #endif
 #define DOFF_ALIGN(x) (((x) + 3) & ~UINT32_C(3))
 
+/* Upper bound on host memory held by cached, relocated library images */
+#define DBLL_IMG_CACHE_SIZE	(1024 * 1024)
+
+/* Loads whose key (headers, placement, imports) is larger are not cached */
+#define DBLL_IMG_KEY_SIZE	(64 * 1024)
+
+/* Closed libraries kept with their symbol tables for the next open */
+#define DBLL_IDLE_LIBS		8
+
+/* Image cache state of a library while dbll_load() runs */
+#define DBLL_IMG_IDLE		0	/* not cacheable, or load finished */
+#define DBLL_IMG_KEYING		1	/* keying headers, placement, imports */
+#define DBLL_IMG_RECORDING	2	/* copying target writes into img_rec */
+#define DBLL_IMG_RECORDED	3	/* image complete, awaiting load result */
+
+/*
+ *  ======== dbll_img_rec ========
+ *  One write_mem() or fill_mem() call made while loading a library.
+ */
+struct dbll_img_rec {
+	struct list_head link;
+	u32 addr;		/* Target address */
+	u32 bytes;		/* Bytes written or filled */
+	u32 mem_sect_type;	/* DBLL_CODE or DBLL_DATA */
+	bool fill;		/* fill_mem() with val, no data */
+	u8 val;
+	u8 data[0];
+};
+
+/*
+ *  ======== dbll_img ========
+ *  Relocated image of a library, keyed by file name, the stamp of the
+ *  file, the DOFF headers, the addresses the sections were allocated at
+ *  and the values of every symbol imported from other libraries. If all
+ *  of them match on a later load, relocating the image again would
+ *  produce exactly the same bytes, so the writes are replayed instead.
+ *  The key bytes are kept and compared in full; their hash only picks
+ *  the candidates.
+ */
+struct dbll_img {
+	struct list_head link;	/* Target's cache, most recently used first */
+	struct list_head recs;	/* List of dbll_img_rec, in write order */
+	char *file_name;
+	struct dbll_file_stamp stamp;	/* File the image was loaded from */
+	u32 key;		/* Hash of key_data */
+	u8 *key_data;		/* Everything the key was built from */
+	u32 key_len;
+	u32 size;		/* Bytes of image data held */
+};
+
 /*
  *  ======== struct dbll_tar_obj* ========
  *  A target may have one or more libraries of symbols/code/data loaded
@@ -59,6 +109,12 @@
 struct dbll_tar_obj {
 	struct dbll_attrs attrs;
 	struct dbll_library_obj *head;	/* List of all opened libraries */
+	struct list_head img_cache;	/* Cached images, dbll_img */
+	u32 img_cache_size;	/* Bytes held by img_cache */
+	struct list_head idle_libs;	/* Closed libraries, most recent first */
+	u32 idle_count;
+	u32 img_hits;
+	u32 img_misses;
 };
 
 /*
@@ -128,6 +184,17 @@ struct dbll_library_obj {
 	u32 load_ref;		/* Number of times loaded */
 	struct gh_t_hash_tab *sym_tab;	/* Hash table of symbols */
 	u32 ul_pos;
+	u32 img_state;		/* DBLL_IMG_* */
+	u32 img_key;		/* Running hash while DBLL_IMG_KEYING */
+	u8 *img_key_data;	/* Bytes hashed into img_key so far */
+	u32 img_key_len;
+	u32 img_key_max;	/* Allocated size of img_key_data */
+	struct dbll_file_stamp img_stamp;	/* Of fp, while not IDLE */
+	struct dbll_img *img_rec;	/* Image being recorded */
+	struct list_head idle_link;	/* In target's idle_libs if closed */
+	bool sym_stamped;	/* sym_stamp is valid */
+	struct dbll_file_stamp sym_stamp;	/* Of the file sym_tab was read
+						 * from */
 };
 
 /*
@@ -136,6 +203,18 @@ struct dbll_library_obj {
 struct dbll_symbol {
 	struct dbll_sym_val value;
 	char *name;
+	u32 hash;		/* Cached name_hash value of name */
+};
+
+/*
+ *  ======== dbll_sym_key ========
+ *  Key used for symbol table lookups. The hash of the name is computed
+ *  once per lookup and compared against the cached hash of each symbol
+ *  on the chain before falling back to strcmp().
+ */
+struct dbll_sym_key {
+	const char *name;
+	u32 hash;
 };
 extern bool symbols_reloaded;
 
@@ -187,8 +266,25 @@ static int fill_mem(struct dynamic_loader_initialize *this, ldr_addr addr,
 		    unsigned val);
 static int execute(struct dynamic_loader_initialize *this, ldr_addr start);
 static void release(struct dynamic_loader_initialize *this);
+static int cached_image(struct dynamic_loader_initialize *this, int done);
+
+/* relocated image cache */
+static void img_key_mix(struct dbll_library_obj *lib, const void *buf,
+			u32 bytes);
+static bool img_record(struct dbll_library_obj *lib, u32 addr, void *buf,
+		       u32 bytes, u32 mem_sect_type, bool fill, u8 val);
+static void img_abandon(struct dbll_library_obj *lib);
+static void img_commit(struct dbll_library_obj *lib);
+static void img_free(struct dbll_tar_obj *target, struct dbll_img *img);
+
+/* closed library cache */
+static bool lib_stamp(struct dbll_library_obj *lib,
+		      struct dbll_file_stamp *stamp);
+static void lib_free(struct dbll_library_obj *zl_lib);
 
 /* symbol table hash functions */
+static u32 sym_hash(const char *name);
+static inline void sym_key_init(struct dbll_sym_key *key, const char *name);
 static u16 name_hash(void *name, u16 max_bucket);
 static bool name_match(void *name, void *sp);
 static void sym_delete(void *sp);
@@ -201,6 +297,11 @@ static int gbl_search = 1;
 
 /*
  *  ======== dbll_close ========
+ *  The last close of a library with a symbol table does not free it: it
+ *  stays on the target's list, on idle_libs, so that the next dbll_open()
+ *  and dbll_load() of the same file reuse the table. Only the oldest idle
+ *  library beyond DBLL_IDLE_LIBS, and all of them in dbll_delete(), are
+ *  freed.
  */
 void dbll_close(struct dbll_library_obj *zl_lib)
 {
@@ -211,28 +312,24 @@ void dbll_close(struct dbll_library_obj *zl_lib)
 	DBC_REQUIRE(zl_lib->open_ref > 0);
 	zl_target = zl_lib->target_obj;
 	zl_lib->open_ref--;
-	if (zl_lib->open_ref == 0) {
-		/* Remove library from list */
-		if (zl_target->head == zl_lib)
-			zl_target->head = zl_lib->next;
-
-		if (zl_lib->prev)
-			(zl_lib->prev)->next = zl_lib->next;
-
-		if (zl_lib->next)
-			(zl_lib->next)->prev = zl_lib->prev;
+	if (zl_lib->open_ref != 0)
+		return;
 
-		/* Free DOF resources */
-		dof_close(zl_lib);
-		kfree(zl_lib->file_name);
-
-		/* remove symbols from symbol table */
-		if (zl_lib->sym_tab)
-			gh_delete(zl_lib->sym_tab);
+	if (zl_lib->sym_tab == NULL || !zl_lib->sym_stamped ||
+	    zl_lib->load_ref != 0) {
+		lib_free(zl_lib);
+		return;
+	}
 
-		/* remove the library object itself */
-		kfree(zl_lib);
-		zl_lib = NULL;
+	/* Free DOF resources, the file is opened again on reuse */
+	dof_close(zl_lib);
+	list_add(&zl_lib->idle_link, &zl_target->idle_libs);
+	if (++zl_target->idle_count > DBLL_IDLE_LIBS) {
+		zl_lib = list_entry(zl_target->idle_libs.prev,
+				    struct dbll_library_obj, idle_link);
+		list_del(&zl_lib->idle_link);
+		zl_target->idle_count--;
+		lib_free(zl_lib);
 	}
 }
 
@@ -257,6 +354,8 @@ dsp_status dbll_create(struct dbll_tar_obj **target_obj,
 			status = -ENOMEM;
 		} else {
 			pzl_target->attrs = *pattrs;
+			INIT_LIST_HEAD(&pzl_target->img_cache);
+			INIT_LIST_HEAD(&pzl_target->idle_libs);
 			*target_obj = (struct dbll_tar_obj *)pzl_target;
 		}
 		DBC_ENSURE((DSP_SUCCEEDED(status) && *target_obj) ||
@@ -272,12 +371,22 @@ dsp_status dbll_create(struct dbll_tar_obj **target_obj,
 void dbll_delete(struct dbll_tar_obj *target)
 {
 	struct dbll_tar_obj *zl_target = (struct dbll_tar_obj *)target;
+	struct dbll_img *img, *tmp;
+	struct dbll_library_obj *zl_lib, *next;
 
 	DBC_REQUIRE(refs > 0);
 	DBC_REQUIRE(zl_target);
 
-	if (zl_target != NULL)
+	if (zl_target != NULL) {
+		dev_dbg(bridge, "%s: image cache hits %u misses %u\n",
+			__func__, zl_target->img_hits, zl_target->img_misses);
+		list_for_each_entry_safe(img, tmp, &zl_target->img_cache, link)
+			img_free(zl_target, img);
+		list_for_each_entry_safe(zl_lib, next, &zl_target->idle_libs,
+					 idle_link)
+			lib_free(zl_lib);
 		kfree(zl_target);
+	}
 
 }
 
@@ -305,6 +414,7 @@ bool dbll_get_addr(struct dbll_library_obj *zl_lib, char *name,
 		   struct dbll_sym_val **ppSym)
 {
 	struct dbll_symbol *sym;
+	struct dbll_sym_key key;
 	bool status = false;
 
 	DBC_REQUIRE(refs > 0);
@@ -313,7 +423,8 @@ bool dbll_get_addr(struct dbll_library_obj *zl_lib, char *name,
 	DBC_REQUIRE(ppSym != NULL);
 	DBC_REQUIRE(zl_lib->sym_tab != NULL);
 
-	sym = (struct dbll_symbol *)gh_find(zl_lib->sym_tab, name);
+	sym_key_init(&key, name);
+	sym = (struct dbll_symbol *)gh_find(zl_lib->sym_tab, &key);
 	if (sym != NULL) {
 		*ppSym = &sym->value;
 		status = true;
@@ -349,6 +460,7 @@ bool dbll_get_c_addr(struct dbll_library_obj *zl_lib, char *name,
 		     struct dbll_sym_val **ppSym)
 {
 	struct dbll_symbol *sym;
+	struct dbll_sym_key key;
 	char cname[MAXEXPR + 1];
 	bool status = false;
 
@@ -364,7 +476,8 @@ bool dbll_get_c_addr(struct dbll_library_obj *zl_lib, char *name,
 	cname[MAXEXPR] = '\0';	/* insure '\0' string termination */
 
 	/* Check for C name, if not found */
-	sym = (struct dbll_symbol *)gh_find(zl_lib->sym_tab, cname);
+	sym_key_init(&key, cname);
+	sym = (struct dbll_symbol *)gh_find(zl_lib->sym_tab, &key);
 
 	if (sym != NULL) {
 		*ppSym = &sym->value;
@@ -449,6 +562,32 @@ bool dbll_init(void)
 	return true;
 }
 
+/*
+ *  ======== dbll_invalidate ========
+ *  Drop cached images that write to target memory in [addr, addr + size).
+ */
+void dbll_invalidate(struct dbll_tar_obj *target, u32 addr, u32 size)
+{
+	struct dbll_tar_obj *zl_target = (struct dbll_tar_obj *)target;
+	struct dbll_img *img, *tmp;
+	struct dbll_img_rec *rec;
+
+	DBC_REQUIRE(refs > 0);
+	DBC_REQUIRE(zl_target);
+
+	list_for_each_entry_safe(img, tmp, &zl_target->img_cache, link) {
+		list_for_each_entry(rec, &img->recs, link) {
+			if (rec->addr < addr + size &&
+			    addr < rec->addr + rec->bytes) {
+				dev_dbg(bridge, "%s: dropping image of %s\n",
+					__func__, img->file_name);
+				img_free(zl_target, img);
+				break;
+			}
+		}
+	}
+}
+
 /*
  *  ======== dbll_load ========
  */
@@ -461,11 +600,19 @@ dsp_status dbll_load(struct dbll_library_obj *lib, dbll_flags flags,
 	s32 err;
 	dsp_status status = DSP_SOK;
 	bool opened_doff = false;
+#ifdef OPT_LOAD_TIME_INSTRUMENTATION
+	struct timeval tv1;
+	struct timeval tv2;
+#endif
 	DBC_REQUIRE(refs > 0);
 	DBC_REQUIRE(zl_lib);
 	DBC_REQUIRE(pEntry != NULL);
 	DBC_REQUIRE(attrs != NULL);
 
+#ifdef OPT_LOAD_TIME_INSTRUMENTATION
+	do_gettimeofday(&tv1);
+#endif
+
 	/*
 	 *  Load if not already loaded.
 	 */
@@ -517,7 +664,21 @@ dsp_status dbll_load(struct dbll_library_obj *lib, dbll_flags flags,
 		zl_lib->init.dl_init.fillmem = fill_mem;
 		zl_lib->init.dl_init.execute = execute;
 		zl_lib->init.dl_init.release = release;
+		zl_lib->init.dl_init.cached_image = cached_image;
 		zl_lib->init.lib = zl_lib;
+		/*
+		 * Dynamic libraries are loaded over and over as nodes come
+		 * and go; collect what is needed to recognise a repeated load
+		 * at the same addresses. Images written through log_write
+		 * (overlay bookkeeping) are never cached.
+		 */
+		zl_lib->img_state = DBLL_IMG_IDLE;
+		if ((flags & DBLL_DYNAMIC) && dbzl->attrs.write &&
+		    !dbzl->attrs.log_write) {
+			zl_lib->img_state = DBLL_IMG_KEYING;
+			zl_lib->img_key = sym_hash(zl_lib->file_name);
+			zl_lib->img_key_len = 0;
+		}
 		/* If COFF file is not open, we open it. */
 		if (zl_lib->fp == NULL) {
 			status = dof_open(zl_lib);
@@ -525,6 +686,16 @@ dsp_status dbll_load(struct dbll_library_obj *lib, dbll_flags flags,
 				opened_doff = true;
 
 		}
+		/* Without the file's stamp, a rebuilt library could not be
+		 * told from the one cached */
+		if (DSP_SUCCEEDED(status) &&
+		    zl_lib->img_state == DBLL_IMG_KEYING &&
+		    !lib_stamp(zl_lib, &zl_lib->img_stamp))
+			zl_lib->img_state = DBLL_IMG_IDLE;
+		/* A new symbol table is only reused while the file stays */
+		if (DSP_SUCCEEDED(status) && !got_symbols)
+			zl_lib->sym_stamped = lib_stamp(zl_lib,
+							&zl_lib->sym_stamp);
 		if (DSP_SUCCEEDED(status)) {
 			zl_lib->ul_pos = (*(zl_lib->target_obj->attrs.ftell))
 			    (zl_lib->fp);
@@ -544,6 +715,9 @@ dsp_status dbll_load(struct dbll_library_obj *lib, dbll_flags flags,
 						  DLOAD_INITBSS,
 						  &zl_lib->dload_mod_obj);
 
+			if (err == 0 && !redefined_symbol)
+				img_commit(zl_lib);
+
 			if (err != 0) {
 				status = DSP_EDYNLOAD;
 			} else if (redefined_symbol) {
@@ -563,10 +737,23 @@ dsp_status dbll_load(struct dbll_library_obj *lib, dbll_flags flags,
 	if (opened_doff)
 		dof_close(zl_lib);
 
+	/* Drop a partial image; no-op after img_commit() */
+	img_abandon(zl_lib);
+
 	DBC_ENSURE(DSP_FAILED(status) || zl_lib->load_ref > 0);
 
 	dev_dbg(bridge, "%s: lib: %p flags: 0x%x pEntry: %p, status 0x%x\n",
 		__func__, lib, flags, pEntry, status);
+#ifdef OPT_LOAD_TIME_INSTRUMENTATION
+	do_gettimeofday(&tv2);
+	if (tv2.tv_usec < tv1.tv_usec) {
+		tv2.tv_usec += 1000000;
+		tv2.tv_sec--;
+	}
+	dev_dbg(bridge, "%s: %s: symbols %s, time to load %ld sec and %ld usec\n",
+		__func__, zl_lib->file_name, got_symbols ? "reused" : "built",
+		tv2.tv_sec - tv1.tv_sec, tv2.tv_usec - tv1.tv_usec);
+#endif
 
 	return status;
 }
@@ -591,6 +778,9 @@ dsp_status dbll_open(struct dbll_tar_obj *target, char *file, dbll_flags flags,
 {
 	struct dbll_tar_obj *zl_target = (struct dbll_tar_obj *)target;
 	struct dbll_library_obj *zl_lib = NULL;
+	struct dbll_file_stamp stamp;
+	bool new_lib = false;
+	bool was_idle = false;
 	s32 err;
 	dsp_status status = DSP_SOK;
 
@@ -603,7 +793,12 @@ dsp_status dbll_open(struct dbll_tar_obj *target, char *file, dbll_flags flags,
 	zl_lib = zl_target->head;
 	while (zl_lib != NULL) {
 		if (strcmp(zl_lib->file_name, file) == 0) {
-			/* Library is already opened */
+			/* Library is already opened, or idle since closed */
+			if (zl_lib->open_ref == 0) {
+				list_del(&zl_lib->idle_link);
+				zl_target->idle_count--;
+				was_idle = true;
+			}
 			zl_lib->open_ref++;
 			break;
 		}
@@ -615,6 +810,7 @@ dsp_status dbll_open(struct dbll_tar_obj *target, char *file, dbll_flags flags,
 		if (zl_lib == NULL) {
 			status = -ENOMEM;
 		} else {
+			new_lib = true;
 			zl_lib->ul_pos = 0;
 			/* Increment ref count to allow close on failure
 			 * later on */
@@ -661,10 +857,20 @@ dsp_status dbll_open(struct dbll_tar_obj *target, char *file, dbll_flags flags,
 	zl_lib->init.dl_init.fillmem = fill_mem;
 	zl_lib->init.dl_init.execute = execute;
 	zl_lib->init.dl_init.release = release;
+	zl_lib->init.dl_init.cached_image = cached_image;
 	zl_lib->init.lib = zl_lib;
 	if (DSP_SUCCEEDED(status) && zl_lib->fp == NULL)
 		status = dof_open(zl_lib);
 
+	/* The file may have been replaced while the library was idle */
+	if (DSP_SUCCEEDED(status) && was_idle &&
+	    (!lib_stamp(zl_lib, &stamp) ||
+	     memcmp(&stamp, &zl_lib->sym_stamp, sizeof(stamp)))) {
+		gh_delete(zl_lib->sym_tab);
+		zl_lib->sym_tab = NULL;
+		zl_lib->sym_stamped = false;
+	}
+
 	zl_lib->ul_pos = (*(zl_lib->target_obj->attrs.ftell)) (zl_lib->fp);
 	(*(zl_lib->target_obj->attrs.fseek)) (zl_lib->fp, (long)0, SEEK_SET);
 	/* Create a hash table for symbols if flag is set */
@@ -677,6 +883,7 @@ dsp_status dbll_open(struct dbll_tar_obj *target, char *file, dbll_flags flags,
 	if (zl_lib->sym_tab == NULL) {
 		status = -ENOMEM;
 	} else {
+		zl_lib->sym_stamped = lib_stamp(zl_lib, &zl_lib->sym_stamp);
 		/* Do a fake load to get symbols - set write func to no_op */
 		zl_lib->init.dl_init.writemem = no_op;
 		err = dynamic_open_module(&zl_lib->stream.dl_stream,
@@ -700,7 +907,7 @@ dsp_status dbll_open(struct dbll_tar_obj *target, char *file, dbll_flags flags,
 	}
 func_cont:
 	if (DSP_SUCCEEDED(status)) {
-		if (zl_lib->open_ref == 1) {
+		if (new_lib) {
 			/* First time opened - insert in list */
 			if (zl_target->head)
 				(zl_target->head)->prev = zl_lib;
@@ -840,11 +1047,12 @@ void dbll_unload(struct dbll_library_obj *lib, struct dbll_attrs *attrs)
 			dev_dbg(bridge, "%s: failed: 0x%x\n", __func__, err);
 		}
 	}
-	/* remove symbols from symbol table */
-	if (zl_lib->sym_tab != NULL) {
-		gh_delete(zl_lib->sym_tab);
-		zl_lib->sym_tab = NULL;
-	}
+	/*
+	 * The symbol table is kept, past dbll_close() too: the names do
+	 * not change between loads of the same file, and the next
+	 * dbll_load() refills the values in place through
+	 * find_in_symbol_table() instead of rebuilding the whole table.
+	 */
 	/* delete DOFF desc since it holds *lots* of host OS
 	 * resources */
 	dof_close(zl_lib);
@@ -881,6 +1089,48 @@ static void dof_close(struct dbll_library_obj *zl_lib)
 	}
 }
 
+/*
+ *  ======== lib_stamp ========
+ *  Stamp of the library's open file. Returns false if there is none.
+ */
+static bool lib_stamp(struct dbll_library_obj *lib,
+		      struct dbll_file_stamp *stamp)
+{
+	dbll_f_stamp_fxn fstamp = lib->target_obj->attrs.fstamp;
+
+	return lib->fp && fstamp && (*fstamp) (lib->fp, stamp) == 0;
+}
+
+/*
+ *  ======== lib_free ========
+ *  Unlink a library from its target and free it.
+ */
+static void lib_free(struct dbll_library_obj *zl_lib)
+{
+	struct dbll_tar_obj *zl_target = zl_lib->target_obj;
+
+	/* Remove library from list */
+	if (zl_target->head == zl_lib)
+		zl_target->head = zl_lib->next;
+
+	if (zl_lib->prev)
+		(zl_lib->prev)->next = zl_lib->next;
+
+	if (zl_lib->next)
+		(zl_lib->next)->prev = zl_lib->prev;
+
+	/* Free DOF resources */
+	dof_close(zl_lib);
+	kfree(zl_lib->file_name);
+
+	/* remove symbols from symbol table */
+	if (zl_lib->sym_tab)
+		gh_delete(zl_lib->sym_tab);
+
+	/* remove the library object itself */
+	kfree(zl_lib);
+}
+
 /*
  *  ======== dof_open ========
  */
@@ -913,39 +1163,62 @@ static dsp_status dof_open(struct dbll_library_obj *zl_lib)
 }
 
 /*
- *  ======== name_hash ========
+ *  ======== sym_hash ========
+ *  32-bit FNV-1a over the whole name. DSP symbol names share long
+ *  prefixes (_ti_sdo_..., _VIDDEC_...), so every character has to
+ *  contribute to the hash to keep the chains short.
  */
-static u16 name_hash(void *key, u16 max_bucket)
+static u32 sym_hash(const char *name)
 {
-	u16 ret;
-	u16 hash;
-	char *name = (char *)key;
+	u32 hash = 2166136261u;
 
 	DBC_REQUIRE(name != NULL);
 
-	hash = 0;
-
 	while (*name) {
-		hash <<= 1;
-		hash ^= *name++;
+		hash ^= (u8) *name++;
+		hash *= 16777619u;
 	}
 
-	ret = hash % max_bucket;
+	return hash;
+}
 
-	return ret;
+/*
+ *  ======== sym_key_init ========
+ */
+static inline void sym_key_init(struct dbll_sym_key *key, const char *name)
+{
+	key->name = name;
+	key->hash = sym_hash(name);
+}
+
+/*
+ *  ======== name_hash ========
+ */
+static u16 name_hash(void *key, u16 max_bucket)
+{
+	struct dbll_sym_key *sym_key = (struct dbll_sym_key *)key;
+
+	DBC_REQUIRE(sym_key != NULL);
+
+	return sym_key->hash % max_bucket;
 }
 
 /*
  *  ======== name_match ========
+ *  Compare the cached hashes first; strcmp() only runs on a real hit or
+ *  a full 32-bit collision.
  */
 static bool name_match(void *key, void *value)
 {
+	struct dbll_sym_key *sym_key = (struct dbll_sym_key *)key;
+	struct dbll_symbol *sym = (struct dbll_symbol *)value;
+
 	DBC_REQUIRE(key != NULL);
 	DBC_REQUIRE(value != NULL);
 
-	if ((key != NULL) && (value != NULL)) {
-		if (strcmp((char *)key, ((struct dbll_symbol *)value)->name) ==
-		    0)
+	if ((sym_key != NULL) && (sym != NULL)) {
+		if (sym_key->hash == sym->hash &&
+		    strcmp(sym_key->name, sym->name) == 0)
 			return true;
 	}
 	return false;
@@ -993,6 +1266,8 @@ static int dbll_read_buffer(struct dynamic_loader_stream *this, void *buffer,
 		bytes_read =
 		    (*(lib->target_obj->attrs.fread)) (buffer, 1, bufsize,
 						       lib->fp);
+		if (lib->img_state == DBLL_IMG_KEYING && bytes_read > 0)
+			img_key_mix(lib, buffer, bytes_read);
 	}
 	return bytes_read;
 }
@@ -1063,6 +1338,13 @@ static struct dynload_symbol *dbll_find_symbol(struct dynamic_loader_sym *this,
 		dev_dbg(bridge, "%s: Symbol not found: %s\n", __func__, name);
 	}
 
+	/* The image is only reusable if every import resolves the same */
+	if (lib && lib->img_state == DBLL_IMG_KEYING && gbl_search) {
+		u32 val = dbll_sym ? dbll_sym->value : 0;
+
+		img_key_mix(lib, &val, sizeof(val));
+	}
+
 	DBC_ASSERT((status && (dbll_sym != NULL))
 		   || (!status && (dbll_sym == NULL)));
 
@@ -1081,13 +1363,19 @@ static struct dynload_symbol *find_in_symbol_table(struct dynamic_loader_sym
 	struct ldr_symbol *ldr_sym = (struct ldr_symbol *)this;
 	struct dbll_library_obj *lib;
 	struct dbll_symbol *sym;
+	struct dbll_sym_key key;
 
 	DBC_REQUIRE(this != NULL);
 	lib = ldr_sym->lib;
 	DBC_REQUIRE(lib);
 	DBC_REQUIRE(lib->sym_tab != NULL);
 
-	sym = (struct dbll_symbol *)gh_find(lib->sym_tab, (char *)name);
+	sym_key_init(&key, name);
+	sym = (struct dbll_symbol *)gh_find(lib->sym_tab, &key);
+	if (sym == NULL) {
+		/* Table was built by an earlier load; add what is missing */
+		return dbll_add_to_symbol_table(this, name, moduleid);
+	}
 
 	ret_sym = (struct dynload_symbol *)&sym->value;
 	return ret_sym;
@@ -1102,6 +1390,7 @@ static struct dynload_symbol *dbll_add_to_symbol_table(struct dynamic_loader_sym
 {
 	struct dbll_symbol *sym_ptr = NULL;
 	struct dbll_symbol symbol;
+	struct dbll_sym_key key;
 	struct dynload_symbol *dbll_sym = NULL;
 	struct ldr_symbol *ldr_sym = (struct ldr_symbol *)this;
 	struct dbll_library_obj *lib;
@@ -1133,10 +1422,12 @@ static struct dynload_symbol *dbll_add_to_symbol_table(struct dynamic_loader_sym
 		/* Just copy name (value will be filled in by dynamic loader) */
 		strncpy(symbol.name, (char *const)name,
 			strlen((char *const)name) + 1);
+		sym_key_init(&key, symbol.name);
+		symbol.hash = key.hash;
 
 		/* Add symbol to symbol table */
 		sym_ptr =
-		    (struct dbll_symbol *)gh_insert(lib->sym_tab, (void *)name,
+		    (struct dbll_symbol *)gh_insert(lib->sym_tab, (void *)&key,
 						    (void *)&symbol);
 		if (sym_ptr == NULL)
 			kfree(symbol.name);
@@ -1328,6 +1619,16 @@ func_cont:
 		if (!run_addr_flag)
 			info->run_addr = info->load_addr;
 		info->context = (u32) rmm_addr_obj.segid;
+		if (lib->img_state == DBLL_IMG_KEYING) {
+			img_key_mix(lib, &info->load_addr,
+				    sizeof(info->load_addr));
+			img_key_mix(lib, &info->run_addr,
+				    sizeof(info->run_addr));
+		} else if (lib->img_state == DBLL_IMG_RECORDING) {
+			/* Trampoline sections are placed while relocating;
+			 * the image depends on more than the key covers. */
+			img_abandon(lib);
+		}
 		dev_dbg(bridge, "%s: %s base = 0x%x len = 0x%x, "
 			"info->run_addr 0x%x, info->load_addr 0x%x\n",
 			__func__, info->name, info->load_addr / DSPWORDSIZE,
@@ -1431,6 +1732,10 @@ static int write_mem(struct dynamic_loader_initialize *this, void *buf,
 		    (*target_obj->attrs.write) (target_obj->attrs.input_params,
 						addr, buf, bytes,
 						mem_sect_type);
+		/* bytes == 0 only asks for a pointer, see fill_mem() */
+		if (ret && bytes && lib->img_state == DBLL_IMG_RECORDING)
+			img_record(lib, addr, buf, bytes, mem_sect_type, false,
+				   0);
 
 		if (target_obj->attrs.log_write) {
 			sect_info.name = info->name;
@@ -1472,8 +1777,13 @@ static int fill_mem(struct dynamic_loader_initialize *this, ldr_addr addr,
 	 */
 	if ((lib->target_obj->attrs.write) != (dbll_write_fxn) no_op)
 		write_mem(this, &pbuf, addr, info, 0);
-	if (pbuf)
+	if (pbuf) {
 		memset(pbuf, val, bytes);
+		if (lib->img_state == DBLL_IMG_RECORDING)
+			img_record(lib, addr, NULL, bytes,
+				   DLOAD_SECTION_TYPE(info->type) == DLOAD_TEXT ?
+				   DBLL_CODE : DBLL_DATA, true, val);
+	}
 
 	return ret;
 }
@@ -1504,6 +1814,237 @@ static void release(struct dynamic_loader_initialize *this)
 {
 }
 
+/*
+ *  ======== cached_image ========
+ *  Called by the dynamic loader around image download. On the way in,
+ *  the key is complete: replay a cached image if one matches, otherwise
+ *  start recording the writes of this load. Images of an older version
+ *  of the file are dropped on the way.
+ */
+static int cached_image(struct dynamic_loader_initialize *this, int done)
+{
+	struct dbll_init_obj *init_obj = (struct dbll_init_obj *)this;
+	struct dbll_library_obj *lib;
+	struct dbll_tar_obj *target_obj;
+	struct dbll_img *img, *tmp, *found = NULL;
+	struct dbll_img_rec *rec;
+	char *pbuf;
+	bool ret = true;
+
+	DBC_REQUIRE(this != NULL);
+	lib = init_obj->lib;
+	DBC_REQUIRE(lib);
+	target_obj = lib->target_obj;
+
+	if (done) {
+		if (lib->img_state == DBLL_IMG_RECORDING)
+			lib->img_state = DBLL_IMG_RECORDED;
+		return false;
+	}
+	if (lib->img_state != DBLL_IMG_KEYING)
+		return false;
+
+	list_for_each_entry_safe(img, tmp, &target_obj->img_cache, link) {
+		if (strcmp(img->file_name, lib->file_name) != 0)
+			continue;
+		if (memcmp(&img->stamp, &lib->img_stamp, sizeof(img->stamp)))
+			img_free(target_obj, img);
+		else if (img->key == lib->img_key && found == NULL &&
+			 img->key_len == lib->img_key_len &&
+			 memcmp(img->key_data, lib->img_key_data,
+				img->key_len) == 0)
+			found = img;
+	}
+	img = found;
+	if (img == NULL) {
+		target_obj->img_misses++;
+		lib->img_rec = kzalloc(sizeof(struct dbll_img), GFP_KERNEL);
+		if (lib->img_rec == NULL) {
+			lib->img_state = DBLL_IMG_IDLE;
+			return false;
+		}
+		INIT_LIST_HEAD(&lib->img_rec->recs);
+		lib->img_rec->stamp = lib->img_stamp;
+		lib->img_rec->key = lib->img_key;
+		lib->img_rec->key_data = lib->img_key_data;
+		lib->img_rec->key_len = lib->img_key_len;
+		lib->img_key_data = NULL;
+		lib->img_state = DBLL_IMG_RECORDING;
+		return false;
+	}
+
+	list_for_each_entry(rec, &img->recs, link) {
+		if (rec->fill) {
+			pbuf = NULL;
+			if (target_obj->attrs.write != (dbll_write_fxn) no_op)
+				(*target_obj->attrs.write)
+				    (target_obj->attrs.input_params, rec->addr,
+				     &pbuf, 0, rec->mem_sect_type);
+			if (pbuf)
+				memset(pbuf, rec->val, rec->bytes);
+		} else {
+			ret = (*target_obj->attrs.write)
+			    (target_obj->attrs.input_params, rec->addr,
+			     rec->data, rec->bytes, rec->mem_sect_type);
+			if (!ret)
+				break;
+		}
+	}
+	lib->img_state = DBLL_IMG_IDLE;
+	if (!ret) {
+		/* Let the loader redo the image from the file */
+		img_free(target_obj, img);
+		return false;
+	}
+
+	list_move(&img->link, &target_obj->img_cache);
+	target_obj->img_hits++;
+	dev_dbg(bridge, "%s: %s: replayed %u bytes\n", __func__,
+		lib->file_name, img->size);
+
+	return true;
+}
+
+/*
+ *  ======== img_key_mix ========
+ *  Add bytes to the image key: append them to the key data, which cached
+ *  images are compared against, and fold them into the running hash
+ *  (FNV-1a, as sym_hash()) that picks the candidates.
+ */
+static void img_key_mix(struct dbll_library_obj *lib, const void *buf,
+			u32 bytes)
+{
+	const u8 *p = buf;
+	u32 hash = lib->img_key;
+	u32 max = lib->img_key_max;
+	u8 *data;
+
+	if (lib->img_key_data == NULL || lib->img_key_len + bytes > max) {
+		if (max == 0)
+			max = 1024;
+		while (lib->img_key_len + bytes > max)
+			max *= 2;
+		if (max > DBLL_IMG_KEY_SIZE) {
+			img_abandon(lib);
+			return;
+		}
+		data = krealloc(lib->img_key_data, max, GFP_KERNEL);
+		if (data == NULL) {
+			img_abandon(lib);
+			return;
+		}
+		lib->img_key_data = data;
+		lib->img_key_max = max;
+	}
+	memcpy(lib->img_key_data + lib->img_key_len, buf, bytes);
+	lib->img_key_len += bytes;
+
+	while (bytes--) {
+		hash ^= *p++;
+		hash *= 16777619u;
+	}
+	lib->img_key = hash;
+}
+
+/*
+ *  ======== img_record ========
+ */
+static bool img_record(struct dbll_library_obj *lib, u32 addr, void *buf,
+		       u32 bytes, u32 mem_sect_type, bool fill, u8 val)
+{
+	struct dbll_img *img = lib->img_rec;
+	struct dbll_img_rec *rec;
+	u32 size = fill ? 0 : bytes;
+
+	if (img->size + size > DBLL_IMG_CACHE_SIZE) {
+		img_abandon(lib);
+		return false;
+	}
+	rec = kmalloc(sizeof(struct dbll_img_rec) + size, GFP_KERNEL);
+	if (rec == NULL) {
+		img_abandon(lib);
+		return false;
+	}
+	rec->addr = addr;
+	rec->bytes = bytes;
+	rec->mem_sect_type = mem_sect_type;
+	rec->fill = fill;
+	rec->val = val;
+	if (size)
+		memcpy(rec->data, buf, size);
+	list_add_tail(&rec->link, &img->recs);
+	img->size += size;
+
+	return true;
+}
+
+/*
+ *  ======== img_abandon ========
+ *  Stop caching the current load of lib.
+ */
+static void img_abandon(struct dbll_library_obj *lib)
+{
+	if (lib->img_rec) {
+		img_free(NULL, lib->img_rec);
+		lib->img_rec = NULL;
+	}
+	kfree(lib->img_key_data);
+	lib->img_key_data = NULL;
+	lib->img_key_len = 0;
+	lib->img_key_max = 0;
+	lib->img_state = DBLL_IMG_IDLE;
+}
+
+/*
+ *  ======== img_commit ========
+ *  The load succeeded: put the recorded image in the target's cache,
+ *  evicting the least recently used images to stay within
+ *  DBLL_IMG_CACHE_SIZE.
+ */
+static void img_commit(struct dbll_library_obj *lib)
+{
+	struct dbll_tar_obj *target_obj = lib->target_obj;
+	struct dbll_img *img = lib->img_rec;
+
+	if (img == NULL || lib->img_state != DBLL_IMG_RECORDED) {
+		img_abandon(lib);
+		return;
+	}
+	img->file_name = kstrdup(lib->file_name, GFP_KERNEL);
+	if (img->file_name == NULL) {
+		img_abandon(lib);
+		return;
+	}
+	while (target_obj->img_cache_size + img->size + img->key_len >
+	       DBLL_IMG_CACHE_SIZE && !list_empty(&target_obj->img_cache))
+		img_free(target_obj, list_entry(target_obj->img_cache.prev,
+						struct dbll_img, link));
+
+	list_add(&img->link, &target_obj->img_cache);
+	target_obj->img_cache_size += img->size + img->key_len;
+	lib->img_rec = NULL;
+	lib->img_state = DBLL_IMG_IDLE;
+}
+
+/*
+ *  ======== img_free ========
+ *  Free img, removing it from target's cache if target is not NULL.
+ */
+static void img_free(struct dbll_tar_obj *target, struct dbll_img *img)
+{
+	struct dbll_img_rec *rec, *tmp;
+
+	if (target) {
+		list_del(&img->link);
+		target->img_cache_size -= img->size + img->key_len;
+	}
+	list_for_each_entry_safe(rec, tmp, &img->recs, link)
+		kfree(rec);
+	kfree(img->key_data);
+	kfree(img->file_name);
+	kfree(img);
+}
+
 /**
  *  find_symbol_context - Basic symbol context structure
  * @address:		Symbol Adress
@@ -280,6 +280,7 @@ static struct dbll_fxns ldr_fxns = {
 	(dbll_set_attrs_fxn) dbll_set_attrs,
 	(dbll_unload_fxn) dbll_unload,
 	(dbll_unload_sect_fxn) dbll_unload_sect,
+	(dbll_invalidate_fxn) dbll_invalidate,
 };
 
 static u32 refs;		/* module reference count */
@@ -1561,6 +1562,11 @@ static dsp_status load_ovly(struct nldr_nodeobject *nldr_node_obj,
 			/* Load sections for this phase */
 			ovly_section = phase_sects;
 			while (ovly_section && DSP_SUCCEEDED(status)) {
+				/* Cached dynamic images there are stale now */
+				nldr_obj->ldr_fxns.
+				    invalidate_fxn(nldr_obj->dbll,
+						   ovly_section->sect_run_addr,
+						   ovly_section->size);
 				bytes =
 				    (*nldr_obj->ovly_fxn) (nldr_node_obj->
 							   priv_ref,
@@ -1582,6 +1588,11 @@ static dsp_status load_ovly(struct nldr_nodeobject *nldr_node_obj,
 			/* Load other sections (create phase) */
 			ovly_section = other_sects_list;
 			while (ovly_section && DSP_SUCCEEDED(status)) {
+				/* Cached dynamic images there are stale now */
+				nldr_obj->ldr_fxns.
+				    invalidate_fxn(nldr_obj->dbll,
+						   ovly_section->sect_run_addr,
+						   ovly_section->size);
 				bytes =
 				    (*nldr_obj->ovly_fxn) (nldr_node_obj->
 							   priv_ref,
@@ -1786,7 +1797,8 @@ static void unload_lib(struct nldr_nodeobject *nldr_node_obj,
 	new_attrs.sym_arg = root;
 
 	if (root->lib) {
-		/* Unload the root library */
+		/* Unload the root library. Closing it leaves it idle in the
+		 * dbll target with its symbol table, for the next load */
 		nldr_obj->ldr_fxns.unload_fxn(root->lib, &new_attrs);
 		nldr_obj->ldr_fxns.close_fxn(root->lib);
 	}
@@ -0,0 +1,241 @@
+/*
+ * Test clients for the shared sensor polling service
+ *
+ * Samples three fake sensors on the i2c-stub adapter at the default rates
+ * of the accelerometer, light sensor and compass drivers for a while, and
+ * prints how many times the CPU had to wake up and how far the spacing
+ * of the samples strayed from their interval.  With batched=0 every
+ * sensor runs its own delayed work, the way the drivers used to, which
+ * gives the numbers to compare against:
+ *
+ *	modprobe i2c-stub chip_addr=0x1d
+ *	insmod sensor-poll-test.ko batched=1
+ *	insmod sensor-poll-test.ko batched=0
+ *
+ * Each insmod runs the test and then fails with -EAGAIN once it is done,
+ * so the module never stays loaded.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by
+ * the Free Software Foundation.
+ */
+
+#include <linux/init.h>
+#include <linux/module.h>
+#include <linux/moduleparam.h>
+#include <linux/delay.h>
+#include <linux/hrtimer.h>
+#include <linux/i2c.h>
+#include <linux/input.h>
+#include <linux/workqueue.h>
+#include <linux/sensor-poll.h>
+
+#define PRINT_PREF KERN_INFO "sensor_poll_test: "
+
+static int bus = -1;
+module_param(bus, int, S_IRUGO);
+MODULE_PARM_DESC(bus, "I2C bus of the stub adapter (default: look it up)");
+
+static ushort addr = 0x1d;
+module_param(addr, ushort, S_IRUGO);
+MODULE_PARM_DESC(addr, "Chip address given to i2c-stub");
+
+static int batched = 1;
+module_param(batched, int, S_IRUGO);
+MODULE_PARM_DESC(batched,
+		 "Use the shared poller (1) or one work per sensor (0)");
+
+static unsigned int duration = 10000;
+module_param(duration, uint, S_IRUGO);
+MODULE_PARM_DESC(duration, "Test length in msec");
+
+static unsigned int accel_ms = 200;
+module_param(accel_ms, uint, S_IRUGO);
+MODULE_PARM_DESC(accel_ms, "Accelerometer poll interval in msec");
+
+static unsigned int light_ms = 781;
+module_param(light_ms, uint, S_IRUGO);
+MODULE_PARM_DESC(light_ms, "Light sensor poll interval in msec");
+
+static unsigned int compass_ms = 200;
+module_param(compass_ms, uint, S_IRUGO);
+MODULE_PARM_DESC(compass_ms, "Compass poll interval in msec");
+
+struct test_sensor {
+	struct sensor_poll_client client;
+	struct delayed_work work;
+	u8 reg;
+	u8 nregs;
+	unsigned int abs;
+	ktime_t last;
+	unsigned int nominal;	/* msec between samples */
+	unsigned long samples;
+	u64 late_sum;
+	unsigned int late_max;
+};
+
+static struct test_sensor sensors[] = {
+	{ .client.name = "accel",   .reg = 0x00, .nregs = 6, .abs = ABS_X },
+	{ .client.name = "light",   .reg = 0x10, .nregs = 2, .abs = ABS_MISC },
+	{ .client.name = "compass", .reg = 0x20, .nregs = 4, .abs = ABS_HAT0X },
+};
+
+static struct i2c_adapter *adap;
+static struct input_dev *input;
+static unsigned long wakeups;
+static unsigned long last_jiffies;
+static DEFINE_SPINLOCK(stats_lock);
+
+static void test_sample(struct test_sensor *s, ktime_t stamp)
+{
+	union i2c_smbus_data data;
+	int val = 0, i;
+
+	for (i = 0; i < s->nregs; i++) {
+		if (i2c_smbus_xfer(adap, addr, 0, I2C_SMBUS_READ, s->reg + i,
+				   I2C_SMBUS_BYTE_DATA, &data) < 0)
+			break;
+		val += data.byte;
+	}
+	input_report_abs(input, s->abs, val);
+	input_sync(input);
+
+	spin_lock(&stats_lock);
+	/* timers that expire on the same jiffy share one wakeup */
+	if (!wakeups || jiffies != last_jiffies) {
+		wakeups++;
+		last_jiffies = jiffies;
+	}
+	if (s->samples++) {
+		s64 late = ktime_us_delta(stamp, s->last) -
+			   s->nominal * USEC_PER_MSEC;
+
+		if (late < 0)
+			late = -late;
+		s->late_sum += late;
+		if (late > s->late_max)
+			s->late_max = late;
+	}
+	s->last = stamp;
+	spin_unlock(&stats_lock);
+}
+
+static void test_poll(struct sensor_poll_client *client, ktime_t stamp)
+{
+	test_sample(container_of(client, struct test_sensor, client), stamp);
+}
+
+static void test_work(struct work_struct *work)
+{
+	struct test_sensor *s = container_of(work, struct test_sensor,
+					     work.work);
+
+	test_sample(s, ktime_get());
+	schedule_delayed_work(&s->work, msecs_to_jiffies(s->client.interval));
+}
+
+static struct i2c_adapter *find_stub_adapter(void)
+{
+	struct i2c_adapter *a;
+	int i;
+
+	if (bus >= 0)
+		return i2c_get_adapter(bus);
+
+	for (i = 0; i < 32; i++) {
+		a = i2c_get_adapter(i);
+		if (!a)
+			continue;
+		if (!strcmp(a->name, "SMBus stub driver"))
+			return a;
+		i2c_put_adapter(a);
+	}
+	return NULL;
+}
+
+static int __init sensor_poll_test_init(void)
+{
+	unsigned int tick;
+	int i, err;
+
+	if (!accel_ms || !light_ms || !compass_ms)
+		return -EINVAL;
+
+	adap = find_stub_adapter();
+	if (!adap) {
+		printk(PRINT_PREF "no i2c-stub adapter, load i2c-stub first\n");
+		return -ENODEV;
+	}
+
+	input = input_allocate_device();
+	if (!input) {
+		err = -ENOMEM;
+		goto out_adap;
+	}
+	input->name = "sensor-poll-test";
+	set_bit(EV_ABS, input->evbit);
+	for (i = 0; i < ARRAY_SIZE(sensors); i++)
+		input_set_abs_params(input, sensors[i].abs, 0, 0x600, 0, 0);
+	err = input_register_device(input);
+	if (err) {
+		input_free_device(input);
+		goto out_adap;
+	}
+
+	sensors[0].client.interval = accel_ms;
+	sensors[1].client.interval = light_ms;
+	sensors[2].client.interval = compass_ms;
+	tick = min(accel_ms, min(light_ms, compass_ms));
+
+	printk(PRINT_PREF "%s polling for %u ms\n",
+	       batched ? "batched" : "independent", duration);
+
+	for (i = 0; i < ARRAY_SIZE(sensors); i++) {
+		struct test_sensor *s = &sensors[i];
+
+		if (batched) {
+			s->client.poll = test_poll;
+			s->nominal = max(DIV_ROUND_CLOSEST(s->client.interval,
+							   tick), 1U) * tick;
+			sensor_poll_start(&s->client);
+		} else {
+			s->nominal = s->client.interval;
+			INIT_DELAYED_WORK(&s->work, test_work);
+			schedule_delayed_work(&s->work,
+				msecs_to_jiffies(s->client.interval));
+		}
+	}
+
+	msleep(duration);
+
+	for (i = 0; i < ARRAY_SIZE(sensors); i++) {
+		if (batched)
+			sensor_poll_stop(&sensors[i].client);
+		else
+			cancel_delayed_work_sync(&sensors[i].work);
+	}
+
+	printk(PRINT_PREF "%lu wakeups\n", wakeups);
+	for (i = 0; i < ARRAY_SIZE(sensors); i++) {
+		struct test_sensor *s = &sensors[i];
+		unsigned long n = s->samples > 1 ? s->samples - 1 : 1;
+
+		printk(PRINT_PREF "%-8s %4u ms: %lu samples, "
+		       "jitter avg %llu us, max %u us\n",
+		       s->client.name, s->nominal, s->samples,
+		       (unsigned long long)div_u64(s->late_sum, n),
+		       s->late_max);
+	}
+
+	input_unregister_device(input);
+	/* done, and there is nothing to keep loaded */
+	err = -EAGAIN;
+ out_adap:
+	i2c_put_adapter(adap);
+	return err;
+}
+
+module_init(sensor_poll_test_init);
+
+MODULE_DESCRIPTION("Sensor polling test clients");
+MODULE_LICENSE("GPL");
@@ -0,0 +1,285 @@
+/*
+ * Shared polling service for slow sensors
+ *
+ * The accelerometer, light sensor and compass drivers used to run one
+ * delayed work each, so the CPU woke up on three unrelated periods and
+ * issued the I2C reads one sensor at a time.  Here all of them are
+ * sampled from a single worker running on a common tick.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by
+ * the Free Software Foundation.
+ */
+
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/jiffies.h>
+#include <linux/hrtimer.h>
+#include <linux/mutex.h>
+#include <linux/workqueue.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/sensor-poll.h>
+
+MODULE_DESCRIPTION("Shared polling service for slow sensors");
+MODULE_LICENSE("GPL v2");
+
+/* shortest interval accepted from a client, in msec */
+#define SENSOR_POLL_MIN_INTERVAL	10
+
+static DEFINE_MUTEX(sensor_poll_mutex);
+static LIST_HEAD(sensor_poll_clients);
+static struct workqueue_struct *sensor_poll_wq;
+
+static void sensor_poll_work_fn(struct work_struct *work);
+static DECLARE_DELAYED_WORK(sensor_poll_work, sensor_poll_work_fn);
+
+/* current tick in msec, and the time the next tick is due */
+static unsigned int sensor_poll_tick;
+static ktime_t sensor_poll_deadline;
+
+/* wakeups and how late they were, reset by writing to the debugfs file */
+static unsigned long sensor_poll_ticks;
+static u64 sensor_poll_late_sum;
+static unsigned int sensor_poll_late_max;
+
+static void sensor_poll_queue(ktime_t now)
+{
+	s64 delta = ktime_us_delta(sensor_poll_deadline, now);
+
+	/* missed ticks are dropped, not made up */
+	if (delta < 0) {
+		sensor_poll_deadline = ktime_add_us(now,
+				sensor_poll_tick * USEC_PER_MSEC);
+		delta = sensor_poll_tick * USEC_PER_MSEC;
+	}
+
+	queue_delayed_work(sensor_poll_wq, &sensor_poll_work,
+			   usecs_to_jiffies(delta));
+}
+
+/*
+ * Called with the mutex held whenever the set of clients or one of the
+ * intervals changes.  The shortest interval becomes the tick, the others
+ * are rounded to the closest multiple of it, and every client is sampled
+ * on the next tick so the phases line up again.
+ */
+static void sensor_poll_retune(void)
+{
+	struct sensor_poll_client *client;
+	unsigned int tick = UINT_MAX;
+	ktime_t now;
+
+	cancel_delayed_work(&sensor_poll_work);
+
+	if (list_empty(&sensor_poll_clients)) {
+		sensor_poll_tick = 0;
+		return;
+	}
+
+	list_for_each_entry(client, &sensor_poll_clients, node)
+		tick = min(tick, client->interval);
+
+	list_for_each_entry(client, &sensor_poll_clients, node) {
+		client->period = max(DIV_ROUND_CLOSEST(client->interval, tick),
+				     1U);
+		client->countdown = 1;
+	}
+
+	sensor_poll_tick = tick;
+	now = ktime_get();
+	sensor_poll_deadline = ktime_add_us(now, tick * USEC_PER_MSEC);
+	sensor_poll_queue(now);
+}
+
+static void sensor_poll_work_fn(struct work_struct *work)
+{
+	struct sensor_poll_client *client;
+	ktime_t now;
+	s64 late;
+
+	mutex_lock(&sensor_poll_mutex);
+
+	if (list_empty(&sensor_poll_clients))
+		goto out;
+
+	now = ktime_get();
+	late = ktime_us_delta(now, sensor_poll_deadline);
+	if (late < 0)
+		late = 0;
+	sensor_poll_ticks++;
+	sensor_poll_late_sum += late;
+	if (late > sensor_poll_late_max)
+		sensor_poll_late_max = late;
+
+	list_for_each_entry(client, &sensor_poll_clients, node) {
+		if (--client->countdown)
+			continue;
+		client->countdown = client->period;
+		client->samples++;
+		client->poll(client, now);
+	}
+
+	sensor_poll_deadline = ktime_add_us(sensor_poll_deadline,
+					    sensor_poll_tick * USEC_PER_MSEC);
+	sensor_poll_queue(ktime_get());
+ out:
+	mutex_unlock(&sensor_poll_mutex);
+}
+
+/**
+ * sensor_poll_start - start sampling a sensor
+ * @client: sensor to sample, with @poll and @interval set up
+ *
+ * Starting a client that is already active only updates its interval.
+ * Neither this nor sensor_poll_stop() may be called from a poll() method.
+ */
+void sensor_poll_start(struct sensor_poll_client *client)
+{
+	mutex_lock(&sensor_poll_mutex);
+
+	client->interval = max_t(unsigned int, client->interval,
+				 SENSOR_POLL_MIN_INTERVAL);
+	if (!client->period)
+		list_add_tail(&client->node, &sensor_poll_clients);
+	sensor_poll_retune();
+
+	mutex_unlock(&sensor_poll_mutex);
+}
+EXPORT_SYMBOL(sensor_poll_start);
+
+/**
+ * sensor_poll_stop - stop sampling a sensor
+ * @client: sensor to stop
+ *
+ * The poll() method of @client is not running and will not be called
+ * again once this returns.
+ */
+void sensor_poll_stop(struct sensor_poll_client *client)
+{
+	mutex_lock(&sensor_poll_mutex);
+
+	if (client->period) {
+		list_del(&client->node);
+		client->period = 0;
+		sensor_poll_retune();
+	}
+
+	mutex_unlock(&sensor_poll_mutex);
+}
+EXPORT_SYMBOL(sensor_poll_stop);
+
+/**
+ * sensor_poll_set_interval - change the sampling interval of a sensor
+ * @client: sensor to change
+ * @interval: new interval in msec
+ *
+ * Takes effect at once if @client is active, otherwise at the next
+ * sensor_poll_start().
+ */
+void sensor_poll_set_interval(struct sensor_poll_client *client,
+			      unsigned int interval)
+{
+	mutex_lock(&sensor_poll_mutex);
+
+	client->interval = max_t(unsigned int, interval,
+				 SENSOR_POLL_MIN_INTERVAL);
+	if (client->period)
+		sensor_poll_retune();
+
+	mutex_unlock(&sensor_poll_mutex);
+}
+EXPORT_SYMBOL(sensor_poll_set_interval);
+
+#ifdef CONFIG_DEBUG_FS
+static int sensor_poll_show(struct seq_file *m, void *unused)
+{
+	struct sensor_poll_client *client;
+
+	mutex_lock(&sensor_poll_mutex);
+
+	seq_printf(m, "tick:       %u ms\n", sensor_poll_tick);
+	seq_printf(m, "wakeups:    %lu\n", sensor_poll_ticks);
+	seq_printf(m, "late avg:   %llu us\n", sensor_poll_ticks ?
+		   (unsigned long long)div_u64(sensor_poll_late_sum,
+					       sensor_poll_ticks) : 0ULL);
+	seq_printf(m, "late max:   %u us\n", sensor_poll_late_max);
+	list_for_each_entry(client, &sensor_poll_clients, node)
+		seq_printf(m, "%-16s %5u ms x%u %lu samples\n",
+			   client->name, client->interval, client->period,
+			   client->samples);
+
+	mutex_unlock(&sensor_poll_mutex);
+	return 0;
+}
+
+static int sensor_poll_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, sensor_poll_show, NULL);
+}
+
+static ssize_t sensor_poll_write(struct file *file, const char __user *buf,
+				 size_t count, loff_t *ppos)
+{
+	struct sensor_poll_client *client;
+
+	mutex_lock(&sensor_poll_mutex);
+
+	sensor_poll_ticks = 0;
+	sensor_poll_late_sum = 0;
+	sensor_poll_late_max = 0;
+	list_for_each_entry(client, &sensor_poll_clients, node)
+		client->samples = 0;
+
+	mutex_unlock(&sensor_poll_mutex);
+	return count;
+}
+
+static const struct file_operations sensor_poll_fops = {
+	.owner		= THIS_MODULE,
+	.open		= sensor_poll_open,
+	.read		= seq_read,
+	.write		= sensor_poll_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static struct dentry *sensor_poll_dentry;
+
+static void sensor_poll_debugfs_init(void)
+{
+	sensor_poll_dentry = debugfs_create_file("sensor_poll", 0644, NULL,
+						 NULL, &sensor_poll_fops);
+}
+
+static void sensor_poll_debugfs_exit(void)
+{
+	debugfs_remove(sensor_poll_dentry);
+}
+#else
+static inline void sensor_poll_debugfs_init(void) { }
+static inline void sensor_poll_debugfs_exit(void) { }
+#endif
+
+static int __init sensor_poll_init(void)
+{
+	/* freezeable, so nothing is sampled while the system suspends */
+	sensor_poll_wq = create_freezeable_workqueue("sensor_poll");
+	if (!sensor_poll_wq) {
+		printk(KERN_ERR "sensor-poll: failed to create workqueue\n");
+		return -ENOMEM;
+	}
+
+	sensor_poll_debugfs_init();
+	return 0;
+}
+
+static void __exit sensor_poll_exit(void)
+{
+	sensor_poll_debugfs_exit();
+	cancel_delayed_work_sync(&sensor_poll_work);
+	destroy_workqueue(sensor_poll_wq);
+}
+
+subsys_initcall(sensor_poll_init);
+module_exit(sensor_poll_exit);
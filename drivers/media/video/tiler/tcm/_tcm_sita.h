@@ -45,6 +45,12 @@
 				((align == ALIGN_32) ? 32 : \
 				((align == ALIGN_16) ? 16 : 1)))
 
+/* Index of a tiler_page in the raster ordered busy map */
+#define SLOT(pvt, x, y)	((u32)(y) * (pvt)->width + (x))
+
+/* Row y of the per row busy map */
+#define ROW_MAP(pvt, y)	((pvt)->row_map + (u32)(y) * (pvt)->row_words)
+
 /*Provide inclusive length between co-ordinates */
 #define INCL_LEN(high, low)		((high) - (low) + 1)
 #define INCL_LEN_MOD(start, end)   ((start) > (end) ? (start) - (end) + 1 : \
@@ -120,9 +126,23 @@ struct tiler_page {
 struct sita_pvt {
 	u16 width;
 	u16 height;
-	/* This list keeps a track of all the allocations that happened in terms
-	of area allocated, this list is checked for removing any allocations */
-	struct area_spec_list *res_list;
+	/* Free space index: one bit per tiler_page in raster order (set when
+	occupied) and the number of free pages in the container. Scans use it
+	to test and skip whole words of pages at a time */
+	unsigned long *busy_map;
+	u32 num_free;
+	/* The same bits again with each row starting on a word (columns past
+	the width are marked occupied), and the columns occupied in any row of
+	the band of rows a 2D scan is testing. Bands are put together from
+	running ORs over blocks of band_h rows, see fill_band() */
+	unsigned long *row_map;
+	unsigned long *band;
+	unsigned long *sfx_map;
+	unsigned long *pfx_map;
+	u16 row_words;
+	u16 band_h;
+	s32 sfx_blk;
+	s32 pfx_blk;
 	/* mutex */
 	struct mutex mtx;
 	/* Divider point splitting the tiler container
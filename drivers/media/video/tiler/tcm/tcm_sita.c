@@ -74,11 +74,22 @@ static s32 scan_r2l_b2t_one_dim(struct tcm *tcm, u32 num_of_pages,
 /*********************************************
  *	Support Infrastructure Methods
  *********************************************/
+#ifdef SCAN_BOTTOM_UP
 static s32 check_fit_r_and_b(struct tcm *tcm, u16 w, u16 h, u16 left_x,
 			     u16 top_y);
+#endif
+
+static void or_rows(struct tcm *tcm, unsigned long *map, s32 from_y,
+		    s32 to_y);
+
+static s32 fill_band(struct tcm *tcm, u16 h, u16 top_y);
 
-static s32 check_fit_r_one_dim(struct tcm *tcm, u16 x, u16 y, u32 num_of_pages,
-			       u16 *busy_x, u16 *busy_y);
+static u32 update_bits(unsigned long *map, u32 start, u32 nbits, u8 set);
+
+static u16 count_busy_slots(struct tcm *tcm, u32 slot, u32 num_of_pages);
+
+static void mark_slots(struct tcm *tcm, u32 slot, u32 num_of_pages,
+		       u8 occupied);
 
 static s32 select_candidate(struct tcm *tcm, IN u16 w, IN u16 h,
 			IN u16 num_short_listed,
@@ -98,11 +109,6 @@ static s32 insert_pages_with_tiler_page(struct tcm *tcm,
 
 static s32 insert_area_with_tiler_page(struct tcm *tcm,
 		       struct tcm_area *area, struct tiler_page tile);
-
-static s32 move_left(struct tcm *tcm, u16 x, u16 y, u32 num_of_pages,
-		     u16 *xx, u16 *yy);
-static s32 move_right(struct tcm *tcm, u16 x, u16 y, u32 num_of_pages,
-		      u16 *xx, u16 *yy);
 /*********************************************/
 
 /*********************************************
@@ -147,64 +153,6 @@ s32 insert_element(INOUT struct area_spec_list **list,
 	return TilerErrorNone;
 }
 
-static
-s32 rem_element_with_match(struct area_spec_list **listHead,
-			   struct tcm_area *to_be_removed, u16 *area_type)
-{
-	struct area_spec_list *temp_list = NULL;
-	struct area_spec_list *matched_elem = NULL;
-	struct tcm_area *cur_area = NULL;
-	u8 found_flag = NO;
-
-	/*If the area to be removed matchs the list head itself,
-	we need to put the next one as list head */
-	if (*listHead !=  NULL) {
-		cur_area = &(*listHead)->area;
-		if (cur_area->p0.x == to_be_removed->p0.x && cur_area->p0.y ==
-			to_be_removed->p0.y && cur_area->p1.x ==
-			to_be_removed->p1.x && cur_area->p1.y ==
-			to_be_removed->p1.y) {
-			*area_type = (*listHead)->area_type;
-			PA(1, "removing match", cur_area);
-
-			temp_list = (*listHead)->next;
-			kfree(*listHead);
-			*listHead = temp_list;
-			return TilerErrorNone;
-		}
-	}
-
-	temp_list = *listHead;
-	while (temp_list  !=  NULL) {
-		/* we have already checked the list head,
-			we check for the second in list */
-		if (temp_list->next != NULL) {
-			cur_area = &temp_list->next->area;
-			if (cur_area->p0.x == to_be_removed->p0.x
-				&& cur_area->p0.y == to_be_removed->p0.y
-				&& cur_area->p1.x == to_be_removed->p1.x
-				&& cur_area->p1.y == to_be_removed->p1.y) {
-				PA(1, "removing match", cur_area);
-				matched_elem = temp_list->next;
-				*area_type = matched_elem->area_type;
-				temp_list->next = matched_elem->next;
-				kfree(matched_elem);
-				matched_elem = NULL;
-				found_flag = YES;
-				break;
-			}
-		}
-		temp_list = temp_list->next;
-	}
-
-	if (found_flag)
-		return TilerErrorNone;
-
-	PA(5, "Match Not found", to_be_removed);
-
-	return TilerErrorMatchNotFound;
-}
-
 static
 s32 clean_list(struct area_spec_list **list)
 {
@@ -293,7 +241,6 @@ struct tcm *sita_init(u16 width, u16 height, struct tcm_pt *attr)
 	}
 
 	memset(pvt, 0, sizeof(*pvt));
-	pvt->res_list = NULL;
 
 	/* Updating the pointers to SiTA implementation APIs */
 	tmp->height = height;
@@ -341,6 +288,39 @@ struct tcm *sita_init(u16 width, u16 height, struct tcm_pt *attr)
 		}
 	}
 
+	/* Creating free space index, everything starts out free */
+	pvt->busy_map = kzalloc(BITS_TO_LONGS(pvt->width * pvt->height) *
+				sizeof(unsigned long), GFP_KERNEL);
+	pvt->row_words = BITS_TO_LONGS(pvt->width);
+	pvt->row_map = kzalloc(pvt->row_words * pvt->height *
+			       sizeof(unsigned long), GFP_KERNEL);
+	pvt->band = kmalloc(pvt->row_words * sizeof(unsigned long),
+			    GFP_KERNEL);
+	pvt->sfx_map = kmalloc(pvt->row_words * pvt->height *
+			       sizeof(unsigned long), GFP_KERNEL);
+	pvt->pfx_map = kmalloc(pvt->row_words * pvt->height *
+			       sizeof(unsigned long), GFP_KERNEL);
+	if (pvt->busy_map == NULL || pvt->row_map == NULL ||
+	    pvt->band == NULL || pvt->sfx_map == NULL ||
+	    pvt->pfx_map == NULL) {
+		kfree(pvt->busy_map);
+		kfree(pvt->row_map);
+		kfree(pvt->band);
+		kfree(pvt->sfx_map);
+		kfree(pvt->pfx_map);
+		for (i = 0; i < pvt->width; i++)
+			kfree(pvt->tcm_map[i]);
+		kfree(pvt->tcm_map);
+		kfree(pvt);
+		kfree(tmp);
+		return NULL;
+	}
+
+	for (i = 0; i < pvt->height; i++)
+		update_bits(ROW_MAP(pvt, i), pvt->width,
+			    pvt->row_words * BITS_PER_LONG - pvt->width, YES);
+	pvt->num_free = pvt->width * pvt->height;
+
 	if (attr && attr->x < pvt->width && attr->y < pvt->height) {
 		pvt->div_pt.x = attr->x;
 		pvt->div_pt.y = attr->y;
@@ -384,13 +364,24 @@ static s32 sita_deinit(struct tcm *tcm)
 
 	mutex_destroy(&(pvt->mtx));
 
-	for (i = 0; i < pvt->height; i++) {
+	for (i = 0; i < pvt->width; i++) {
 		kfree(pvt->tcm_map[i]);
 		pvt->tcm_map[i] = NULL;
 	}
 	kfree(pvt->tcm_map);
 	pvt->tcm_map = NULL;
 
+	kfree(pvt->busy_map);
+	pvt->busy_map = NULL;
+	kfree(pvt->row_map);
+	pvt->row_map = NULL;
+	kfree(pvt->band);
+	pvt->band = NULL;
+	kfree(pvt->sfx_map);
+	pvt->sfx_map = NULL;
+	kfree(pvt->pfx_map);
+	pvt->pfx_map = NULL;
+
 	return TilerErrorNone;
 }
 
@@ -439,8 +430,6 @@ static s32 sita_reserve_1d(struct tcm *tcm, u32 num_of_pages,
 		tile.type = TCM_1D;
 		/* inserting into tiler container */
 		insert_pages_with_tiler_page(tcm, allocated_pages, tile);
-		/* updating the list of allocations */
-		insert_element(&pvt->res_list, allocated_pages, TCM_1D);
 	}
 	mutex_unlock(&(pvt->mtx));
 	return ret;
@@ -490,13 +479,8 @@ static s32 sita_reserve_2d(struct tcm *tcm, u16 h, u16 w, u8 align,
 		tile.type = TCM_2D;
 		/* inserting into tiler container */
 		ret = insert_area_with_tiler_page(tcm, allocated_area, tile);
-		if (ret == TilerErrorNone) {
-			/*updating the list of allocations */
-			insert_element(&(pvt->res_list),
-				       allocated_area, TCM_2D);
-		} else {
+		if (ret != TilerErrorNone)
 			PA(5, "Could not insert area", allocated_area);
-		}
 	}
 	mutex_unlock(&(pvt->mtx));
 	return ret;
@@ -510,8 +494,7 @@ static s32 sita_reserve_2d(struct tcm *tcm, u16 h, u16 w, u8 align,
  * contain the start and end Tiles
  *
  * @return 0 on success, non-0 error value on failure. On success
- * the to_be_removed_area is removed from g_allocation_list and the
- * corresponding tiles are marked 'NOT_OCCUPIED'
+ * the corresponding tiles are marked 'NOT_OCCUPIED'
  *
  */
 static s32 sita_free(struct tcm *tcm, struct tcm_area *to_be_removed_area)
@@ -519,13 +502,27 @@ static s32 sita_free(struct tcm *tcm, struct tcm_area *to_be_removed_area)
 	s32 ret = TilerErrorNone;
 	struct tiler_page reset_tile = {0};
 	struct sita_pvt *pvt = (struct sita_pvt *)tcm->pvt;
-	u16 area_type;
+	struct tiler_page *tile;
+	u16 area_type = 0;
 
 	reset_tile.is_occupied = NOT_OCCUPIED;
 	mutex_lock(&(pvt->mtx));
-	/*First we check if the given Area is aleast valid in our list*/
-	ret = rem_element_with_match(&(pvt->res_list), to_be_removed_area,
-				     &area_type);
+	/*First we check if the given Area is aleast a valid allocation: its
+	first tile must be occupied by an area with the same corners */
+	ret = TilerErrorMatchNotFound;
+	if (to_be_removed_area->p0.x < pvt->width &&
+	    to_be_removed_area->p0.y < pvt->height) {
+		tile = &pvt->tcm_map[to_be_removed_area->p0.x]
+				    [to_be_removed_area->p0.y];
+		if (tile->is_occupied &&
+		    tile->parent_area.p0.x == to_be_removed_area->p0.x &&
+		    tile->parent_area.p0.y == to_be_removed_area->p0.y &&
+		    tile->parent_area.p1.x == to_be_removed_area->p1.x &&
+		    tile->parent_area.p1.y == to_be_removed_area->p1.y) {
+			area_type = tile->type;
+			ret = TilerErrorNone;
+		}
+	}
 
 	/* If we found a positive match & removed the area details from list
 	 * then we clear the contents of the associated tiles in the global
@@ -571,10 +568,11 @@ static s32 scan_r2l_t2b(struct tcm *tcm, u16 w, u16 h, u16 stride,
 	s16 start_x = -1, end_x = -1, start_y = -1, end_y = -1;
 	s16 found_x = -1, found_y = -1;
 	u16 remainder;
+	u32 busy;
+	struct sita_pvt *pvt = (struct sita_pvt *)tcm->pvt;
 	struct area_spec_list *short_listed = NULL;
 	struct tcm_area candidate_area = {0};
 	u16 num_short_listed = 0;
-	struct sita_pvt *pvt = (struct sita_pvt *)tcm->pvt;
 
 	PA(2, "scan_r2l_t2b:", scan_area);
 
@@ -633,38 +631,40 @@ static s32 scan_r2l_t2b(struct tcm *tcm, u16 w, u16 h, u16 stride,
 	 * 255th element is also checked
 	 */
 	for (yy = start_y; yy <= end_y; yy++) {
+		/* the columns busy in any of the h rows from yy on */
+		if (fill_band(tcm, h, yy) == NO_FIT)
+			continue;
+
 		for (xx = start_x; xx >= end_x; xx -= stride) {
-			if (pvt->tcm_map[xx][yy].is_occupied ==
-					NOT_OCCUPIED) {
-				if (FIT == check_fit_r_and_b(tcm, w, h,
-							     xx, yy)) {
-					P3("Found Free Shoulder at:"
-						"(%d, %d)\n", xx, yy);
-					found_x = xx;
-					found_y = yy;
-					/* Insert this candidate, it is just a
-						co-ordinate, reusing Area */
-					assign(&candidate_area, xx, yy, 0, 0);
-					insert_element(&short_listed,
-						       &candidate_area, TCM_2D);
-					num_short_listed++;
+			busy = find_next_bit(pvt->band, xx + w, xx);
+			if (busy >= xx + w) {
+				P3("Found Free Shoulder at:"
+					"(%d, %d)\n", xx, yy);
+				found_x = xx;
+				found_y = yy;
+				/* Insert this candidate, it is just a
+					co-ordinate, reusing Area */
+				assign(&candidate_area, xx, yy, 0, 0);
+				insert_element(&short_listed,
+					       &candidate_area, TCM_2D);
+				num_short_listed++;
 #ifdef X_SCAN_LIMITER
-					/* change upper x bound */
-					end_x = xx + 1;
+				/* change upper x bound */
+				end_x = xx + 1;
 #endif
-					break;
-				}
-			} else {
-				/* Optimization required only for Non Aligned,
-				Aligned anyways skip by 32/64 tiles at a time */
-				if (stride == 1 &&
-				    pvt->tcm_map[xx][yy].type == TCM_2D) {
-					xx = pvt->tcm_map
-					     [xx][yy].parent_area.p0.x;
-					P3("Moving to parent location start_x"
-						"(%d %d)\n", xx, yy);
-				}
+				break;
 			}
+
+			/* Every area starting between (busy - w, busy] covers
+			the leftmost busy column, so continue from the first
+			aligned column to the left of that range */
+			if (busy < w)
+				break;
+			xx = busy - w;
+			xx -= xx % stride;
+			P3("Moving to aligned location left of busy page"
+				"(%d %d)\n", xx, yy);
+			xx += stride;
 		}
 
 		/* if you find a free area shouldering the given scan area on
@@ -862,10 +862,11 @@ s32 scan_l2r_t2b(struct tcm *tcm, u16 w, u16 h, u16 stride,
 	s16 start_x = -1, end_x = -1, start_y = -1, end_y = -1;
 	s16 found_x = -1, found_y = -1;
 	u16 remainder;
+	u32 busy;
+	struct sita_pvt *pvt = (struct sita_pvt *)tcm->pvt;
 	struct area_spec_list *short_listed = NULL;
 	struct tcm_area candidate_area = {0};
 	u16 num_short_listed = 0;
-	struct sita_pvt *pvt = (struct sita_pvt *)tcm->pvt;
 
 	PA(2, "scan_l2r_t2b:", scan_area);
 
@@ -924,38 +925,36 @@ s32 scan_l2r_t2b(struct tcm *tcm, u16 w, u16 h, u16 stride,
 	 * 255th element is also checked
 	 */
 	for (yy = start_y; yy <= end_y; yy++) {
+		/* the columns busy in any of the h rows from yy on */
+		if (fill_band(tcm, h, yy) == NO_FIT)
+			continue;
+
 		for (xx = start_x; xx <= end_x; xx += stride) {
-			/* if NOT occupied */
-			if (pvt->tcm_map[xx][yy].is_occupied == NOT_OCCUPIED) {
-				if (check_fit_r_and_b(tcm, w, h, xx, yy)
-						== FIT) {
-					P3("Found Free Shoulder at: (%d, %d)\n",
-					   xx, yy);
-					found_x = xx;
-					found_y = yy;
-					/* Insert this candidate, it is just a
-						co-ordinate, reusing Area */
-					assign(&candidate_area, xx, yy, 0, 0);
-					insert_element(&short_listed,
-						       &candidate_area, TCM_2D);
-					num_short_listed++;
+			busy = find_last_bit(pvt->band, xx + w);
+			if (busy < xx || busy >= xx + w) {
+				P3("Found Free Shoulder at: (%d, %d)\n",
+				   xx, yy);
+				found_x = xx;
+				found_y = yy;
+				/* Insert this candidate, it is just a
+					co-ordinate, reusing Area */
+				assign(&candidate_area, xx, yy, 0, 0);
+				insert_element(&short_listed,
+					       &candidate_area, TCM_2D);
+				num_short_listed++;
 #ifdef X_SCAN_LIMITER
-					/* change upper x bound */
-					end_x = xx - 1;
+				/* change upper x bound */
+				end_x = xx - 1;
 #endif
-					break;
-				}
-			} else {
-				/* Optimization required only for Non Aligned,
-				Aligned anyways skip by 32/64 tiles at a time */
-				if (stride == 1 &&
-				    pvt->tcm_map[xx][yy].type == TCM_2D) {
-					xx = pvt->tcm_map
-					     [xx][yy].parent_area.p1.x;
-					P3("Moving to parent location end_x"
-						"(%d %d)\n", xx, yy);
-				}
+				break;
 			}
+
+			/* Every area starting between xx and busy covers the
+			rightmost busy column, so continue from the first
+			aligned column to the right of it */
+			xx = roundup(busy + 1, stride) - stride;
+			P3("Moving to aligned location right of busy page"
+				"(%d %d)\n", xx + stride, yy);
 		}
 		/* if you find a free area shouldering the given scan area on
 		   then we can break */
@@ -1148,10 +1147,8 @@ will have p1.x <= p0.x and p1.y <= p0.y
 static s32 scan_r2l_b2t_one_dim(struct tcm *tcm, u32 num_of_pages,
 		 struct tcm_area *scan_area, struct tcm_area *alloc_area)
 {
-	s32 fit = NO_FIT;
-	s32 ret = TilerErrorNone;
 	u16 x, y;
-	u16 left_x, left_y, busy_x, busy_y;
+	u32 start, end, busy, slot;
 	struct sita_pvt *pvt = (struct sita_pvt *)tcm->pvt;
 
 	/* Basic checks */
@@ -1196,66 +1193,44 @@ static s32 scan_r2l_b2t_one_dim(struct tcm *tcm, u32 num_of_pages,
 		return TilerErrorNoRoom;
 	}
 
+	if (num_of_pages > pvt->num_free) {
+		PE("Slots requested exceed free slots (%d)\n", pvt->num_free);
+		return TilerErrorNoRoom;
+	}
+
 	/* Ah we are here, it implies we can try fitting now after we have
-	checked everything */
-	left_x = scan_area->p0.x;
-	left_y = scan_area->p0.y;
-	while (ret == TilerErrorNone) {
-		x = left_x;
-		y = left_y;
-
-		/* P("Checking if (%d %d) is Occupied\n",x,y); */
-		if (pvt->tcm_map[x][y].is_occupied == NOT_OCCUPIED) {
-			ret = move_left(tcm, x, y, (num_of_pages - 1),
-					&left_x, &left_y);
-			if (ret == TilerErrorNone) {
-				P3("Moved left to (%d %d) for num_of_pages (%d)"
-					",checking for fit\n", left_x,
-				   left_y, (num_of_pages - 1));
-				fit = check_fit_r_one_dim(tcm, left_x, left_y,
-					  num_of_pages, &busy_x, &busy_y);
-				if (fit == FIT) {
-					/*Implies we are fine, we found a place
-							to put our 1D alloc */
-					assign(alloc_area, left_x, left_y,
-					       busy_x, busy_y);
-					PA(3, "Allocated 1D area", alloc_area);
-					break;
-				} else {
-					/* Implies it did not fit, the busy_x,
-					busy_y will now be pointing to the Tile
-					that was found busy/Occupied */
-					x = busy_x;
-					y = busy_y;
-				}
-			} else {
-				PE("Error in Moving left: Error Code %d,"
-					"Breaking....\n", ret);
-				break;
-			}
+	checked everything.  Walk backwards from the bottom right of the scan
+	area through the busy map, each time checking the free run between
+	the previous busy page and the current end. */
+	start = SLOT(pvt, 0, scan_area->p1.y);
+	end = SLOT(pvt, scan_area->p0.x, scan_area->p0.y) + 1;
+	while (end > start && end - start >= num_of_pages) {
+		busy = find_last_bit(pvt->busy_map, end);
+		if (busy >= end || busy < start || end - busy > num_of_pages) {
+			/* free run [end - num_of_pages, end) fits */
+			slot = end - num_of_pages;
+			assign(alloc_area, slot % pvt->width,
+			       slot / pvt->width, (end - 1) % pvt->width,
+			       (end - 1) / pvt->width);
+			PA(3, "Allocated 1D area", alloc_area);
+			return TilerErrorNone;
 		}
 
-		/* Ah if we are here then we the Tile is occupied, now we might
+		/* Ah if we are here then the run is too short, now we might
 		move to the start of parent locations */
-		if (pvt->tcm_map[x][y].type == TCM_1D) {
-			busy_x = pvt->tcm_map[x][y].parent_area.p0.x;
-			busy_y = pvt->tcm_map[x][y].parent_area.p0.y;
-		} else {
-			busy_x = pvt->tcm_map[x][y].parent_area.p0.x;
-			busy_y = y;
-		}
-		x = busy_x;
-		y = busy_y;
-
+		x = busy % pvt->width;
+		y = busy / pvt->width;
+		if (pvt->tcm_map[x][y].type == TCM_1D)
+			end = SLOT(pvt, pvt->tcm_map[x][y].parent_area.p0.x,
+				   pvt->tcm_map[x][y].parent_area.p0.y);
+		else
+			end = SLOT(pvt, pvt->tcm_map[x][y].parent_area.p0.x,
+				   y);
 		P3("Busy Tile found moving to ParentArea start :"
-			"(%d %d)\n", x, y);
-		ret = move_left(tcm, x, y, 1, &left_x, &left_y);
+			"(%d %d)\n", end % pvt->width, end / pvt->width);
 	}
 
-	if (!fit)
-		ret = TilerErrorNoRoom;
-
-	return ret;
+	return TilerErrorNoRoom;
 }
 
 /**
@@ -1363,79 +1338,162 @@ static s32 scan_areas_and_find_fit(struct tcm *tcm, u16 w, u16 h, u16 stride,
 	return ret;
 }
 
+#ifdef SCAN_BOTTOM_UP
 static s32 check_fit_r_and_b(struct tcm *tcm, u16 w, u16 h, u16 left_x,
 			     u16 top_y)
 {
-	u16 xx = 0, yy = 0;
-	s32 ret = FIT;
 	struct sita_pvt *pvt = (struct sita_pvt *)tcm->pvt;
 
-	for (yy = top_y; yy < top_y+h; yy++) {
-		for (xx = left_x; xx < left_x+w; xx++) {
-			/*P("Checking Occ: (%d %d) - %d\n",xx,yy,
-			pvt->tcm_map[xx][yy].is_occupied); */
-			if (pvt->tcm_map[xx][yy].is_occupied == OCCUPIED) {
-				ret = NO_FIT;
-				return ret;
-			}
-		}
+	if (fill_band(tcm, h, top_y) == NO_FIT)
+		return NO_FIT;
+
+	return find_next_bit(pvt->band, left_x + w, left_x) < left_x + w ?
+		NO_FIT : FIT;
+}
+#endif
+
+/*
+ * Stores the running OR of the rows from from_y to to_y, in either direction,
+ * into the same rows of map.
+ */
+static void or_rows(struct tcm *tcm, unsigned long *map, s32 from_y,
+		    s32 to_y)
+{
+	s32 yy, step = from_y <= to_y ? 1 : -1;
+	u16 i;
+	unsigned long *row, *prev, *cur;
+	struct sita_pvt *pvt = (struct sita_pvt *)tcm->pvt;
+
+	memcpy(map + from_y * pvt->row_words, ROW_MAP(pvt, from_y),
+	       pvt->row_words * sizeof(unsigned long));
+
+	for (yy = from_y + step; yy != to_y + step; yy += step) {
+		row = ROW_MAP(pvt, yy);
+		prev = map + (yy - step) * pvt->row_words;
+		cur = map + yy * pvt->row_words;
+		for (i = 0; i < pvt->row_words; i++)
+			cur[i] = prev[i] | row[i];
 	}
-	return ret;
 }
 
-static s32 check_fit_r_one_dim(struct tcm *tcm, u16 x, u16 y, u32 num_of_pages,
-			u16 *busy_x, u16 *busy_y)
+/*
+ * Collects the columns occupied in any of the rows [top_y, top_y + h) into
+ * pvt->band.  The rows are cut into blocks of h, so the band is the OR of
+ * top_y to the end of its block (sfx_map) and of the start of the next block
+ * to the bottom row (pfx_map).  Both blocks are kept until the busy map or h
+ * changes, and a scan moving one row at a time ORs about two rows per band
+ * however tall it is.  Returns NO_FIT if every column is occupied.
+ */
+static s32 fill_band(struct tcm *tcm, u16 h, u16 top_y)
 {
-	s32 fit = FIT;
-	s32 ret = TilerErrorNone;
+	u16 i, bottom_y = top_y + h - 1;
+	s32 blk = top_y / h;
+	unsigned long full = ~0UL, *sfx, *pfx;
 	struct sita_pvt *pvt = (struct sita_pvt *)tcm->pvt;
-	s32 i = 0;
-	*busy_x = x;
-	*busy_y = y;
-
-	P2("checking Fit for (%d) pages from (%d %d)\n ", num_of_pages, x, y);
-	while (i < num_of_pages) {
-		/* P("Checking if occupied (%d %d)\n",x, y); */
-		if (pvt->tcm_map[x][y].is_occupied) {
-			/*Oh the Tile is occupied so we break and let know that
-						we encoutered a BUSY tile */
-			fit = NO_FIT;
-
-			/* Now going to the start of the parent allocation
-			   so we avoid unecessary checking */
-			if (pvt->tcm_map[x][y].type == TCM_1D) {
-				*busy_x = pvt->tcm_map[x][y].parent_area.p0.x;
-				*busy_y = pvt->tcm_map[x][y].parent_area.p0.y;
-			} else {
-				*busy_x = pvt->tcm_map[x][y].parent_area.p0.x;
-				*busy_y = y;
-			}
-			/* TODO: Could also move left in case of TCM_2D */
-			P2("Busy Tile found moving to ParentArea start :"
-				"(%d %d)\n", *busy_x, *busy_y);
-			break;
+
+	if (pvt->band_h != h) {
+		pvt->band_h = h;
+		pvt->sfx_blk = -1;
+		pvt->pfx_blk = -1;
+	}
+
+	if (pvt->sfx_blk != blk) {
+		or_rows(tcm, pvt->sfx_map,
+			min_t(s32, (blk + 1) * h, pvt->height) - 1, blk * h);
+		pvt->sfx_blk = blk;
+	}
+	sfx = pvt->sfx_map + top_y * pvt->row_words;
+
+	if (bottom_y < (blk + 1) * h) {
+		for (i = 0; i < pvt->row_words; i++) {
+			pvt->band[i] = sfx[i];
+			full &= sfx[i];
 		}
+		return full == ~0UL ? NO_FIT : FIT;
+	}
 
-		i++;
-		/* Sorry for this ugly code, i had to break before moving right
-		unecessarily */
-		/* This also helps my dual purpose busy_x and busy_y with the
-		end co-ordinates  of 1D allocations*/
-		if (i == num_of_pages)
-			break;
+	if (pvt->pfx_blk != blk + 1) {
+		or_rows(tcm, pvt->pfx_map, (blk + 1) * h,
+			min_t(s32, (blk + 2) * h, pvt->height) - 1);
+		pvt->pfx_blk = blk + 1;
+	}
+	pfx = pvt->pfx_map + bottom_y * pvt->row_words;
 
-		ret = move_right(tcm, x, y, 1, busy_x, busy_y);
-		if (ret != TilerErrorNone) {
-			PE("Error in Moving Right.. Breaking...\n");
-			fit = NO_FIT;
-			break;
+	for (i = 0; i < pvt->row_words; i++) {
+		pvt->band[i] = sfx[i] | pfx[i];
+		full &= pvt->band[i];
+	}
+	return full == ~0UL ? NO_FIT : FIT;
+}
+
+/* counts the occupied pages among num_of_pages pages starting at slot */
+static u16 count_busy_slots(struct tcm *tcm, u32 slot, u32 num_of_pages)
+{
+	u16 count = 0;
+	u32 end = slot + num_of_pages;
+	struct sita_pvt *pvt = (struct sita_pvt *)tcm->pvt;
+
+	for (slot = find_next_bit(pvt->busy_map, end, slot); slot < end;
+	     slot = find_next_bit(pvt->busy_map, end, slot + 1))
+		count++;
+
+	return count;
+}
+
+/*
+ * Sets or clears nbits bits of map from start on, a word at a time, and
+ * returns how many of them changed.
+ */
+static u32 update_bits(unsigned long *map, u32 start, u32 nbits, u8 set)
+{
+	u32 changed = 0, end = start + nbits, bit, n;
+	unsigned long mask, *word;
+
+	while (start < end) {
+		word = map + BIT_WORD(start);
+		bit = start % BITS_PER_LONG;
+		n = min_t(u32, end - start, BITS_PER_LONG - bit);
+		mask = (n == BITS_PER_LONG ? ~0UL : (1UL << n) - 1) << bit;
+		if (set) {
+			changed += hweight_long(~*word & mask);
+			*word |= mask;
 		} else {
-			x = *busy_x;
-			y = *busy_y;
+			changed += hweight_long(*word & mask);
+			*word &= ~mask;
 		}
+		start += n;
 	}
 
-	return fit;
+	return changed;
+}
+
+/* updates the free space index for num_of_pages pages starting at slot */
+static void mark_slots(struct tcm *tcm, u32 slot, u32 num_of_pages,
+		       u8 occupied)
+{
+	u16 x, y;
+	u32 n, changed;
+	struct sita_pvt *pvt = (struct sita_pvt *)tcm->pvt;
+
+	/* the running ORs of fill_band() are out of date now */
+	pvt->band_h = 0;
+
+	/* a run of 1D pages may wrap into the following rows */
+	while (num_of_pages) {
+		x = slot % pvt->width;
+		y = slot / pvt->width;
+		n = min_t(u32, num_of_pages, pvt->width - x);
+
+		changed = update_bits(pvt->busy_map, slot, n, occupied);
+		update_bits(ROW_MAP(pvt, y), x, n, occupied);
+		if (occupied)
+			pvt->num_free -= changed;
+		else
+			pvt->num_free += changed;
+
+		slot += n;
+		num_of_pages -= n;
+	}
 }
 
 static s32 insert_area_with_tiler_page(struct tcm *tcm,
@@ -1455,15 +1513,17 @@ static s32 insert_area_with_tiler_page(struct tcm *tcm,
 	for (x = area->p0.x; x <= area->p1.x; ++x)
 		for (y = area->p0.y; y <= area->p1.y; ++y)
 			pvt->tcm_map[x][y] = tile;
+	for (y = area->p0.y; y <= area->p1.y; ++y)
+		mark_slots(tcm, SLOT(pvt, area->p0.x, y),
+			   area->p1.x - area->p0.x + 1, tile.is_occupied);
 	return TilerErrorNone;
 }
 
 static s32 insert_pages_with_tiler_page(struct tcm *tcm, struct tcm_area *area,
 		struct tiler_page tile)
 {
-	u16 x = 0, y = 0;
-	u16 right_x = 0, right_y = 0;
-	s32 ret = TilerErrorNone;
+	u16 x, y;
+	u32 slot, end;
 	struct sita_pvt *pvt = (struct sita_pvt *)tcm->pvt;
 
 	if (area == NULL) {
@@ -1472,30 +1532,24 @@ static s32 insert_pages_with_tiler_page(struct tcm *tcm, struct tcm_area *area,
 	}
 
 	/*Note: By the way I expect Pages specified from Right to Left */
-	/* TO DO:
-	*Do i really need to check integrity of area specs?
-	*/
-
 	P2("Inserting Tiler Pages from (%d %d) to (%d %d)\n", area->p0.x,
 	   area->p0.y, area->p1.x, area->p1.y);
 
-	x = area->p0.x;
-	y = area->p0.y;
+	slot = SLOT(pvt, area->p0.x, area->p0.y);
+	end = SLOT(pvt, area->p1.x, area->p1.y);
+	if (end < slot || end >= pvt->width * pvt->height) {
+		PE("Invalid dimensions\n");
+		return TilerErrorInvalidDimension;
+	}
 
-	while (!(x == area->p1.x && y == area->p1.y)) {
-		/* P("(%d %d)\n",x,y); */
+	mark_slots(tcm, slot, end - slot + 1, tile.is_occupied);
+	for (x = area->p0.x, y = area->p0.y; slot <= end; slot++) {
 		pvt->tcm_map[x][y] = tile;
-		ret = move_right(tcm, x, y, 1, &right_x, &right_y);
-		if (ret == TilerErrorNone) {
-			x = right_x;
-			y = right_y;
-		} else {
-			PE("Error in Moving right\n");
-			return ret;
+		if (++x == pvt->width) {
+			x = 0;
+			y++;
 		}
 	}
-	/* set the last tile */
-	pvt->tcm_map[x][y] = tile;
 
 	return TilerErrorNone;
 }
@@ -1703,7 +1757,7 @@ static s32 get_busy_neigh_stats(struct tcm *tcm, u16 width, u16 height,
 			 struct tcm_area *top_left_corner,
 			 struct neighbour_stats *neighbour_stat)
 {
-	s16 xx = 0, yy = 0;
+	s16 yy = 0;
 	struct tcm_area left_edge;
 	struct tcm_area right_edge;
 	struct tcm_area top_edge;
@@ -1749,29 +1803,33 @@ static s32 get_busy_neigh_stats(struct tcm *tcm, u16 width, u16 height,
 	dump_area(&left_edge);
 	*/
 
-	/* Parsing through top & bottom edge */
-	for (xx = top_edge.p0.x; xx <= top_edge.p1.x; xx++) {
-		if (top_edge.p0.y - 1 < 0)
-			neighbour_stat->top_boundary++;
-		else if (pvt->tcm_map[xx][top_edge.p0.y - 1].is_occupied)
-			neighbour_stat->top_occupied++;
-
-		if (bottom_edge.p0.y + 1 > pvt->height - 1)
-			neighbour_stat->bottom_boundary++;
-		else if (pvt->tcm_map[xx][bottom_edge.p0.y+1].is_occupied)
-			neighbour_stat->bottom_occupied++;
-	}
+	/* Parsing through top & bottom edge, the rows above and below are
+	contiguous in the busy map */
+	if (top_edge.p0.y - 1 < 0)
+		neighbour_stat->top_boundary += width;
+	else
+		neighbour_stat->top_occupied += count_busy_slots(tcm,
+			SLOT(pvt, top_edge.p0.x, top_edge.p0.y - 1), width);
+
+	if (bottom_edge.p0.y + 1 > pvt->height - 1)
+		neighbour_stat->bottom_boundary += width;
+	else
+		neighbour_stat->bottom_occupied += count_busy_slots(tcm,
+			SLOT(pvt, bottom_edge.p0.x, bottom_edge.p0.y + 1),
+			width);
 
 	/* Parsing throught left and right edge */
 	for (yy = left_edge.p0.y; yy <= left_edge.p1.y; ++yy) {
 		if (left_edge.p0.x - 1 < 0)
 			neighbour_stat->left_boundary++;
-		else if (pvt->tcm_map[left_edge.p0.x - 1][yy].is_occupied)
+		else if (test_bit(SLOT(pvt, left_edge.p0.x - 1, yy),
+				  pvt->busy_map))
 			neighbour_stat->left_occupied++;
 
 		if (right_edge.p0.x + 1 > pvt->width - 1)
 			neighbour_stat->right_boundary++;
-		else if (pvt->tcm_map[right_edge.p0.x + 1][yy].is_occupied)
+		else if (test_bit(SLOT(pvt, right_edge.p0.x + 1, yy),
+				  pvt->busy_map))
 			neighbour_stat->right_occupied++;
 
 	}
@@ -1818,89 +1876,6 @@ static s32 sita_get_parent(struct tcm *tcm, struct tcm_pt *pt,
 	return TilerErrorNone;
 }
 
-static s32 move_left(struct tcm *tcm, u16 x, u16 y, u32 num_of_pages,
-		     u16 *xx, u16 *yy)
-{
-	/* Num of Pages remaining to the left of the same ROW. */
-	u16 num_of_pages_left = x;
-	u16 remain_pages = 0;
-	struct sita_pvt *pvt = (struct sita_pvt *)tcm->pvt;
-
-	/* I want this function to be really fast and dont take too much time,
-					so i will not do detailed checks */
-	if (x > pvt->width || y > pvt->height || xx == NULL || yy == NULL) {
-		PE("Error in input arguments\n");
-		return TilerErrorInvalidArg;
-	}
-
-	/*Checking if we are going to go out of bound with the given
-	num_of_pages */
-	if (num_of_pages > x + (y * pvt->width)) {
-		PE("Overflows off the top left corner, can go at the Max (%d) "
-			"to left from (%d, %d)\n", (x + y * pvt->width), x, y);
-		return TilerErrorOverFlow;
-	}
-
-	if (num_of_pages > num_of_pages_left) {
-		/* we fit the num of Pages Left on the same column */
-		remain_pages = num_of_pages - num_of_pages_left;
-
-		if (0 == remain_pages % pvt->width) {
-			*xx = 0;
-			*yy = y - remain_pages / pvt->width;
-		} else {
-			*xx = pvt->width - remain_pages %
-			      pvt->width;
-			*yy = y - (1 + remain_pages / pvt->width);
-		}
-	} else {
-		*xx = x - num_of_pages;
-		*yy = y;
-	}
-	return TilerErrorNone;
-}
-
-static s32 move_right(struct tcm *tcm, u16 x, u16 y, u32 num_of_pages,
-	       u16 *xx, u16 *yy)
-{
-	struct sita_pvt *pvt = (struct sita_pvt *)tcm->pvt;
-	u32 avail_pages = (pvt->width - x - 1) +
-			  (pvt->height - y - 1) * pvt->width;
-	/* Num of Pages remaining to the Right of the same ROW. */
-	u16 num_of_pages_right = pvt->width - 1 - x;
-	u16 remain_pages = 0;
-
-	if (x > pvt->width || y > pvt->height || xx == NULL || yy == NULL) {
-		PE("Error in input arguments");
-		return TilerErrorInvalidArg;
-	}
-
-	/*Checking if we are going to go out of bound with the given
-	num_of_pages */
-	if (num_of_pages > avail_pages) {
-		PE("Overflows off the top Right corner, can go at the Max (%d) "
-			"to Right from (%d, %d)\n", avail_pages, x, y);
-		return TilerErrorOverFlow;
-	}
-
-	if (num_of_pages > num_of_pages_right) {
-		remain_pages = num_of_pages - num_of_pages_right;
-
-		if (0 == remain_pages % pvt->width) {
-			*xx = pvt->width - 1;
-			*yy = y + remain_pages / pvt->width;
-		} else {
-			*xx = remain_pages % pvt->width - 1;
-			*yy = y + (1 + remain_pages / pvt->width);
-		}
-	} else {
-		*xx = x + num_of_pages;
-		*yy = y;
-	}
-
-	return TilerErrorNone;
-}
-
 #ifdef TILER_TEST_FUNCTIONS
 /* Test insert
  * Dummy insertion, No Error Checking.
@@ -1927,12 +1902,6 @@ static s32 test_insert(struct tcm *tcm, IN struct area_spec_list *new_area)
 	return insert_pages_with_tiler_page(tcm, &area, tile);
 }
 
-static s32 test_dump_alloc_list(struct tcm *tcm)
-{
-	dump_list_entries(pvt->res_list);
-	return TilerErrorNone;
-}
-
 static s32 test_allocate_2D_area(struct tcm *tcm, IN u16 w, IN u16 h,
 		  u16  align, u16 corner, OUT struct tcm_area *allocated_area)
 {
@@ -1990,9 +1959,6 @@ static s32 test_allocate_2D_area(struct tcm *tcm, IN u16 w, IN u16 h,
 
 		/* inserting into tiler container */
 		insert_area_with_tiler_page(tcm, allocated_area, tile);
-
-		/*updating the list of allocations */
-		insert_element(&pvt->res_list, allocated_area, TCM_2D);
 	}
 
 	mutex_unlock(&(pvt->mtx));
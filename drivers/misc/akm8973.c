@@ -22,6 +22,7 @@
 #include <linux/interrupt.h>
 #include <linux/irq.h>
 #include <linux/miscdevice.h>
+#include <linux/sensor-poll.h>
 #include <linux/uaccess.h>
 #include <linux/workqueue.h>
 
@@ -44,7 +45,7 @@ struct akm8973_data {
 
 	struct work_struct irq_work;
 
-	struct delayed_work input_work;
+	struct sensor_poll_client poll_client;
 	struct input_dev *input_dev;
 
 	int hw_initialized;
@@ -417,9 +418,8 @@ static int akm8973_enable(struct akm8973_data *akm)
 			return err;
 		}
 
-		schedule_delayed_work(&akm->input_work,
-				      msecs_to_jiffies(akm->pdata->
-						       poll_interval));
+		akm->poll_client.interval = akm->pdata->poll_interval;
+		sensor_poll_start(&akm->poll_client);
 	}
 
 	return 0;
@@ -428,7 +428,7 @@ static int akm8973_enable(struct akm8973_data *akm)
 static int akm8973_disable(struct akm8973_data *akm)
 {
 	if (test_and_clear_bit(ENABLED, &akm->flags)) {
-		cancel_delayed_work_sync(&akm->input_work);
+		sensor_poll_stop(&akm->poll_client);
 		akm8973_device_power_off(akm);
 	}
 
@@ -499,6 +499,8 @@ static int akm8973_misc_ioctl(struct inode *inode, struct file *file,
 
 		akm->pdata->poll_interval =
 		    max(interval, akm->pdata->min_interval);
+		sensor_poll_set_interval(&akm->poll_client,
+					 akm->pdata->poll_interval);
 		break;
 
 	case AKM8973_IOCTL_SET_FLAG:
@@ -541,18 +543,15 @@ static struct miscdevice akm8973_misc_device = {
 	.fops = &akm8973_misc_fops,
 };
 
-static void akm8973_input_work_func(struct work_struct *work)
+static void akm8973_poll(struct sensor_poll_client *client, ktime_t stamp)
 {
-	struct akm8973_data *akm = container_of((struct delayed_work *)work,
-						struct akm8973_data,
-						input_work);
+	struct akm8973_data *akm = container_of(client, struct akm8973_data,
+						poll_client);
 
 	/* if we are already measuring, don't start another measurement */
 	if (!test_and_set_bit(BUSY, &akm->flags)) {
 		akm8973_set_mode(akm, AKM8973_MODE_MEASURE);
 	}
-	schedule_delayed_work(&akm->input_work,
-			      msecs_to_jiffies(akm->pdata->poll_interval));
 }
 
 #ifdef AKM8973_OPEN_ENABLE
@@ -597,7 +596,8 @@ static int akm8973_input_init(struct akm8973_data *akm)
 {
 	int err;
 
-	INIT_DELAYED_WORK(&akm->input_work, akm8973_input_work_func);
+	akm->poll_client.name = NAME;
+	akm->poll_client.poll = akm8973_poll;
 
 	akm->input_dev = input_allocate_device();
 	if (!akm->input_dev) {
@@ -886,6 +886,77 @@ static void onenand_invalidate_bufferram(struct mtd_info *mtd, loff_t addr,
 	}
 }
 
+#ifdef CONFIG_MTD_ONENAND_READ_AHEAD
+/**
+ * onenand_start_prefetch - [GENERIC] Start loading the page after a read
+ * @param mtd		MTD device structure
+ * @param from		offset the read ended at
+ *
+ * yaffs2 and the block layer ask for one page or a few at a time, so the
+ * read-while-load in onenand_read_ops_nolock() has nothing to overlap with
+ * the first load of every request.  When a read continues the previous one
+ * and ends on a page boundary, start loading the next page of the block
+ * into the other BufferRAM and leave it in flight.  The next user of the
+ * chip finishes it in onenand_get_device().
+ */
+static void onenand_start_prefetch(struct mtd_info *mtd, loff_t from)
+{
+	struct onenand_chip *this = mtd->priv;
+
+	if (from & (this->writesize - 1) || from >= mtd->size)
+		return;
+
+	/* Stay in the block, a sequential reader may skip a bad one */
+	if (onenand_block(this, from) != onenand_block(this, from - 1))
+		return;
+
+	if (onenand_check_bufferram(mtd, from))
+		return;
+
+	this->command(mtd, ONENAND_CMD_READ, from, this->writesize);
+	/* The load overwrites whatever this BufferRAM held */
+	onenand_update_bufferram(mtd, from, 0);
+	this->prefetch = from;
+}
+
+/**
+ * onenand_finish_prefetch - [GENERIC] Wait for a read ahead load
+ * @param mtd		MTD device structure
+ *
+ * Poll for the end of the load and keep the page if it came in clean.
+ * A page with ECC errors is dropped, so that the read that wants it
+ * loads it again and reports and accounts the errors itself.
+ */
+static void onenand_finish_prefetch(struct mtd_info *mtd)
+{
+	struct onenand_chip *this = mtd->priv;
+	unsigned int interrupt = 0, ctrl;
+	unsigned long timeout;
+	int valid;
+
+	if (likely(this->prefetch < 0))
+		return;
+
+	/* Whatever is left of a 30us load */
+	timeout = jiffies + msecs_to_jiffies(20);
+	while (time_before(jiffies, timeout)) {
+		interrupt = this->read_word(this->base + ONENAND_REG_INTERRUPT);
+		if (interrupt & ONENAND_INT_MASTER)
+			break;
+	}
+	interrupt = this->read_word(this->base + ONENAND_REG_INTERRUPT);
+	ctrl = this->read_word(this->base + ONENAND_REG_CTRL_STATUS);
+
+	valid = (interrupt & ONENAND_INT_READ) &&
+		!(ctrl & ONENAND_CTRL_ERROR) && !onenand_read_ecc(this);
+	onenand_update_bufferram(mtd, this->prefetch, valid);
+	this->prefetch = -1;
+}
+#else
+#define onenand_start_prefetch(...)	do { } while (0)
+#define onenand_finish_prefetch(...)	do { } while (0)
+#endif
+
 /**
  * onenand_get_device - [GENERIC] Get chip for selected access
  * @param mtd		MTD device structure
@@ -919,6 +990,9 @@ static int onenand_get_device(struct mtd_info *mtd, int new_state)
 		remove_wait_queue(&this->wq, &wait);
 	}
 
+	/* The chip is ours, but it may still be reading ahead */
+	onenand_finish_prefetch(mtd);
+
 	return 0;
 }
 
@@ -1143,7 +1217,7 @@ static int onenand_read_ops_nolock(struct mtd_info *mtd, loff_t from,
 	u_char *oobbuf = ops->oobbuf;
 	int read = 0, column, thislen;
 	int oobread = 0, oobcolumn, thisooblen, oobsize;
-	int ret = 0, boundary = 0;
+	int ret = 0, boundary = 0, seq;
 	int writesize = this->writesize;
 
 	DEBUG(MTD_DEBUG_LEVEL3, "onenand_read_ops_nolock: from = 0x%08x, len = %i\n", (unsigned int) from, (int) len);
@@ -1165,6 +1239,9 @@ static int onenand_read_ops_nolock(struct mtd_info *mtd, loff_t from,
 
 	stats = mtd->ecc_stats;
 
+	/* Sequential if it continues the last read or spans pages */
+	seq = from == this->read_next || len > writesize;
+
  	/* Read-while-load method */
 
  	/* Do first load to bufferRAM */
@@ -1248,6 +1325,10 @@ static int onenand_read_ops_nolock(struct mtd_info *mtd, loff_t from,
 	if (ret)
 		return ret;
 
+	this->read_next = from;
+	if (seq && len)
+		onenand_start_prefetch(mtd, from);
+
 	if (mtd->ecc_stats.failed - stats.failed)
 		return -EBADMSG;
 
@@ -1660,6 +1741,7 @@ static int onenand_panic_write(struct mtd_info *mtd, loff_t to, size_t len,
 
 	/* Wait for any existing operation to clear */
 	onenand_panic_wait(mtd);
+	this->prefetch = -1;
 
 	DEBUG(MTD_DEBUG_LEVEL3, "onenand_panic_write: to = 0x%08x, len = %i\n",
 	      (unsigned int) to, (int) len);
@@ -1770,6 +1852,31 @@ static int onenand_fill_auto_oob(struct mtd_info *mtd, u_char *oob_buf,
 	return 0;
 }
 
+/**
+ * onenand_cache_prog - [GENERIC] Check if 2X cache program can be used
+ * @param mtd		MTD device structure
+ * @param to		offset of the page to program
+ * @param subpage	page is only partly written
+ * @param left		bytes left to write, this page included
+ *
+ * 2X cache program frees the DataRAM as soon as the chip has taken the
+ * page, so the next page is loaded while this one is still programming.
+ * Use it for full pages followed by more of the same block; the last
+ * page of a run goes out with 2X program, which waits for all of them.
+ */
+static inline int onenand_cache_prog(struct mtd_info *mtd, loff_t to,
+				     int subpage, size_t left)
+{
+#ifdef CONFIG_MTD_ONENAND_CACHE_PROGRAM
+	struct onenand_chip *this = mtd->priv;
+
+	return ONENAND_IS_2PLANE(this) && !subpage && left > mtd->writesize &&
+		((to + mtd->writesize) & (mtd->erasesize - 1));
+#else
+	return 0;
+#endif
+}
+
 /**
  * onenand_write_ops_nolock - [OneNAND Interface] write main and/or out-of-band
  * @param mtd		MTD device structure
@@ -1785,6 +1892,7 @@ static int onenand_write_ops_nolock(struct mtd_info *mtd, loff_t to,
 	int written = 0, column, thislen = 0, subpage = 0;
 	int prev = 0, prevlen = 0, prev_subpage = 0, first = 1;
 	int oobwritten = 0, oobcolumn, thisooblen, oobsize;
+	int cmd, cached = 0;
 	size_t len = ops->len;
 	size_t ooblen = ops->ooblen;
 	const u_char *buf = ops->datbuf;
@@ -1894,7 +2002,10 @@ static int onenand_write_ops_nolock(struct mtd_info *mtd, loff_t to,
 			ONENAND_SET_NEXT_BUFFERRAM(this);
 		}
 
-		this->command(mtd, ONENAND_CMD_PROG, to, mtd->writesize);
+		cmd = ONENAND_CMD_PROG;
+		if (onenand_cache_prog(mtd, to, subpage, len - written))
+			cmd = ONENAND_CMD_2X_CACHE_PROG;
+		this->command(mtd, cmd, to, mtd->writesize);
 
 		/*
 		 * 2 PLANE, MLC, and Flex-OneNAND wait here
@@ -1905,15 +2016,25 @@ static int onenand_write_ops_nolock(struct mtd_info *mtd, loff_t to,
 			/* In partial page write we don't update bufferram */
 			onenand_update_bufferram(mtd, to, !ret && !subpage);
 			if (ret) {
+				/* It may be any page of the cached run failing */
+				written -= cached;
 				printk(KERN_ERR "onenand_write_ops_nolock: write failed %d\n", ret);
 				break;
 			}
 
-			/* Only check verify write turn on */
-			ret = onenand_verify(mtd, buf, to, thislen);
-			if (ret) {
-				printk(KERN_ERR "onenand_write_ops_nolock: verify failed %d\n", ret);
-				break;
+			if (cmd == ONENAND_CMD_2X_CACHE_PROG) {
+				/* Still programming, verify it with the last page */
+				cached += thislen;
+			} else {
+				/* Only check verify write turn on */
+				ret = onenand_verify(mtd, buf - cached, to - cached,
+						     cached + thislen);
+				if (ret) {
+					written -= cached;
+					printk(KERN_ERR "onenand_write_ops_nolock: verify failed %d\n", ret);
+					break;
+				}
+				cached = 0;
 			}
 
 			written += thislen;
@@ -3483,6 +3604,8 @@ int onenand_scan(struct mtd_info *mtd, int maxchips)
 	}
 
 	this->state = FL_READY;
+	this->read_next = -1;
+	this->prefetch = -1;
 	init_waitqueue_head(&this->wq);
 	spin_lock_init(&this->chip_lock);
 
@@ -17,7 +17,9 @@
 
 #include <linux/kernel.h>
 #include <linux/module.h>
+#include <linux/moduleparam.h>
 #include <linux/init.h>
+#include <linux/hrtimer.h>
 #include <linux/vmalloc.h>
 #include <linux/mtd/mtd.h>
 #include <linux/mtd/partitions.h>
@@ -61,6 +63,28 @@ static int boundary[] = {
 	CONFIG_FLEXONENAND_SIM_DIE1_BOUNDARY,
 };
 
+/*
+ * Command latencies.  The data moves at once, but the interrupt register
+ * only reports the command done and the controller idle after this long,
+ * so read-while-load and read ahead show up in throughput as on a chip.
+ * A KFM4G16Q2M takes about 30us to load, 220us to program and 2ms to
+ * erase.  The default of 0 completes all commands at once.
+ */
+static unsigned int load_us;
+module_param(load_us, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(load_us, "Page load time in usec");
+
+static unsigned int prog_us;
+module_param(prog_us, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(prog_us, "Page program time in usec");
+
+static unsigned int erase_us;
+module_param(erase_us, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(erase_us, "Block erase time in usec");
+
+/* When the running command completes */
+static s64 ready_ns;
+
 struct onenand_flash {
 	void __iomem *base;
 	void __iomem *data;
@@ -221,6 +245,47 @@ static void onenand_update_interrupt(struct onenand_chip *this, int cmd)
 	writew(interrupt, this->base + ONENAND_REG_INTERRUPT);
 }
 
+/**
+ * onenand_busy - Check if a command is still running
+ *
+ * Returns:		1 while the latency of the last command lasts
+ */
+static int onenand_busy(void)
+{
+	return ktime_to_ns(ktime_get()) < ready_ns;
+}
+
+/**
+ * onenand_update_latency - Start the latency of a command
+ * @cmd:		The command to be sent
+ */
+static void onenand_update_latency(int cmd)
+{
+	unsigned int us;
+
+	switch (cmd) {
+	case ONENAND_CMD_READ:
+	case ONENAND_CMD_READOOB:
+		us = load_us;
+		break;
+
+	case ONENAND_CMD_PROG:
+	case ONENAND_CMD_PROGOOB:
+		us = prog_us;
+		break;
+
+	case ONENAND_CMD_ERASE:
+		us = erase_us;
+		break;
+
+	default:
+		us = 0;
+		break;
+	}
+
+	ready_ns = ktime_to_ns(ktime_get()) + (s64)us * NSEC_PER_USEC;
+}
+
 /**
  * onenand_check_overwrite - Check if over-write happened
  * @dest:		The destination pointer
@@ -372,6 +437,10 @@ static void onenand_command_handle(struct onenand_chip *this, int cmd)
 	int block = -1, page = -1, bufferram = -1;
 	int dataram = 0;
 
+	/* The driver has to wait for the interrupt first */
+	if (cmd != ONENAND_CMD_RESET && onenand_busy())
+		printk(KERN_ERR "command 0x%02x while busy\n", cmd);
+
 	switch (cmd) {
 	case ONENAND_CMD_UNLOCK:
 	case ONENAND_CMD_LOCK:
@@ -412,6 +481,28 @@ static void onenand_command_handle(struct onenand_chip *this, int cmd)
 	onenand_data_handle(this, cmd, dataram, offset);
 
 	onenand_update_interrupt(this, cmd);
+	onenand_update_latency(cmd);
+}
+
+/**
+ * onenand_readw - [OneNAND Interface] Emulate read operation
+ * @addr:		address to read
+ *
+ * Read OneNAND register, which shows the command running until its
+ * latency is over
+ */
+static unsigned short onenand_readw(void __iomem *addr)
+{
+	struct onenand_chip *this = info->mtd.priv;
+
+	if (onenand_busy()) {
+		if (addr == this->base + ONENAND_REG_INTERRUPT)
+			return 0;
+		if (addr == this->base + ONENAND_REG_CTRL_STATUS)
+			return ONENAND_CTRL_ONGO;
+	}
+
+	return readw(addr);
 }
 
 /**
@@ -512,7 +603,8 @@ static int __init onenand_sim_init(void)
 		return -ENOMEM;
 	}
 
-	/* Override write_word function */
+	/* Override read_word and write_word functions */
+	info->onenand.read_word = onenand_readw;
 	info->onenand.write_word = onenand_writew;
 
 	if (flash_init(&info->flash)) {
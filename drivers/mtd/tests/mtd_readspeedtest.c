@@ -0,0 +1,329 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; see the file COPYING. If not, write to the Free Software
+ * Foundation, 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ * Test read speed of a MTD device the way file systems read it: whole
+ * eraseblocks, single pages as the block layer and squashfs do, single pages
+ * with their OOB as yaffs2 does, and pages in random order.  Nothing is
+ * written, so it can run on a partition that is in use.
+ */
+
+#include <linux/init.h>
+#include <linux/module.h>
+#include <linux/moduleparam.h>
+#include <linux/err.h>
+#include <linux/mtd/mtd.h>
+#include <linux/sched.h>
+
+#define PRINT_PREF KERN_INFO "mtd_readspeedtest: "
+
+static int dev;
+module_param(dev, int, S_IRUGO);
+MODULE_PARM_DESC(dev, "MTD device number to use");
+
+static int count;
+module_param(count, int, S_IRUGO);
+MODULE_PARM_DESC(count, "Number of eraseblocks to read (0 = all)");
+
+static struct mtd_info *mtd;
+static unsigned char *iobuf;
+static unsigned char *oobbuf;
+static unsigned char *bbt;
+
+static int pgsize;
+static int ebcnt;
+static int pgcnt;
+static int goodebcnt;
+static struct timeval start, finish;
+static unsigned long next = 1;
+
+static inline unsigned int simple_rand(void)
+{
+	next = next * 1103515245 + 12345;
+	return (unsigned int)((next / 65536) % 32768);
+}
+
+static inline void simple_srand(unsigned long seed)
+{
+	next = seed;
+}
+
+static int check_read(int err, size_t read, size_t len, loff_t addr)
+{
+	/* Ignore corrected ECC errors */
+	if (err == -EUCLEAN)
+		err = 0;
+	if (err || read != len) {
+		printk(PRINT_PREF "error: read failed at %#llx\n", addr);
+		if (!err)
+			err = -EINVAL;
+	}
+	return err;
+}
+
+static int read_eraseblock(int ebnum)
+{
+	size_t read = 0;
+	loff_t addr = ebnum * mtd->erasesize;
+	int err;
+
+	err = mtd->read(mtd, addr, mtd->erasesize, &read, iobuf);
+	return check_read(err, read, mtd->erasesize, addr);
+}
+
+static int read_eraseblock_by_page(int ebnum)
+{
+	size_t read = 0;
+	int i, err = 0;
+	loff_t addr = ebnum * mtd->erasesize;
+
+	for (i = 0; i < pgcnt; i++) {
+		err = mtd->read(mtd, addr, pgsize, &read, iobuf);
+		err = check_read(err, read, pgsize, addr);
+		if (err)
+			break;
+		addr += pgsize;
+	}
+
+	return err;
+}
+
+static int read_page_with_oob(loff_t addr)
+{
+	struct mtd_oob_ops ops;
+	int err;
+
+	ops.mode      = MTD_OOB_AUTO;
+	ops.len       = pgsize;
+	ops.retlen    = 0;
+	ops.ooblen    = mtd->ecclayout ? mtd->ecclayout->oobavail : 0;
+	ops.oobretlen = 0;
+	ops.ooboffs   = 0;
+	ops.datbuf    = iobuf;
+	ops.oobbuf    = ops.ooblen ? oobbuf : NULL;
+
+	err = mtd->read_oob(mtd, addr, &ops);
+	return check_read(err, ops.retlen, pgsize, addr);
+}
+
+static int read_eraseblock_by_page_with_oob(int ebnum)
+{
+	int i, err = 0;
+	loff_t addr = ebnum * mtd->erasesize;
+
+	for (i = 0; i < pgcnt; i++) {
+		err = read_page_with_oob(addr);
+		if (err)
+			break;
+		addr += pgsize;
+	}
+
+	return err;
+}
+
+static int read_random_pages(void)
+{
+	size_t read = 0;
+	int i, ebnum, err = 0;
+	loff_t addr;
+
+	for (i = 0; i < goodebcnt * pgcnt; i++) {
+		do {
+			ebnum = ((simple_rand() << 15) | simple_rand()) % ebcnt;
+		} while (bbt[ebnum]);
+		addr = ebnum * mtd->erasesize +
+		       (simple_rand() % pgcnt) * pgsize;
+
+		err = mtd->read(mtd, addr, pgsize, &read, iobuf);
+		err = check_read(err, read, pgsize, addr);
+		if (err)
+			break;
+		if (!(i % pgcnt))
+			cond_resched();
+	}
+
+	return err;
+}
+
+static int is_block_bad(int ebnum)
+{
+	loff_t addr = ebnum * mtd->erasesize;
+	int ret;
+
+	ret = mtd->block_isbad(mtd, addr);
+	if (ret)
+		printk(PRINT_PREF "block %d is bad\n", ebnum);
+	return ret;
+}
+
+static inline void start_timing(void)
+{
+	do_gettimeofday(&start);
+}
+
+static inline void stop_timing(void)
+{
+	do_gettimeofday(&finish);
+}
+
+static long calc_speed(void)
+{
+	long ms, k, speed;
+
+	ms = (finish.tv_sec - start.tv_sec) * 1000 +
+	     (finish.tv_usec - start.tv_usec) / 1000;
+	if (!ms)
+		ms = 1;
+	k = goodebcnt * (mtd->erasesize / 1024);
+	speed = (k * 1000) / ms;
+	return speed;
+}
+
+static int scan_for_bad_eraseblocks(void)
+{
+	int i, bad = 0;
+
+	bbt = kzalloc(ebcnt, GFP_KERNEL);
+	if (!bbt) {
+		printk(PRINT_PREF "error: cannot allocate memory\n");
+		return -ENOMEM;
+	}
+
+	printk(PRINT_PREF "scanning for bad eraseblocks\n");
+	for (i = 0; i < ebcnt; ++i) {
+		bbt[i] = is_block_bad(i) ? 1 : 0;
+		if (bbt[i])
+			bad += 1;
+		cond_resched();
+	}
+	printk(PRINT_PREF "scanned %d eraseblocks, %d are bad\n", i, bad);
+	goodebcnt = ebcnt - bad;
+	return goodebcnt ? 0 : -EIO;
+}
+
+static int read_all(int (*read_one)(int ebnum), const char *name)
+{
+	int i, err;
+
+	printk(PRINT_PREF "testing %s read speed\n", name);
+	start_timing();
+	for (i = 0; i < ebcnt; ++i) {
+		if (bbt[i])
+			continue;
+		err = read_one(i);
+		if (err)
+			return err;
+		cond_resched();
+	}
+	stop_timing();
+	printk(PRINT_PREF "%s read speed is %ld KiB/s\n", name, calc_speed());
+	return 0;
+}
+
+static int __init mtd_readspeedtest_init(void)
+{
+	int err;
+	uint64_t tmp;
+
+	printk(KERN_INFO "\n");
+	printk(KERN_INFO "=================================================\n");
+	printk(PRINT_PREF "MTD device: %d\n", dev);
+
+	mtd = get_mtd_device(NULL, dev);
+	if (IS_ERR(mtd)) {
+		err = PTR_ERR(mtd);
+		printk(PRINT_PREF "error: cannot get MTD device\n");
+		return err;
+	}
+
+	if (mtd->writesize == 1) {
+		printk(PRINT_PREF "not NAND flash, assume page size is 512 "
+		       "bytes.\n");
+		pgsize = 512;
+	} else
+		pgsize = mtd->writesize;
+
+	tmp = mtd->size;
+	do_div(tmp, mtd->erasesize);
+	ebcnt = tmp;
+	if (count > 0 && count < ebcnt)
+		ebcnt = count;
+	pgcnt = mtd->erasesize / pgsize;
+
+	printk(PRINT_PREF "MTD device size %llu, eraseblock size %u, "
+	       "page size %u, count of eraseblocks %u, pages per "
+	       "eraseblock %u, OOB size %u\n",
+	       (unsigned long long)mtd->size, mtd->erasesize,
+	       pgsize, ebcnt, pgcnt, mtd->oobsize);
+
+	err = -ENOMEM;
+	iobuf = kmalloc(mtd->erasesize, GFP_KERNEL);
+	oobbuf = kmalloc(mtd->oobsize, GFP_KERNEL);
+	if (!iobuf || !oobbuf) {
+		printk(PRINT_PREF "error: cannot allocate memory\n");
+		goto out;
+	}
+
+	err = scan_for_bad_eraseblocks();
+	if (err)
+		goto out;
+
+	/* Read all eraseblocks, 1 eraseblock at a time */
+	err = read_all(read_eraseblock, "eraseblock");
+	if (err)
+		goto out;
+
+	/* Read all eraseblocks, 1 page at a time */
+	err = read_all(read_eraseblock_by_page, "page");
+	if (err)
+		goto out;
+
+	/* Read all eraseblocks, 1 page and its OOB at a time */
+	if (mtd->read_oob && mtd->writesize > 1) {
+		err = read_all(read_eraseblock_by_page_with_oob, "page+oob");
+		if (err)
+			goto out;
+	}
+
+	/* Read as many pages again, in random order */
+	printk(PRINT_PREF "testing random page read speed\n");
+	simple_srand(1);
+	start_timing();
+	err = read_random_pages();
+	if (err)
+		goto out;
+	stop_timing();
+	printk(PRINT_PREF "random page read speed is %ld KiB/s\n",
+	       calc_speed());
+
+	printk(PRINT_PREF "finished\n");
+out:
+	kfree(oobbuf);
+	kfree(iobuf);
+	kfree(bbt);
+	put_mtd_device(mtd);
+	if (err)
+		printk(PRINT_PREF "error %d occurred\n", err);
+	printk(KERN_INFO "=================================================\n");
+	return err;
+}
+module_init(mtd_readspeedtest_init);
+
+static void __exit mtd_readspeedtest_exit(void)
+{
+	return;
+}
+module_exit(mtd_readspeedtest_exit);
+
+MODULE_DESCRIPTION("Read speed test module");
+MODULE_LICENSE("GPL");
@@ -568,10 +568,10 @@ static void free_internal_volumes(struct ubi_device *ubi)
  * This function returns zero in case of success and a negative error code in
  * case of failure.
  *
- * Note, currently this is the only method to attach UBI devices. Hopefully in
- * the future we'll have more scalable attaching methods and avoid full media
- * scanning. But even in this case scanning will be needed as a fall-back
- * attaching method if there are some on-flash table corruptions.
+ * Note, this is the only method to attach UBI devices. If the checkpoint is
+ * enabled, 'ubi_scan()' takes what it can from the checkpoint and only scans
+ * the rest, and it falls back to full media scanning if the checkpoint is
+ * missing or corrupted.
  */
 static int attach_by_scanning(struct ubi_device *ubi)
 {
@@ -599,11 +599,16 @@ static int attach_by_scanning(struct ubi_device *ubi)
 	if (err)
 		goto out_wl;
 
+	err = ubi_ckpt_init(ubi, si);
+	if (err)
+		goto out_wl;
+
 	ubi_scan_destroy_si(si);
 	return 0;
 
 out_wl:
 	ubi_wl_close(ubi);
+	ubi_ckpt_close(ubi);
 out_vtbl:
 	free_internal_volumes(ubi);
 	vfree(ubi->vtbl);
@@ -853,6 +858,7 @@ static int ubi_reboot_notifier(struct notifier_block *n, unsigned long state,
 	ubi = container_of(n, struct ubi_device, reboot_notifier);
 	if (ubi->bgt_thread)
 		kthread_stop(ubi->bgt_thread);
+	ubi_ckpt_write(ubi, 1);
 	ubi_sync(ubi->ubi_num);
 	return NOTIFY_DONE;
 }
@@ -1029,6 +1035,7 @@ out_nofree:
 	do_free = 0;
 out_detach:
 	ubi_wl_close(ubi);
+	ubi_ckpt_close(ubi);
 	if (do_free)
 		free_user_volumes(ubi);
 	free_internal_volumes(ubi);
@@ -1093,6 +1100,7 @@ int ubi_detach_mtd_dev(int ubi_num, int anyway)
 	unregister_reboot_notifier(&ubi->reboot_notifier);
 	if (ubi->bgt_thread)
 		kthread_stop(ubi->bgt_thread);
+	ubi_ckpt_write(ubi, 1);
 
 	/*
 	 * Get a reference to the device in order to prevent 'dev_release()'
@@ -1102,6 +1110,7 @@ int ubi_detach_mtd_dev(int ubi_num, int anyway)
 
 	uif_close(ubi);
 	ubi_wl_close(ubi);
+	ubi_ckpt_close(ubi);
 	free_internal_volumes(ubi);
 	vfree(ubi->vtbl);
 	put_mtd_device(ubi->mtd);
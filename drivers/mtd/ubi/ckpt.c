@@ -0,0 +1,878 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See
+ * the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+/*
+ * UBI checkpoint.
+ *
+ * Attaching an MTD device normally means reading the EC and VID headers of
+ * every physical eraseblock, which takes time proportional to the flash size.
+ * The checkpoint is a snapshot of the state of all PEBs which lets UBI attach
+ * by reading a few PEBs instead. It is stored in the internal checkpoint
+ * volume, see &struct ubi_ckpt_hdr for the on-flash format, and it is written
+ * when the device is attached, detached, and from time to time in between.
+ *
+ * The checkpoint lists every PEB either as used by a logical eraseblock, with
+ * the information the VID header would give, as free, as to be erased, or as
+ * bad. Since the checkpoint is not re-written on every change, it also sets
+ * aside a small pool of free PEBs: while the checkpoint is active, new data is
+ * only written to the pool, and the pool PEBs are scanned when attaching. The
+ * same goes for PEBs whose state the checkpoint cannot tell, like the ones
+ * just being written. When the pool runs out, the next checkpoint is written,
+ * which gets a fresh pool.
+ *
+ * For the snapshot to stay correct, a PEB the checkpoint lists as used must
+ * not be erased before the next checkpoint is written, the WL sub-system keeps
+ * such PEBs aside until then. PEBs which are erased while the checkpoint is
+ * active are not handed out before the next one either.
+ *
+ * The first PEB of the checkpoint, the anchor, is always one of the first
+ * %UBI_CKPT_MAX_START PEBs, so attaching only has to look there for it. If
+ * none of them is free, as on a freshly flashed image, the WL sub-system moves
+ * the data out of one of them. The previous anchor is erased before the next
+ * checkpoint is written, and the checkpoint on the flash is only used if
+ * everything in it checks out. Otherwise, and if the checkpoint cannot be
+ * written, UBI simply falls back to scanning.
+ */
+
+#include <linux/crc32.h>
+#include <linux/bitmap.h>
+#include <linux/vmalloc.h>
+#include "ubi.h"
+
+/* How many percent of the good PEBs the pool gets, and the bounds */
+#define POOL_PERCENT 5
+#define POOL_MIN     8
+#define POOL_MAX     256
+
+/**
+ * ckpt_vol_idx - get the index of a volume in the checkpoint volume table.
+ * @vol_id: volume ID
+ *
+ * Returns %-1 if @vol_id cannot be in the checkpoint.
+ */
+static int ckpt_vol_idx(int vol_id)
+{
+	if (vol_id >= 0 && vol_id < UBI_MAX_VOLUMES)
+		return vol_id;
+	if (vol_id >= UBI_INTERNAL_VOL_START &&
+	    vol_id < UBI_INTERNAL_VOL_START + UBI_INT_VOL_COUNT)
+		return UBI_MAX_VOLUMES + vol_id - UBI_INTERNAL_VOL_START;
+	return -1;
+}
+
+/**
+ * add_ec - account an erase counter in the scanning information.
+ * @si: scanning information
+ * @ec: erase counter
+ */
+static void add_ec(struct ubi_scan_info *si, int ec)
+{
+	si->ec_sum += ec;
+	si->ec_count += 1;
+	if (ec > si->max_ec)
+		si->max_ec = ec;
+	if (ec < si->min_ec)
+		si->min_ec = ec;
+}
+
+/**
+ * find_anchor - find the anchor of the checkpoint.
+ * @ubi: UBI device description object
+ * @vh: VID header buffer
+ * @dirty: bitmap of the first PEBs which are not clean
+ * @sqnum: the sequence number of the anchor is returned here
+ *
+ * Returns the PEB number of the anchor, %-1 if there is none, and a negative
+ * error code in case of failure.
+ */
+static int find_anchor(struct ubi_device *ubi, struct ubi_vid_hdr *vh,
+		       unsigned long *dirty, unsigned long long *sqnum)
+{
+	int err, pnum, anchor = -1;
+
+	for (pnum = 0; pnum < UBI_CKPT_MAX_START && pnum < ubi->peb_count;
+	     pnum++) {
+		err = ubi_io_is_bad(ubi, pnum);
+		if (err < 0)
+			return err;
+		if (err)
+			continue;
+
+		err = ubi_io_read_vid_hdr(ubi, pnum, vh, 0);
+		if (err < 0)
+			return err;
+		if (err == UBI_IO_PEB_FREE)
+			continue;
+
+		__set_bit(pnum, dirty);
+		if (err == UBI_IO_BAD_VID_HDR)
+			continue;
+
+		if (be32_to_cpu(vh->vol_id) != UBI_CKPT_VOLUME_ID ||
+		    be32_to_cpu(vh->lnum) != 0)
+			continue;
+
+		if (anchor == -1 || be64_to_cpu(vh->sqnum) > *sqnum) {
+			anchor = pnum;
+			*sqnum = be64_to_cpu(vh->sqnum);
+		}
+	}
+
+	return anchor;
+}
+
+/**
+ * check_hdr - check the checkpoint header.
+ * @ubi: UBI device description object
+ * @hdr: the checkpoint header
+ * @anchor: the PEB the header was read from
+ * @sqnum: the sequence number of the VID header of @anchor
+ *
+ * Returns zero if the header is fine and %1 if not.
+ */
+static int check_hdr(const struct ubi_device *ubi,
+		     const struct ubi_ckpt_hdr *hdr, int anchor,
+		     unsigned long long sqnum)
+{
+	int i, pnum, ckpt_pebs, vol_count, data_size;
+	uint32_t crc;
+
+	if (be32_to_cpu(hdr->magic) != UBI_CKPT_HDR_MAGIC ||
+	    hdr->version != UBI_CKPT_VERSION)
+		return 1;
+
+	crc = crc32(UBI_CRC32_INIT, hdr, UBI_CKPT_HDR_SIZE_CRC);
+	if (crc != be32_to_cpu(hdr->hdr_crc))
+		return 1;
+
+	ckpt_pebs = be32_to_cpu(hdr->ckpt_pebs);
+	vol_count = be32_to_cpu(hdr->vol_count);
+	data_size = be32_to_cpu(hdr->data_size);
+	if (be32_to_cpu(hdr->peb_count) != ubi->peb_count ||
+	    ckpt_pebs < 1 || ckpt_pebs > UBI_CKPT_MAX_PEBS ||
+	    vol_count < 0 || vol_count > UBI_CKPT_MAX_VOLUMES ||
+	    be64_to_cpu(hdr->sqnum) != sqnum)
+		return 1;
+
+	if (data_size != vol_count * UBI_CKPT_VOL_SIZE +
+			 ubi->peb_count * UBI_CKPT_PEB_SIZE ||
+	    UBI_CKPT_HDR_SIZE + data_size > ckpt_pebs * ubi->leb_size)
+		return 1;
+
+	if (be32_to_cpu(hdr->pnum[0]) != anchor)
+		return 1;
+	for (i = 1; i < ckpt_pebs; i++) {
+		pnum = be32_to_cpu(hdr->pnum[i]);
+		if (pnum < 0 || pnum >= ubi->peb_count)
+			return 1;
+	}
+
+	return 0;
+}
+
+/**
+ * read_ckpt - read the checkpoint.
+ * @ubi: UBI device description object
+ * @vh: VID header buffer
+ * @buf: the checkpoint is read here, the header is already there
+ *
+ * Returns zero in case of success, %1 if the checkpoint is not valid, and a
+ * negative error code in case of failure.
+ */
+static int read_ckpt(struct ubi_device *ubi, struct ubi_vid_hdr *vh,
+		     void *buf)
+{
+	struct ubi_ckpt_hdr *hdr = buf;
+	int err, i, pnum, len, size;
+	unsigned long long sqnum = be64_to_cpu(hdr->sqnum);
+	uint32_t crc;
+
+	size = UBI_CKPT_HDR_SIZE + be32_to_cpu(hdr->data_size);
+	for (i = 0; i * ubi->leb_size < size; i++) {
+		pnum = be32_to_cpu(hdr->pnum[i]);
+		if (i > 0) {
+			err = ubi_io_read_vid_hdr(ubi, pnum, vh, 0);
+			if (err < 0)
+				return err;
+			if ((err && err != UBI_IO_BITFLIPS) ||
+			    be32_to_cpu(vh->vol_id) != UBI_CKPT_VOLUME_ID ||
+			    be32_to_cpu(vh->lnum) != i ||
+			    be64_to_cpu(vh->sqnum) != sqnum)
+				return 1;
+		}
+
+		len = min(size - i * ubi->leb_size, ubi->leb_size);
+		err = ubi_io_read_data(ubi, buf + i * ubi->leb_size, pnum, 0,
+				       len);
+		if (err && err != UBI_IO_BITFLIPS)
+			return err;
+	}
+
+	crc = crc32(UBI_CRC32_INIT, buf + UBI_CKPT_HDR_SIZE,
+		    be32_to_cpu(hdr->data_size));
+	if (crc != be32_to_cpu(hdr->data_crc))
+		return 1;
+
+	return 0;
+}
+
+/**
+ * add_ckpt_peb - add a physical eraseblock the checkpoint describes.
+ * @ubi: UBI device description object
+ * @si: scanning information
+ * @vols: the checkpoint volume records indexed by 'ckpt_vol_idx()'
+ * @rec: the record of the PEB
+ * @pnum: the PEB number
+ * @dirty: bitmap of the first PEBs which are not clean
+ * @vh: VID header buffer
+ *
+ * Returns zero in case of success, %1 if the record is not valid, and a
+ * negative error code in case of failure.
+ */
+static int add_ckpt_peb(struct ubi_device *ubi, struct ubi_scan_info *si,
+			struct ubi_ckpt_vol **vols,
+			const struct ubi_ckpt_peb *rec, int pnum,
+			const unsigned long *dirty, struct ubi_vid_hdr *vh)
+{
+	const struct ubi_ckpt_vol *vol;
+	int err, idx, ec = be32_to_cpu(rec->ec);
+
+	if (ec < 0 || ec > UBI_MAX_ERASECOUNTER)
+		return 1;
+
+	switch (rec->state) {
+	case UBI_CKPT_FREE:
+		/*
+		 * A checkpoint which was not completely written may have
+		 * started in a free PEB.
+		 */
+		if (pnum < UBI_CKPT_MAX_START && test_bit(pnum, dirty))
+			return ubi_scan_process_eb(ubi, si, pnum);
+		/* Fall through */
+	case UBI_CKPT_ERASE:
+		err = ubi_io_is_bad(ubi, pnum);
+		if (err < 0)
+			return err;
+		if (err) {
+			si->bad_peb_count += 1;
+			return 0;
+		}
+		err = ubi_scan_add_to_list(si, pnum, ec,
+				rec->state == UBI_CKPT_FREE ? &si->free :
+							      &si->erase);
+		break;
+
+	case UBI_CKPT_SELF:
+		err = ubi_scan_add_to_list(si, pnum, ec, &si->erase);
+		break;
+
+	case UBI_CKPT_USED:
+		idx = ckpt_vol_idx(be32_to_cpu(rec->vol_id));
+		if (idx < 0 || !vols[idx])
+			return 1;
+		vol = vols[idx];
+
+		memset(vh, 0, sizeof(struct ubi_vid_hdr));
+		vh->vol_type = vol->vol_type;
+		vh->compat = vol->compat;
+		vh->vol_id = rec->vol_id;
+		vh->lnum = rec->lnum;
+		vh->sqnum = rec->sqnum;
+		vh->data_size = vol->last_data_size;
+		vh->used_ebs = vol->used_ebs;
+		vh->data_pad = vol->data_pad;
+		err = ubi_scan_add_used(ubi, si, pnum, ec, vh, 0);
+		break;
+
+	case UBI_CKPT_POOL:
+	case UBI_CKPT_SCAN:
+		return ubi_scan_process_eb(ubi, si, pnum);
+
+	case UBI_CKPT_BAD:
+		si->bad_peb_count += 1;
+		return 0;
+
+	default:
+		return 1;
+	}
+
+	if (err)
+		return err;
+
+	add_ec(si, ec);
+	return 0;
+}
+
+/**
+ * ubi_ckpt_scan - attach from the checkpoint.
+ * @ubi: UBI device description object
+ * @si: empty scanning information to fill
+ *
+ * This function looks for the checkpoint and fills @si from it, scanning
+ * the PEBs the checkpoint does not know about. Returns zero in case of
+ * success, %1 if there is no usable checkpoint and the whole flash has to be
+ * scanned, and a negative error code in case of failure.
+ */
+int ubi_ckpt_scan(struct ubi_device *ubi, struct ubi_scan_info *si)
+{
+	int err, i, pnum, anchor, ckpt_pebs, vol_count, idx, scanned = 0;
+	unsigned long long sqnum = 0;
+	DECLARE_BITMAP(dirty, UBI_CKPT_MAX_START);
+	struct ubi_ec_hdr *ech;
+	struct ubi_vid_hdr *vh;
+	struct ubi_ckpt_hdr *hdr = NULL;
+	struct ubi_ckpt_vol *vrec, **vols = NULL;
+	struct ubi_ckpt_peb *recs;
+	void *buf = NULL;
+
+	ubi->ckpt_anchor = -1;
+	bitmap_zero(dirty, UBI_CKPT_MAX_START);
+
+	err = -ENOMEM;
+	ech = kzalloc(ubi->ec_hdr_alsize, GFP_KERNEL);
+	if (!ech)
+		return err;
+
+	vh = ubi_zalloc_vid_hdr(ubi, GFP_KERNEL);
+	if (!vh)
+		goto out_ech;
+
+	hdr = kmalloc(UBI_CKPT_HDR_SIZE, GFP_KERNEL);
+	if (!hdr)
+		goto out_vh;
+
+	anchor = find_anchor(ubi, vh, dirty, &sqnum);
+	if (anchor < 0) {
+		if (anchor == -1)
+			ubi_msg("no checkpoint found");
+		goto out_scan;
+	}
+
+	err = ubi_io_read_ec_hdr(ubi, anchor, ech, 0);
+	if (err < 0)
+		goto out_scan;
+	if ((err && err != UBI_IO_BITFLIPS) || ech->version != UBI_VERSION)
+		goto out_invalid;
+
+	err = ubi_io_read_data(ubi, hdr, anchor, 0, UBI_CKPT_HDR_SIZE);
+	if (err && err != UBI_IO_BITFLIPS)
+		goto out_scan;
+	if (check_hdr(ubi, hdr, anchor, sqnum))
+		goto out_invalid;
+
+	err = -ENOMEM;
+	ckpt_pebs = be32_to_cpu(hdr->ckpt_pebs);
+	buf = vmalloc(ckpt_pebs * ubi->leb_size);
+	if (!buf)
+		goto out_hdr;
+	vols = kcalloc(UBI_CKPT_MAX_VOLUMES, sizeof(*vols), GFP_KERNEL);
+	if (!vols)
+		goto out_hdr;
+
+	memcpy(buf, hdr, UBI_CKPT_HDR_SIZE);
+	err = read_ckpt(ubi, vh, buf);
+	if (err < 0)
+		goto out_scan;
+	if (err)
+		goto out_invalid;
+
+	vol_count = be32_to_cpu(hdr->vol_count);
+	vrec = buf + UBI_CKPT_HDR_SIZE;
+	recs = (struct ubi_ckpt_peb *)(vrec + vol_count);
+	for (i = 0; i < vol_count; i++, vrec++) {
+		idx = ckpt_vol_idx(be32_to_cpu(vrec->vol_id));
+		if (idx < 0 || vols[idx] ||
+		    (vrec->vol_type != UBI_VID_DYNAMIC &&
+		     vrec->vol_type != UBI_VID_STATIC))
+			goto out_invalid;
+		vols[idx] = vrec;
+	}
+
+	dbg_bld("checkpoint at PEB %d, sqnum %llu, %d PEBs", anchor, sqnum,
+		ckpt_pebs);
+
+	si->is_empty = 0;
+	if (!ubi->image_seq)
+		ubi->image_seq = be32_to_cpu(ech->image_seq);
+	if (si->max_sqnum < sqnum)
+		si->max_sqnum = sqnum;
+
+	for (pnum = 0; pnum < ubi->peb_count; pnum++) {
+		cond_resched();
+
+		if (recs[pnum].state == UBI_CKPT_POOL ||
+		    recs[pnum].state == UBI_CKPT_SCAN)
+			scanned += 1;
+		err = add_ckpt_peb(ubi, si, vols, &recs[pnum], pnum, dirty, vh);
+		if (err == -ENOMEM)
+			goto out_hdr;
+		if (err)
+			goto out_invalid;
+	}
+
+	ubi_msg("attached from the checkpoint at PEB %d, %d PEBs scanned",
+		anchor, scanned);
+	ubi->ckpt_anchor = anchor;
+	err = 0;
+	goto out_hdr;
+
+out_invalid:
+	ubi_warn("the checkpoint at PEB %d cannot be used", anchor);
+out_scan:
+	ubi_msg("scanning all PEBs");
+	err = 1;
+out_hdr:
+	kfree(vols);
+	vfree(buf);
+	kfree(hdr);
+out_vh:
+	ubi_free_vid_hdr(ubi, vh);
+out_ech:
+	kfree(ech);
+	return err;
+}
+
+/**
+ * invalidate_ckpt - make sure the checkpoint on the flash is not used.
+ * @ubi: UBI device description object
+ *
+ * This function erases the anchor of the checkpoint on the flash, if there is
+ * one. Returns zero in case of success and a negative error code in case of
+ * failure.
+ */
+static int invalidate_ckpt(struct ubi_device *ubi)
+{
+	int err;
+
+	if (ubi->ckpt_anchor == -1)
+		return 0;
+
+	dbg_msg("invalidate the checkpoint at PEB %d", ubi->ckpt_anchor);
+	if (ubi->ckpt_count)
+		/* Written by us, the WL sub-system knows it is ours */
+		err = ubi_wl_erase_ckpt_peb(ubi,
+					    ubi->lookuptbl[ubi->ckpt_anchor]);
+	else
+		/* Attached from, it is already scheduled for erasure */
+		err = ubi_io_sync_erase(ubi, ubi->ckpt_anchor, 0);
+	if (err < 0)
+		return err;
+
+	ubi->ckpt_anchor = -1;
+	return 0;
+}
+
+/**
+ * fill_ckpt - fill in the checkpoint.
+ * @ubi: UBI device description object
+ * @new: the PEBs the checkpoint is going to be written to
+ * @ckpt_pebs: how many PEBs the checkpoint occupies
+ *
+ * This function takes a consistent snapshot of the volumes and the PEBs and
+ * returns the size of the checkpoint in bytes.
+ */
+static int fill_ckpt(struct ubi_device *ubi, struct ubi_wl_entry **new,
+		     int ckpt_pebs)
+{
+	struct ubi_ckpt_hdr *hdr = ubi->ckpt_buf;
+	struct ubi_ckpt_vol *vrec = ubi->ckpt_buf + UBI_CKPT_HDR_SIZE;
+	struct ubi_ckpt_peb *recs;
+	struct ubi_volume *vol;
+	int i, idx, lnum, pnum, vol_count = 0, data_size;
+
+	bitmap_zero(ubi->ckpt_next, ubi->peb_count);
+
+	spin_lock(&ubi->volumes_lock);
+	for (idx = 0; idx < ubi->vtbl_slots + UBI_INT_VOL_COUNT; idx++)
+		if (ubi->volumes[idx])
+			vol_count += 1;
+	recs = (struct ubi_ckpt_peb *)(vrec + vol_count);
+
+	for (i = 0; i < ubi->ckpt_count; i++)
+		recs[ubi->ckpt_pnum[i]].state = UBI_CKPT_ERASE;
+	for (i = 0; i < ckpt_pebs; i++)
+		recs[new[i]->pnum].state = UBI_CKPT_SELF;
+
+	spin_lock(&ubi->wl_lock);
+	ubi_wl_ckpt_fill(ubi, recs);
+
+	for (idx = 0; idx < ubi->vtbl_slots + UBI_INT_VOL_COUNT; idx++) {
+		vol = ubi->volumes[idx];
+		if (!vol)
+			continue;
+
+		vrec->vol_id = cpu_to_be32(vol->vol_id);
+		vrec->data_pad = cpu_to_be32(vol->data_pad);
+		if (vol->vol_type == UBI_STATIC_VOLUME) {
+			vrec->vol_type = UBI_VID_STATIC;
+			vrec->used_ebs = cpu_to_be32(vol->updating ?
+						     vol->upd_ebs :
+						     vol->used_ebs);
+			vrec->last_data_size = cpu_to_be32(vol->last_eb_bytes);
+		} else
+			vrec->vol_type = UBI_VID_DYNAMIC;
+		if (vol->vol_id == UBI_LAYOUT_VOLUME_ID)
+			vrec->compat = UBI_LAYOUT_VOLUME_COMPAT;
+		vrec += 1;
+
+		for (lnum = 0; lnum < vol->reserved_pebs; lnum++) {
+			pnum = vol->eba_tbl[lnum];
+			/* The PEB may be on its way to or from the mapping */
+			if (pnum < 0 || recs[pnum].state != UBI_CKPT_SCAN)
+				continue;
+
+			recs[pnum].state = UBI_CKPT_USED;
+			recs[pnum].vol_id = cpu_to_be32(vol->vol_id);
+			recs[pnum].lnum = cpu_to_be32(lnum);
+			recs[pnum].sqnum = cpu_to_be64(ubi->ckpt_sqnum[pnum]);
+			__set_bit(pnum, ubi->ckpt_next);
+			__set_bit(pnum, ubi->ckpt_pinned);
+		}
+	}
+	spin_unlock(&ubi->wl_lock);
+	spin_unlock(&ubi->volumes_lock);
+
+	data_size = vol_count * UBI_CKPT_VOL_SIZE +
+		    ubi->peb_count * UBI_CKPT_PEB_SIZE;
+
+	hdr->magic = cpu_to_be32(UBI_CKPT_HDR_MAGIC);
+	hdr->version = UBI_CKPT_VERSION;
+	hdr->peb_count = cpu_to_be32(ubi->peb_count);
+	hdr->vol_count = cpu_to_be32(vol_count);
+	hdr->ckpt_pebs = cpu_to_be32(ckpt_pebs);
+	hdr->data_size = cpu_to_be32(data_size);
+	hdr->data_crc = cpu_to_be32(crc32(UBI_CRC32_INIT,
+					  ubi->ckpt_buf + UBI_CKPT_HDR_SIZE,
+					  data_size));
+	for (i = 0; i < ckpt_pebs; i++)
+		hdr->pnum[i] = cpu_to_be32(new[i]->pnum);
+
+	return UBI_CKPT_HDR_SIZE + data_size;
+}
+
+/**
+ * write_ckpt - write a new checkpoint.
+ * @ubi: UBI device description object
+ *
+ * This function has to be called with @ubi->ckpt_mutex held. It returns zero
+ * in case of success and a negative error code in case of failure.
+ */
+static int write_ckpt(struct ubi_device *ubi)
+{
+	struct ubi_wl_entry *new[UBI_CKPT_MAX_PEBS], *old_anchor = NULL;
+	struct ubi_ckpt_hdr *hdr = ubi->ckpt_buf;
+	struct ubi_vid_hdr *vid_hdr;
+	unsigned long long sqnum;
+	int err, i, n, len, size, reused = 0;
+	int ckpt_pebs = DIV_ROUND_UP(ubi->ckpt_size, ubi->leb_size);
+
+	vid_hdr = ubi_zalloc_vid_hdr(ubi, GFP_NOFS);
+	if (!vid_hdr)
+		return -ENOMEM;
+
+	err = invalidate_ckpt(ubi);
+	if (err)
+		goto out_vid_hdr;
+	if (ubi->ckpt_count)
+		old_anchor = ubi->lookuptbl[ubi->ckpt_pnum[0]];
+
+	err = ubi_wl_ckpt_produce(ubi, ckpt_pebs);
+	if (err)
+		goto out_vid_hdr;
+
+	new[0] = ubi_wl_get_ckpt_peb(ubi, 1);
+	if (!new[0] && !old_anchor) {
+		/*
+		 * All of the first PEBs are used, e.g. on a freshly flashed
+		 * image. Move the data out of one of them.
+		 */
+		err = ubi_wl_ckpt_anchor(ubi);
+		if (err)
+			goto out_vid_hdr;
+		new[0] = ubi_wl_get_ckpt_peb(ubi, 1);
+	}
+	if (!new[0]) {
+		if (!old_anchor) {
+			dbg_msg("no free PEB for the checkpoint anchor");
+			err = -ENOSPC;
+			goto out_vid_hdr;
+		}
+		/* The previous anchor is just as good, it has been erased */
+		new[0] = old_anchor;
+		reused = 1;
+	}
+	for (n = 1; n < ckpt_pebs; n++) {
+		new[n] = ubi_wl_get_ckpt_peb(ubi, 0);
+		if (!new[n])
+			break;
+	}
+	if (n < ckpt_pebs) {
+		ubi_err("no free PEBs for the checkpoint");
+		for (i = reused; i < n; i++)
+			ubi_wl_put_ckpt_peb(ubi, new[i], 0);
+		err = -ENOSPC;
+		goto out_vid_hdr;
+	}
+
+	memset(ubi->ckpt_buf, 0, ALIGN(ubi->ckpt_size, ubi->min_io_size));
+	sqnum = ubi_next_sqnum(ubi);
+	hdr->sqnum = cpu_to_be64(sqnum);
+	size = fill_ckpt(ubi, new, ckpt_pebs);
+	hdr->hdr_crc = cpu_to_be32(crc32(UBI_CRC32_INIT, hdr,
+					 UBI_CKPT_HDR_SIZE_CRC));
+
+	vid_hdr->vol_type = UBI_CKPT_VOLUME_TYPE;
+	vid_hdr->compat = UBI_CKPT_VOLUME_COMPAT;
+	vid_hdr->vol_id = cpu_to_be32(UBI_CKPT_VOLUME_ID);
+	vid_hdr->sqnum = cpu_to_be64(sqnum);
+
+	/* The anchor goes first, the checkpoint is not valid without it */
+	for (i = 0; i < ckpt_pebs; i++) {
+		vid_hdr->lnum = cpu_to_be32(i);
+		err = ubi_io_write_vid_hdr(ubi, new[i]->pnum, vid_hdr);
+		if (err)
+			break;
+
+		len = min(size - i * ubi->leb_size, ubi->leb_size);
+		err = ubi_io_write_data(ubi, ubi->ckpt_buf + i * ubi->leb_size,
+					new[i]->pnum, 0,
+					ALIGN(len, ubi->min_io_size));
+		if (err)
+			break;
+	}
+
+	if (err) {
+		ubi_err("cannot write the checkpoint to PEB %d, error %d",
+			new[i]->pnum, err);
+		/* Do not let a part of it be found */
+		if (ubi_wl_erase_ckpt_peb(ubi, new[0]))
+			ubi_ro_mode(ubi);
+		for (n = reused; n < ckpt_pebs; n++)
+			ubi_wl_put_ckpt_peb(ubi, new[n], n == i);
+		goto out_vid_hdr;
+	}
+
+	ubi_wl_ckpt_done(ubi, ubi->ckpt_next);
+	for (i = reused; i < ubi->ckpt_count; i++)
+		ubi_wl_put_ckpt_peb(ubi, ubi->lookuptbl[ubi->ckpt_pnum[i]], 0);
+	for (i = 0; i < ckpt_pebs; i++)
+		ubi->ckpt_pnum[i] = new[i]->pnum;
+	ubi->ckpt_count = ckpt_pebs;
+	ubi->ckpt_anchor = new[0]->pnum;
+	dbg_msg("checkpoint written to PEB %d, sqnum %llu", ubi->ckpt_anchor,
+		sqnum);
+
+out_vid_hdr:
+	ubi_free_vid_hdr(ubi, vid_hdr);
+	return err;
+}
+
+/**
+ * disable_ckpt - stop using the checkpoint.
+ * @ubi: UBI device description object
+ *
+ * This function has to be called with @ubi->ckpt_mutex held. It is used when
+ * a checkpoint cannot be written: all free PEBs may be used again, and the
+ * next checkpoint is only tried after a while.
+ */
+static void disable_ckpt(struct ubi_device *ubi)
+{
+	int i;
+
+	if (!ubi->ro_mode && invalidate_ckpt(ubi))
+		ubi_ro_mode(ubi);
+
+	ubi_wl_ckpt_done(ubi, NULL);
+	for (i = 0; i < ubi->ckpt_count; i++)
+		ubi_wl_put_ckpt_peb(ubi, ubi->lookuptbl[ubi->ckpt_pnum[i]], 0);
+	ubi->ckpt_count = 0;
+}
+
+/**
+ * ubi_ckpt_init - initialize the checkpoint sub-system.
+ * @ubi: UBI device description object
+ * @si: scanning information
+ *
+ * This function is called when the WL and EBA sub-systems have been
+ * initialized, and writes the first checkpoint. UBI works without the
+ * checkpoint if it cannot be used, so this function always returns zero.
+ */
+int ubi_ckpt_init(struct ubi_device *ubi, struct ubi_scan_info *si)
+{
+	struct ubi_scan_volume *sv;
+	struct ubi_scan_leb *seb;
+	struct rb_node *rb1, *rb2;
+	int ckpt_pebs, bitmap_size, err;
+
+	mutex_init(&ubi->ckpt_mutex);
+	ubi->ckpt_size = UBI_CKPT_HDR_SIZE +
+			 (ubi->vtbl_slots + UBI_INT_VOL_COUNT) *
+			 UBI_CKPT_VOL_SIZE +
+			 ubi->peb_count * UBI_CKPT_PEB_SIZE;
+	ckpt_pebs = DIV_ROUND_UP(ubi->ckpt_size, ubi->leb_size);
+
+	if (ckpt_pebs > UBI_CKPT_MAX_PEBS) {
+		ubi_msg("the flash is too large for the checkpoint");
+		goto out_disable;
+	}
+	if (si->alien_peb_count) {
+		ubi_msg("unknown internal volumes, not using the checkpoint");
+		goto out_disable;
+	}
+
+	bitmap_size = BITS_TO_LONGS(ubi->peb_count) * sizeof(unsigned long);
+	ubi->ckpt_pinned = kzalloc(bitmap_size, GFP_KERNEL);
+	ubi->ckpt_next = kzalloc(bitmap_size, GFP_KERNEL);
+	ubi->ckpt_sqnum = vmalloc(ubi->peb_count * sizeof(unsigned long long));
+	ubi->ckpt_buf = vmalloc(ckpt_pebs * ubi->leb_size);
+	if (!ubi->ckpt_pinned || !ubi->ckpt_next || !ubi->ckpt_sqnum ||
+	    !ubi->ckpt_buf) {
+		ubi_warn("cannot allocate the checkpoint buffers");
+		ubi_ckpt_close(ubi);
+		goto out_disable;
+	}
+
+	/* The old and the new checkpoint exist at the same time */
+	spin_lock(&ubi->volumes_lock);
+	if (ubi->avail_pebs < 2 * ckpt_pebs) {
+		spin_unlock(&ubi->volumes_lock);
+		ubi_msg("no PEBs for the checkpoint, need %d", 2 * ckpt_pebs);
+		ubi_ckpt_close(ubi);
+		goto out_disable;
+	}
+	ubi->avail_pebs -= 2 * ckpt_pebs;
+	ubi->rsvd_pebs += 2 * ckpt_pebs;
+	spin_unlock(&ubi->volumes_lock);
+
+	memset(ubi->ckpt_sqnum, 0, ubi->peb_count * sizeof(unsigned long long));
+	ubi_rb_for_each_entry(rb1, sv, &si->volumes, rb)
+		ubi_rb_for_each_entry(rb2, seb, &sv->root, u.rb)
+			ubi->ckpt_sqnum[seb->pnum] = seb->sqnum;
+
+	ubi->ckpt_pool_size = ubi->good_peb_count * POOL_PERCENT / 100;
+	ubi->ckpt_pool_size = clamp(ubi->ckpt_pool_size, POOL_MIN, POOL_MAX);
+	ubi->ckpt_countdown = ubi->ckpt_pool_size;
+	ubi->ckpt_enabled = 1;
+	ubi_msg("checkpoint: %d PEBs, pool of %d PEBs", ckpt_pebs,
+		ubi->ckpt_pool_size);
+
+	if (ubi->ro_mode)
+		return 0;
+
+	mutex_lock(&ubi->ckpt_mutex);
+	err = write_ckpt(ubi);
+	if (err) {
+		ubi_warn("cannot write the checkpoint, error %d", err);
+		disable_ckpt(ubi);
+	}
+	mutex_unlock(&ubi->ckpt_mutex);
+	return 0;
+
+out_disable:
+	if (!ubi->ro_mode && invalidate_ckpt(ubi))
+		ubi_ro_mode(ubi);
+	return 0;
+}
+
+/**
+ * ubi_ckpt_update - write the checkpoint if it is due.
+ * @ubi: UBI device description object
+ *
+ * This function is called by the WL sub-system when the pool is used up, and
+ * now and then while the checkpoint is not used. If the checkpoint cannot be
+ * written or does not leave any PEBs in the pool, it stops being used for a
+ * while.
+ */
+void ubi_ckpt_update(struct ubi_device *ubi)
+{
+	int err, due, empty;
+
+	mutex_lock(&ubi->ckpt_mutex);
+	spin_lock(&ubi->wl_lock);
+	/* Somebody may have done it meanwhile */
+	if (ubi->ckpt_active)
+		due = !ubi->free.rb_node;
+	else
+		due = ubi->ckpt_enabled && ubi->ckpt_countdown <= 0;
+	spin_unlock(&ubi->wl_lock);
+
+	if (!due)
+		goto out_unlock;
+
+	err = ubi->ro_mode ? -EROFS : write_ckpt(ubi);
+	if (!err) {
+		spin_lock(&ubi->wl_lock);
+		empty = !ubi->free.rb_node;
+		spin_unlock(&ubi->wl_lock);
+		if (empty)
+			err = -ENOSPC;
+	}
+	if (err) {
+		dbg_msg("cannot use the checkpoint, error %d", err);
+		disable_ckpt(ubi);
+	}
+
+out_unlock:
+	mutex_unlock(&ubi->ckpt_mutex);
+}
+
+/**
+ * ubi_ckpt_write - write the checkpoint now.
+ * @ubi: UBI device description object
+ * @verbose: print where the checkpoint was written
+ *
+ * This function is called when the UBI device is detached or the system is
+ * rebooted, so that the next attach does not have to scan anything but the
+ * pool, and whenever the PEBs the checkpoint keeps aside have to be erased.
+ */
+void ubi_ckpt_write(struct ubi_device *ubi, int verbose)
+{
+	int err;
+
+	mutex_lock(&ubi->ckpt_mutex);
+	if (ubi->ckpt_enabled && !ubi->ro_mode) {
+		err = write_ckpt(ubi);
+		if (err) {
+			ubi_warn("cannot write the checkpoint, error %d", err);
+			disable_ckpt(ubi);
+		} else if (verbose)
+			ubi_msg("checkpoint written, anchor at PEB %d",
+				ubi->ckpt_anchor);
+		else
+			dbg_msg("checkpoint written, anchor at PEB %d",
+				ubi->ckpt_anchor);
+	}
+	mutex_unlock(&ubi->ckpt_mutex);
+}
+
+/**
+ * ubi_ckpt_close - close the checkpoint sub-system.
+ * @ubi: UBI device description object
+ *
+ * The WL sub-system has to be closed already.
+ */
+void ubi_ckpt_close(struct ubi_device *ubi)
+{
+	ubi->ckpt_enabled = 0;
+	kfree(ubi->ckpt_pinned);
+	ubi->ckpt_pinned = NULL;
+	kfree(ubi->ckpt_next);
+	ubi->ckpt_next = NULL;
+	vfree(ubi->ckpt_sqnum);
+	ubi->ckpt_sqnum = NULL;
+	vfree(ubi->ckpt_buf);
+	ubi->ckpt_buf = NULL;
+}
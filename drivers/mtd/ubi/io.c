@@ -1097,6 +1097,11 @@ int ubi_io_write_vid_hdr(struct ubi_device *ubi, int pnum,
 	p = (char *)vid_hdr - ubi->vid_hdr_shift;
 	err = ubi_io_write(ubi, p, pnum, ubi->vid_hdr_aloffset,
 			   ubi->vid_hdr_alsize);
+#ifdef CONFIG_MTD_UBI_CHECKPOINT
+	/* The checkpoint records it for mapped LEBs */
+	if (!err && ubi->ckpt_sqnum)
+		ubi->ckpt_sqnum[pnum] = be64_to_cpu(vid_hdr->sqnum);
+#endif
 	return err;
 }
 
@@ -312,6 +312,139 @@ struct ubi_vid_hdr {
 #define UBI_LAYOUT_VOLUME_NAME   "layout volume"
 #define UBI_LAYOUT_VOLUME_COMPAT UBI_COMPAT_REJECT
 
+/*
+ * The checkpoint volume contains a snapshot of the state of all physical
+ * eraseblocks which allows attaching without scanning the whole flash. UBI
+ * binaries which do not know it just delete it.
+ */
+#define UBI_CKPT_VOLUME_ID     (UBI_INTERNAL_VOL_START + 1)
+#define UBI_CKPT_VOLUME_TYPE   UBI_VID_DYNAMIC
+#define UBI_CKPT_VOLUME_COMPAT UBI_COMPAT_DELETE
+
+/* The first PEB of a checkpoint is always one of the first 64 PEBs */
+#define UBI_CKPT_MAX_START 64
+
+/* The maximum number of PEBs a checkpoint may occupy */
+#define UBI_CKPT_MAX_PEBS 32
+
+/* The checkpoint header magic number ("UBIC") */
+#define UBI_CKPT_HDR_MAGIC 0x55424943
+
+/* The checkpoint format version */
+#define UBI_CKPT_VERSION 1
+
+/* The maximum number of volume records in a checkpoint */
+#define UBI_CKPT_MAX_VOLUMES (UBI_MAX_VOLUMES + UBI_INT_VOL_COUNT)
+
+/*
+ * States of physical eraseblocks in the checkpoint.
+ *
+ * UBI_CKPT_FREE: free, it is not written until the next checkpoint
+ * UBI_CKPT_POOL: free, but may be written before the next checkpoint
+ * UBI_CKPT_USED: contains the data of a mapped logical eraseblock
+ * UBI_CKPT_SCAN: used but not mapped, has to be scanned when attaching
+ * UBI_CKPT_ERASE: has to be erased
+ * UBI_CKPT_BAD: bad
+ * UBI_CKPT_SELF: contains the checkpoint itself
+ */
+enum {
+	UBI_CKPT_FREE = 1,
+	UBI_CKPT_POOL,
+	UBI_CKPT_USED,
+	UBI_CKPT_SCAN,
+	UBI_CKPT_ERASE,
+	UBI_CKPT_BAD,
+	UBI_CKPT_SELF
+};
+
+/* Sizes of checkpoint structures */
+#define UBI_CKPT_HDR_SIZE  sizeof(struct ubi_ckpt_hdr)
+#define UBI_CKPT_VOL_SIZE  sizeof(struct ubi_ckpt_vol)
+#define UBI_CKPT_PEB_SIZE  sizeof(struct ubi_ckpt_peb)
+
+/* Size of the checkpoint header without the ending CRC */
+#define UBI_CKPT_HDR_SIZE_CRC (UBI_CKPT_HDR_SIZE - sizeof(__be32))
+
+/**
+ * struct ubi_ckpt_hdr - checkpoint header.
+ * @magic: checkpoint header magic number (%UBI_CKPT_HDR_MAGIC)
+ * @version: checkpoint format version (%UBI_CKPT_VERSION)
+ * @padding1: reserved for future, zeroes
+ * @peb_count: count of physical eraseblocks the checkpoint describes
+ * @vol_count: count of volume records
+ * @ckpt_pebs: count of physical eraseblocks the checkpoint occupies
+ * @data_size: size of the volume and physical eraseblock records
+ * @data_crc: CRC32 checksum of the volume and physical eraseblock records
+ * @sqnum: sequence number the checkpoint was written with
+ * @pnum: physical eraseblocks the checkpoint occupies, in order
+ * @padding2: reserved for future, zeroes
+ * @hdr_crc: checkpoint header CRC checksum
+ *
+ * The checkpoint is stored in the logical eraseblocks of the checkpoint
+ * volume, starting with logical eraseblock 0 which begins with this header.
+ * The header is followed by @vol_count &struct ubi_ckpt_vol records and then
+ * by @peb_count &struct ubi_ckpt_peb records, one per physical eraseblock.
+ * All the physical eraseblocks of one checkpoint carry VID headers with the
+ * same sequence number, @sqnum, and the one with the highest sequence number
+ * among the first %UBI_CKPT_MAX_START physical eraseblocks is the current
+ * checkpoint.
+ */
+struct ubi_ckpt_hdr {
+	__be32  magic;
+	__u8    version;
+	__u8    padding1[3];
+	__be32  peb_count;
+	__be32  vol_count;
+	__be32  ckpt_pebs;
+	__be32  data_size;
+	__be32  data_crc;
+	__be64  sqnum;
+	__be32  pnum[UBI_CKPT_MAX_PEBS];
+	__u8    padding2[24];
+	__be32  hdr_crc;
+} __attribute__ ((packed));
+
+/**
+ * struct ubi_ckpt_vol - volume record of the checkpoint.
+ * @vol_id: volume ID
+ * @used_ebs: used logical eraseblocks count (static volumes only)
+ * @data_pad: how many bytes at the end of logical eraseblocks are not used
+ * @last_data_size: bytes in the last logical eraseblock (static volumes only)
+ * @vol_type: volume type (%UBI_VID_DYNAMIC or %UBI_VID_STATIC)
+ * @compat: compatibility of this volume
+ * @padding: reserved for future, zeroes
+ *
+ * These are the fields the VID headers of the volume would contain, they are
+ * used for the logical eraseblocks the checkpoint lists as used.
+ */
+struct ubi_ckpt_vol {
+	__be32  vol_id;
+	__be32  used_ebs;
+	__be32  data_pad;
+	__be32  last_data_size;
+	__u8    vol_type;
+	__u8    compat;
+	__u8    padding[2];
+} __attribute__ ((packed));
+
+/**
+ * struct ubi_ckpt_peb - physical eraseblock record of the checkpoint.
+ * @state: state of the physical eraseblock (%UBI_CKPT_FREE, etc)
+ * @padding: reserved for future, zeroes
+ * @ec: erase counter
+ * @vol_id: volume ID (%UBI_CKPT_USED only)
+ * @lnum: logical eraseblock number (%UBI_CKPT_USED only)
+ * @sqnum: sequence number of the VID header (%UBI_CKPT_USED only)
+ */
+struct ubi_ckpt_peb {
+	__u8    state;
+	__u8    padding[3];
+	__be32  ec;
+	__be32  vol_id;
+	__be32  lnum;
+	__be64  sqnum;
+} __attribute__ ((packed));
+
 /* The maximum number of volumes per one UBI device */
 #define UBI_MAX_VOLUMES 128
 
@@ -380,6 +380,34 @@ struct ubi_wl_entry;
  * @peb_buf2: another buffer of PEB size used for different purposes
  * @buf_mutex: protects @peb_buf1 and @peb_buf2
  * @ckvol_mutex: serializes static volume checking when opening
+ *
+ * @ckpt_spare: RB-tree of free physical eraseblocks which are not in the pool
+ *              of the checkpoint and cannot be used until the next one
+ * @ckpt_pool_next: free physical eraseblocks which join the pool once the
+ *                  checkpoint being written is on the flash
+ * @ckpt_stale: physical eraseblocks which were put, but cannot be erased
+ *              before the next checkpoint because the current one lists them
+ *              as used
+ * @ckpt_pinned: bitmap of physical eraseblocks the checkpoint lists as used
+ * @ckpt_active: if physical eraseblocks are only taken from the pool
+ * @ckpt_enabled: if checkpoints are written for this UBI device
+ * @ckpt_pool_size: how many free physical eraseblocks the pool gets
+ * @ckpt_countdown: allocations left before writing a checkpoint is tried
+ *                  again when it is not active
+ * @ckpt_size: checkpoint size in bytes
+ * @ckpt_count: count of physical eraseblocks of the current checkpoint
+ * @ckpt_pnum: physical eraseblocks of the current checkpoint
+ * @ckpt_anchor: first physical eraseblock of the checkpoint on the flash, or
+ *               %-1 if there is none
+ * @ckpt_sqnum: sequence numbers of the VID headers of all physical eraseblocks
+ * @ckpt_next: bitmap of physical eraseblocks the next checkpoint lists as used
+ * @ckpt_buf: checkpoint buffer
+ * @ckpt_mutex: serializes checkpoint writing, protects @ckpt_count,
+ *              @ckpt_pnum, @ckpt_anchor, @ckpt_next and @ckpt_buf
+ *
+ * @wl_lock also protects the checkpoint fields the WL sub-system deals with:
+ * @ckpt_spare, @ckpt_pool_next, @ckpt_stale, @ckpt_pinned, @ckpt_active and
+ * @ckpt_countdown.
  * @dbg_peb_buf: buffer of PEB size used for debugging
  * @dbg_buf_mutex: protects @dbg_peb_buf
  */
@@ -463,6 +491,25 @@ struct ubi_device {
 	void *peb_buf2;
 	struct mutex buf_mutex;
 	struct mutex ckvol_mutex;
+
+#ifdef CONFIG_MTD_UBI_CHECKPOINT
+	struct rb_root ckpt_spare;
+	struct list_head ckpt_pool_next;
+	struct list_head ckpt_stale;
+	unsigned long *ckpt_pinned;
+	int ckpt_active;
+	int ckpt_enabled;
+	int ckpt_pool_size;
+	int ckpt_countdown;
+	int ckpt_size;
+	int ckpt_count;
+	int ckpt_pnum[UBI_CKPT_MAX_PEBS];
+	int ckpt_anchor;
+	unsigned long long *ckpt_sqnum;
+	unsigned long *ckpt_next;
+	void *ckpt_buf;
+	struct mutex ckpt_mutex;
+#endif
 #ifdef CONFIG_MTD_UBI_DEBUG_PARANOID
 	void *dbg_peb_buf;
 	struct mutex dbg_buf_mutex;
@@ -523,6 +570,7 @@ int ubi_eba_atomic_leb_change(struct ubi_device *ubi, struct ubi_volume *vol,
 int ubi_eba_copy_leb(struct ubi_device *ubi, int from, int to,
 		     struct ubi_vid_hdr *vid_hdr);
 int ubi_eba_init_scan(struct ubi_device *ubi, struct ubi_scan_info *si);
+unsigned long long ubi_next_sqnum(struct ubi_device *ubi);
 
 /* wl.c */
 int ubi_wl_get_peb(struct ubi_device *ubi, int dtype);
@@ -532,6 +580,16 @@ int ubi_wl_scrub_peb(struct ubi_device *ubi, int pnum);
 int ubi_wl_init_scan(struct ubi_device *ubi, struct ubi_scan_info *si);
 void ubi_wl_close(struct ubi_device *ubi);
 int ubi_thread(void *u);
+#ifdef CONFIG_MTD_UBI_CHECKPOINT
+struct ubi_wl_entry *ubi_wl_get_ckpt_peb(struct ubi_device *ubi, int anchor);
+int ubi_wl_erase_ckpt_peb(struct ubi_device *ubi, struct ubi_wl_entry *e);
+void ubi_wl_put_ckpt_peb(struct ubi_device *ubi, struct ubi_wl_entry *e,
+			 int torture);
+int ubi_wl_ckpt_produce(struct ubi_device *ubi, int count);
+void ubi_wl_ckpt_fill(struct ubi_device *ubi, struct ubi_ckpt_peb *recs);
+void ubi_wl_ckpt_done(struct ubi_device *ubi, const unsigned long *pinned);
+int ubi_wl_ckpt_anchor(struct ubi_device *ubi);
+#endif
 
 /* io.c */
 int ubi_io_read(const struct ubi_device *ubi, void *buf, int pnum, int offset,
@@ -563,6 +621,23 @@ int ubi_notify_all(struct ubi_device *ubi, int ntype,
 		   struct notifier_block *nb);
 int ubi_enumerate_volumes(struct notifier_block *nb);
 
+/* ckpt.c */
+#ifdef CONFIG_MTD_UBI_CHECKPOINT
+int ubi_ckpt_scan(struct ubi_device *ubi, struct ubi_scan_info *si);
+int ubi_ckpt_init(struct ubi_device *ubi, struct ubi_scan_info *si);
+void ubi_ckpt_update(struct ubi_device *ubi);
+void ubi_ckpt_write(struct ubi_device *ubi, int verbose);
+void ubi_ckpt_close(struct ubi_device *ubi);
+#else
+static inline int ubi_ckpt_init(struct ubi_device *ubi,
+				struct ubi_scan_info *si)
+{
+	return 0;
+}
+static inline void ubi_ckpt_write(struct ubi_device *ubi, int verbose) {}
+static inline void ubi_ckpt_close(struct ubi_device *ubi) {}
+#endif
+
 /* kapi.c */
 void ubi_do_get_device_info(struct ubi_device *ubi, struct ubi_device_info *di);
 void ubi_do_get_volume_info(struct ubi_device *ubi, struct ubi_volume *vol,
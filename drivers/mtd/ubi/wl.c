@@ -159,6 +159,8 @@ struct ubi_work {
 	/* The below fields are only relevant to erasure works */
 	struct ubi_wl_entry *e;
 	int torture;
+	/* Only relevant to wear-leveling works */
+	int anchor;
 };
 
 #ifdef CONFIG_MTD_UBI_DEBUG_PARANOID
@@ -388,6 +390,9 @@ int ubi_wl_get_peb(struct ubi_device *ubi, int dtype)
 {
 	int err, medium_ec;
 	struct ubi_wl_entry *e, *first, *last;
+#ifdef CONFIG_MTD_UBI_CHECKPOINT
+	int update = 0;
+#endif
 
 	ubi_assert(dtype == UBI_LONGTERM || dtype == UBI_SHORTTERM ||
 		   dtype == UBI_UNKNOWN);
@@ -395,6 +400,17 @@ int ubi_wl_get_peb(struct ubi_device *ubi, int dtype)
 retry:
 	spin_lock(&ubi->wl_lock);
 	if (!ubi->free.rb_node) {
+#ifdef CONFIG_MTD_UBI_CHECKPOINT
+		if (ubi->ckpt_active) {
+			/*
+			 * The pool is used up. Writing a checkpoint refills
+			 * it, or stops using the checkpoint if it cannot.
+			 */
+			spin_unlock(&ubi->wl_lock);
+			ubi_ckpt_update(ubi);
+			goto retry;
+		}
+#endif
 		if (ubi->works_count == 0) {
 			ubi_assert(list_empty(&ubi->works));
 			ubi_err("no free eraseblocks");
@@ -458,6 +474,12 @@ retry:
 	rb_erase(&e->u.rb, &ubi->free);
 	dbg_wl("PEB %d EC %d", e->pnum, e->ec);
 	prot_queue_add(ubi, e);
+#ifdef CONFIG_MTD_UBI_CHECKPOINT
+	/* Try to get back to using checkpoints now and then */
+	if (ubi->ckpt_enabled && !ubi->ckpt_active &&
+	    --ubi->ckpt_countdown <= 0)
+		update = 1;
+#endif
 	spin_unlock(&ubi->wl_lock);
 
 	err = ubi_dbg_check_all_ff(ubi, e->pnum, ubi->vid_hdr_aloffset,
@@ -467,6 +489,10 @@ retry:
 		return err > 0 ? -EINVAL : err;
 	}
 
+#ifdef CONFIG_MTD_UBI_CHECKPOINT
+	if (update)
+		ubi_ckpt_update(ubi);
+#endif
 	return e->pnum;
 }
 
@@ -638,6 +664,22 @@ static int schedule_erase(struct ubi_device *ubi, struct ubi_wl_entry *e,
 	dbg_wl("schedule erasure of PEB %d, EC %d, torture %d",
 	       e->pnum, e->ec, torture);
 
+#ifdef CONFIG_MTD_UBI_CHECKPOINT
+	/*
+	 * The checkpoint lists this PEB as used, and attaching from it would
+	 * find the PEB erased or even re-used. Keep it until the next
+	 * checkpoint, which lists it for erasure.
+	 */
+	spin_lock(&ubi->wl_lock);
+	if (ubi->ckpt_pinned && test_bit(e->pnum, ubi->ckpt_pinned)) {
+		dbg_wl("PEB %d is in the checkpoint, erase it later", e->pnum);
+		list_add_tail(&e->u.list, &ubi->ckpt_stale);
+		spin_unlock(&ubi->wl_lock);
+		return 0;
+	}
+	spin_unlock(&ubi->wl_lock);
+#endif
+
 	wl_wrk = kmalloc(sizeof(struct ubi_work), GFP_NOFS);
 	if (!wl_wrk)
 		return -ENOMEM;
@@ -650,6 +692,40 @@ static int schedule_erase(struct ubi_device *ubi, struct ubi_wl_entry *e,
 	return 0;
 }
 
+/**
+ * find_anchor_move - find a PEB to free for the checkpoint anchor.
+ * @ubi: UBI device description object
+ * @to: the free physical eraseblock to move the data to is returned here
+ *
+ * This function returns the least worn out used PEB among the first
+ * %UBI_CKPT_MAX_START PEBs, and a free PEB past them in @to, or %NULL if
+ * there are no such PEBs. It has to be called with @ubi->wl_lock held.
+ */
+static struct ubi_wl_entry *find_anchor_move(struct ubi_device *ubi,
+					     struct ubi_wl_entry **to)
+{
+	struct ubi_wl_entry *e = NULL, *p;
+	struct rb_node *rb;
+	int pnum;
+
+	*to = NULL;
+	ubi_rb_for_each_entry(rb, p, &ubi->free, u.rb)
+		if (p->pnum >= UBI_CKPT_MAX_START) {
+			*to = p;
+			break;
+		}
+	if (!*to)
+		return NULL;
+
+	for (pnum = 0; pnum < UBI_CKPT_MAX_START && pnum < ubi->peb_count;
+	     pnum++) {
+		p = ubi->lookuptbl[pnum];
+		if (p && (!e || p->ec < e->ec) && in_wl_tree(p, &ubi->used))
+			e = p;
+	}
+	return e;
+}
+
 /**
  * wear_leveling_worker - wear-leveling worker function.
  * @ubi: UBI device description object
@@ -657,14 +733,15 @@ static int schedule_erase(struct ubi_device *ubi, struct ubi_wl_entry *e,
  * @cancel: non-zero if the worker has to free memory and exit
  *
  * This function copies a more worn out physical eraseblock to a less worn out
- * one. Returns zero in case of success and a negative error code in case of
- * failure.
+ * one, or for an anchor work, one of the PEBs the checkpoint anchor has to be
+ * in to a PEB past them. Returns zero in case of success and a negative error
+ * code in case of failure.
  */
 static int wear_leveling_worker(struct ubi_device *ubi, struct ubi_work *wrk,
 				int cancel)
 {
 	int err, scrubbing = 0, torture = 0, protect = 0, erroneous = 0;
-	int vol_id = -1, uninitialized_var(lnum);
+	int vol_id = -1, uninitialized_var(lnum), anchor = wrk->anchor;
 	struct ubi_wl_entry *e1, *e2;
 	struct ubi_vid_hdr *vid_hdr;
 
@@ -698,7 +775,17 @@ static int wear_leveling_worker(struct ubi_device *ubi, struct ubi_work *wrk,
 		goto out_cancel;
 	}
 
-	if (!ubi->scrub.rb_node) {
+	if (anchor) {
+		e1 = find_anchor_move(ubi, &e2);
+		if (!e1) {
+			dbg_wl("cancel anchor move, no PEB to move");
+			goto out_cancel;
+		}
+		paranoid_check_in_wl_tree(e1, &ubi->used);
+		rb_erase(&e1->u.rb, &ubi->used);
+		dbg_wl("move PEB %d EC %d to PEB %d EC %d for the anchor",
+		       e1->pnum, e1->ec, e2->pnum, e2->ec);
+	} else if (!ubi->scrub.rb_node) {
 		/*
 		 * Now pick the least worn-out used physical eraseblock and a
 		 * highly worn-out free physical eraseblock. If the erase
@@ -977,6 +1064,7 @@ static int ensure_wear_leveling(struct ubi_device *ubi)
 	}
 
 	wrk->func = &wear_leveling_worker;
+	wrk->anchor = 0;
 	schedule_ubi_work(ubi, wrk);
 	return err;
 
@@ -1020,7 +1108,16 @@ static int erase_worker(struct ubi_device *ubi, struct ubi_work *wl_wrk,
 		kfree(wl_wrk);
 
 		spin_lock(&ubi->wl_lock);
-		wl_tree_add(e, &ubi->free);
+#ifdef CONFIG_MTD_UBI_CHECKPOINT
+		/*
+		 * Only the pool may be written before the next checkpoint,
+		 * the PEB joins it then.
+		 */
+		if (ubi->ckpt_active)
+			wl_tree_add(e, &ubi->ckpt_spare);
+		else
+#endif
+			wl_tree_add(e, &ubi->free);
 		spin_unlock(&ubi->wl_lock);
 
 		/*
@@ -1265,6 +1362,20 @@ retry:
 int ubi_wl_flush(struct ubi_device *ubi)
 {
 	int err;
+#ifdef CONFIG_MTD_UBI_CHECKPOINT
+	int stale;
+
+	/*
+	 * PEBs the checkpoint lists as used are only erased once the next
+	 * checkpoint is written. Write it now, the callers expect the PEBs
+	 * put so far to be erased when this function returns.
+	 */
+	spin_lock(&ubi->wl_lock);
+	stale = !list_empty(&ubi->ckpt_stale);
+	spin_unlock(&ubi->wl_lock);
+	if (stale)
+		ubi_ckpt_write(ubi, 0);
+#endif
 
 	/*
 	 * Erase while the pending works queue is not empty, but not more than
@@ -1425,6 +1536,11 @@ int ubi_wl_init_scan(struct ubi_device *ubi, struct ubi_scan_info *si)
 	init_rwsem(&ubi->work_sem);
 	ubi->max_ec = si->max_ec;
 	INIT_LIST_HEAD(&ubi->works);
+#ifdef CONFIG_MTD_UBI_CHECKPOINT
+	ubi->ckpt_spare = RB_ROOT;
+	INIT_LIST_HEAD(&ubi->ckpt_pool_next);
+	INIT_LIST_HEAD(&ubi->ckpt_stale);
+#endif
 
 	sprintf(ubi->bgt_name, UBI_BGT_NAME_PATTERN, ubi->ubi_num);
 
@@ -1547,6 +1663,330 @@ static void protection_queue_destroy(struct ubi_device *ubi)
 	}
 }
 
+#ifdef CONFIG_MTD_UBI_CHECKPOINT
+
+/**
+ * tree_has - check if an RB-tree has enough entries.
+ * @root: the root of the tree
+ * @count: how many entries are needed
+ */
+static int tree_has(struct rb_root *root, int count)
+{
+	struct rb_node *rb;
+
+	for (rb = rb_first(root); rb && count > 0; rb = rb_next(rb))
+		count -= 1;
+	return count <= 0;
+}
+
+/**
+ * ubi_wl_get_ckpt_peb - get a free physical eraseblock for the checkpoint.
+ * @ubi: UBI device description object
+ * @anchor: if the PEB has to be one of the first %UBI_CKPT_MAX_START PEBs
+ *
+ * The PEB is taken from the spare free PEBs if possible, and from the pool
+ * otherwise. It is not in any tree until it is given back by
+ * 'ubi_wl_put_ckpt_peb()'. Returns %NULL if there is no suitable PEB.
+ */
+struct ubi_wl_entry *ubi_wl_get_ckpt_peb(struct ubi_device *ubi, int anchor)
+{
+	struct rb_root *root = NULL, *r;
+	struct ubi_wl_entry *e = NULL, *p;
+	int pnum;
+
+	spin_lock(&ubi->wl_lock);
+	if (anchor) {
+		/* Spread the anchor over the PEBs it may be in */
+		for (pnum = 0; pnum < UBI_CKPT_MAX_START &&
+			       pnum < ubi->peb_count; pnum++) {
+			p = ubi->lookuptbl[pnum];
+			if (!p)
+				continue;
+			if (in_wl_tree(p, &ubi->ckpt_spare))
+				r = &ubi->ckpt_spare;
+			else if (in_wl_tree(p, &ubi->free))
+				r = &ubi->free;
+			else
+				continue;
+			if (!e || p->ec < e->ec) {
+				e = p;
+				root = r;
+			}
+		}
+	} else {
+		if (ubi->ckpt_spare.rb_node)
+			root = &ubi->ckpt_spare;
+		else if (ubi->free.rb_node)
+			root = &ubi->free;
+		/* PEBs holding the checkpoint are erased often */
+		if (root)
+			e = rb_entry(rb_first(root), struct ubi_wl_entry, u.rb);
+	}
+
+	if (e)
+		rb_erase(&e->u.rb, root);
+	spin_unlock(&ubi->wl_lock);
+
+	return e;
+}
+
+/**
+ * ubi_wl_erase_ckpt_peb - erase a physical eraseblock of the checkpoint.
+ * @ubi: UBI device description object
+ * @e: the physical eraseblock to erase
+ *
+ * This function is used to invalidate the previous checkpoint before the next
+ * one is written. The PEB stays with the caller. Returns zero in case of
+ * success and a negative error code in case of failure.
+ */
+int ubi_wl_erase_ckpt_peb(struct ubi_device *ubi, struct ubi_wl_entry *e)
+{
+	return sync_erase(ubi, e, 0);
+}
+
+/**
+ * ubi_wl_put_ckpt_peb - return a physical eraseblock of the checkpoint.
+ * @ubi: UBI device description object
+ * @e: the physical eraseblock to return
+ * @torture: if this physical eraseblock has to be tortured
+ */
+void ubi_wl_put_ckpt_peb(struct ubi_device *ubi, struct ubi_wl_entry *e,
+			 int torture)
+{
+	if (schedule_erase(ubi, e, torture)) {
+		ubi_ro_mode(ubi);
+		ubi->lookuptbl[e->pnum] = NULL;
+		kmem_cache_free(ubi_wl_entry_slab, e);
+	}
+}
+
+/**
+ * ubi_wl_ckpt_produce - produce spare free physical eraseblocks.
+ * @ubi: UBI device description object
+ * @count: how many spare PEBs are needed
+ *
+ * This function does pending works until there are @count spare PEBs or
+ * there are no works left. Returns zero in case of success and a negative
+ * error code in case of failure.
+ */
+int ubi_wl_ckpt_produce(struct ubi_device *ubi, int count)
+{
+	int err;
+
+	spin_lock(&ubi->wl_lock);
+	while (!tree_has(&ubi->ckpt_spare, count) && ubi->works_count) {
+		spin_unlock(&ubi->wl_lock);
+
+		err = do_work(ubi);
+		if (err)
+			return err;
+
+		spin_lock(&ubi->wl_lock);
+	}
+	spin_unlock(&ubi->wl_lock);
+
+	return 0;
+}
+
+/**
+ * ubi_wl_ckpt_fill - fill in the WL part of a checkpoint.
+ * @ubi: UBI device description object
+ * @recs: physical eraseblock records of the checkpoint
+ *
+ * This function has to be called with @ubi->wl_lock held. It records the
+ * erase counter of every PEB the WL sub-system knows and classifies the PEBs
+ * it has not been told about: free PEBs are either in the pool or spare,
+ * PEBs waiting for erasure are to be erased, and the remaining ones are
+ * used. It also tops the pool up from the spare PEBs, the new ones are only
+ * handed out once 'ubi_wl_ckpt_done()' is called.
+ */
+void ubi_wl_ckpt_fill(struct ubi_device *ubi, struct ubi_ckpt_peb *recs)
+{
+	struct ubi_wl_entry *e;
+	struct ubi_work *wrk;
+	struct rb_node *rb;
+	int pnum, pool = 0;
+
+	ubi_rb_for_each_entry(rb, e, &ubi->free, u.rb)
+		pool += 1;
+
+	/*
+	 * Keep only a pool's worth of PEBs where they can be handed out. There
+	 * are more only when checkpoints were not used until now.
+	 */
+	while (pool > ubi->ckpt_pool_size) {
+		e = rb_entry(rb_last(&ubi->free), struct ubi_wl_entry, u.rb);
+		rb_erase(&e->u.rb, &ubi->free);
+		wl_tree_add(e, &ubi->ckpt_spare);
+		pool -= 1;
+	}
+	ubi_rb_for_each_entry(rb, e, &ubi->free, u.rb)
+		recs[e->pnum].state = UBI_CKPT_POOL;
+
+	/*
+	 * Top the pool up with the PEBs with the lowest erase counters, plus
+	 * one with a high erase counter to give wear-leveling a target.
+	 */
+	while (pool < ubi->ckpt_pool_size && ubi->ckpt_spare.rb_node) {
+		if (list_empty(&ubi->ckpt_pool_next))
+			rb = rb_last(&ubi->ckpt_spare);
+		else
+			rb = rb_first(&ubi->ckpt_spare);
+		e = rb_entry(rb, struct ubi_wl_entry, u.rb);
+		rb_erase(&e->u.rb, &ubi->ckpt_spare);
+		list_add_tail(&e->u.list, &ubi->ckpt_pool_next);
+		pool += 1;
+	}
+	list_for_each_entry(e, &ubi->ckpt_pool_next, u.list)
+		recs[e->pnum].state = UBI_CKPT_POOL;
+
+	ubi_rb_for_each_entry(rb, e, &ubi->ckpt_spare, u.rb)
+		recs[e->pnum].state = UBI_CKPT_FREE;
+	list_for_each_entry(wrk, &ubi->works, list)
+		if (wrk->func == &erase_worker)
+			recs[wrk->e->pnum].state = UBI_CKPT_ERASE;
+	list_for_each_entry(e, &ubi->ckpt_stale, u.list)
+		recs[e->pnum].state = UBI_CKPT_ERASE;
+
+	for (pnum = 0; pnum < ubi->peb_count; pnum++) {
+		e = ubi->lookuptbl[pnum];
+		if (!e) {
+			/* Marked bad since attaching, or bad from the start */
+			if (!recs[pnum].state)
+				recs[pnum].state = UBI_CKPT_BAD;
+			continue;
+		}
+		recs[pnum].ec = cpu_to_be32(e->ec);
+		if (!recs[pnum].state)
+			recs[pnum].state = UBI_CKPT_SCAN;
+	}
+
+	/* Erased PEBs go to the spare tree from now on */
+	ubi->ckpt_active = 1;
+}
+
+/**
+ * ubi_wl_ckpt_done - finish writing a checkpoint.
+ * @ubi: UBI device description object
+ * @pinned: PEBs the new checkpoint lists as used, %NULL if it failed
+ *
+ * If the checkpoint has been written, the PEBs put since the previous one can
+ * be erased now unless the new one lists them as used again, and the pool
+ * gets the new PEBs. Otherwise checkpoints are not used until the next one
+ * is written, and all free PEBs can be handed out again.
+ */
+void ubi_wl_ckpt_done(struct ubi_device *ubi, const unsigned long *pinned)
+{
+	struct ubi_wl_entry *e, *tmp;
+	struct rb_node *rb;
+	LIST_HEAD(stale);
+
+	spin_lock(&ubi->wl_lock);
+	list_for_each_entry_safe(e, tmp, &ubi->ckpt_pool_next, u.list) {
+		list_del(&e->u.list);
+		wl_tree_add(e, &ubi->free);
+	}
+	if (pinned)
+		bitmap_copy(ubi->ckpt_pinned, pinned, ubi->peb_count);
+	else {
+		while ((rb = rb_first(&ubi->ckpt_spare))) {
+			e = rb_entry(rb, struct ubi_wl_entry, u.rb);
+			rb_erase(&e->u.rb, &ubi->ckpt_spare);
+			wl_tree_add(e, &ubi->free);
+		}
+		bitmap_zero(ubi->ckpt_pinned, ubi->peb_count);
+		ubi->ckpt_active = 0;
+		ubi->ckpt_countdown = ubi->ckpt_pool_size;
+	}
+	list_splice_init(&ubi->ckpt_stale, &stale);
+	spin_unlock(&ubi->wl_lock);
+
+	list_for_each_entry_safe(e, tmp, &stale, u.list) {
+		list_del(&e->u.list);
+		ubi_wl_put_ckpt_peb(ubi, e, 0);
+	}
+}
+
+/**
+ * ubi_wl_ckpt_anchor - free a physical eraseblock for the checkpoint anchor.
+ * @ubi: UBI device description object
+ *
+ * This function is used when none of the first %UBI_CKPT_MAX_START PEBs is
+ * free. It moves the data out of the least worn out of them and waits for the
+ * PEB to be erased. The move is a wear-leveling work and is only queued when
+ * none is pending, so a pending one is run first. Returns zero in case of
+ * success and a negative error code in case of failure.
+ */
+int ubi_wl_ckpt_anchor(struct ubi_device *ubi)
+{
+	struct ubi_work *wrk;
+	int err;
+
+	wrk = kmalloc(sizeof(struct ubi_work), GFP_NOFS);
+	if (!wrk)
+		return -ENOMEM;
+
+	spin_lock(&ubi->wl_lock);
+	while (ubi->wl_scheduled) {
+		/* The pending wear-leveling work clears the flag when done */
+		spin_unlock(&ubi->wl_lock);
+		err = do_work(ubi);
+		if (err) {
+			kfree(wrk);
+			return err;
+		}
+		/* It may be running in the background thread */
+		down_write(&ubi->work_sem);
+		up_write(&ubi->work_sem);
+		spin_lock(&ubi->wl_lock);
+	}
+	ubi->wl_scheduled = 1;
+	spin_unlock(&ubi->wl_lock);
+
+	dbg_wl("schedule anchor move");
+	wrk->func = &wear_leveling_worker;
+	wrk->anchor = 1;
+	schedule_ubi_work(ubi, wrk);
+
+	/* The erasure of the PEB is queued by the move */
+	while (ubi->works_count) {
+		err = do_work(ubi);
+		if (err)
+			return err;
+	}
+
+	/* The background thread may still be doing the last of them */
+	down_write(&ubi->work_sem);
+	up_write(&ubi->work_sem);
+	return 0;
+}
+
+/**
+ * ckpt_destroy - free the physical eraseblocks the checkpoint code holds.
+ * @ubi: UBI device description object
+ */
+static void ckpt_destroy(struct ubi_device *ubi)
+{
+	struct ubi_wl_entry *e, *tmp;
+	int i;
+
+	tree_destroy(&ubi->ckpt_spare);
+	list_for_each_entry_safe(e, tmp, &ubi->ckpt_pool_next, u.list) {
+		list_del(&e->u.list);
+		kmem_cache_free(ubi_wl_entry_slab, e);
+	}
+	list_for_each_entry_safe(e, tmp, &ubi->ckpt_stale, u.list) {
+		list_del(&e->u.list);
+		kmem_cache_free(ubi_wl_entry_slab, e);
+	}
+	for (i = 0; i < ubi->ckpt_count; i++)
+		kmem_cache_free(ubi_wl_entry_slab,
+				ubi->lookuptbl[ubi->ckpt_pnum[i]]);
+	ubi->ckpt_count = 0;
+}
+
+#endif /* CONFIG_MTD_UBI_CHECKPOINT */
+
 /**
  * ubi_wl_close - close the wear-leveling sub-system.
  * @ubi: UBI device description object
@@ -1556,6 +1996,9 @@ void ubi_wl_close(struct ubi_device *ubi)
 	dbg_wl("close the WL sub-system");
 	cancel_pending(ubi);
 	protection_queue_destroy(ubi);
+#ifdef CONFIG_MTD_UBI_CHECKPOINT
+	ckpt_destroy(ubi);
+#endif
 	tree_destroy(&ubi->used);
 	tree_destroy(&ubi->erroneous);
 	tree_destroy(&ubi->free);
@@ -4622,3 +4622,164 @@ error_return:
 		kmem_cache_free(ext4_ac_cachep, ac);
 	return;
 }
+
+static int ext4_issue_discard(struct super_block *sb, ext4_group_t group,
+			      ext4_grpblk_t start, ext4_grpblk_t count)
+{
+	ext4_fsblk_t block = ext4_group_first_block_no(sb, group) + start;
+	int shift = sb->s_blocksize_bits - 9;
+
+	trace_ext4_discard_blocks(sb, (unsigned long long)block, count);
+	return blkdev_issue_discard(sb->s_bdev, (sector_t)block << shift,
+				    (sector_t)count << shift, GFP_NOFS,
+				    DISCARD_FL_WAIT);
+}
+
+/*
+ * Trims one free extent of a group.  The blocks are marked in use in the
+ * buddy for the duration, so that nobody allocates them while the group
+ * lock is dropped for the discard.
+ */
+static int ext4_trim_extent(struct super_block *sb, ext4_grpblk_t start,
+			    ext4_grpblk_t count, struct ext4_buddy *e4b)
+{
+	ext4_group_t group = e4b->bd_group;
+	struct ext4_free_extent ex;
+	int err;
+
+	ex.fe_logical = 0;
+	ex.fe_start = start;
+	ex.fe_group = group;
+	ex.fe_len = count;
+
+	mb_mark_used(e4b, &ex);
+	ext4_unlock_group(sb, group);
+
+	err = ext4_issue_discard(sb, group, start, count);
+
+	ext4_lock_group(sb, group);
+	mb_free_blocks(NULL, e4b, start, count);
+	return err;
+}
+
+/*
+ * Trims the free extents of at least @minblocks blocks between @start and
+ * @max, inclusive, of a group, and returns the number of blocks trimmed.
+ */
+static ext4_grpblk_t ext4_trim_all_free(struct super_block *sb,
+					struct ext4_buddy *e4b,
+					ext4_grpblk_t start, ext4_grpblk_t max,
+					ext4_grpblk_t minblocks)
+{
+	void *bitmap = EXT4_MB_BITMAP(e4b);
+	ext4_group_t group = e4b->bd_group;
+	ext4_grpblk_t next, count = 0, seen = 0;
+	int err = 0;
+
+	ext4_lock_group(sb, group);
+	if (start < e4b->bd_info->bb_first_free)
+		start = e4b->bd_info->bb_first_free;
+
+	while (start <= max) {
+		start = mb_find_next_zero_bit(bitmap, max + 1, start);
+		if (start > max)
+			break;
+		next = mb_find_next_bit(bitmap, max + 1, start);
+
+		if (next - start >= minblocks) {
+			err = ext4_trim_extent(sb, start, next - start, e4b);
+			if (err)
+				break;
+			count += next - start;
+		}
+		seen += next - start;
+		start = next + 1;
+
+		if (fatal_signal_pending(current)) {
+			err = -ERESTARTSYS;
+			break;
+		}
+		if (need_resched()) {
+			ext4_unlock_group(sb, group);
+			cond_resched();
+			ext4_lock_group(sb, group);
+		}
+		/* what is left free in the group is too short to bother */
+		if (e4b->bd_info->bb_free - seen < minblocks)
+			break;
+	}
+	ext4_unlock_group(sb, group);
+
+	return err ? err : count;
+}
+
+/**
+ * ext4_trim_fs() -- trim ioctl handler
+ * @sb:		superblock of the filesystem
+ * @range:	fstrim_range from userspace
+ *
+ * Discards the free extents of at least range->minlen bytes within the
+ * range, group by group, so that an FTL can drop their contents instead
+ * of copying them around during garbage collection.  Blocks freed by a
+ * transaction that has not committed yet are not free in the buddy and
+ * are left alone.  On return range->len holds the number of bytes
+ * trimmed.
+ */
+int ext4_trim_fs(struct super_block *sb, struct fstrim_range *range)
+{
+	struct ext4_super_block *es = EXT4_SB(sb)->s_es;
+	struct ext4_buddy e4b;
+	ext4_group_t group, first_group, last_group;
+	ext4_grpblk_t first_block, last_block, cnt;
+	ext4_fsblk_t start, end, minlen, first_data_blk, max_blks;
+	u64 trimmed = 0;
+	int err = 0;
+
+	start = range->start >> sb->s_blocksize_bits;
+	minlen = range->minlen >> sb->s_blocksize_bits;
+	first_data_blk = le32_to_cpu(es->s_first_data_block);
+	max_blks = ext4_blocks_count(es);
+
+	if (minlen > EXT4_BLOCKS_PER_GROUP(sb) || start >= max_blks ||
+	    range->len < sb->s_blocksize)
+		return -EINVAL;
+	if (!minlen)
+		minlen = 1;
+
+	end = start + (range->len >> sb->s_blocksize_bits) - 1;
+	if (end < start || end >= max_blks)
+		end = max_blks - 1;
+	if (end <= first_data_blk)
+		goto out;
+	if (start < first_data_blk)
+		start = first_data_blk;
+
+	ext4_get_group_no_and_offset(sb, start, &first_group, &first_block);
+	ext4_get_group_no_and_offset(sb, end, &last_group, &last_block);
+
+	for (group = first_group; group <= last_group; group++) {
+		err = ext4_mb_load_buddy(sb, group, &e4b);
+		if (err) {
+			ext4_error(sb, __func__, "Error in loading buddy "
+				   "information for %u", group);
+			break;
+		}
+
+		if (e4b.bd_info->bb_free >= minlen) {
+			cnt = ext4_trim_all_free(sb, &e4b, first_block,
+					group == last_group ? last_block :
+					EXT4_BLOCKS_PER_GROUP(sb) - 1, minlen);
+			if (cnt < 0) {
+				err = cnt;
+				ext4_mb_release_desc(&e4b);
+				break;
+			}
+			trimmed += cnt;
+		}
+		ext4_mb_release_desc(&e4b);
+		first_block = 0;
+	}
+out:
+	range->len = trimmed << sb->s_blocksize_bits;
+	return err;
+}
@@ -545,29 +545,19 @@ static int get_cluster(struct inode *inode, unsigned int *new_clu, unsigned int
 }
 
 /**
- *  allocate a new cluster from pool file or fat table
+ *  append a new cluster to fat chain of inode
  * @param inode                inode
  * @param[out] new_clu new clsuter number to be allocated
  * @return             return 0 on success, errno on failure
- *
- * if file write or expand file(truncate), pre-allocation is available
- * if fat table doesn't have a free cluster at normal allocation case, free cluster will be allocated in pool file
- */ 
-int alloc_cluster(struct inode *inode, unsigned int *new_clu)
+ * @pre                        caller should get fat lock
+ */
+static int __alloc_cluster(struct inode *inode, unsigned int *new_clu)
 {
        struct super_block *sb = inode->i_sb;
        unsigned int last_clu;
        int is_first = FALSE;
        int err;
 
-       if (RFS_I(inode)->start_clu < VALID_CLU) { /* out-of-range input */
-               DPRINTK("inode has invalid start cluster(%u)\n", 
-                               RFS_I(inode)->start_clu);
-               return -EINVAL;
-       }
-
-       fat_lock(sb);
-
        if (RFS_I(inode)->start_clu != CLU_TAIL)
                last_clu = RFS_I(inode)->last_clu;
        else
@@ -577,11 +567,11 @@ int alloc_cluster(struct inode *inode, unsigned int *new_clu)
        if (tr_pre_alloc(sb)) { /* pre-allocation case */
                err = rfs_log_get_cluster(inode, new_clu);      
                if (err)
-                       goto out;
+                       return err;
        } else { /* normal allocation case */
                err = get_cluster(inode, new_clu, last_clu);
                if (err)
-                       goto out;
+                       return err;
        }
 
        /* Phase 2 : append free cluster to end of fat chain related to inode */
@@ -590,7 +580,7 @@ int alloc_cluster(struct inode *inode, unsigned int *new_clu)
        else
                err = append_new_cluster(inode, last_clu, *new_clu);
        if (err)
-               goto out;
+               return err;
 
        /* update start & last cluster */
        if (RFS_I(inode)->start_clu == CLU_TAIL) {
@@ -611,6 +601,77 @@ int alloc_cluster(struct inode *inode, unsigned int *new_clu)
                        err = rfs_insert_candidate(inode);
        }
 
+       return err;
+}
+
+/**
+ *  allocate a new cluster from pool file or fat table
+ * @param inode                inode
+ * @param[out] new_clu new clsuter number to be allocated
+ * @return             return 0 on success, errno on failure
+ *
+ * if file write or expand file(truncate), pre-allocation is available
+ * if fat table doesn't have a free cluster at normal allocation case, free cluster will be allocated in pool file
+ */ 
+int alloc_cluster(struct inode *inode, unsigned int *new_clu)
+{
+       struct super_block *sb = inode->i_sb;
+       int err;
+
+       if (RFS_I(inode)->start_clu < VALID_CLU) { /* out-of-range input */
+               DPRINTK("inode has invalid start cluster(%u)\n", 
+                               RFS_I(inode)->start_clu);
+               return -EINVAL;
+       }
+
+       fat_lock(sb);
+       err = __alloc_cluster(inode, new_clu);
+       fat_unlock(sb);
+
+       return err;
+}
+
+/**
+ *  allocate the cluster following the last cluster of inode
+ * @param inode                inode
+ * @param[out] new_clu new clsuter number to be allocated
+ * @return             return 0 on success, -EAGAIN if that cluster is not free, errno on failure
+ *
+ * Used to grow a file by physically contiguous clusters, so that one
+ * get_block call can map a run of several clusters. Nothing is allocated
+ * when the next cluster is in use or when the pool file or the
+ * pre-allocation of the log would supply the cluster.
+ */
+int alloc_contig_cluster(struct inode *inode, unsigned int *new_clu)
+{
+       struct super_block *sb = inode->i_sb;
+       struct rfs_sb_info *sbi = RFS_SB(sb);
+       unsigned int next_clu, content;
+       int err;
+
+       if (RFS_I(inode)->start_clu < VALID_CLU ||
+                       RFS_I(inode)->start_clu == CLU_TAIL)
+               return -EAGAIN;
+
+       fat_lock(sb);
+
+       next_clu = RFS_I(inode)->last_clu + 1;
+       if (tr_pre_alloc(sb) || (sbi->pool_info &&
+                       !IS_POOL_EMPTY(RFS_POOL_I(sb)->num_clusters)) ||
+                       next_clu >= sbi->num_clusters) {
+               err = -EAGAIN;
+               goto out;
+       }
+
+       err = fat_read(sb, next_clu, &content);
+       if (err || content != 0) {
+               err = -EAGAIN;
+               goto out;
+       }
+
+       /* find_free_cluster() starts from search_ptr */
+       sbi->search_ptr = next_clu;
+       err = __alloc_cluster(inode, new_clu);
 out:
        fat_unlock(sb);
 
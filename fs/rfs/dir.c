@@ -171,11 +171,35 @@ static int internal_readdir(struct inode *inode, struct buffer_head **bh, loff_t
        unsigned short uname[UNICODE_NAME_LENGTH];
 #endif
        struct rfs_dir_entry *ep = NULL;
+       struct rfs_dir_cache *cache;
        loff_t index = *ppos;
        unsigned long ino;
        unsigned int type;
        int err;
 
+       /* serve decoded entries from the directory cache */
+       cache = rfs_dir_cache_get(inode);
+       if (cache) {
+               struct rfs_dir_cache_entry *ent;
+
+               ent = rfs_dir_cache_next(cache, (u32) index);
+               if (!ent) {
+                       dir_info->type = TYPE_UNUSED;
+                       return -INTERNAL_EOF; /* not error case */
+               }
+
+               err = rfs_iunique(inode, ent->index, &ino);
+               if (err)
+                       return err;
+
+               dir_info->type = ent->type;
+               dir_info->ino = ino;
+               strcpy(dir_info->name, cache->names + ent->name_off);
+
+               *ppos = ent->index + 1;
+               return 0;
+       }
+
        while (1) {
                ep = get_entry(inode, (u32) index, bh);
                if (IS_ERR(ep)) 
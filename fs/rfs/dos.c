@@ -27,6 +27,7 @@
 #include <linux/string.h>
 #include <linux/sched.h>
 #include <linux/time.h>
+#include <linux/slab.h>
 #include <linux/rfs_fs.h>
 
 #include "rfs.h"
@@ -766,7 +767,9 @@ struct rfs_dir_entry *get_entry(struct inode *dir, unsigned int entry, struct bu
 
                /* FAT32 or sub directory */
                iblock = off >> sb->s_blocksize_bits;
-               err = rfs_bmap(dir, iblock, &block);
+               err = rfs_dir_cache_block(dir, iblock, &block);
+               if (err)
+                       err = rfs_bmap(dir, iblock, &block);
        } else {
                /* FAT16 root directory */
                err = get_root_block(sb, &off, &block);
@@ -911,6 +914,62 @@ static int get_long_name(struct inode *dir, unsigned int entry, struct buffer_he
        return nr_ext;
 }
 
+/**
+ * Function searching a name in the directory cache
+ * @param dir          inode relating to seeking entry
+ * @param cache                directory cache of dir
+ * @param dosname      dos name to be sought when uni_slot is zero
+ * @param unicode      unicode name to be sought
+ * @param uni_slot     the number of the extend slots of unicode
+ * @param ext_uname    buffer of MAX_TOTAL_LENGTH for the long name on disk
+ * @param bh           buffer head pointer
+ * @return     a offset of entry if file name exists, a negative value otherwise.
+ *
+ * It matches exactly what the scan in find_entry_long matches for TYPE_ALL.
+ * A long name whose hash matches is compared again with the slots on disk.
+ */
+static int find_entry_cached(struct inode *dir, struct rfs_dir_cache *cache, const char *dosname, u16 *unicode, unsigned int uni_slot, u16 *ext_uname, struct buffer_head **bh)
+{
+       struct rfs_dir_cache_entry *ent;
+       struct rfs_dir_entry *ep;
+       unsigned int hash = 0, i;
+       int nr_slot;
+
+       if (uni_slot)
+               hash = full_name_hash((unsigned char *) unicode, 
+                               uni_slot * EXT_UNAME_LENGTH * sizeof(u16));
+
+       for (i = 0; i < cache->nr_ents; i++) {
+               ent = &cache->ents[i];
+
+               if (!uni_slot) {
+                       /* always compare short name */
+                       if (!strncmp(dosname, ent->dosname, DOS_NAME_LENGTH))
+                               return ent->index;
+                       continue;
+               }
+
+               if ((ent->nr_ext != uni_slot) || (ent->hash != hash))
+                       continue;
+
+               ep = get_entry(dir, ent->index - uni_slot, bh);
+               if (IS_ERR(ep))
+                       return PTR_ERR(ep);
+
+               memset(ext_uname, 0xff, MAX_TOTAL_LENGTH * sizeof(u16));
+               nr_slot = get_long_name(dir, ent->index - uni_slot, bh, 
+                               &ep, ext_uname);
+               if (nr_slot < 0)
+                       return nr_slot;
+
+               if ((nr_slot == uni_slot) && !memcmp(ext_uname, unicode, 
+                               nr_slot * EXT_UNAME_LENGTH * sizeof(u16)))
+                       return ent->index;
+       }
+
+       return -ENOENT;
+}
+
 /**
  * Function check if given file name is exist 
  * @param dir          inode relating to seeking entry
@@ -924,6 +983,7 @@ static int get_long_name(struct inode *dir, unsigned int entry, struct buffer_he
  */
 int find_entry_long (struct inode *dir, const char *name, struct buffer_head **bh, unsigned int seek_type) 
 {
+       struct rfs_dir_cache *cache;
        struct rfs_dir_entry *ep;
        struct rfs_ext_entry *extp;
        u16 ext_uname[MAX_TOTAL_LENGTH];
@@ -950,6 +1010,14 @@ int find_entry_long (struct inode *dir, const char *name, struct buffer_head **b
 
        uni_slot = ((uni_len + (EXT_UNAME_LENGTH - 1)) / EXT_UNAME_LENGTH);
 
+       /* lookup from the VFS is served by the directory cache */
+       if (seek_type == TYPE_ALL) {
+               cache = rfs_dir_cache_get(dir);
+               if (cache)
+                       return find_entry_cached(dir, cache, dosname, 
+                                       unicode, uni_slot, ext_uname, bh);
+       }
+
        /* scan the directory */
        while(1) {
                ep = get_entry(dir, cpos, bh);
@@ -1029,8 +1097,10 @@ found:
  */
 int find_entry_short(struct inode *dir, const char *name, struct buffer_head **bh, unsigned int seek_type)
 {
+       struct rfs_dir_cache *cache;
        struct rfs_dir_entry *ep;
        char dosname[DOS_NAME_LENGTH];
+       unsigned int i;
        int cpos = 0;
        unsigned int type;
        
@@ -1044,6 +1114,19 @@ int find_entry_short(struct inode *dir, const char *name, struct buffer_head **b
        if (cpos < 0)
                return cpos;
 
+       /* lookup from the VFS is served by the directory cache */
+       if (seek_type == TYPE_ALL) {
+               cache = rfs_dir_cache_get(dir);
+               if (cache) {
+                       for (i = 0; i < cache->nr_ents; i++) {
+                               if (!strncmp(dosname, cache->ents[i].dosname,
+                                                       DOS_NAME_LENGTH))
+                                       return cache->ents[i].index;
+                       }
+                       return -ENOENT;
+               }
+       }
+
        cpos = 0;
        while (1) {
                ep = get_entry(dir, cpos, bh);
@@ -1141,8 +1224,515 @@ int remove_entry (struct inode *dir, unsigned int entry, struct buffer_head **bh
                        rfs_mark_buffer_dirty(*bh, dir->i_sb);
        }
 
+       rfs_dir_cache_del(dir, entry);
        return 0;
 
 error: 
+       rfs_dir_cache_invalidate(dir);
        return PTR_ERR(ep);
 }
+
+/*
+ * directory cache
+ *
+ * The entries of a directory are decoded in one sequential pass over its
+ * blocks, with read-ahead, and kept on the directory inode together with
+ * the device block of each directory block. Lookup, readdir and iunique are
+ * served from it instead of resolving the FAT chain and decoding names for
+ * every entry. build_entry and remove_entry keep it up to date; extending
+ * the directory drops it. The VFS holds the directory's i_mutex across all
+ * of them, which serializes the users of the cache.
+ */
+
+#define DIR_CACHE_MIN_ENTS     64
+#define DIR_CACHE_MIN_NAMES    1024
+#define DIR_CACHE_RA_BLOCKS    16      /* blocks per read-ahead window */
+
+/**
+ * Function releasing a directory cache
+ * @param cache        directory cache
+ * @return     none
+ */
+static void free_dir_cache(struct rfs_dir_cache *cache)
+{
+       kfree(cache->ents);
+       kfree(cache->names);
+       kfree(cache);
+}
+
+/**
+ * Function searching the first cached entry at or after given index
+ * @param cache        directory cache
+ * @param index        entry index
+ * @return     position in cache->ents (nr_ents if there is none)
+ */
+static unsigned int dir_cache_pos(struct rfs_dir_cache *cache, unsigned int index)
+{
+       unsigned int lo = 0, hi = cache->nr_ents, mid;
+
+       while (lo < hi) {
+               mid = (lo + hi) >> 1;
+               if (cache->ents[mid].index < index)
+                       lo = mid + 1;
+               else
+                       hi = mid;
+       }
+
+       return lo;
+}
+
+/**
+ * Function inserting a decoded entry into the directory cache
+ * @param sb           super block pointer
+ * @param cache                directory cache
+ * @param index                index of the short name entry
+ * @param ep           short name entry
+ * @param uname                unicode name gathered from the extend slots
+ * @param nr_ext       the number of the extend slots, zero if none
+ * @param name         buffer of NAME_MAX + 1 bytes for the decoded name
+ * @return             zero on success, -ENOMEM on failure
+ */
+static int dir_cache_insert(struct super_block *sb, struct rfs_dir_cache *cache, unsigned int index, struct rfs_dir_entry *ep, u16 *uname, unsigned int nr_ext, char *name)
+{
+       struct rfs_dir_cache_entry *ent;
+       unsigned int pos, len, max;
+
+       if (cache->nr_ents == cache->max_ents) {
+               max = cache->max_ents ? 
+                       cache->max_ents << 1 : DIR_CACHE_MIN_ENTS;
+               ent = krealloc(cache->ents, max * sizeof(*ent), GFP_KERNEL);
+               if (!ent)
+                       return -ENOMEM;
+               cache->ents = ent;
+               cache->max_ents = max;
+       }
+
+       /* decode the name as readdir reports it */
+#ifdef CONFIG_RFS_VFAT
+       if (nr_ext && uname[0] != 0x0 && IS_VFAT(RFS_SB(sb)))
+               convert_uname_to_cstring(name, uname, RFS_SB(sb)->nls_disk);
+       else
+#endif
+               convert_dosname_to_cstring(name, ep->name, ep->sysid);
+       len = strlen(name) + 1;
+
+       if (cache->names_len + len > cache->names_max) {
+               char *names;
+
+               max = cache->names_max ? 
+                       cache->names_max << 1 : DIR_CACHE_MIN_NAMES;
+               if (max < cache->names_len + len)
+                       max = cache->names_len + len;
+               names = krealloc(cache->names, max, GFP_KERNEL);
+               if (!names)
+                       return -ENOMEM;
+               cache->names = names;
+               cache->names_max = max;
+       }
+       memcpy(cache->names + cache->names_len, name, len);
+
+       pos = dir_cache_pos(cache, index);
+       ent = &cache->ents[pos];
+       memmove(ent + 1, ent, (cache->nr_ents - pos) * sizeof(*ent));
+
+       /* same bytes find_entry_long compares with the unicode name */
+       ent->hash = nr_ext ? full_name_hash((unsigned char *) uname, 
+                       nr_ext * EXT_UNAME_LENGTH * sizeof(u16)) : 0;
+       ent->name_off = cache->names_len;
+       ent->index = index;
+       ent->type = entry_type(ep);
+       ent->nr_ext = nr_ext;
+       memcpy(ent->dosname, ep->name, DOS_NAME_LENGTH);
+
+       cache->names_len += len;
+       cache->nr_ents++;
+
+       return 0;
+}
+
+/**
+ * Function mapping the blocks of a directory for its cache
+ * @param dir  directory inode
+ * @return     a directory cache without entries on success, NULL on failure
+ */
+static struct rfs_dir_cache *map_dir_cache(struct inode *dir)
+{
+       struct super_block *sb = dir->i_sb;
+       struct rfs_sb_info *sbi = RFS_SB(sb);
+       struct rfs_dir_cache *cache;
+       unsigned int base_off = 0, size, nr_blocks, clu, next, n, i;
+       unsigned long first = 0;
+       int err = 0;
+
+       if ((RFS_I(dir)->start_clu != sbi->root_clu) || IS_FAT32(sbi)) {
+               if (RFS_I(dir)->start_clu < VALID_CLU)
+                       return NULL;
+               size = (unsigned int) dir->i_size;
+       } else {
+               /* FAT16 root directory */
+               base_off = sbi->root_start_addr & (sb->s_blocksize - 1);
+               first = sbi->root_start_addr >> sb->s_blocksize_bits;
+               size = sbi->root_end_addr - sbi->root_start_addr;
+       }
+
+       if (!size || (size >> DENTRY_SIZE_BITS) > DIR_CACHE_MAX_DENTRY)
+               return NULL;
+
+       nr_blocks = (base_off + size + sb->s_blocksize - 1) 
+                       >> sb->s_blocksize_bits;
+       cache = kzalloc(sizeof(struct rfs_dir_cache) + 
+                       nr_blocks * sizeof(unsigned long), GFP_KERNEL);
+       if (!cache)
+               return NULL;
+
+       cache->base_off = base_off;
+
+       if (first) {
+               for (n = 0; n < nr_blocks; n++)
+                       cache->blocks[n] = first + n;
+               cache->nr_blocks = nr_blocks;
+               return cache;
+       }
+
+       /* walk the cluster chain once */
+       clu = RFS_I(dir)->start_clu;
+       n = 0;
+       fat_lock(sb);
+       while (1) {
+               for (i = 0; (i < sbi->blks_per_clu) && (n < nr_blocks); i++)
+                       cache->blocks[n++] = START_BLOCK(clu, sb) + i;
+               if (n == nr_blocks)
+                       break;
+
+               err = fat_read(sb, clu, &next);
+               if (err)
+                       break;
+               if (next < VALID_CLU) {
+                       err = -EIO;
+                       break;
+               }
+               if (next == CLU_TAIL)
+                       break;
+               clu = next;
+       }
+       fat_unlock(sb);
+
+       if (err) {
+               kfree(cache);
+               return NULL;
+       }
+
+       cache->nr_blocks = n;
+       return cache;
+}
+
+/**
+ * Function building the cache of a directory
+ * @param dir  directory inode
+ * @return     a directory cache on success, NULL on failure
+ *
+ * Entries are decoded in order until the first unused one. Long names are
+ * gathered as get_long_name does, and the slots of an orphan long name are
+ * ignored, so readdir and lookup agree on every name.
+ */
+static struct rfs_dir_cache *build_dir_cache(struct inode *dir)
+{
+       struct super_block *sb = dir->i_sb;
+       struct rfs_dir_cache *cache;
+       struct buffer_head *bh = NULL;
+       struct rfs_dir_entry *ep;
+       unsigned long cur = 0;
+       unsigned int nr_slots, cpos, pos, blk, j, end;
+       unsigned int type;
+       u16 *uname;
+       char *name;
+#ifdef CONFIG_RFS_VFAT
+       struct rfs_ext_entry *extp;
+       unsigned int nr_ext = 0, pending = 0, in_lfn = FALSE;
+       unsigned char checksum = 0;
+#endif
+       int err = 0;
+
+       cache = map_dir_cache(dir);
+       if (!cache)
+               return NULL;
+
+       uname = kmalloc((MAX_TOTAL_LENGTH + 1) * sizeof(u16) + NAME_MAX + 1, 
+                       GFP_KERNEL);
+       if (!uname) {
+               free_dir_cache(cache);
+               return NULL;
+       }
+       name = (char *) (uname + MAX_TOTAL_LENGTH + 1);
+
+       nr_slots = ((cache->nr_blocks << sb->s_blocksize_bits) - 
+                       cache->base_off) >> DENTRY_SIZE_BITS;
+       if (nr_slots > DIR_CACHE_MAX_DENTRY)
+               nr_slots = DIR_CACHE_MAX_DENTRY;
+
+       for (cpos = 0; cpos < nr_slots; cpos++) {
+               pos = cache->base_off + (cpos << DENTRY_SIZE_BITS);
+               blk = pos >> sb->s_blocksize_bits;
+
+               if (!bh || cache->blocks[blk] != cur) {
+#ifdef RFS_FOR_2_6
+                       /* keep the next window in flight while decoding */
+                       if (!(blk % DIR_CACHE_RA_BLOCKS)) {
+                               end = blk + (DIR_CACHE_RA_BLOCKS << 1);
+                               if (end > cache->nr_blocks)
+                                       end = cache->nr_blocks;
+                               j = blk ? blk + DIR_CACHE_RA_BLOCKS : 0;
+                               for (; j < end; j++)
+                                       sb_breadahead(sb, cache->blocks[j]);
+                       }
+#endif
+                       brelse(bh);
+                       cur = cache->blocks[blk];
+                       bh = rfs_bread(sb, cur, BH_RFS_DIR);
+                       if (!bh) {      /* I/O error */
+                               err = -EIO;
+                               break;
+                       }
+               }
+
+               ep = (struct rfs_dir_entry *) (bh->b_data + 
+                               (pos & (sb->s_blocksize - 1)));
+               type = entry_type(ep);
+               if (type == TYPE_UNUSED)        /* end-of-directory */
+                       break;
+
+#ifdef CONFIG_RFS_VFAT
+               extp = (struct rfs_ext_entry *) ep;
+               if (pending) {
+                       /* the rest of the extend slots */
+                       if ((type == TYPE_EXTEND) && 
+                                       (extp->entry_offset <= EXT_END_MARK) &&
+                                       (extp->checksum == checksum)) {
+                               pending--;
+                               get_uname_from_ext_entry(extp, 
+                                       uname + pending * EXT_UNAME_LENGTH, 
+                                       FALSE);
+                               continue;
+                       }
+                       /* orphan LFN entries, see this slot on its own */
+                       pending = 0;
+                       in_lfn = FALSE;
+               } else if (in_lfn) {
+                       in_lfn = FALSE;
+                       if (((type == TYPE_FILE) || (type == TYPE_DIR)) && 
+                                       (checksum == calc_checksum(ep->name))) {
+                               err = dir_cache_insert(sb, cache, cpos, ep, 
+                                               uname, nr_ext, name);
+                               if (err)
+                                       break;
+                               continue;
+                       }
+               }
+
+               if (type == TYPE_EXTEND) {
+                       /* the last extend slot comes first on the disk */
+                       if ((extp->entry_offset <= EXT_END_MARK) || 
+                                       (extp->entry_offset - EXT_END_MARK > 
+                                        MAX_TOTAL_LENGTH / EXT_UNAME_LENGTH))
+                               continue;
+
+                       nr_ext = extp->entry_offset - EXT_END_MARK;
+                       memset(uname, 0xff, MAX_TOTAL_LENGTH * sizeof(u16));
+                       checksum = extp->checksum;
+                       pending = nr_ext - 1;
+                       in_lfn = TRUE;
+                       get_uname_from_ext_entry(extp, 
+                               uname + pending * EXT_UNAME_LENGTH, TRUE);
+                       continue;
+               }
+#endif
+               if ((type != TYPE_FILE) && (type != TYPE_DIR))
+                       continue;
+
+               err = dir_cache_insert(sb, cache, cpos, ep, uname, 0, name);
+               if (err)
+                       break;
+       }
+
+       brelse(bh);
+       kfree(uname);
+
+       if (err) {
+               free_dir_cache(cache);
+               return NULL;
+       }
+
+       return cache;
+}
+
+/**
+ * Function returning the cache of a directory, building it if necessary
+ * @param dir  directory inode
+ * @return     a directory cache, NULL if the directory can't be cached
+ */
+struct rfs_dir_cache *rfs_dir_cache_get(struct inode *dir)
+{
+       if (!RFS_I(dir)->dir_cache)
+               RFS_I(dir)->dir_cache = build_dir_cache(dir);
+
+       return RFS_I(dir)->dir_cache;
+}
+
+/**
+ * Function returning the first cached entry at or after given index
+ * @param cache        directory cache
+ * @param index        entry index
+ * @return     a cached entry, NULL if there is none
+ */
+struct rfs_dir_cache_entry *rfs_dir_cache_next(struct rfs_dir_cache *cache, unsigned int index)
+{
+       unsigned int pos = dir_cache_pos(cache, index);
+
+       return (pos < cache->nr_ents) ? &cache->ents[pos] : NULL;
+}
+
+/**
+ * Function mapping a directory block with the block map of the cache
+ * @param dir          directory inode
+ * @param iblock       block number in the directory
+ * @param[out] block   device block number
+ * @return     zero on success, -ENOENT if the block is not cached
+ *
+ * It never builds the cache. The FAT16 root directory is not mapped here.
+ */
+int rfs_dir_cache_block(struct inode *dir, long iblock, unsigned long *block)
+{
+       struct rfs_dir_cache *cache = RFS_I(dir)->dir_cache;
+
+       if (!cache || cache->base_off || (iblock < 0) || 
+                       ((unsigned long) iblock >= cache->nr_blocks))
+               return -ENOENT;
+
+       *block = cache->blocks[iblock];
+       return 0;
+}
+
+/**
+ * Function adding a new entry to the cache of a directory
+ * @param dir          directory inode
+ * @param index                index of the short name entry just built
+ * @return     none
+ *
+ * The cache is dropped if the entry can't be decoded.
+ */
+void rfs_dir_cache_add(struct inode *dir, unsigned int index)
+{
+       struct rfs_dir_cache *cache = RFS_I(dir)->dir_cache;
+       struct buffer_head *bh = NULL;
+       struct rfs_dir_entry *ep, sfn;
+       unsigned int nr_ext = 0;
+       u16 *uname;
+       int err = -ENOMEM;
+#ifdef CONFIG_RFS_VFAT
+       struct rfs_ext_entry *extp;
+       unsigned char checksum;
+       unsigned int i;
+#endif
+
+       if (!cache)
+               return;
+
+       uname = kmalloc((MAX_TOTAL_LENGTH + 1) * sizeof(u16) + NAME_MAX + 1, 
+                       GFP_KERNEL);
+       if (!uname)
+               goto out;
+
+       ep = get_entry(dir, index, &bh);
+       if (IS_ERR(ep)) {
+               err = PTR_ERR(ep);
+               goto out;
+       }
+       sfn = *ep;
+
+#ifdef CONFIG_RFS_VFAT
+       /* gather the extend slots backward from the short name entry */
+       memset(uname, 0xff, MAX_TOTAL_LENGTH * sizeof(u16));
+       checksum = calc_checksum(sfn.name);
+       for (i = 1; (i <= index) && 
+                       (i <= MAX_TOTAL_LENGTH / EXT_UNAME_LENGTH); i++) {
+               ep = get_entry(dir, index - i, &bh);
+               if (IS_ERR(ep)) {
+                       err = PTR_ERR(ep);
+                       goto out;
+               }
+
+               extp = (struct rfs_ext_entry *) ep;
+               if ((entry_type(ep) != TYPE_EXTEND) || 
+                               (extp->checksum != checksum))
+                       break;
+
+               if (extp->entry_offset > EXT_END_MARK) {
+                       if (extp->entry_offset - EXT_END_MARK == i) {
+                               get_uname_from_ext_entry(extp, uname + 
+                                       (i - 1) * EXT_UNAME_LENGTH, TRUE);
+                               nr_ext = i;
+                       }
+                       break;
+               }
+
+               get_uname_from_ext_entry(extp, 
+                               uname + (i - 1) * EXT_UNAME_LENGTH, FALSE);
+       }
+#endif
+
+       err = dir_cache_insert(dir->i_sb, cache, index, &sfn, uname, nr_ext, 
+                       (char *) (uname + MAX_TOTAL_LENGTH + 1));
+out:
+       brelse(bh);
+       kfree(uname);
+
+       if (err)
+               rfs_dir_cache_invalidate(dir);
+}
+
+/**
+ * Function removing an entry from the cache of a directory
+ * @param dir          directory inode
+ * @param index                index of the short name entry just removed
+ * @return     none
+ */
+void rfs_dir_cache_del(struct inode *dir, unsigned int index)
+{
+       struct rfs_dir_cache *cache = RFS_I(dir)->dir_cache;
+       struct rfs_dir_cache_entry *ent;
+       unsigned int pos;
+
+       if (!cache)
+               return;
+
+       pos = dir_cache_pos(cache, index);
+       if ((pos == cache->nr_ents) || (cache->ents[pos].index != index)) {
+               rfs_dir_cache_invalidate(dir);
+               return;
+       }
+
+       ent = &cache->ents[pos];
+       cache->names_dead += strlen(cache->names + ent->name_off) + 1;
+       memmove(ent, ent + 1, (cache->nr_ents - pos - 1) * sizeof(*ent));
+       cache->nr_ents--;
+
+       /* rebuild it rather than keep growing the names of removed entries */
+       if ((cache->names_dead > DIR_CACHE_MIN_NAMES) && 
+                       (cache->names_dead > (cache->names_len >> 1)))
+               rfs_dir_cache_invalidate(dir);
+}
+
+/**
+ * Function dropping the cache of a directory
+ * @param dir          directory inode
+ * @return     none
+ */
+void rfs_dir_cache_invalidate(struct inode *dir)
+{
+       struct rfs_dir_cache *cache = RFS_I(dir)->dir_cache;
+
+       if (cache) {
+               RFS_I(dir)->dir_cache = NULL;
+               free_dir_cache(cache);
+       }
+}
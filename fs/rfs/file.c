@@ -629,14 +629,19 @@ struct inode_operations rfs_file_inode_operations = {
 };
 
 /**
- *  translate index into a logical block
+ *  translate index into a run of logical blocks
  * @param inode                inode
  * @param iblock       index
  * @param bh_result    buffer head pointer
  * @param create       flag whether new block will be allocated
  * @return             returns 0 on success, errno on failure 
  *
- * if there aren't logical block, allocate new cluster and map it
+ * if there aren't logical block, allocate new cluster and map it.
+ * On 2.6, bh_result->b_size holds the size the caller wants mapped; it is
+ * set to the size of the physically contiguous run actually mapped, so
+ * that mpage and direct IO can build one bio for a whole cluster run.
+ * When appending, the following clusters are allocated contiguously as
+ * long as they are free.
  */
 #ifdef RFS_FOR_2_6
 int rfs_get_block(struct inode *inode, sector_t iblock, struct buffer_head *bh_result, int create)
@@ -646,22 +651,32 @@ int rfs_get_block(struct inode *inode, long iblock, struct buffer_head *bh_resul
 {
        unsigned long phys = 0;
        struct super_block *sb = inode->i_sb;
+       unsigned int blks_per_clu = RFS_SB(sb)->blks_per_clu;
+       unsigned int max_blocks = 1, nr_blocks = 0;
        unsigned int new_clu;
+       long block;
        int ret = 0;
 
 #ifdef RFS_FOR_2_4
        lock_kernel();
 #endif
 
-       ret = rfs_bmap(inode, iblock, &phys);
-       if (!ret) {
+#ifdef RFS_FOR_2_6
+       if (bh_result->b_size > sb->s_blocksize)
+               max_blocks = bh_result->b_size >> sb->s_blocksize_bits;
+#endif
+
+       ret = rfs_bmap_blocks(inode, iblock, &phys, max_blocks);
+       if (ret > 0) {
 #ifdef RFS_FOR_2_6
                map_bh(bh_result, sb, phys);
+               bh_result->b_size = ret << sb->s_blocksize_bits;
 #else          
                bh_result->b_dev = inode->i_dev;
                bh_result->b_blocknr = phys;
                bh_result->b_state |= (1UL << BH_Mapped);
 #endif
+               ret = 0;
                goto out;
        }
 
@@ -672,16 +687,28 @@ int rfs_get_block(struct inode *inode, long iblock, struct buffer_head *bh_resul
        if (iblock != (RFS_I(inode)->mmu_private >> sb->s_blocksize_bits))
                goto out;
 
-       if (!(iblock & (RFS_SB(sb)->blks_per_clu - 1))) {
-               ret = alloc_cluster(inode, &new_clu);
-               if (ret)
-                       goto out;
+       /* append blocks while they stay physically contiguous */
+       for (block = iblock; nr_blocks < max_blocks; block++, nr_blocks++) {
+               if (!(block & (blks_per_clu - 1))) {
+                       if (!nr_blocks) {
+                               ret = alloc_cluster(inode, &new_clu);
+                               if (ret)
+                                       goto out;
+                       } else if (alloc_contig_cluster(inode, &new_clu)) {
+                               /*
+                                * next cluster is taken (or failed to be
+                                * allocated); end the run here, the next
+                                * call allocates it the usual way
+                                */
+                               break;
+                       }
+               }
+               RFS_I(inode)->mmu_private += sb->s_blocksize;
        }
 
-       RFS_I(inode)->mmu_private += sb->s_blocksize;
        ret = rfs_bmap(inode, iblock, &phys);
        if (ret) {
-               RFS_I(inode)->mmu_private -= sb->s_blocksize;
+               RFS_I(inode)->mmu_private -= nr_blocks << sb->s_blocksize_bits;
                RFS_BUG("iblock(%ld) doesn't have a physical mapping", 
                                (long int)iblock);
                goto out;
@@ -690,6 +717,7 @@ int rfs_get_block(struct inode *inode, long iblock, struct buffer_head *bh_resul
 #ifdef RFS_FOR_2_6
        set_buffer_new(bh_result);
        map_bh(bh_result, sb, phys);
+       bh_result->b_size = nr_blocks << sb->s_blocksize_bits;
 #else          
        bh_result->b_dev = inode->i_dev;
        bh_result->b_blocknr = phys;
@@ -713,11 +741,32 @@ out:
  * @pre                FAT16 root directory's inode does not invoke this function      
  */
 int rfs_bmap(struct inode *inode, long index, unsigned long *phys)
+{
+       int ret;
+
+       ret = rfs_bmap_blocks(inode, index, phys, 1);
+
+       return (ret < 0) ? ret : 0;
+}
+
+/**
+ *  translation index into a run of contiguous logical blocks
+ * @param inode                inode   
+ * @param index                index number    
+ * @param[out] phys    logical block number of index
+ * @param max_blocks   maximum number of blocks to map
+ * @return     returns the number of contiguous blocks from phys on success, errno on failure  
+ * @pre                FAT16 root directory's inode does not invoke this function      
+ *
+ * The run follows the fat chain while each cluster is the physical
+ * successor of the previous one, and never crosses mmu_private.
+ */
+int rfs_bmap_blocks(struct inode *inode, long index, unsigned long *phys, unsigned int max_blocks)
 {
        struct super_block *sb = inode->i_sb;
        struct rfs_sb_info *sbi = RFS_SB(sb);
        unsigned int cluster, offset, num_clusters;
-       unsigned int last_block;
+       unsigned int last_block, blocks;
        unsigned int clu, prev, next; 
        int err = 0;
 
@@ -747,6 +796,22 @@ int rfs_bmap(struct inode *inode, long index, unsigned long *phys)
        rfs_update_hint(inode, prev, cluster);
 
        *phys = START_BLOCK(prev, sb) + offset;
+
+       /* extend the run over physically adjacent clusters */
+       blocks = sbi->blks_per_clu - offset;
+       clu = prev;
+       while (blocks < max_blocks && next == clu + 1) {
+               clu = next;
+               if (fat_read(sb, clu, &next))
+                       break;
+               blocks += sbi->blks_per_clu;
+       }
+
+       if (blocks > max_blocks)
+               blocks = max_blocks;
+       if (blocks > last_block - index)
+               blocks = last_block - index;
+       err = blocks;
 out:
        fat_unlock(sb);
 
@@ -316,10 +316,21 @@ int rfs_iunique(struct inode *dir, unsigned int index, unsigned long *ino)
        if ((RFS_I(dir)->start_clu != sbi->root_clu) || IS_FAT32(sbi)) {
                unsigned int offset, cluster_offset;
                unsigned int prev, next;
+               unsigned long block;
                int err;
 
                /* in FAT32 root dir or sub-directories */
                offset = index << DENTRY_SIZE_BITS;
+
+               /* block map of the directory cache, if any */
+               if (!rfs_dir_cache_block(dir, offset >> sb->s_blocksize_bits,
+                                       &block)) {
+                       offset &= sb->s_blocksize - 1;
+                       offset += (block << sb->s_blocksize_bits);
+                       *ino = offset >> DENTRY_SIZE_BITS;
+                       return 0;
+               }
+
                cluster_offset = offset >> sbi->cluster_bits;
                fat_lock(sb);
                err = find_cluster(sb, RFS_I(dir)->start_clu, 
@@ -630,6 +641,15 @@ out:
 #endif
 }
 
+/**
+ *  release the in-core data of inode
+ * @param inode        inode will be cleared
+ */
+void rfs_clear_inode(struct inode *inode)
+{
+       rfs_dir_cache_invalidate(inode);
+}
+
 /**
  *  deallocate clusters and remove entries for inode
  * @param dir  parent directory inode  
@@ -77,6 +77,9 @@ static struct buffer_head *extend_dir(struct inode * dir, unsigned int *start_cl
        if (err)
                return ERR_PTR(err);
 
+       /* block map of the directory cache is stale now */
+       rfs_dir_cache_invalidate(dir);
+
        if (start_clu)
                *start_clu = new_clu;
 
@@ -338,6 +341,12 @@ int build_entry_short(struct inode *dir, struct inode *inode, unsigned int start
 
 out:
        brelse(bh);
+
+       if (ret >= 0)
+               rfs_dir_cache_add(dir, index);
+       else
+               rfs_dir_cache_invalidate(dir);
+
        return ret;
 }
 
@@ -435,6 +444,11 @@ int build_entry_long(struct inode *dir, struct inode *inode, unsigned int start_
 out:
        brelse(bh);
 
+       if (ret >= 0)
+               rfs_dir_cache_add(dir, index);
+       else
+               rfs_dir_cache_invalidate(dir);
+
        return ret;     
 }
 
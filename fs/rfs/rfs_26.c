@@ -37,7 +37,8 @@
 #ifdef RFS_FOR_2_6_17
 /*
  * In linux 2.6.17 or more, the callback function in direct io is changed.
- * Now, it is used to single get block instead of multiple get blocks.
+ * The number of blocks wanted is passed in bh_result->b_size, which
+ * rfs_get_block already honours.
  */
 #define rfs_get_blocks         rfs_get_block
 
@@ -46,7 +47,7 @@
  *  Function to translate a logical block into physical block
  *  @param inode       inode
  *  @param iblock      logical block number
- *  @param max_blocks  dummy variable new
+ *  @param max_blocks  maximum number of blocks to map
  *  @param bh_result   buffer head pointer
  *  @param create      control flag
  *  @return            zero on success, negative value on failure
@@ -55,12 +56,10 @@
  */
 static int rfs_get_blocks(struct inode *inode, sector_t iblock, unsigned long max_blocks, struct buffer_head *bh_result, int create)
 {
-       int ret;
+       /* rfs_get_block maps up to b_size and returns the mapped size in it */
+       bh_result->b_size = max_blocks << inode->i_blkbits;
 
-       ret = rfs_get_block(inode, iblock, bh_result, create);
-       if (!ret)
-               bh_result->b_size = (1 << inode->i_blkbits);
-       return ret;
+       return rfs_get_block(inode, iblock, bh_result, create);
 }
 #endif /* RFS_FOR_2_6_17 */
 
@@ -346,6 +345,7 @@ struct inode *rfs_alloc_inode(struct super_block *sb)
                
        /* initialize rfs inode info, if necessary */
        new->i_state = RFS_I_ALLOC;
+       new->dir_cache = NULL;
 
        return &new->vfs_inode; 
 }
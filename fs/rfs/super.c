@@ -173,6 +173,7 @@ static struct super_operations rfs_sops = {
 #endif
        .write_inode    = rfs_write_inode,
        .delete_inode   = rfs_delete_inode,
+       .clear_inode    = rfs_clear_inode,
        .put_super      = rfs_put_super,
        .write_super    = rfs_write_super,
        .statfs         = rfs_statfs,
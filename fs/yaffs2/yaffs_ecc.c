@@ -35,6 +35,10 @@ const char *yaffs_ecc_c_version =
 
 #include "yaffs_ecc.h"
 
+#ifdef CONFIG_YAFFS_ECC_SELFTEST
+#include <linux/ktime.h>
+#endif
+
 static const unsigned char column_parity_table[] = {
 	0x00, 0x55, 0x59, 0x0c, 0x65, 0x30, 0x3c, 0x69,
 	0x69, 0x3c, 0x30, 0x65, 0x0c, 0x59, 0x55, 0x00,
@@ -94,26 +98,11 @@ static int yaffs_CountBits32(unsigned x)
 	return r;
 }
 
-/* Calculate the ECC for a 256-byte block of data */
-void yaffs_ECCCalculate(const unsigned char *data, unsigned char *ecc)
+/* Pack the column and line parities into the three SmartMedia ECC bytes */
+static void yaffs_ECCPack(unsigned char col_parity, unsigned char line_parity,
+			  unsigned char line_parity_prime, unsigned char *ecc)
 {
-	unsigned int i;
-
-	unsigned char col_parity = 0;
-	unsigned char line_parity = 0;
-	unsigned char line_parity_prime = 0;
 	unsigned char t;
-	unsigned char b;
-
-	for (i = 0; i < 256; i++) {
-		b = column_parity_table[*data++];
-		col_parity ^= b;
-
-		if (b & 0x01) {		/* odd number of bits in the byte */
-			line_parity ^= i;
-			line_parity_prime ^= ~i;
-		}
-	}
 
 	ecc[2] = (~col_parity) | 0x03;
 
@@ -163,6 +152,143 @@ void yaffs_ECCCalculate(const unsigned char *data, unsigned char *ecc)
 #endif
 }
 
+/* Calculate the ECC for a 256-byte block of data, one byte at a time */
+static void yaffs_ECCCalculateBytewise(const unsigned char *data,
+				       unsigned char *ecc)
+{
+	unsigned int i;
+
+	unsigned char col_parity = 0;
+	unsigned char line_parity = 0;
+	unsigned char line_parity_prime = 0;
+	unsigned char b;
+
+	for (i = 0; i < 256; i++) {
+		b = column_parity_table[*data++];
+		col_parity ^= b;
+
+		if (b & 0x01) {		/* odd number of bits in the byte */
+			line_parity ^= i;
+			line_parity_prime ^= ~i;
+		}
+	}
+
+	yaffs_ECCPack(col_parity, line_parity, line_parity_prime, ecc);
+}
+
+#ifdef CONFIG_YAFFS_ECC_WORDWISE
+/*
+ * Word at a time version, after drivers/mtd/nand/nand_ecc.c.
+ *
+ * The column parities only depend on the XOR of all the bytes, since
+ * column_parity_table is linear. Bit k of the line parity is the parity of
+ * all the bytes whose index has bit k set, and bit k of the line parity
+ * prime is the parity of the rest. For k >= 2 that is the parity of the
+ * words whose index has bit k - 2 set, so each 32-bit word only has to be
+ * XORed into the accumulators selected by its index. The two low bits of
+ * the byte index come from the byte lanes of the XOR of all the words.
+ */
+static unsigned char yaffs_Parity32(__u32 x)
+{
+	x ^= x >> 16;
+	x ^= x >> 8;
+	return column_parity_table[x & 0xff] & 0x01;
+}
+
+void yaffs_ECCCalculate(const unsigned char *data, unsigned char *ecc)
+{
+	const __u32 *bp = (const __u32 *)data;
+	__u32 cur;
+	__u32 tmppar;
+	__u32 par = 0;
+	__u32 rp2 = 0, rp3 = 0, rp4 = 0, rp5 = 0, rp6 = 0, rp7 = 0;
+	union {
+		__u32 w;
+		unsigned char b[4];
+	} lanes;
+	unsigned char line_parity;
+	unsigned char all_parity;
+	int i;
+
+	if (((unsigned long)data) & 3) {
+		yaffs_ECCCalculateBytewise(data, ecc);
+		return;
+	}
+
+	/* Four groups of 16 words; within a group word n feeds rp2..rp5
+	 * according to the bits of n, the group number feeds rp6 and rp7.
+	 */
+	for (i = 0; i < 4; i++) {
+		cur = *bp++;
+		tmppar = cur;
+		cur = *bp++;
+		tmppar ^= cur; rp2 ^= cur;
+		cur = *bp++;
+		tmppar ^= cur; rp3 ^= cur;
+		cur = *bp++;
+		tmppar ^= cur; rp2 ^= cur; rp3 ^= cur;
+		cur = *bp++;
+		tmppar ^= cur; rp4 ^= cur;
+		cur = *bp++;
+		tmppar ^= cur; rp2 ^= cur; rp4 ^= cur;
+		cur = *bp++;
+		tmppar ^= cur; rp3 ^= cur; rp4 ^= cur;
+		cur = *bp++;
+		tmppar ^= cur; rp2 ^= cur; rp3 ^= cur; rp4 ^= cur;
+		cur = *bp++;
+		tmppar ^= cur; rp5 ^= cur;
+		cur = *bp++;
+		tmppar ^= cur; rp2 ^= cur; rp5 ^= cur;
+		cur = *bp++;
+		tmppar ^= cur; rp3 ^= cur; rp5 ^= cur;
+		cur = *bp++;
+		tmppar ^= cur; rp2 ^= cur; rp3 ^= cur; rp5 ^= cur;
+		cur = *bp++;
+		tmppar ^= cur; rp4 ^= cur; rp5 ^= cur;
+		cur = *bp++;
+		tmppar ^= cur; rp2 ^= cur; rp4 ^= cur; rp5 ^= cur;
+		cur = *bp++;
+		tmppar ^= cur; rp3 ^= cur; rp4 ^= cur; rp5 ^= cur;
+		cur = *bp++;
+		tmppar ^= cur; rp2 ^= cur; rp3 ^= cur; rp4 ^= cur; rp5 ^= cur;
+
+		par ^= tmppar;
+		if (i & 1)
+			rp6 ^= tmppar;
+		if (i & 2)
+			rp7 ^= tmppar;
+	}
+
+	/* Byte lanes are in memory order whatever the endianness */
+	lanes.w = par;
+
+	line_parity = 0;
+	if (column_parity_table[lanes.b[1] ^ lanes.b[3]] & 0x01)
+		line_parity |= 0x01;
+	if (column_parity_table[lanes.b[2] ^ lanes.b[3]] & 0x01)
+		line_parity |= 0x02;
+	line_parity |= yaffs_Parity32(rp2) << 2;
+	line_parity |= yaffs_Parity32(rp3) << 3;
+	line_parity |= yaffs_Parity32(rp4) << 4;
+	line_parity |= yaffs_Parity32(rp5) << 5;
+	line_parity |= yaffs_Parity32(rp6) << 6;
+	line_parity |= yaffs_Parity32(rp7) << 7;
+
+	/* Each prime bit covers the bytes the line parity bit does not */
+	all_parity = yaffs_Parity32(par) ? 0xff : 0x00;
+
+	yaffs_ECCPack(column_parity_table[lanes.b[0] ^ lanes.b[1] ^
+					  lanes.b[2] ^ lanes.b[3]],
+		      line_parity, line_parity ^ all_parity, ecc);
+}
+#else
+/* Calculate the ECC for a 256-byte block of data */
+void yaffs_ECCCalculate(const unsigned char *data, unsigned char *ecc)
+{
+	yaffs_ECCCalculateBytewise(data, ecc);
+}
+#endif
+
 
 /* Correct the ECC on a 256 byte block of data */
 
@@ -324,3 +450,92 @@ int yaffs_ECCCorrectOther(unsigned char *data, unsigned nBytes,
 
 	return -1;
 }
+
+#ifdef CONFIG_YAFFS_ECC_SELFTEST
+/*
+ * Check the word at a time ECC against the byte at a time one on a set of
+ * single bit and pseudo-random blocks, check that every single bit error
+ * in a block is corrected, then report how long each version takes.
+ */
+#define YAFFS_ECC_TEST_BLOCKS	256
+#define YAFFS_ECC_TEST_LOOPS	2000
+
+static __u32 yaffs_ecc_test_block[64];
+
+static __u32 yaffs_ECCTestRandom(__u32 *seed)
+{
+	*seed = *seed * 1103515245 + 12345;
+	return *seed;
+}
+
+static void yaffs_ECCTestFill(unsigned char *data, int n, __u32 *seed)
+{
+	int i;
+
+	if (n < 256 * 8) {
+		memset(data, 0, 256);
+		data[n >> 3] = 1 << (n & 7);
+	} else {
+		for (i = 0; i < 256; i++)
+			data[i] = yaffs_ECCTestRandom(seed) >> 16;
+	}
+}
+
+int yaffs_ECCSelfTest(void)
+{
+	unsigned char *data = (unsigned char *)yaffs_ecc_test_block;
+	unsigned char wordEcc[3];
+	unsigned char byteEcc[3];
+	unsigned char readEcc[3];
+	unsigned char orig;
+	__u32 seed = 1;
+	ktime_t start;
+	s64 wordNs;
+	s64 byteNs;
+	int n;
+
+	for (n = 0; n < 256 * 8 + YAFFS_ECC_TEST_BLOCKS; n++) {
+		yaffs_ECCTestFill(data, n, &seed);
+		yaffs_ECCCalculate(data, wordEcc);
+		yaffs_ECCCalculateBytewise(data, byteEcc);
+		if (memcmp(wordEcc, byteEcc, 3)) {
+			T(YAFFS_TRACE_ALWAYS,
+			  (TSTR("yaffs: ECC self-test mismatch on block %d"
+			   TENDSTR), n));
+			return -1;
+		}
+	}
+
+	yaffs_ECCCalculate(data, readEcc);
+	for (n = 0; n < 256 * 8; n++) {
+		orig = data[n >> 3];
+		data[n >> 3] ^= 1 << (n & 7);
+		yaffs_ECCCalculate(data, wordEcc);
+		if (yaffs_ECCCorrect(data, readEcc, wordEcc) != 1 ||
+		    data[n >> 3] != orig) {
+			T(YAFFS_TRACE_ALWAYS,
+			  (TSTR("yaffs: ECC self-test failed to correct bit %d"
+			   TENDSTR), n));
+			return -1;
+		}
+	}
+
+	start = ktime_get();
+	for (n = 0; n < YAFFS_ECC_TEST_LOOPS; n++)
+		yaffs_ECCCalculate(data, wordEcc);
+	wordNs = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	start = ktime_get();
+	for (n = 0; n < YAFFS_ECC_TEST_LOOPS; n++)
+		yaffs_ECCCalculateBytewise(data, byteEcc);
+	byteNs = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	T(YAFFS_TRACE_ALWAYS,
+	  (TSTR("yaffs: ECC self-test passed, %d ns per 256 bytes"
+	   " (byte at a time %d ns)" TENDSTR),
+	   (int)div_s64(wordNs, YAFFS_ECC_TEST_LOOPS),
+	   (int)div_s64(byteNs, YAFFS_ECC_TEST_LOOPS)));
+
+	return 0;
+}
+#endif
@@ -112,6 +112,7 @@ static uint32_t YCALCBLOCKS(uint64_t partition_size, uint32_t block_size)
 
 #include "yportenv.h"
 #include "yaffs_guts.h"
+#include "yaffs_ecc.h"
 
 #include <linux/mtd/mtd.h>
 #include "yaffs_mtdif.h"
@@ -121,16 +122,22 @@ static uint32_t YCALCBLOCKS(uint64_t partition_size, uint32_t block_size)
 unsigned int yaffs_traceMask = YAFFS_TRACE_BAD_BLOCKS;
 unsigned int yaffs_wr_attempts = YAFFS_WR_ATTEMPTS;
 unsigned int yaffs_auto_checkpoint = 1;
+unsigned int yaffs_checkpoint_lag = 16;
+unsigned int yaffs_short_op_caches = 32;
 
 /* Module Parameters */
 #if (LINUX_VERSION_CODE > KERNEL_VERSION(2, 5, 0))
 module_param(yaffs_traceMask, uint, 0644);
 module_param(yaffs_wr_attempts, uint, 0644);
 module_param(yaffs_auto_checkpoint, uint, 0644);
+module_param(yaffs_checkpoint_lag, uint, 0644);
+module_param(yaffs_short_op_caches, uint, 0644);
 #else
 MODULE_PARM(yaffs_traceMask, "i");
 MODULE_PARM(yaffs_wr_attempts, "i");
 MODULE_PARM(yaffs_auto_checkpoint, "i");
+MODULE_PARM(yaffs_checkpoint_lag, "i");
+MODULE_PARM(yaffs_short_op_caches, "i");
 #endif
 
 #if (LINUX_VERSION_CODE < KERNEL_VERSION(2, 6, 25))
@@ -1730,24 +1737,30 @@ static int yaffs_statfs(struct super_block *sb, struct statfs *buf)
 }
 
 
-static int yaffs_do_sync_fs(struct super_block *sb)
+/*
+ * Writes no longer dirty the superblock (see yaffs_AgeCheckpoint()), so the
+ * short-op cache is flushed on every sync whatever s_dirt says. The
+ * checkpoint is only rewritten once it lags too far behind.
+ */
+static int yaffs_do_sync_fs(struct super_block *sb, int do_checkpoint)
 {
 
 	yaffs_Device *dev = yaffs_SuperToDevice(sb);
 	T(YAFFS_TRACE_OS, ("yaffs_do_sync_fs\n"));
 
-	if (sb->s_dirt) {
-		yaffs_GrossLock(dev);
+	yaffs_GrossLock(dev);
 
-		if (dev) {
-			yaffs_FlushEntireDeviceCache(dev);
-			yaffs_CheckpointSave(dev);
-		}
+	if (dev) {
+		yaffs_FlushEntireDeviceCache(dev);
+		if (do_checkpoint)
+			yaffs_CheckpointSync(dev);
+	}
 
-		yaffs_GrossUnlock(dev);
+	yaffs_GrossUnlock(dev);
 
+	if (do_checkpoint)
 		sb->s_dirt = 0;
-	}
+
 	return 0;
 }
 
@@ -1761,7 +1774,7 @@ static int yaffs_write_super(struct super_block *sb)
 
 	T(YAFFS_TRACE_OS, ("yaffs_write_super\n"));
 	if (yaffs_auto_checkpoint >= 2)
-		yaffs_do_sync_fs(sb);
+		yaffs_do_sync_fs(sb, 1);
 #if (LINUX_VERSION_CODE < KERNEL_VERSION(2, 6, 18))
 	return 0;
 #endif
@@ -1776,8 +1789,7 @@ static int yaffs_sync_fs(struct super_block *sb)
 {
 	T(YAFFS_TRACE_OS, ("yaffs_sync_fs\n"));
 
-	if (yaffs_auto_checkpoint >= 1)
-		yaffs_do_sync_fs(sb);
+	yaffs_do_sync_fs(sb, yaffs_auto_checkpoint >= 1);
 
 	return 0;
 }
@@ -1844,6 +1856,11 @@ static void yaffs_read_inode(struct inode *inode)
 
 static YLIST_HEAD(yaffs_dev_list);
 
+/* Also held across yaffs_dev_list changes, so that the cache shrinker can
+ * walk the list without lock_kernel(). Nothing allocates while holding it.
+ */
+static DEFINE_MUTEX(yaffs_dev_list_lock);
+
 #if 0 /* not used */
 static int yaffs_remount_fs(struct super_block *sb, int *flags, char *data)
 {
@@ -1894,7 +1911,9 @@ static void yaffs_put_super(struct super_block *sb)
 	yaffs_GrossUnlock(dev);
 
 	/* we assume this is protected by lock_kernel() in mount/umount */
+	mutex_lock(&yaffs_dev_list_lock);
 	ylist_del(&dev->devList);
+	mutex_unlock(&yaffs_dev_list_lock);
 
 	if (dev->spareBuffer) {
 		YFREE(dev->spareBuffer);
@@ -1930,6 +1949,7 @@ typedef struct {
 	int skip_checkpoint_read;
 	int skip_checkpoint_write;
 	int no_cache;
+	int n_caches;	/* cache=N, 0 if not given */
 	int empty_lost_and_found_overridden;
 	int empty_lost_and_found;
 	int tags_ecc_on;
@@ -1964,6 +1984,11 @@ static int yaffs_parse_options(yaffs_options *options, const char *options_str)
 			options->inband_tags = 1;
 		else if (!strcmp(cur_opt, "no-cache"))
 			options->no_cache = 1;
+		else if (!strncmp(cur_opt, "cache=", 6)) {
+			options->n_caches = simple_strtoul(cur_opt + 6, NULL, 10);
+			if (!options->n_caches)
+				options->no_cache = 1;
+		}
 		else if (!strcmp(cur_opt, "no-checkpoint-read"))
 			options->skip_checkpoint_read = 1;
 		else if (!strcmp(cur_opt, "no-checkpoint-write"))
@@ -2192,7 +2217,12 @@ static struct super_block *yaffs_internal_read_super(int yaffsVersion,
 	dev->nChunksPerBlock = YAFFS_CHUNKS_PER_BLOCK;
 	dev->totalBytesPerChunk = YAFFS_BYTES_PER_CHUNK;
 	dev->nReservedBlocks = 5;
-	dev->nShortOpCaches = (options.no_cache) ? 0 : 10;
+	if (options.no_cache)
+		dev->nShortOpCaches = 0;
+	else if (options.n_caches)
+		dev->nShortOpCaches = options.n_caches;
+	else
+		dev->nShortOpCaches = yaffs_short_op_caches;
 	dev->inbandTags = options.inband_tags;
 #ifdef CONFIG_YAFFS_DOES_TAGS_ECC
 	dev->doesTagsEcc = !options.tags_ecc_off;
@@ -2256,9 +2286,12 @@ static struct super_block *yaffs_internal_read_super(int yaffsVersion,
 
 	dev->skipCheckpointRead = options.skip_checkpoint_read;
 	dev->skipCheckpointWrite = options.skip_checkpoint_write;
+	dev->checkpointMaxLag = yaffs_checkpoint_lag;
 
 	/* we assume this is protected by lock_kernel() in mount/umount */
+	mutex_lock(&yaffs_dev_list_lock);
 	ylist_add_tail(&dev->devList, &yaffs_dev_list);
+	mutex_unlock(&yaffs_dev_list_lock);
 
         /* Directory search handling...*/
         YINIT_LIST_HEAD(&dev->searchContexts);
@@ -2299,7 +2332,9 @@ static struct super_block *yaffs_internal_read_super(int yaffsVersion,
 		return NULL;
 	}
 	sb->s_root = root;
-	sb->s_dirt = !dev->isCheckpointed;
+	/* A restored checkpoint may already be due for a rewrite */
+	if (!dev->isCheckpointed)
+		sb->s_dirt = 1;
 	T(YAFFS_TRACE_ALWAYS,
 	  ("yaffs_read_super: isCheckpointed %d\n", dev->isCheckpointed));
 
@@ -2435,6 +2470,8 @@ static char *yaffs_dump_dev(char *buf, yaffs_Device * dev)
 	buf += sprintf(buf, "tagsEccFixed....... %d\n", dev->tagsEccFixed);
 	buf += sprintf(buf, "tagsEccUnfixed..... %d\n", dev->tagsEccUnfixed);
 	buf += sprintf(buf, "cacheHits.......... %d\n", dev->cacheHits);
+	buf += sprintf(buf, "cachesAllocated.... %d\n", dev->srAllocated);
+	buf += sprintf(buf, "cachesDirty........ %d\n", dev->srDirtyCount);
 	buf += sprintf(buf, "nDeletedFiles...... %d\n", dev->nDeletedFiles);
 	buf += sprintf(buf, "nUnlinkedFiles..... %d\n", dev->nUnlinkedFiles);
 	buf +=
@@ -2634,6 +2671,38 @@ static struct file_system_to_install fs_to_install[] = {
 	{NULL, 0}
 };
 
+/*
+ * Short op cache shrinker.
+ * Clean cache buffers are released when the VM asks; they are
+ * reallocated on demand as the cache refills. A device that is busy
+ * (grossLock held) is simply skipped.
+ */
+static int yaffs_shrink_caches(int nr_to_scan, gfp_t gfp_mask)
+{
+	struct ylist_head *item;
+	yaffs_Device *dev;
+	int nShrinkable = 0;
+
+	mutex_lock(&yaffs_dev_list_lock);
+	ylist_for_each(item, &yaffs_dev_list) {
+		dev = ylist_entry(item, yaffs_Device, devList);
+
+		if (nr_to_scan > 0 && !down_trylock(&dev->grossLock)) {
+			nr_to_scan -= yaffs_ShrinkChunkCache(dev, nr_to_scan);
+			up(&dev->grossLock);
+		}
+		nShrinkable += yaffs_ShrinkableChunkCaches(dev);
+	}
+	mutex_unlock(&yaffs_dev_list_lock);
+
+	return nShrinkable;
+}
+
+static struct shrinker yaffs_cache_shrinker = {
+	.shrink = yaffs_shrink_caches,
+	.seeks = DEFAULT_SEEKS,
+};
+
 static int __init init_yaffs_fs(void)
 {
 	int error = 0;
@@ -2642,6 +2711,11 @@ static int __init init_yaffs_fs(void)
 	T(YAFFS_TRACE_ALWAYS,
 	  ("yaffs " __DATE__ " " __TIME__ " Installing. \n"));
 
+#ifdef CONFIG_YAFFS_ECC_SELFTEST
+	if (yaffs_ECCSelfTest())
+		return -EINVAL;
+#endif
+
 	/* Install the proc_fs entry */
 	my_proc_entry = create_proc_entry("yaffs",
 					       S_IRUGO | S_IFREG,
@@ -2678,6 +2752,9 @@ static int __init init_yaffs_fs(void)
 		}
 	}
 
+	if (!error)
+		register_shrinker(&yaffs_cache_shrinker);
+
 	return error;
 }
 
@@ -2689,6 +2766,8 @@ static void __exit exit_yaffs_fs(void)
 	T(YAFFS_TRACE_ALWAYS, ("yaffs " __DATE__ " " __TIME__
 			       " removing. \n"));
 
+	unregister_shrinker(&yaffs_cache_shrinker);
+
 	remove_proc_entry("yaffs", YPROC_ROOT);
 
 	fsinst = fs_to_install;
@@ -103,6 +103,9 @@ static void yaffs_InvalidateWholeChunkCache(yaffs_Object *in);
 static void yaffs_InvalidateChunkCache(yaffs_Object *object, int chunkId);
 
 static void yaffs_InvalidateCheckpoint(yaffs_Device *dev);
+static void yaffs_AgeCheckpoint(yaffs_Device *dev);
+static int yaffs_ScanSinceCheckpoint(yaffs_Device *dev);
+static int yaffs_CountFreeChunks(yaffs_Device *dev);
 
 static int yaffs_FindChunkInFile(yaffs_Object *in, int chunkInInode,
 				yaffs_ExtendedTags *tags);
@@ -927,8 +930,6 @@ static int yaffs_WriteNewChunkWithTagsToNAND(struct yaffs_DeviceStruct *dev,
 	int writeOk = 0;
 	int chunk;
 
-	yaffs_InvalidateCheckpoint(dev);
-
 	do {
 		yaffs_BlockInfo *bi = 0;
 		int erasedOk = 0;
@@ -1008,6 +1009,9 @@ static int yaffs_WriteNewChunkWithTagsToNAND(struct yaffs_DeviceStruct *dev,
 		dev->nRetriedWrites += (attempts - 1);
 	}
 
+	if (chunk >= 0)
+		yaffs_AgeCheckpoint(dev);
+
 	return chunk;
 }
 
@@ -2742,7 +2746,6 @@ static void yaffs_BlockBecameDirty(yaffs_Device *dev, int blockNo)
 	bi->blockState = YAFFS_BLOCK_STATE_DIRTY;
 
 	if (!bi->needsRetiring) {
-		yaffs_InvalidateCheckpoint(dev);
 		erasedOk = yaffs_EraseBlockInNAND(dev, blockNo);
 		if (!erasedOk) {
 			dev->nErasureFailures++;
@@ -3243,6 +3246,12 @@ static int yaffs_CheckGarbageCollection(yaffs_Device *dev)
 	do {
 		maxTries++;
 
+		if (dev->nErasedBlocks < dev->nReservedBlocks &&
+		    dev->blocksInCheckpoint > 0) {
+			/* Running short, so give the checkpoint blocks back */
+			yaffs_InvalidateCheckpoint(dev);
+		}
+
 		checkpointBlockAdjust = yaffs_CalcCheckpointBlocksRequired(dev) - dev->blocksInCheckpoint;
 		if (checkpointBlockAdjust < 0)
 			checkpointBlockAdjust = 0;
@@ -3855,22 +3864,90 @@ int yaffs_UpdateObjectHeader(yaffs_Object *in, const YCHAR *name, int force,
  *   In Linux, the page cache provides read buffering aand the short op cache provides write
  *   buffering.
  *
- *   There are a limited number (~10) of cache chunks per device so that we don't
- *   need a very intelligent search.
+ *   Workloads such as databases do many sub-chunk writes scattered over a file,
+ *   so the cache can be made much larger than the traditional ~10 chunks.
+ *   Entries are found through a hash on (object, chunkId) and recycled from the
+ *   tail of an LRU list. Chunk buffers are only allocated when the cache needs
+ *   to grow, and clean ones are handed back by yaffs_ShrinkChunkCache() when
+ *   memory gets tight. Dirty entries are kept on srDirty grouped by object and
+ *   in chunkId order so that a flush writes each file's chunks sequentially.
  */
 
+static int yaffs_ChunkCacheHash(const yaffs_Object *obj, int chunkId)
+{
+	return (obj->objectId * 31 + chunkId) &
+		(YAFFS_SHORT_OP_CACHE_BUCKETS - 1);
+}
+
+static void yaffs_MarkChunkCacheDirty(yaffs_Device *dev,
+				      yaffs_ChunkCache *cache)
+{
+	struct ylist_head *i;
+	struct ylist_head *pos = &dev->srDirty;
+	yaffs_ChunkCache *other;
+	int seenObject = 0;
+
+	if (cache->dirty)
+		return;
+
+	/* Insert before the first chunk of this object with a higher
+	 * chunkId, or just after the object's last dirty chunk.
+	 */
+	ylist_for_each(i, &dev->srDirty) {
+		other = ylist_entry(i, yaffs_ChunkCache, dirtyLink);
+		if (other->object == cache->object) {
+			seenObject = 1;
+			if (other->chunkId > cache->chunkId) {
+				pos = i;
+				break;
+			}
+		} else if (seenObject) {
+			pos = i;
+			break;
+		}
+	}
+
+	ylist_add_tail(&cache->dirtyLink, pos);
+	cache->dirty = 1;
+	dev->srDirtyCount++;
+}
+
+static void yaffs_MarkChunkCacheClean(yaffs_Device *dev,
+				      yaffs_ChunkCache *cache)
+{
+	if (cache->dirty) {
+		ylist_del_init(&cache->dirtyLink);
+		cache->dirty = 0;
+		dev->srDirtyCount--;
+	}
+}
+
+/* Drop whatever the entry holds and make it the first to be reused. */
+static void yaffs_ReleaseChunkCache(yaffs_Device *dev, yaffs_ChunkCache *cache)
+{
+	yaffs_MarkChunkCacheClean(dev, cache);
+
+	if (cache->object) {
+		ylist_del_init(&cache->hashLink);
+		cache->object = NULL;
+	}
+
+	ylist_del(&cache->lruLink);
+	ylist_add_tail(&cache->lruLink, &dev->srLru);
+}
+
 static int yaffs_ObjectHasCachedWriteData(yaffs_Object *obj)
 {
 	yaffs_Device *dev = obj->myDev;
-	int i;
+	struct ylist_head *i;
 	yaffs_ChunkCache *cache;
-	int nCaches = obj->myDev->nShortOpCaches;
 
-	for (i = 0; i < nCaches; i++) {
-		cache = &dev->srCache[i];
-		if (cache->object == obj &&
-		    cache->dirty)
-			return 1;
+	if (dev->nShortOpCaches > 0) {
+		ylist_for_each(i, &dev->srDirty) {
+			cache = ylist_entry(i, yaffs_ChunkCache, dirtyLink);
+			if (cache->object == obj)
+				return 1;
+		}
 	}
 
 	return 0;
@@ -3880,52 +3957,48 @@ static int yaffs_ObjectHasCachedWriteData(yaffs_Object *obj)
 static void yaffs_FlushFilesChunkCache(yaffs_Object *obj)
 {
 	yaffs_Device *dev = obj->myDev;
-	int lowest = -99;	/* Stop compiler whining. */
-	int i;
+	struct ylist_head *i;
+	struct ylist_head *n;
 	yaffs_ChunkCache *cache;
-	int chunkWritten = 0;
-	int nCaches = obj->myDev->nShortOpCaches;
+	int chunkWritten = 1;
+	int seenObject = 0;
 
-	if (nCaches > 0) {
-		do {
-			cache = NULL;
-
-			/* Find the dirty cache for this object with the lowest chunk id. */
-			for (i = 0; i < nCaches; i++) {
-				if (dev->srCache[i].object == obj &&
-				    dev->srCache[i].dirty) {
-					if (!cache
-					    || dev->srCache[i].chunkId <
-					    lowest) {
-						cache = &dev->srCache[i];
-						lowest = cache->chunkId;
-					}
-				}
-			}
+	if (dev->nShortOpCaches <= 0)
+		return;
 
-			if (cache && !cache->locked) {
-				/* Write it out and free it up */
+	/* The object's dirty chunks are adjacent on srDirty and already in
+	 * chunkId order. Written chunks stay cached, but clean.
+	 */
+	ylist_for_each_safe(i, n, &dev->srDirty) {
+		cache = ylist_entry(i, yaffs_ChunkCache, dirtyLink);
 
-				chunkWritten =
-				    yaffs_WriteChunkDataToObject(cache->object,
-								 cache->chunkId,
-								 cache->data,
-								 cache->nBytes,
-								 1);
-				cache->dirty = 0;
-				cache->object = NULL;
-			}
+		if (cache->object != obj) {
+			if (seenObject)
+				break;
+			continue;
+		}
+		seenObject = 1;
 
-		} while (cache && chunkWritten > 0);
+		if (cache->locked)
+			break;
 
-		if (cache) {
-			/* Hoosterman, disk full while writing cache out. */
-			T(YAFFS_TRACE_ERROR,
-			  (TSTR("yaffs tragedy: no space during cache write" TENDSTR)));
+		chunkWritten = yaffs_WriteChunkDataToObject(cache->object,
+							    cache->chunkId,
+							    cache->data,
+							    cache->nBytes,
+							    1);
+		if (chunkWritten <= 0)
+			break;
 
-		}
+		yaffs_MarkChunkCacheClean(dev, cache);
 	}
 
+	if (chunkWritten <= 0) {
+		/* Hoosterman, disk full while writing cache out. */
+		T(YAFFS_TRACE_ERROR,
+		  (TSTR("yaffs tragedy: no space during cache write" TENDSTR)));
+
+	}
 }
 
 /*yaffs_FlushEntireDeviceCache(dev)
@@ -3935,97 +4008,100 @@ static void yaffs_FlushFilesChunkCache(yaffs_Object *obj)
 
 void yaffs_FlushEntireDeviceCache(yaffs_Device *dev)
 {
-	yaffs_Object *obj;
-	int nCaches = dev->nShortOpCaches;
-	int i;
-
-	/* Find a dirty object in the cache and flush it...
-	 * until there are no further dirty objects.
-	 */
-	do {
-		obj = NULL;
-		for (i = 0; i < nCaches && !obj; i++) {
-			if (dev->srCache[i].object &&
-			    dev->srCache[i].dirty)
-				obj = dev->srCache[i].object;
-
-		}
-		if (obj)
-			yaffs_FlushFilesChunkCache(obj);
-
-	} while (obj);
+	yaffs_ChunkCache *cache;
+	int nDirty;
 
-}
+	if (dev->nShortOpCaches <= 0)
+		return;
 
+	/* Flush the object owning the first dirty chunk...
+	 * until there are no further dirty objects, or no progress is made.
+	 */
+	while (!ylist_empty(&dev->srDirty)) {
+		cache = ylist_entry(dev->srDirty.next, yaffs_ChunkCache,
+				    dirtyLink);
+		nDirty = dev->srDirtyCount;
 
-/* Grab us a cache chunk for use.
- * First look for an empty one.
- * Then look for the least recently used non-dirty one.
- * Then look for the least recently used dirty one...., flush and look again.
- */
-static yaffs_ChunkCache *yaffs_GrabChunkCacheWorker(yaffs_Device *dev)
-{
-	int i;
+		yaffs_FlushFilesChunkCache(cache->object);
 
-	if (dev->nShortOpCaches > 0) {
-		for (i = 0; i < dev->nShortOpCaches; i++) {
-			if (!dev->srCache[i].object)
-				return &dev->srCache[i];
-		}
+		if (dev->srDirtyCount == nDirty)
+			break;
 	}
 
-	return NULL;
 }
 
-static yaffs_ChunkCache *yaffs_GrabChunkCache(yaffs_Device *dev)
+/* Give an empty entry a buffer and put it on the LRU. */
+static yaffs_ChunkCache *yaffs_PopulateChunkCache(yaffs_Device *dev)
 {
 	yaffs_ChunkCache *cache;
-	yaffs_Object *theObj;
-	int usage;
-	int i;
-	int pushout;
 
-	if (dev->nShortOpCaches > 0) {
-		/* Try find a non-dirty one... */
+	if (ylist_empty(&dev->srEmpty))
+		return NULL;
 
-		cache = yaffs_GrabChunkCacheWorker(dev);
+	cache = ylist_entry(dev->srEmpty.next, yaffs_ChunkCache, lruLink);
+	cache->data = YMALLOC_DMA(dev->totalBytesPerChunk);
+	if (!cache->data)
+		return NULL;
 
-		if (!cache) {
-			/* They were all dirty, find the last recently used object and flush
-			 * its cache, then  find again.
-			 * NB what's here is not very accurate, we actually flush the object
-			 * the last recently used page.
-			 */
+	ylist_del(&cache->lruLink);
+	ylist_add_tail(&cache->lruLink, &dev->srLru);
+	dev->srAllocated++;
+
+	return cache;
+}
+
+/* Grab us a cache chunk for (obj, chunkId).
+ * First look for a released one at the tail of the LRU.
+ * Then grow the cache if we are allowed to and can get the memory.
+ * Then take the least recently used one, flushing its object if it is dirty.
+ */
+static yaffs_ChunkCache *yaffs_GrabChunkCache(yaffs_Object *obj, int chunkId)
+{
+	yaffs_Device *dev = obj->myDev;
+	yaffs_ChunkCache *cache = NULL;
+	struct ylist_head *i;
 
-			/* With locking we can't assume we can use entry zero */
+	if (dev->nShortOpCaches <= 0)
+		return NULL;
 
-			theObj = NULL;
-			usage = -1;
+	if (!ylist_empty(&dev->srLru)) {
+		cache = ylist_entry(dev->srLru.prev, yaffs_ChunkCache, lruLink);
+		if (cache->object)
 			cache = NULL;
-			pushout = -1;
+	}
 
-			for (i = 0; i < dev->nShortOpCaches; i++) {
-				if (dev->srCache[i].object &&
-				    !dev->srCache[i].locked &&
-				    (dev->srCache[i].lastUse < usage || !cache)) {
-					usage = dev->srCache[i].lastUse;
-					theObj = dev->srCache[i].object;
-					cache = &dev->srCache[i];
-					pushout = i;
-				}
-			}
+	if (!cache)
+		cache = yaffs_PopulateChunkCache(dev);
 
-			if (!cache || cache->dirty) {
-				/* Flush and try again */
-				yaffs_FlushFilesChunkCache(theObj);
-				cache = yaffs_GrabChunkCacheWorker(dev);
-			}
+	if (!cache) {
+		/* With locking we can't assume we can use the tail entry */
+		for (i = dev->srLru.prev; i != &dev->srLru; i = i->prev) {
+			cache = ylist_entry(i, yaffs_ChunkCache, lruLink);
+			if (!cache->locked)
+				break;
+			cache = NULL;
+		}
 
+		if (cache && cache->dirty) {
+			yaffs_FlushFilesChunkCache(cache->object);
+			if (cache->dirty)
+				cache = NULL;
 		}
-		return cache;
-	} else
-		return NULL;
+	}
+
+	if (cache) {
+		yaffs_ReleaseChunkCache(dev, cache);
+		cache->object = obj;
+		cache->chunkId = chunkId;
+		cache->locked = 0;
+		cache->nBytes = 0;
+		ylist_add(&cache->hashLink,
+			  &dev->srHash[yaffs_ChunkCacheHash(obj, chunkId)]);
+		ylist_del(&cache->lruLink);
+		ylist_add(&cache->lruLink, &dev->srLru);
+	}
 
+	return cache;
 }
 
 /* Find a cached chunk */
@@ -4033,14 +4109,17 @@ static yaffs_ChunkCache *yaffs_FindChunkCache(const yaffs_Object *obj,
 					      int chunkId)
 {
 	yaffs_Device *dev = obj->myDev;
-	int i;
+	struct ylist_head *i;
+	yaffs_ChunkCache *cache;
+
 	if (dev->nShortOpCaches > 0) {
-		for (i = 0; i < dev->nShortOpCaches; i++) {
-			if (dev->srCache[i].object == obj &&
-			    dev->srCache[i].chunkId == chunkId) {
+		ylist_for_each(i, &dev->srHash[yaffs_ChunkCacheHash(obj, chunkId)]) {
+			cache = ylist_entry(i, yaffs_ChunkCache, hashLink);
+			if (cache->object == obj &&
+			    cache->chunkId == chunkId) {
 				dev->cacheHits++;
 
-				return &dev->srCache[i];
+				return cache;
 			}
 		}
 	}
@@ -4053,21 +4132,11 @@ static void yaffs_UseChunkCache(yaffs_Device *dev, yaffs_ChunkCache *cache,
 {
 
 	if (dev->nShortOpCaches > 0) {
-		if (dev->srLastUse < 0 || dev->srLastUse > 100000000) {
-			/* Reset the cache usages */
-			int i;
-			for (i = 1; i < dev->nShortOpCaches; i++)
-				dev->srCache[i].lastUse = 0;
-
-			dev->srLastUse = 0;
-		}
-
-		dev->srLastUse++;
-
-		cache->lastUse = dev->srLastUse;
+		ylist_del(&cache->lruLink);
+		ylist_add(&cache->lruLink, &dev->srLru);
 
 		if (isAWrite)
-			cache->dirty = 1;
+			yaffs_MarkChunkCacheDirty(dev, cache);
 	}
 }
 
@@ -4081,7 +4150,7 @@ static void yaffs_InvalidateChunkCache(yaffs_Object *object, int chunkId)
 		yaffs_ChunkCache *cache = yaffs_FindChunkCache(object, chunkId);
 
 		if (cache)
-			cache->object = NULL;
+			yaffs_ReleaseChunkCache(object->myDev, cache);
 	}
 }
 
@@ -4097,9 +4166,57 @@ static void yaffs_InvalidateWholeChunkCache(yaffs_Object *in)
 		/* Invalidate it. */
 		for (i = 0; i < dev->nShortOpCaches; i++) {
 			if (dev->srCache[i].object == in)
-				dev->srCache[i].object = NULL;
+				yaffs_ReleaseChunkCache(dev, &dev->srCache[i]);
+		}
+	}
+}
+
+/* Hand the buffers of up to nToRelease clean entries back to the system,
+ * least recently used first. Called with the device locked when memory is
+ * short. Returns the number released.
+ */
+int yaffs_ShrinkChunkCache(yaffs_Device *dev, int nToRelease)
+{
+	struct ylist_head *i;
+	struct ylist_head *prev;
+	yaffs_ChunkCache *cache;
+	int nReleased = 0;
+
+	if (!dev->srCache)
+		return 0;
+
+	for (i = dev->srLru.prev;
+	     i != &dev->srLru && nReleased < nToRelease &&
+	     dev->srAllocated > YAFFS_MIN_SHORT_OP_CACHES;
+	     i = prev) {
+		prev = i->prev;
+		cache = ylist_entry(i, yaffs_ChunkCache, lruLink);
+
+		if (cache->dirty || cache->locked)
+			continue;
+
+		if (cache->object) {
+			ylist_del_init(&cache->hashLink);
+			cache->object = NULL;
 		}
+
+		YFREE(cache->data);
+		cache->data = NULL;
+		ylist_del(&cache->lruLink);
+		ylist_add(&cache->lruLink, &dev->srEmpty);
+		dev->srAllocated--;
+		nReleased++;
 	}
+
+	return nReleased;
+}
+
+/* Estimate of what yaffs_ShrinkChunkCache() could release right now. */
+int yaffs_ShrinkableChunkCaches(yaffs_Device *dev)
+{
+	int n = dev->srAllocated - dev->srDirtyCount - YAFFS_MIN_SHORT_OP_CACHES;
+
+	return (n > 0) ? n : 0;
 }
 
 /*--------------------- Checkpointing --------------------*/
@@ -4630,6 +4747,24 @@ static void yaffs_InvalidateCheckpoint(yaffs_Device *dev)
 	}
 }
 
+/*
+ * Called after every chunk write. The checkpoint stays valid (mount replays
+ * what was written since, see yaffs_ScanSinceCheckpoint()) but once it is
+ * checkpointMaxLag blocks behind we ask for a new one at the next sync.
+ */
+static void yaffs_AgeCheckpoint(yaffs_Device *dev)
+{
+	if (!dev->isCheckpointed)
+		return;
+
+	dev->checkpointStale = 1;
+
+	if (dev->sequenceNumber - dev->checkpointSequence >=
+	    dev->checkpointMaxLag &&
+	    dev->superBlock && dev->markSuperBlockDirty)
+		dev->markSuperBlockDirty(dev->superBlock);
+}
+
 
 int yaffs_CheckpointSave(yaffs_Device *dev)
 {
@@ -4640,9 +4775,12 @@ int yaffs_CheckpointSave(yaffs_Device *dev)
 	yaffs_VerifyBlocks(dev);
 	yaffs_VerifyFreeChunks(dev);
 
-	if (!dev->isCheckpointed) {
+	if (!dev->isCheckpointed || dev->checkpointStale) {
 		yaffs_InvalidateCheckpoint(dev);
-		yaffs_WriteCheckpointData(dev);
+		if (yaffs_WriteCheckpointData(dev)) {
+			dev->checkpointSequence = dev->sequenceNumber;
+			dev->checkpointStale = 0;
+		}
 	}
 
 	T(YAFFS_TRACE_ALWAYS, (TSTR("save exit: isCheckpointed %d"TENDSTR), dev->isCheckpointed));
@@ -4650,6 +4788,21 @@ int yaffs_CheckpointSave(yaffs_Device *dev)
 	return dev->isCheckpointed;
 }
 
+/*
+ * Called on sync. Unlike yaffs_CheckpointSave(), which unmount uses, a
+ * checkpoint that is less than checkpointMaxLag blocks behind is kept:
+ * mount catches up on the few blocks written since.
+ */
+int yaffs_CheckpointSync(yaffs_Device *dev)
+{
+	if (dev->isCheckpointed && dev->checkpointStale &&
+	    dev->sequenceNumber - dev->checkpointSequence <
+	    dev->checkpointMaxLag)
+		return 1;
+
+	return yaffs_CheckpointSave(dev);
+}
+
 int yaffs_CheckpointRestore(yaffs_Device *dev)
 {
 	int retval;
@@ -4657,6 +4810,13 @@ int yaffs_CheckpointRestore(yaffs_Device *dev)
 
 	retval = yaffs_ReadCheckpointData(dev);
 
+	if (retval && !yaffs_ScanSinceCheckpoint(dev)) {
+		T(YAFFS_TRACE_ALWAYS,
+		  (TSTR("yaffs: checkpoint catch-up failed, full scan" TENDSTR)));
+		dev->isCheckpointed = 0;
+		retval = 0;
+	}
+
 	if (dev->isCheckpointed) {
 		yaffs_VerifyObjects(dev);
 		yaffs_VerifyBlocks(dev);
@@ -4719,15 +4879,10 @@ int yaffs_ReadDataFromFile(yaffs_Object *in, __u8 *buffer, loff_t offset,
 				/* If we can't find the data in the cache, then load it up. */
 
 				if (!cache) {
-					cache = yaffs_GrabChunkCache(in->myDev);
-					cache->object = in;
-					cache->chunkId = chunk;
-					cache->dirty = 0;
-					cache->locked = 0;
+					cache = yaffs_GrabChunkCache(in, chunk);
 					yaffs_ReadChunkDataFromObject(in, chunk,
 								      cache->
 								      data);
-					cache->nBytes = 0;
 				}
 
 				yaffs_UseChunkCache(dev, cache, 0);
@@ -4849,14 +5004,10 @@ int yaffs_WriteDataToFile(yaffs_Object *in, const __u8 *buffer, loff_t offset,
 				if (!cache
 				    && yaffs_CheckSpaceForAllocation(in->
 								     myDev)) {
-					cache = yaffs_GrabChunkCache(in->myDev);
-					cache->object = in;
-					cache->chunkId = chunk;
-					cache->dirty = 0;
-					cache->locked = 0;
-					yaffs_ReadChunkDataFromObject(in, chunk,
-								      cache->
-								      data);
+					cache = yaffs_GrabChunkCache(in, chunk);
+					if (cache)
+						yaffs_ReadChunkDataFromObject(in,
+							chunk, cache->data);
 				} else if (cache &&
 					!cache->dirty &&
 					!yaffs_CheckSpaceForAllocation(in->myDev)) {
@@ -4885,7 +5036,8 @@ int yaffs_WriteDataToFile(yaffs_Object *in, const __u8 *buffer, loff_t offset,
 						     cache->chunkId,
 						     cache->data, cache->nBytes,
 						     1);
-						cache->dirty = 0;
+						yaffs_MarkChunkCacheClean(dev,
+									  cache);
 					}
 
 				} else {
@@ -5434,6 +5586,28 @@ static int ybicmp(const void *a, const void *b)
 		return aseq - bseq;
 }
 
+static void yaffs_SortBlockIndex(yaffs_BlockIndex *blockIndex, int nBlocks)
+{
+#ifndef CONFIG_YAFFS_USE_OWN_SORT
+	/* Use qsort now. */
+	yaffs_qsort(blockIndex, nBlocks, sizeof(yaffs_BlockIndex), ybicmp);
+#else
+	/* Dungy old bubble sort... */
+
+	yaffs_BlockIndex temp;
+	int i;
+	int j;
+
+	for (i = 0; i < nBlocks; i++)
+		for (j = i + 1; j < nBlocks; j++)
+			if (blockIndex[i].seq > blockIndex[j].seq) {
+				temp = blockIndex[j];
+				blockIndex[j] = blockIndex[i];
+				blockIndex[i] = temp;
+			}
+#endif
+}
+
 
 struct yaffs_ShadowFixerStruct {
 	int objectId;
@@ -6215,28 +6389,7 @@ static int yaffs_ScanBackwards(yaffs_Device *dev)
 	YYIELD();
 
 	/* Sort the blocks */
-#ifndef CONFIG_YAFFS_USE_OWN_SORT
-	{
-		/* Use qsort now. */
-		yaffs_qsort(blockIndex, nBlocksToScan, sizeof(yaffs_BlockIndex), ybicmp);
-	}
-#else
-	{
-		/* Dungy old bubble sort... */
-
-		yaffs_BlockIndex temp;
-		int i;
-		int j;
-
-		for (i = 0; i < nBlocksToScan; i++)
-			for (j = i + 1; j < nBlocksToScan; j++)
-				if (blockIndex[i].seq > blockIndex[j].seq) {
-					temp = blockIndex[j];
-					blockIndex[j] = blockIndex[i];
-					blockIndex[i] = temp;
-				}
-	}
-#endif
+	yaffs_SortBlockIndex(blockIndex, nBlocksToScan);
 
 	YYIELD();
 
@@ -6750,6 +6903,519 @@ static int yaffs_ScanBackwards(yaffs_Device *dev)
 	return YAFFS_OK;
 }
 
+/*------------------------------  Checkpoint catch-up ----------------------------- */
+
+/*
+ * The checkpoint is no longer thrown away on the first write. Everything
+ * written after it lands either in the tail of the checkpoint's allocation
+ * block or in blocks with a higher sequence number, and YAFFS2 never changes
+ * a chunk once written, so those chunks are the log of what happened since.
+ * At mount we restore the checkpoint and replay just that log, oldest first,
+ * instead of scanning the whole device.
+ *
+ * Blocks that the garbage collector erased (and maybe reused) since the
+ * checkpoint are found by reading the first tags of each block. References
+ * the checkpoint holds into those blocks are dropped before the replay: any
+ * chunk that was still live was copied forward and is picked up again from
+ * the log.
+ *
+ * Anything unexpected makes us give up, and the caller falls back to a full
+ * yaffs_ScanBackwards().
+ */
+
+static int yaffs_ChunkIsStale(yaffs_Device *dev, int chunk)
+{
+	int blk = chunk / dev->nChunksPerBlock;
+	yaffs_BlockInfo *bi;
+
+	if (blk < dev->internalStartBlock || blk > dev->internalEndBlock)
+		return 1;
+
+	bi = yaffs_GetBlockInfo(dev, blk);
+
+	/* Only blocks that changed since the checkpoint are in these states
+	 * before the replay starts.
+	 */
+	return (bi->blockState == YAFFS_BLOCK_STATE_EMPTY ||
+		bi->blockState == YAFFS_BLOCK_STATE_NEEDS_SCANNING);
+}
+
+static void yaffs_DropStaleChunksWorker(yaffs_Object *in, yaffs_Tnode *tn,
+					__u32 level)
+{
+	yaffs_Device *dev = in->myDev;
+	int i;
+	int theChunk;
+
+	if (!tn)
+		return;
+
+	if (level > 0) {
+		for (i = 0; i < YAFFS_NTNODES_INTERNAL; i++)
+			if (tn->internal[i])
+				yaffs_DropStaleChunksWorker(in,
+							tn->internal[i],
+							level - 1);
+	} else {
+		for (i = 0; i < YAFFS_NTNODES_LEVEL0; i++) {
+			theChunk = yaffs_GetChunkGroupBase(dev, tn, i);
+			if (theChunk && yaffs_ChunkIsStale(dev, theChunk)) {
+				yaffs_PutLevel0Tnode(dev, tn, i, 0);
+				in->nDataChunks--;
+			}
+		}
+	}
+}
+
+static void yaffs_DropStaleReferences(yaffs_Device *dev)
+{
+	yaffs_Object *obj;
+	struct ylist_head *lh;
+	int i;
+
+	for (i = 0; i < YAFFS_NOBJECT_BUCKETS; i++) {
+		ylist_for_each(lh, &dev->objectBucket[i].list) {
+			if (lh) {
+				obj = ylist_entry(lh, yaffs_Object, hashLink);
+
+				if (obj->hdrChunk > 0 &&
+				    yaffs_ChunkIsStale(dev, obj->hdrChunk))
+					obj->hdrChunk = 0;
+
+				if (obj->variantType == YAFFS_OBJECT_TYPE_FILE)
+					yaffs_DropStaleChunksWorker(obj,
+						obj->variant.fileVariant.top,
+						obj->variant.fileVariant.topLevel);
+			}
+		}
+	}
+}
+
+static int yaffs_ReplayObjectHeader(yaffs_Device *dev, int chunk,
+				const yaffs_ExtendedTags *tags,
+				const yaffs_ObjectHeader *oh,
+				yaffs_Object **hardList)
+{
+	yaffs_BlockInfo *bi = yaffs_GetBlockInfo(dev,
+					chunk / dev->nChunksPerBlock);
+	yaffs_Object *in;
+	yaffs_Object *parent;
+	yaffs_Object *shadowed;
+	int firstHeader;
+	int itsUnlinked;
+	int isShrink;
+	__u32 fileSize;
+
+	in = yaffs_FindObjectByNumber(dev, tags->objectId);
+
+	if (in && in->variantType != oh->type) {
+		T(YAFFS_TRACE_CHECKPOINT,
+		  (TSTR("catch-up: object %d changed type %d -> %d" TENDSTR),
+		   tags->objectId, in->variantType, oh->type));
+		return YAFFS_FAIL;
+	}
+
+	if (in && in->unlinked &&
+	    oh->parentObjectId != YAFFS_OBJECTID_UNLINKED &&
+	    oh->parentObjectId != YAFFS_OBJECTID_DELETED) {
+		/* The objectId was reused after a deletion. */
+		T(YAFFS_TRACE_CHECKPOINT,
+		  (TSTR("catch-up: object %d reused" TENDSTR),
+		   tags->objectId));
+		return YAFFS_FAIL;
+	}
+
+	if (!in)
+		in = yaffs_FindOrCreateObjectByNumber(dev, tags->objectId,
+						      oh->type);
+	if (!in)
+		return YAFFS_FAIL;
+
+	/* A rename over an existing object. Normally the victim's own
+	 * unlink header follows, but we might have lost power before that.
+	 */
+	if (oh->shadowsObject > 0) {
+		shadowed = yaffs_FindObjectByNumber(dev, oh->shadowsObject);
+		if (shadowed && shadowed != in && !shadowed->unlinked)
+			yaffs_AddObjectToDirectory(dev->unlinkedDir, shadowed);
+	}
+
+	firstHeader = (in->hdrChunk <= 0);
+
+	if (in->hdrChunk > 0)
+		yaffs_DeleteChunk(dev, in->hdrChunk, 1, __LINE__);
+
+	in->hdrChunk = chunk;
+	in->serial = tags->serialNumber;
+	in->valid = 1;
+	in->lazyLoaded = 0;
+	in->dirty = 0;
+
+	in->yst_mode = oh->yst_mode;
+#ifdef CONFIG_YAFFS_WINCE
+	in->win_atime[0] = oh->win_atime[0];
+	in->win_ctime[0] = oh->win_ctime[0];
+	in->win_mtime[0] = oh->win_mtime[0];
+	in->win_atime[1] = oh->win_atime[1];
+	in->win_ctime[1] = oh->win_ctime[1];
+	in->win_mtime[1] = oh->win_mtime[1];
+#else
+	in->yst_uid = oh->yst_uid;
+	in->yst_gid = oh->yst_gid;
+	in->yst_atime = oh->yst_atime;
+	in->yst_mtime = oh->yst_mtime;
+	in->yst_ctime = oh->yst_ctime;
+	in->yst_rdev = oh->yst_rdev;
+#endif
+
+	if (tags->objectId == YAFFS_OBJECTID_ROOT ||
+	    tags->objectId == YAFFS_OBJECTID_LOSTNFOUND) {
+		/* We only load some info, don't fiddle with directory structure */
+		return YAFFS_OK;
+	}
+
+	yaffs_SetObjectName(in, oh->name);
+
+	parent = yaffs_FindOrCreateObjectByNumber(dev, oh->parentObjectId,
+						YAFFS_OBJECT_TYPE_DIRECTORY);
+	if (!parent)
+		return YAFFS_FAIL;
+
+	if (parent->variantType == YAFFS_OBJECT_TYPE_UNKNOWN) {
+		/* Set up as a directory */
+		parent->variantType = YAFFS_OBJECT_TYPE_DIRECTORY;
+		YINIT_LIST_HEAD(&parent->variant.directoryVariant.children);
+	} else if (parent->variantType != YAFFS_OBJECT_TYPE_DIRECTORY) {
+		T(YAFFS_TRACE_ERROR,
+		  (TSTR
+		   ("yaffs tragedy: attempting to use non-directory as a directory in catch-up. Put in lost+found."
+		    TENDSTR)));
+		parent = dev->lostNFoundDir;
+	}
+
+	if (in->parent != parent)
+		yaffs_AddObjectToDirectory(parent, in);
+
+	itsUnlinked = (parent == dev->deletedDir) ||
+		      (parent == dev->unlinkedDir);
+
+	switch (in->variantType) {
+	case YAFFS_OBJECT_TYPE_FILE:
+		fileSize = oh->fileSize;
+		isShrink = oh->isShrink;
+
+		/* Unlinked at this point also means deleted */
+		if (itsUnlinked) {
+			fileSize = 0;
+			isShrink = 1;
+		}
+
+		if (isShrink) {
+			if (in->variant.fileVariant.fileSize > fileSize)
+				yaffs_PruneResizedChunks(in, fileSize);
+			in->variant.fileVariant.fileSize = fileSize;
+			bi->hasShrinkHeader = 1;
+		} else if (in->variant.fileVariant.fileSize < fileSize) {
+			in->variant.fileVariant.fileSize = fileSize;
+		}
+		break;
+	case YAFFS_OBJECT_TYPE_HARDLINK:
+		if (firstHeader && !itsUnlinked) {
+			in->variant.hardLinkVariant.equivalentObjectId =
+				oh->equivalentObjectId;
+			in->hardLinks.next = (struct ylist_head *) *hardList;
+			*hardList = in;
+		}
+		break;
+	case YAFFS_OBJECT_TYPE_SYMLINK:
+		if (in->variant.symLinkVariant.alias)
+			YFREE(in->variant.symLinkVariant.alias);
+		in->variant.symLinkVariant.alias =
+			yaffs_CloneString(oh->alias);
+		if (!in->variant.symLinkVariant.alias)
+			return YAFFS_FAIL;
+		break;
+	default:
+		break;
+	}
+
+	return YAFFS_OK;
+}
+
+static int yaffs_ScanSinceCheckpoint(yaffs_Device *dev)
+{
+	yaffs_ExtendedTags tags;
+	yaffs_BlockIndex *blockIndex = NULL;
+	int altBlockIndex = 0;
+	yaffs_BlockInfo *bi;
+	yaffs_BlockState state;
+	__u32 sequenceNumber;
+	__u32 baseSequence = dev->sequenceNumber;
+	int baseBlock = dev->allocationBlock;
+	int basePage = dev->allocationPage;
+	int nBlocks = dev->internalEndBlock - dev->internalStartBlock + 1;
+	int nBlocksToScan = 0;
+	int nChanged = 0;
+	int nReplayed = 0;
+	int blockIterator;
+	int blk;
+	int c;
+	int chunk;
+	int startPage;
+	int lastUsed;
+	unsigned int endpos;
+	yaffs_Object *in;
+	yaffs_Object *hardList = NULL;
+	yaffs_ObjectHeader *oh;
+	struct ylist_head *lh;
+	__u8 *chunkData;
+	int ok = 1;
+	int i;
+
+	dev->checkpointSequence = baseSequence;
+	dev->checkpointStale = 0;
+
+	if (dev->chunkGroupBits) {
+		/* Can't tell stale references apart without reading tags. */
+		T(YAFFS_TRACE_CHECKPOINT,
+		  (TSTR("catch-up: not supported with chunk groups" TENDSTR)));
+		return YAFFS_FAIL;
+	}
+
+	blockIndex = YMALLOC(nBlocks * sizeof(yaffs_BlockIndex));
+
+	if (!blockIndex) {
+		blockIndex = YMALLOC_ALT(nBlocks * sizeof(yaffs_BlockIndex));
+		altBlockIndex = 1;
+	}
+
+	if (!blockIndex)
+		return YAFFS_FAIL;
+
+	/* Find the blocks erased or written since the checkpoint */
+	for (blk = dev->internalStartBlock;
+	     ok && blk <= dev->internalEndBlock; blk++) {
+		bi = yaffs_GetBlockInfo(dev, blk);
+
+		if (bi->blockState == YAFFS_BLOCK_STATE_CHECKPOINT ||
+		    bi->blockState == YAFFS_BLOCK_STATE_DEAD)
+			continue;
+
+		yaffs_QueryInitialBlockState(dev, blk, &state, &sequenceNumber);
+
+		if (state == YAFFS_BLOCK_STATE_DEAD ||
+		    sequenceNumber == YAFFS_SEQUENCE_CHECKPOINT_DATA ||
+		    sequenceNumber == YAFFS_SEQUENCE_BAD_BLOCK) {
+			T(YAFFS_TRACE_CHECKPOINT,
+			  (TSTR("catch-up: block %d unexpected state %d seq %x" TENDSTR),
+			   blk, state, sequenceNumber));
+			ok = 0;
+		} else if (state == YAFFS_BLOCK_STATE_EMPTY) {
+			if (bi->blockState == YAFFS_BLOCK_STATE_EMPTY)
+				continue;
+		} else if (sequenceNumber > baseSequence &&
+			   sequenceNumber < YAFFS_HIGHEST_SEQUENCE_NUMBER) {
+			blockIndex[nBlocksToScan].seq = sequenceNumber;
+			blockIndex[nBlocksToScan].block = blk;
+			nBlocksToScan++;
+		} else if (sequenceNumber == bi->sequenceNumber &&
+			   bi->blockState != YAFFS_BLOCK_STATE_EMPTY) {
+			/* Untouched since the checkpoint */
+			continue;
+		} else {
+			T(YAFFS_TRACE_CHECKPOINT,
+			  (TSTR("catch-up: block %d seq %x, checkpoint had %x" TENDSTR),
+			   blk, sequenceNumber, bi->sequenceNumber));
+			ok = 0;
+		}
+
+		if (!ok)
+			break;
+
+		nChanged++;
+		yaffs_ClearChunkBits(dev, blk);
+		bi->blockState = state;
+		bi->sequenceNumber = sequenceNumber;
+		bi->pagesInUse = 0;
+		bi->softDeletions = 0;
+		bi->hasShrinkHeader = 0;
+		bi->gcPrioritise = 0;
+		bi->needsRetiring = 0;
+		bi->skipErasedCheck = 0;
+	}
+
+	if (baseBlock >= 0 &&
+	    yaffs_GetBlockInfo(dev, baseBlock)->blockState !=
+	    YAFFS_BLOCK_STATE_ALLOCATING)
+		baseBlock = -1;
+
+	T(YAFFS_TRACE_CHECKPOINT,
+	  (TSTR("catch-up: %d blocks changed, %d to replay, base seq %d" TENDSTR),
+	   nChanged, nBlocksToScan, baseSequence));
+
+	if (ok && nChanged > 0)
+		yaffs_DropStaleReferences(dev);
+
+	yaffs_SortBlockIndex(blockIndex, nBlocksToScan);
+
+	chunkData = yaffs_GetTempBuffer(dev, __LINE__);
+
+	dev->allocationBlock = -1;
+	dev->allocationPage = 0;
+
+	/* Replay oldest first: the rest of the checkpoint's allocation block,
+	 * then the newer blocks in sequence order.
+	 */
+	for (blockIterator = (baseBlock >= 0) ? -1 : 0;
+	     ok && blockIterator < nBlocksToScan; blockIterator++) {
+		YYIELD();
+
+		if (blockIterator < 0) {
+			blk = baseBlock;
+			startPage = basePage;
+		} else {
+			blk = blockIndex[blockIterator].block;
+			startPage = 0;
+		}
+
+		bi = yaffs_GetBlockInfo(dev, blk);
+		lastUsed = startPage - 1;
+
+		for (c = startPage; ok && c < dev->nChunksPerBlock; c++) {
+			chunk = blk * dev->nChunksPerBlock + c;
+
+			yaffs_ReadChunkWithTagsFromNAND(dev, chunk, NULL, &tags);
+
+			if (!tags.chunkUsed)
+				continue;
+
+			lastUsed = c;
+
+			if (tags.eccResult == YAFFS_ECC_RESULT_UNFIXED) {
+				T(YAFFS_TRACE_SCAN,
+				  (TSTR(" Unfixed ECC in chunk(%d:%d), chunk ignored"TENDSTR),
+				  blk, c));
+				continue;
+			}
+
+			nReplayed++;
+			yaffs_SetChunkBit(dev, blk, c);
+			bi->pagesInUse++;
+
+			if (tags.chunkId > 0) {
+				in = yaffs_FindOrCreateObjectByNumber(dev,
+							tags.objectId,
+							YAFFS_OBJECT_TYPE_FILE);
+				if (!in ||
+				    !yaffs_PutChunkIntoFile(in, tags.chunkId,
+							   chunk, 1)) {
+					ok = 0;
+				} else if (in->variantType ==
+					   YAFFS_OBJECT_TYPE_FILE) {
+					endpos = (tags.chunkId - 1) *
+						 dev->nDataBytesPerChunk +
+						 tags.byteCount;
+					if (in->variant.fileVariant.fileSize <
+					    endpos)
+						in->variant.fileVariant.fileSize =
+							endpos;
+				}
+			} else {
+				yaffs_ReadChunkWithTagsFromNAND(dev, chunk,
+								chunkData,
+								NULL);
+				oh = (yaffs_ObjectHeader *) chunkData;
+
+				if (dev->inbandTags) {
+					/* Fix up the header if they got corrupted by inband tags */
+					oh->shadowsObject = oh->inbandShadowsObject;
+					oh->isShrink = oh->inbandIsShrink;
+				}
+
+				ok = yaffs_ReplayObjectHeader(dev, chunk,
+							&tags, oh,
+							&hardList);
+			}
+		}
+
+		if (lastUsed == dev->nChunksPerBlock - 1) {
+			bi->blockState = YAFFS_BLOCK_STATE_FULL;
+		} else if (blockIterator == nBlocksToScan - 1) {
+			/* this is the block being allocated from */
+			bi->blockState = YAFFS_BLOCK_STATE_ALLOCATING;
+			dev->allocationBlock = blk;
+			dev->allocationPage = lastUsed + 1;
+			dev->allocationBlockFinder = blk;
+		} else {
+			/* A partially written block that is not the current
+			 * allocation block must have had a write failure.
+			 */
+			bi->blockState = YAFFS_BLOCK_STATE_FULL;
+			bi->gcPrioritise = 1;
+			T(YAFFS_TRACE_ALWAYS,
+			  (TSTR("Partially written block %d detected" TENDSTR),
+			  blk));
+		}
+	}
+
+	yaffs_ReleaseTempBuffer(dev, chunkData, __LINE__);
+
+	if (ok)
+		yaffs_HardlinkFixup(dev, hardList);
+
+	/* Every real object must have ended up with a header. */
+	for (i = 0; ok && i < YAFFS_NOBJECT_BUCKETS; i++) {
+		ylist_for_each(lh, &dev->objectBucket[i].list) {
+			in = ylist_entry(lh, yaffs_Object, hashLink);
+			if (!in->fake && in->hdrChunk <= 0) {
+				T(YAFFS_TRACE_CHECKPOINT,
+				  (TSTR("catch-up: object %d has no header" TENDSTR),
+				   in->objectId));
+				ok = 0;
+				break;
+			}
+		}
+	}
+
+	if (ok) {
+		for (i = 0; i < nBlocksToScan; i++) {
+			blk = blockIndex[i].block;
+			bi = yaffs_GetBlockInfo(dev, blk);
+			if (bi->pagesInUse == 0 &&
+			    !bi->hasShrinkHeader &&
+			    bi->blockState == YAFFS_BLOCK_STATE_FULL)
+				yaffs_BlockBecameDirty(dev, blk);
+		}
+
+		if (nBlocksToScan > 0)
+			dev->sequenceNumber = blockIndex[nBlocksToScan - 1].seq;
+		dev->oldestDirtySequence = 0;
+
+		dev->nErasedBlocks = 0;
+		for (blk = dev->internalStartBlock;
+		     blk <= dev->internalEndBlock; blk++)
+			if (yaffs_GetBlockInfo(dev, blk)->blockState ==
+			    YAFFS_BLOCK_STATE_EMPTY)
+				dev->nErasedBlocks++;
+		dev->nFreeChunks = yaffs_CountFreeChunks(dev);
+
+		/* The checkpoint stays as the base until it is rewritten. */
+		if (nChanged > 0 || nReplayed > 0)
+			yaffs_AgeCheckpoint(dev);
+	}
+
+	if (altBlockIndex)
+		YFREE_ALT(blockIndex);
+	else
+		YFREE(blockIndex);
+
+	T(YAFFS_TRACE_CHECKPOINT,
+	  (TSTR("catch-up: replayed %d chunks, ok %d" TENDSTR),
+	   nReplayed, ok));
+
+	return ok ? YAFFS_OK : YAFFS_FAIL;
+}
+
 /*------------------------------  Directory Functions ----------------------------- */
 
 static void yaffs_VerifyObjectInDirectory(yaffs_Object *obj)
@@ -7461,32 +8127,47 @@ int yaffs_GutsInitialise(yaffs_Device *dev)
 	dev->gcCleanupList = NULL;
 
 
+	dev->srAllocated = 0;
+	dev->srDirtyCount = 0;
+	YINIT_LIST_HEAD(&dev->srLru);
+	YINIT_LIST_HEAD(&dev->srEmpty);
+	YINIT_LIST_HEAD(&dev->srDirty);
+
 	if (!init_failed &&
 	    dev->nShortOpCaches > 0) {
 		int i;
-		void *buf;
-		int srCacheBytes = dev->nShortOpCaches * sizeof(yaffs_ChunkCache);
+		int srCacheBytes;
 
 		if (dev->nShortOpCaches > YAFFS_MAX_SHORT_OP_CACHES)
 			dev->nShortOpCaches = YAFFS_MAX_SHORT_OP_CACHES;
 
+		srCacheBytes = dev->nShortOpCaches * sizeof(yaffs_ChunkCache);
 		dev->srCache =  YMALLOC(srCacheBytes);
 
-		buf = (__u8 *) dev->srCache;
-
-		if (dev->srCache)
+		if (dev->srCache) {
 			memset(dev->srCache, 0, srCacheBytes);
 
-		for (i = 0; i < dev->nShortOpCaches && buf; i++) {
-			dev->srCache[i].object = NULL;
-			dev->srCache[i].lastUse = 0;
-			dev->srCache[i].dirty = 0;
-			dev->srCache[i].data = buf = YMALLOC_DMA(dev->totalBytesPerChunk);
-		}
-		if (!buf)
-			init_failed = 1;
+			for (i = 0; i < YAFFS_SHORT_OP_CACHE_BUCKETS; i++)
+				YINIT_LIST_HEAD(&dev->srHash[i]);
+
+			for (i = 0; i < dev->nShortOpCaches; i++) {
+				YINIT_LIST_HEAD(&dev->srCache[i].hashLink);
+				YINIT_LIST_HEAD(&dev->srCache[i].dirtyLink);
+				ylist_add_tail(&dev->srCache[i].lruLink,
+					       &dev->srEmpty);
+			}
 
-		dev->srLastUse = 0;
+			/* The rest of the buffers are allocated on demand. */
+			while (dev->srAllocated < dev->nShortOpCaches &&
+			       dev->srAllocated < YAFFS_MIN_SHORT_OP_CACHES &&
+			       yaffs_PopulateChunkCache(dev))
+				;
+
+			if (dev->srAllocated < dev->nShortOpCaches &&
+			    dev->srAllocated < YAFFS_MIN_SHORT_OP_CACHES)
+				init_failed = 1;
+		} else
+			init_failed = 1;
 	}
 
 	dev->cacheHits = 0;
@@ -7656,7 +8337,6 @@ int yaffs_GetNumberOfFreeChunks(yaffs_Device *dev)
 	int nFree;
 	int nDirtyCacheChunks;
 	int blocksForCheckpoint;
-	int i;
 
 #if 1
 	nFree = dev->nFreeChunks;
@@ -7668,10 +8348,7 @@ int yaffs_GetNumberOfFreeChunks(yaffs_Device *dev)
 
 	/* Now count the number of dirty chunks in the cache and subtract those */
 
-	for (nDirtyCacheChunks = 0, i = 0; i < dev->nShortOpCaches; i++) {
-		if (dev->srCache[i].dirty)
-			nDirtyCacheChunks++;
-	}
+	nDirtyCacheChunks = dev->srDirtyCount;
 
 	nFree -= nDirtyCacheChunks;
 
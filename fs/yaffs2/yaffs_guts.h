@@ -63,7 +63,7 @@
 
 #define YAFFS_OBJECT_SPACE		0x40000
 
-#define YAFFS_CHECKPOINT_VERSION 	3
+#define YAFFS_CHECKPOINT_VERSION 	4
 
 #ifdef CONFIG_YAFFS_UNICODE
 #define YAFFS_MAX_NAME_LENGTH		127
@@ -88,7 +88,9 @@
 
 /* */
 
-#define YAFFS_MAX_SHORT_OP_CACHES	20
+#define YAFFS_MAX_SHORT_OP_CACHES	256
+#define YAFFS_MIN_SHORT_OP_CACHES	4	/* Never shrunk below this */
+#define YAFFS_SHORT_OP_CACHE_BUCKETS	64	/* Must be a power of 2 */
 
 #define YAFFS_N_TEMP_BUFFERS		6
 
@@ -113,9 +115,11 @@
 
 /* ChunkCache is used for short read/write operations.*/
 typedef struct {
+	struct ylist_head hashLink;	/* Hash chain, while object is set */
+	struct ylist_head lruLink;	/* srLru if data is allocated, else srEmpty */
+	struct ylist_head dirtyLink;	/* srDirty, grouped by object in chunkId order */
 	struct yaffs_ObjectStruct *object;
 	int chunkId;
-	int lastUse;
 	int dirty;
 	int nBytes;		/* Only valid if the cache is dirty */
 	int locked;		/* Can't push out or flush while locked. */
@@ -553,7 +557,9 @@ struct yaffs_DeviceStruct {
 
 
 	int nShortOpCaches;	/* If <= 0, then short op caching is disabled, else
-				 * the number of short op caches (don't use too many)
+				 * the most short op caches that may be allocated.
+				 * Buffers are allocated on demand and released
+				 * again under memory pressure.
 				 */
 
 	int useHeaderFileSize;	/* Flag to determine if we should use file sizes from the header */
@@ -614,6 +620,9 @@ struct yaffs_DeviceStruct {
 	/* Checkpoint control. Can be set before or after initialisation */
 	__u8 skipCheckpointRead;
 	__u8 skipCheckpointWrite;
+	__u32 checkpointMaxLag;	/* Blocks written since the checkpoint before we
+				 * ask for a new one. 0 rewrites it on every sync.
+				 */
 
 	/* Runtime parameters. Set up by YAFFS. */
 
@@ -653,6 +662,8 @@ struct yaffs_DeviceStruct {
 	int isMounted;
 
 	int isCheckpointed;
+	__u32 checkpointSequence;	/* sequenceNumber when the checkpoint was taken */
+	int checkpointStale;		/* Written to since the checkpoint was taken */
 
 
 	/* Stuff to support block offsetting to support start block zero */
@@ -752,7 +763,12 @@ struct yaffs_DeviceStruct {
 	int doingBufferedBlockRewrite;
 
 	yaffs_ChunkCache *srCache;
-	int srLastUse;
+	struct ylist_head srHash[YAFFS_SHORT_OP_CACHE_BUCKETS];
+	struct ylist_head srLru;	/* Entries with a buffer, most recently used first */
+	struct ylist_head srEmpty;	/* Entries whose buffer was released or never allocated */
+	struct ylist_head srDirty;	/* Dirty entries, in flush order */
+	int srAllocated;	/* Entries on srLru */
+	int srDirtyCount;
 
 	int cacheHits;
 
@@ -855,8 +871,11 @@ int yaffs_FlushFile(yaffs_Object *obj, int updateTime);
 
 /* Flushing and checkpointing */
 void yaffs_FlushEntireDeviceCache(yaffs_Device *dev);
+int yaffs_ShrinkChunkCache(yaffs_Device *dev, int nToRelease);
+int yaffs_ShrinkableChunkCaches(yaffs_Device *dev);
 
 int yaffs_CheckpointSave(yaffs_Device *dev);
+int yaffs_CheckpointSync(yaffs_Device *dev);
 int yaffs_CheckpointRestore(yaffs_Device *dev);
 
 /* Directory operations */
@@ -247,6 +247,7 @@ extern bool printk_timed_ratelimit(unsigned long *caller_jiffies,
 				   unsigned int interval_msec);
 
 extern int printk_delay_msec;
+extern int printk_deferred;
 
 /*
  * Print a one-time message (analogous to WARN_ONCE() et al):
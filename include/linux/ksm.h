@@ -51,6 +51,31 @@ static inline void page_add_ksm_rmap(struct page *page)
 		__inc_zone_page_state(page, NR_ANON_PAGES);
 	}
 }
+
+extern atomic_long_t ksm_pages_zero;
+
+/*
+ * KSM maps zero-filled pages to the zero page with a dirty pte, which
+ * tells them apart from the zero page mapped on a read fault.
+ */
+static inline int is_ksm_zero_pte(pte_t pte)
+{
+	return pte_pfn(pte) == page_to_pfn(ZERO_PAGE(0)) && pte_dirty(pte);
+}
+
+/* A present pte mapping the zero page is copied on fork. */
+static inline void ksm_map_zero_pte(pte_t pte)
+{
+	if (is_ksm_zero_pte(pte))
+		atomic_long_inc(&ksm_pages_zero);
+}
+
+/* A present pte mapping the zero page is zapped or replaced. */
+static inline void ksm_unmap_zero_pte(pte_t pte)
+{
+	if (is_ksm_zero_pte(pte))
+		atomic_long_dec(&ksm_pages_zero);
+}
 #else  /* !CONFIG_KSM */
 
 static inline int ksm_madvise(struct vm_area_struct *vma, unsigned long start,
@@ -73,6 +98,14 @@ static inline int PageKsm(struct page *page)
 	return 0;
 }
 
+static inline void ksm_map_zero_pte(pte_t pte)
+{
+}
+
+static inline void ksm_unmap_zero_pte(pte_t pte)
+{
+}
+
 /* No stub required for page_add_ksm_rmap(page) */
 #endif /* !CONFIG_KSM */
 
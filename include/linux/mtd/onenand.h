@@ -69,6 +69,8 @@ struct onenand_bufferram {
  * @writesize:		[INTERN] a real page size
  * @bufferram_index:	[INTERN] BufferRAM index
  * @bufferram:		[INTERN] BufferRAM info
+ * @read_next:		[INTERN] offset the last page read ended at
+ * @prefetch:		[INTERN] offset of the page being read ahead, or -1
  * @readw:		[REPLACEABLE] hardware specific function for read short
  * @writew:		[REPLACEABLE] hardware specific function for write short
  * @command:		[REPLACEABLE] hardware specific function for writing
@@ -117,6 +119,8 @@ struct onenand_chip {
 
 	unsigned int		bufferram_index;
 	struct onenand_bufferram	bufferram[MAX_BUFFERRAM];
+	loff_t			read_next;
+	loff_t			prefetch;
 
 	int (*command)(struct mtd_info *mtd, int cmd, loff_t address, size_t len);
 	int (*wait)(struct mtd_info *mtd, int state);
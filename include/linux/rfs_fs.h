@@ -77,6 +77,7 @@
 #define DENTRY_SIZE_BITS       5
 #define MAX_ROOT_DENTRY                511     /* 0 ~ 511 */
 #define MAX_DIR_DENTRY         65536
+#define DIR_CACHE_MAX_DENTRY   8192    /* larger dirs are not cached */
 
 #define SECTOR_SIZE             512
 #define SECTOR_BITS             9
@@ -345,6 +346,36 @@ struct rfs_ext_entry {
        u16     uni_11_12[2];           /* unicode 11 ~ 12 */
 } __attribute__ ((packed));
 
+/*
+ * decoded dir entry kept in the directory cache (INCORE)
+ */
+struct rfs_dir_cache_entry {
+       u32     hash;                   /* hash of the extend slots */
+       u32     name_off;               /* decoded name in cache->names */
+       u16     index;                  /* index of the short name entry */
+       u8      type;                   /* TYPE_FILE or TYPE_DIR */
+       u8      nr_ext;                 /* the number of extend slots */
+       u8      dosname[DOS_NAME_LENGTH];
+};
+
+/*
+ * decoded entries and block map of a directory (INCORE)
+ */
+struct rfs_dir_cache {
+       unsigned int    nr_ents;        /* entries sorted by index */
+       unsigned int    max_ents;
+       struct rfs_dir_cache_entry *ents;
+
+       unsigned int    names_len;      /* decoded names for readdir */
+       unsigned int    names_max;
+       unsigned int    names_dead;     /* bytes of removed entries */
+       char            *names;
+
+       unsigned int    base_off;       /* offset of entry 0 in blocks[0] */
+       unsigned int    nr_blocks;
+       unsigned long   blocks[0];      /* device block of each dir block */
+};
+
 /* 
  * hint info for fast unlink (DISK/INCORE) 
  */
@@ -402,6 +433,7 @@ int rfs_iunique (struct inode *, unsigned int, unsigned long *);
 int fill_inode (struct inode *, struct rfs_dir_entry *, unsigned int, unsigned int);
 struct inode *rfs_new_inode (struct inode *, struct dentry *, unsigned int);
 void rfs_delete_inode (struct inode *);
+void rfs_clear_inode (struct inode *);
 int rfs_delete_entry (struct inode *, struct inode *);
 #if LINUX_VERSION_CODE >= KERNEL_VERSION(2, 6, 0)
 int rfs_write_inode (struct inode *, int);
@@ -431,6 +463,7 @@ int rfs_sync_vol(struct super_block *);
 int extend_with_zerofill (struct inode *, unsigned int, unsigned int); 
 int rfs_setattr (struct dentry *, struct iattr *);
 int rfs_bmap (struct inode *, long, unsigned long *);
+int rfs_bmap_blocks (struct inode *, long, unsigned long *, unsigned int);
 #if LINUX_VERSION_CODE >= KERNEL_VERSION(2, 6, 0)
 int rfs_get_block (struct inode *, sector_t, struct buffer_head *, int);
 #if LINUX_VERSION_CODE >= KERNEL_VERSION(2, 6, 27)
@@ -472,11 +505,18 @@ struct rfs_dir_entry *get_entry_with_cluster (struct super_block *, unsigned int
 int find_entry_short (struct inode *, const char *, struct buffer_head **, unsigned int);
 int find_entry_long (struct inode *, const char *, struct buffer_head **, unsigned int); 
 int remove_entry (struct inode *, unsigned int, struct buffer_head **);
+struct rfs_dir_cache *rfs_dir_cache_get (struct inode *);
+struct rfs_dir_cache_entry *rfs_dir_cache_next (struct rfs_dir_cache *, unsigned int);
+int rfs_dir_cache_block (struct inode *, long, unsigned long *);
+void rfs_dir_cache_add (struct inode *, unsigned int);
+void rfs_dir_cache_del (struct inode *, unsigned int);
+void rfs_dir_cache_invalidate (struct inode *);
 
 /* cluster.c */
 int fat_read (struct super_block *, unsigned int, unsigned int *);
 int fat_write (struct super_block *, unsigned int, unsigned int);
 int alloc_cluster (struct inode *, unsigned int *);
+int alloc_contig_cluster (struct inode *, unsigned int *);
 int rfs_map_destroy (struct super_block *);
 int free_chain (struct inode *, unsigned int, unsigned int, unsigned int *);
 int count_num_clusters (struct inode *);
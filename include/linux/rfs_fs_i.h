@@ -42,6 +42,8 @@ struct fast_seek_info {
 };
 #endif
 
+struct rfs_dir_cache;
+
 struct rfs_inode_info {
        __u32   start_clu;      /* start cluster of inode */
        __u32   p_start_clu;    /* parent directory start cluster */
@@ -69,6 +71,9 @@ struct rfs_inode_info {
        /* hint for quick search */
        __u32   hint_last_clu;
        __u32   hint_last_offset;
+
+       /* decoded entries of a directory (see dos.c) */
+       struct rfs_dir_cache    *dir_cache;
        
        /* truncate point */
        unsigned long   trunc_start;
@@ -0,0 +1,53 @@
+#ifndef _SENSOR_POLL_H
+#define _SENSOR_POLL_H
+
+/*
+ * Shared polling service for slow sensors (accelerometer, light, compass)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by
+ * the Free Software Foundation.
+ */
+
+#include <linux/list.h>
+#include <linux/ktime.h>
+
+/**
+ * struct sensor_poll_client - a sensor sampled by the shared poller
+ * @name: name shown in the statistics
+ * @poll: driver-supplied method that reads the sensor and posts input
+ *	events (mandatory). It runs in process context and may sleep.
+ *	@stamp is the time of the tick, the same for every client
+ *	sampled in that tick.
+ * @interval: requested sampling interval in msec
+ * @private: private driver data
+ *
+ * All active clients are sampled from one worker. The shortest active
+ * interval becomes the common tick and every other interval is rounded
+ * to a multiple of it, so the CPU wakes once per tick and the I2C reads
+ * of all due sensors are issued back to back.
+ */
+struct sensor_poll_client {
+	const char *name;
+	void (*poll)(struct sensor_poll_client *client, ktime_t stamp);
+	unsigned int interval;
+	void *private;
+
+	/* private to sensor-poll.c */
+	struct list_head node;
+	unsigned int period;		/* in ticks */
+	unsigned int countdown;
+	unsigned long samples;
+};
+
+void sensor_poll_start(struct sensor_poll_client *client);
+void sensor_poll_stop(struct sensor_poll_client *client);
+void sensor_poll_set_interval(struct sensor_poll_client *client,
+			      unsigned int interval);
+
+static inline int sensor_poll_active(struct sensor_poll_client *client)
+{
+	return client->period != 0;
+}
+
+#endif
@@ -0,0 +1,148 @@
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM cpufreq_interactive
+
+#if !defined(_TRACE_CPUFREQ_INTERACTIVE_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _TRACE_CPUFREQ_INTERACTIVE_H
+
+#include <linux/tracepoint.h>
+
+/*
+ * A load evaluation that gets as far as picking a frequency ends in one of
+ * the first three events, which tell why that frequency was (or was not)
+ * requested:
+ *
+ *   target   - a new target frequency was chosen and queued
+ *   notyet   - a change was wanted but held back by above_hispeed_delay
+ *              or by the min_sample_time floor
+ *   already  - the chosen frequency equals the current target
+ *
+ * Evaluations that stop earlier trace nothing: the governor was stopped,
+ * the timer raced with idle exit, the sample was shorter than 1 ms, or
+ * the frequency table lookup failed.  The other two events do not come
+ * from the load evaluation:
+ *
+ *   setspeed - the speed change thread applied a target to the hardware
+ *   boost    - an input event or boostpulse raised the floor to hispeed
+ */
+TRACE_EVENT(cpufreq_interactive_target,
+
+	TP_PROTO(unsigned int cpu, unsigned int load,
+		 unsigned int curtarg, unsigned int targ),
+
+	TP_ARGS(cpu, load, curtarg, targ),
+
+	TP_STRUCT__entry(
+		__field(	unsigned int,	cpu		)
+		__field(	unsigned int,	load		)
+		__field(	unsigned int,	curtarg		)
+		__field(	unsigned int,	targ		)
+	),
+
+	TP_fast_assign(
+		__entry->cpu = cpu;
+		__entry->load = load;
+		__entry->curtarg = curtarg;
+		__entry->targ = targ;
+	),
+
+	TP_printk("cpu=%u load=%u cur=%u targ=%u",
+		  __entry->cpu, __entry->load, __entry->curtarg,
+		  __entry->targ)
+);
+
+TRACE_EVENT(cpufreq_interactive_notyet,
+
+	TP_PROTO(unsigned int cpu, unsigned int load,
+		 unsigned int curtarg, unsigned int targ),
+
+	TP_ARGS(cpu, load, curtarg, targ),
+
+	TP_STRUCT__entry(
+		__field(	unsigned int,	cpu		)
+		__field(	unsigned int,	load		)
+		__field(	unsigned int,	curtarg		)
+		__field(	unsigned int,	targ		)
+	),
+
+	TP_fast_assign(
+		__entry->cpu = cpu;
+		__entry->load = load;
+		__entry->curtarg = curtarg;
+		__entry->targ = targ;
+	),
+
+	TP_printk("cpu=%u load=%u cur=%u targ=%u",
+		  __entry->cpu, __entry->load, __entry->curtarg,
+		  __entry->targ)
+);
+
+TRACE_EVENT(cpufreq_interactive_already,
+
+	TP_PROTO(unsigned int cpu, unsigned int load,
+		 unsigned int curtarg, unsigned int targ),
+
+	TP_ARGS(cpu, load, curtarg, targ),
+
+	TP_STRUCT__entry(
+		__field(	unsigned int,	cpu		)
+		__field(	unsigned int,	load		)
+		__field(	unsigned int,	curtarg		)
+		__field(	unsigned int,	targ		)
+	),
+
+	TP_fast_assign(
+		__entry->cpu = cpu;
+		__entry->load = load;
+		__entry->curtarg = curtarg;
+		__entry->targ = targ;
+	),
+
+	TP_printk("cpu=%u load=%u cur=%u targ=%u",
+		  __entry->cpu, __entry->load, __entry->curtarg,
+		  __entry->targ)
+);
+
+TRACE_EVENT(cpufreq_interactive_setspeed,
+
+	TP_PROTO(unsigned int cpu, unsigned int targfreq,
+		 unsigned int actualfreq),
+
+	TP_ARGS(cpu, targfreq, actualfreq),
+
+	TP_STRUCT__entry(
+		__field(	unsigned int,	cpu		)
+		__field(	unsigned int,	targfreq	)
+		__field(	unsigned int,	actualfreq	)
+	),
+
+	TP_fast_assign(
+		__entry->cpu = cpu;
+		__entry->targfreq = targfreq;
+		__entry->actualfreq = actualfreq;
+	),
+
+	TP_printk("cpu=%u targ=%u actual=%u",
+		  __entry->cpu, __entry->targfreq, __entry->actualfreq)
+);
+
+TRACE_EVENT(cpufreq_interactive_boost,
+
+	TP_PROTO(const char *source),
+
+	TP_ARGS(source),
+
+	TP_STRUCT__entry(
+		__string(	source,		source		)
+	),
+
+	TP_fast_assign(
+		__assign_str(source, source);
+	),
+
+	TP_printk("%s", __get_str(source))
+);
+
+#endif /* _TRACE_CPUFREQ_INTERACTIVE_H */
+
+/* This part must be outside protection */
+#include <trace/define_trace.h>
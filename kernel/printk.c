@@ -33,6 +33,7 @@
 #include <linux/bootmem.h>
 #include <linux/syscalls.h>
 #include <linux/kexec.h>
+#include <linux/kthread.h>
 
 #include <asm/uaccess.h>
 
@@ -137,6 +138,24 @@ EXPORT_SYMBOL(console_set_on_cmdline);
 /* Flag: console code may call schedule() */
 static int console_may_schedule;
 
+/* Work left for printk_tick() */
+#define PRINTK_PENDING_WAKEUP	0x01	/* wake up syslog readers */
+#define PRINTK_PENDING_CONSOLE	0x02	/* wake up the console thread */
+
+static DEFINE_PER_CPU(int, printk_pending);
+
+#ifdef CONFIG_PRINTK_DEFERRED_CONSOLE
+/*
+ * With the deferred console, printk() only stores into log_buf and the
+ * console thread writes it to the consoles later.  printk_deferred is
+ * the kernel.printk_deferred sysctl.
+ */
+int printk_deferred = 1;
+static struct task_struct *console_thread;
+static DECLARE_WAIT_QUEUE_HEAD(console_thread_wait);
+static int console_thread_pending;
+#endif
+
 #ifdef CONFIG_PRINTK
 
 static char __log_buf[__LOG_BUF_LEN];
@@ -711,6 +730,51 @@ static int acquire_console_semaphore_for_printk(unsigned int cpu)
 	spin_unlock(&logbuf_lock);
 	return retval;
 }
+#ifdef CONFIG_PRINTK_DEFERRED_CONSOLE
+/*
+ * Leave the console to the console thread, unless this is an emergency
+ * (KERN_CRIT or worse, an oops or a panic) or the system is booting or
+ * going down, when the message has to be out before printk() returns.
+ */
+static inline int printk_defer_console(int log_level)
+{
+	return printk_deferred && console_thread && !oops_in_progress &&
+		log_level > 2 && system_state == SYSTEM_RUNNING;
+}
+
+/*
+ * We failed to get console_sem during an oops or a panic.  Whoever holds
+ * it - the console thread in the middle of a line, or a task preempted
+ * or stopped with it held - may never get to release it, so print the
+ * backlog ourselves, as bust_spinlocks() does for the console drivers.
+ * Not for a console suspended for PM, whose hardware may be off, and
+ * not when console output is synchronous anyway.
+ */
+static void console_thread_oops_flush(void)
+{
+	unsigned _con_start, _log_end;
+
+	if (!oops_in_progress || !printk_deferred || console_suspended)
+		return;
+
+	spin_lock(&logbuf_lock);
+	_con_start = con_start;
+	_log_end = log_end;
+	con_start = log_end;
+	spin_unlock(&logbuf_lock);
+	call_console_drivers(_con_start, _log_end);
+}
+#else
+static inline int printk_defer_console(int log_level)
+{
+	return 0;
+}
+
+static inline void console_thread_oops_flush(void)
+{
+}
+#endif
+
 static const char recursion_bug_msg [] =
 		KERN_CRIT "BUG: recent printk recursion!\n";
 static int recursion_bug;
@@ -851,9 +915,18 @@ asmlinkage int vprintk(const char *fmt, va_list args)
 	 * The acquire_console_semaphore_for_printk() function
 	 * will release 'logbuf_lock' regardless of whether it
 	 * actually gets the semaphore or not.
+	 *
+	 * With the deferred console the next timer tick wakes
+	 * up the console thread instead.
 	 */
-	if (acquire_console_semaphore_for_printk(this_cpu))
+	if (printk_defer_console(current_log_level)) {
+		printk_cpu = UINT_MAX;
+		spin_unlock(&logbuf_lock);
+		__raw_get_cpu_var(printk_pending) |= PRINTK_PENDING_CONSOLE;
+	} else if (acquire_console_semaphore_for_printk(this_cpu))
 		release_console_sem();
+	else
+		console_thread_oops_flush();
 
 	lockdep_on();
 out_restore_irqs:
@@ -1017,6 +1090,11 @@ void suspend_console(void)
 	if (!console_suspend_enabled)
 		return;
 	printk("Suspending console(s) (use no_console_suspend to debug)\n");
+#ifdef CONFIG_PRINTK_DEFERRED_CONSOLE
+	/* write out what the console thread has not got to yet */
+	acquire_console_sem();
+	release_console_sem();
+#endif
 	acquire_console_sem();
 	console_suspended = 1;
 	up(&console_sem);
@@ -1069,13 +1147,20 @@ int is_console_locked(void)
 	return console_locked;
 }
 
-static DEFINE_PER_CPU(int, printk_pending);
-
 void printk_tick(void)
 {
-	if (__get_cpu_var(printk_pending)) {
+	int pending = __get_cpu_var(printk_pending);
+
+	if (pending) {
 		__get_cpu_var(printk_pending) = 0;
-		wake_up_interruptible(&log_wait);
+#ifdef CONFIG_PRINTK_DEFERRED_CONSOLE
+		if (pending & PRINTK_PENDING_CONSOLE) {
+			console_thread_pending = 1;
+			wake_up(&console_thread_wait);
+		}
+#endif
+		if (pending & PRINTK_PENDING_WAKEUP)
+			wake_up_interruptible(&log_wait);
 	}
 }
 
@@ -1087,7 +1172,7 @@ int printk_needs_cpu(int cpu)
 void wake_up_klogd(void)
 {
 	if (waitqueue_active(&log_wait))
-		__raw_get_cpu_var(printk_pending) = 1;
+		__raw_get_cpu_var(printk_pending) |= PRINTK_PENDING_WAKEUP;
 }
 
 /**
@@ -1139,6 +1224,91 @@ void release_console_sem(void)
 }
 EXPORT_SYMBOL(release_console_sem);
 
+#ifdef CONFIG_PRINTK_DEFERRED_CONSOLE
+/*
+ * release_console_sem() for the console thread: the drivers are called
+ * one line at a time, with interrupts off only while a line is written,
+ * as the drivers expect from printk().  console_sem is only held, with
+ * preemption off, for the same line, so that an oops or a KERN_CRIT
+ * message never finds it taken by a preempted console thread.
+ * If someone else holds console_sem, their release_console_sem() prints
+ * the rest of the backlog and the thread has nothing to do.
+ */
+static void console_thread_flush(void)
+{
+	unsigned long flags;
+	unsigned _con_start, _log_end;
+	unsigned wake_klogd = 0;
+
+	for ( ; ; ) {
+		preempt_disable();
+		if (try_acquire_console_sem()) {
+			preempt_enable();
+			break;
+		}
+
+		spin_lock_irqsave(&logbuf_lock, flags);
+		wake_klogd |= log_start - log_end;
+		if (con_start == log_end) {
+			spin_unlock_irqrestore(&logbuf_lock, flags);
+			console_locked = 0;
+			up(&console_sem);
+			preempt_enable();
+			break;			/* Nothing to print */
+		}
+		_con_start = con_start;
+		_log_end = con_start;
+		while (_log_end != log_end)
+			if (LOG_BUF(_log_end++) == '\n')
+				break;
+		con_start = _log_end;
+		spin_unlock(&logbuf_lock);
+		stop_critical_timings();	/* don't trace print latency */
+		call_console_drivers(_con_start, _log_end);
+		start_critical_timings();
+		local_irq_restore(flags);
+
+		console_locked = 0;
+		up(&console_sem);
+		preempt_enable();
+		cond_resched();
+	}
+	if (wake_klogd)
+		wake_up_klogd();
+}
+
+static int console_thread_fn(void *unused)
+{
+	set_user_nice(current, 10);
+
+	for ( ; ; ) {
+		wait_event_interruptible(console_thread_wait,
+					 console_thread_pending);
+		console_thread_pending = 0;
+
+		/* with the console suspended, resume_console() prints it */
+		console_thread_flush();
+	}
+
+	return 0;
+}
+
+static int __init console_thread_init(void)
+{
+	struct task_struct *p;
+
+	p = kthread_run(console_thread_fn, NULL, "kconsoled");
+	if (IS_ERR(p)) {
+		printk(KERN_ERR "printk: cannot start console thread, "
+		       "console output stays synchronous\n");
+		return PTR_ERR(p);
+	}
+	console_thread = p;
+	return 0;
+}
+core_initcall(console_thread_init);
+#endif
+
 /**
  * console_conditional_schedule - yield the CPU if required
  *
@@ -0,0 +1,113 @@
+/*
+ * printk() latency test module
+ *
+ * Times a series of printk() calls, once with interrupts enabled and once
+ * with them disabled as a driver logging from a critical section would,
+ * and prints a histogram of how long the calls took.  Run it with the
+ * console synchronous and deferred to compare:
+ *
+ *	sysctl -w kernel.printk_deferred=0
+ *	modprobe printk_latency_test
+ *	sysctl -w kernel.printk_deferred=1
+ *	modprobe printk_latency_test
+ *
+ * modprobe reports the load as failed with -EAGAIN: the module has done
+ * its job by then and is not kept loaded.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2
+ * of the License.
+ */
+
+#include <linux/delay.h>
+#include <linux/hrtimer.h>
+#include <linux/irqflags.h>
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/moduleparam.h>
+
+static unsigned int count = 200;
+module_param(count, uint, S_IRUGO);
+MODULE_PARM_DESC(count, "Number of printk() calls per run");
+
+static unsigned int interval = 10;
+module_param(interval, uint, S_IRUGO);
+MODULE_PARM_DESC(interval, "Delay between calls in msec");
+
+/* bucket i counts calls that took less than 2^i usec, the last the rest */
+#define NR_BUCKETS	18
+
+struct printk_hist {
+	unsigned long bucket[NR_BUCKETS];
+	u64 sum;
+	unsigned int max;
+};
+
+static struct printk_hist on, off;
+
+static void hist_add(struct printk_hist *h, unsigned int us)
+{
+	int i = 0;
+
+	while (i < NR_BUCKETS - 1 && us >= (1U << i))
+		i++;
+	h->bucket[i]++;
+	h->sum += us;
+	if (us > h->max)
+		h->max = us;
+}
+
+static void hist_print(const char *name, struct printk_hist *h)
+{
+	int i;
+
+	printk(KERN_WARNING "printk latency, %s: avg %llu us, max %u us\n",
+	       name, (unsigned long long)div_u64(h->sum, count), h->max);
+	for (i = 0; i < NR_BUCKETS; i++) {
+		if (!h->bucket[i])
+			continue;
+		if (i < NR_BUCKETS - 1)
+			printk(KERN_WARNING "  < %6u us: %lu\n",
+			       1U << i, h->bucket[i]);
+		else
+			printk(KERN_WARNING "  >=%6u us: %lu\n",
+			       1U << (i - 1), h->bucket[i]);
+	}
+}
+
+static void printk_latency_run(struct printk_hist *h, int irqs_off)
+{
+	unsigned long flags = 0;
+	unsigned int i;
+	ktime_t t0;
+
+	for (i = 0; i < count; i++) {
+		if (irqs_off)
+			local_irq_save(flags);
+		t0 = ktime_get();
+		printk(KERN_INFO "printk latency test %u/%u, a line about "
+		       "as long as a typical driver message\n", i + 1, count);
+		hist_add(h, ktime_us_delta(ktime_get(), t0));
+		if (irqs_off)
+			local_irq_restore(flags);
+		msleep(interval);
+	}
+}
+
+static int __init printk_latency_init(void)
+{
+	if (!count)
+		return -EINVAL;
+
+	printk_latency_run(&on, 0);
+	printk_latency_run(&off, 1);
+
+	hist_print("irqs on", &on);
+	hist_print("irqs off", &off);
+	return -EAGAIN;
+}
+
+module_init(printk_latency_init);
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("printk() latency test");
@@ -471,10 +471,14 @@ int add_to_page_cache_lru(struct page *page, struct address_space *mapping,
 
 	ret = add_to_page_cache(page, mapping, offset, gfp_mask);
 	if (ret == 0) {
-		if (page_is_file_cache(page))
-			lru_cache_add_file(page);
-		else
+		if (!page_is_file_cache(page))
 			lru_cache_add_active_anon(page);
+		else if (workingset_refault(mapping, offset)) {
+			/* evicted too early, it is part of the working set */
+			workingset_activation(page);
+			lru_cache_add_active_file(page);
+		} else
+			lru_cache_add_file(page);
 	}
 	return ret;
 }
@@ -1018,6 +1022,7 @@ static void do_generic_file_read(struct file *filp, loff_t *ppos,
 		unsigned long nr, ret;
 
 		cond_resched();
+		ra_trace_record(filp, index);
 find_page:
 		page = find_get_page(mapping, index);
 		if (!page) {
@@ -1520,6 +1525,8 @@ int filemap_fault(struct vm_area_struct *vma, struct vm_fault *vmf)
 	if (offset >= size)
 		return VM_FAULT_SIGBUS;
 
+	ra_trace_record(file, offset);
+
 	/*
 	 * Do we have something in the page cache already?
 	 */
@@ -1620,8 +1627,71 @@ page_not_uptodate:
 }
 EXPORT_SYMBOL(filemap_fault);
 
+/**
+ * filemap_map_pages - map cached pages around a read fault
+ * @vma:	vma in which the fault was taken
+ * @vmf:	range to map, see do_fault_around()
+ *
+ * Maps the pages from @vmf->pgoff to @vmf->max_pgoff that are already in
+ * the page cache and uptodate, without blocking or starting any I/O.
+ * Pages that are locked, marked for readahead or not yet read in are left
+ * to the real fault, so readahead keeps working as before.  Called with
+ * the pte lock held.
+ */
+void filemap_map_pages(struct vm_area_struct *vma, struct vm_fault *vmf)
+{
+	struct address_space *mapping = vma->vm_file->f_mapping;
+	struct page *pages[FAULT_AROUND_PAGES_MAX];
+	unsigned long address = (unsigned long)vmf->virtual_address;
+	unsigned int i, nr, mapped = 0;
+	pgoff_t size;
+	pte_t *pte;
+
+	nr = min_t(pgoff_t, vmf->max_pgoff - vmf->pgoff + 1,
+		   FAULT_AROUND_PAGES_MAX);
+	nr = find_get_pages(mapping, vmf->pgoff, nr, pages);
+
+	size = (i_size_read(mapping->host) + PAGE_CACHE_SIZE - 1) >>
+							PAGE_CACHE_SHIFT;
+	for (i = 0; i < nr; i++) {
+		struct page *page = pages[i];
+
+		if (!PageUptodate(page) || PageReadahead(page) ||
+		    PageHWPoison(page))
+			goto skip;
+		if (!trylock_page(page))
+			goto skip;
+
+		/* Did it get truncated, or reused? */
+		if (page->mapping != mapping || !PageUptodate(page))
+			goto unlock;
+		if (page->index < vmf->pgoff || page->index > vmf->max_pgoff ||
+		    page->index >= size)
+			goto unlock;
+
+		pte = vmf->pte + (page->index - vmf->pgoff);
+		if (!pte_none(*pte))
+			goto unlock;
+
+		do_set_pte(vma, address +
+			   ((page->index - vmf->pgoff) << PAGE_SHIFT), page, pte);
+		unlock_page(page);
+		mapped++;
+		continue;
+unlock:
+		unlock_page(page);
+skip:
+		page_cache_release(page);
+	}
+
+	if (mapped)
+		count_vm_events(PGFAULTAROUND, mapped);
+}
+EXPORT_SYMBOL(filemap_map_pages);
+
 const struct vm_operations_struct generic_file_vm_ops = {
 	.fault		= filemap_fault,
+	.map_pages	= filemap_map_pages,
 };
 
 /* This is used for a general mmap of a disk file */
@@ -50,6 +50,7 @@ extern void putback_lru_page(struct page *page);
  */
 extern void __free_pages_bootmem(struct page *page, unsigned int order);
 extern void prep_compound_page(struct page *page, unsigned long order);
+extern int split_free_page(struct page *page);
 
 
 /*
@@ -63,6 +64,26 @@ static inline unsigned long page_order(struct page *page)
 	return page_private(page);
 }
 
+/*
+ * During exec() the stack vma is set up at the top of the address space
+ * and later moved, under the anon_vma lock but not the page table lock,
+ * so an rmap walk can miss the ptes on the way.  Migration leaves such a
+ * temporary stack alone until exec() is done with it.
+ */
+static inline int is_vma_temporary_stack(struct vm_area_struct *vma)
+{
+	int maybe_stack = vma->vm_flags & (VM_GROWSDOWN | VM_GROWSUP);
+
+	if (!maybe_stack)
+		return 0;
+
+	if ((vma->vm_flags & VM_STACK_INCOMPLETE_SETUP) ==
+						VM_STACK_INCOMPLETE_SETUP)
+		return 1;
+
+	return 0;
+}
+
 #ifdef CONFIG_HAVE_MLOCK
 extern long mlock_vma_pages_range(struct vm_area_struct *vma,
 			unsigned long start, unsigned long end);
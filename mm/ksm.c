@@ -32,6 +32,8 @@
 #include <linux/mmu_notifier.h>
 #include <linux/swap.h>
 #include <linux/ksm.h>
+#include <linux/kernel_stat.h>
+#include <linux/earlysuspend.h>
 
 #include <asm/tlbflush.h>
 #include "internal.h"
@@ -172,6 +174,32 @@ static unsigned int ksm_thread_pages_to_scan = 100;
 /* Milliseconds ksmd should sleep between batches */
 static unsigned int ksm_thread_sleep_millisecs = 20;
 
+/* Limit on the sleep between batches when merging yields little */
+static unsigned int ksm_thread_max_sleep_millisecs = 1000;
+
+/* Milliseconds ksmd currently sleeps, adapted to the merge yield */
+static unsigned int ksm_thread_cur_sleep_millisecs = 20;
+
+/* ksmd pauses while the CPUs are busy more than this percentage */
+static unsigned int ksm_busy_percent = 90;
+
+/* Whether to map zero-filled pages to the zero page */
+static unsigned int ksm_use_zero_pages = 1;
+
+/* The checksum of a zero-filled page */
+static u32 zero_checksum __read_mostly;
+
+/* The number of ptes mapped to the zero page, see is_ksm_zero_pte() */
+atomic_long_t ksm_pages_zero = ATOMIC_LONG_INIT(0);
+
+/* The number of pages looked at by ksmd */
+static unsigned long ksm_pages_scanned;
+
+/* Set while the screen is off */
+static int ksm_screen_off;
+
+static struct task_struct *ksm_thread;
+
 #define KSM_RUN_STOP	0
 #define KSM_RUN_MERGE	1
 #define KSM_RUN_UNMERGE	2
@@ -308,7 +336,38 @@ static inline bool ksm_test_exit(struct mm_struct *mm)
  * in case the application has unmapped and remapped mm,addr meanwhile.
  * Could a ksm page appear anywhere else?  Actually yes, in a VM_PFNMAP
  * mmap of /dev/mem or /dev/kmem, where we would not want to touch it.
+ *
+ * The zero page is only touched where ksm mapped it, not where a read
+ * fault did, which ksm_zero_pte_at() tells from the pte.
  */
+static int ksm_zero_pte_at(struct vm_area_struct *vma, unsigned long addr)
+{
+	struct mm_struct *mm = vma->vm_mm;
+	pgd_t *pgd;
+	pud_t *pud;
+	pmd_t *pmd;
+	pte_t *ptep;
+	spinlock_t *ptl;
+	int ret;
+
+	pgd = pgd_offset(mm, addr);
+	if (!pgd_present(*pgd))
+		return 0;
+
+	pud = pud_offset(pgd, addr);
+	if (!pud_present(*pud))
+		return 0;
+
+	pmd = pmd_offset(pud, addr);
+	if (!pmd_present(*pmd))
+		return 0;
+
+	ptep = pte_offset_map_lock(mm, pmd, addr, &ptl);
+	ret = pte_present(*ptep) && is_ksm_zero_pte(*ptep);
+	pte_unmap_unlock(ptep, ptl);
+	return ret;
+}
+
 static int break_ksm(struct vm_area_struct *vma, unsigned long addr)
 {
 	struct page *page;
@@ -319,7 +378,8 @@ static int break_ksm(struct vm_area_struct *vma, unsigned long addr)
 		page = follow_page(vma, addr, FOLL_GET);
 		if (!page)
 			break;
-		if (PageKsm(page))
+		if (PageKsm(page) ||
+		    (page == ZERO_PAGE(0) && ksm_zero_pte_at(vma, addr)))
 			ret = handle_mm_fault(vma->vm_mm, vma, addr,
 							FAULT_FLAG_WRITE);
 		else
@@ -667,7 +727,7 @@ out:
  * replace_page - replace page in vma by new ksm page
  * @vma:      vma that holds the pte pointing to oldpage
  * @oldpage:  the page we are replacing by newpage
- * @newpage:  the ksm page we replace oldpage by
+ * @newpage:  the ksm page or the zero page we replace oldpage by
  * @orig_pte: the original value of the pte
  *
  * Returns 0 on success, -EFAULT on failure.
@@ -680,6 +740,7 @@ static int replace_page(struct vm_area_struct *vma, struct page *oldpage,
 	pud_t *pud;
 	pmd_t *pmd;
 	pte_t *ptep;
+	pte_t newpte;
 	spinlock_t *ptl;
 	unsigned long addr;
 	pgprot_t prot;
@@ -709,12 +770,25 @@ static int replace_page(struct vm_area_struct *vma, struct page *oldpage,
 		goto out;
 	}
 
-	get_page(newpage);
-	page_add_ksm_rmap(newpage);
+	/*
+	 * The zero page is mapped the way do_anonymous_page() maps it:
+	 * without a reference, rmap or rss, and write faults on it
+	 * allocate a fresh page.  The pte is marked dirty so that unmerging
+	 * and unmapping can tell it from one mapped on a read fault.
+	 */
+	if (newpage == ZERO_PAGE(0)) {
+		newpte = pte_mkdirty(pte_mkspecial(pfn_pte(page_to_pfn(newpage),
+							   prot)));
+		dec_mm_counter(mm, anon_rss);
+	} else {
+		get_page(newpage);
+		page_add_ksm_rmap(newpage);
+		newpte = mk_pte(newpage, prot);
+	}
 
 	flush_cache_page(vma, addr, pte_pfn(*ptep));
 	ptep_clear_flush(vma, addr, ptep);
-	set_pte_at_notify(mm, addr, ptep, mk_pte(newpage, prot));
+	set_pte_at_notify(mm, addr, ptep, newpte);
 
 	page_remove_rmap(oldpage);
 	put_page(oldpage);
@@ -733,7 +807,8 @@ out:
  *
  * Note:
  * oldpage should be a PageAnon page, while newpage should be a PageKsm page,
- * or a newly allocated kernel page which page_add_ksm_rmap will make PageKsm.
+ * or a newly allocated kernel page which page_add_ksm_rmap will make PageKsm,
+ * or the zero page.
  *
  * This function returns 0 if the pages were merged, -EFAULT otherwise.
  */
@@ -785,7 +860,8 @@ out:
 
 /*
  * try_to_merge_with_ksm_page - like try_to_merge_two_pages,
- * but no new kernel page is allocated: kpage must already be a ksm page.
+ * but no new kernel page is allocated: kpage must already be a ksm page,
+ * or the zero page.
  */
 static int try_to_merge_with_ksm_page(struct mm_struct *mm1,
 				      unsigned long addr1,
@@ -1083,12 +1159,29 @@ static void cmp_and_merge_page(struct page *page, struct rmap_item *rmap_item)
 {
 	struct page *page2[1];
 	struct rmap_item *tree_rmap_item;
-	unsigned int checksum;
+	unsigned int checksum = 0;
 	int err;
 
 	if (in_stable_tree(rmap_item))
 		remove_rmap_item_from_tree(rmap_item);
 
+	/*
+	 * A zero-filled page that has stayed so since the last scan is
+	 * mapped to the zero page straight away, without a search of
+	 * either tree and without using up a kernel page.
+	 */
+	if (ksm_use_zero_pages && !PageKsm(page)) {
+		checksum = calc_checksum(page);
+		if (checksum == zero_checksum &&
+		    rmap_item->oldchecksum == checksum &&
+		    !try_to_merge_with_ksm_page(rmap_item->mm,
+						rmap_item->address, page,
+						ZERO_PAGE(0))) {
+			atomic_long_inc(&ksm_pages_zero);
+			return;
+		}
+	}
+
 	/* We first start with searching the page inside the stable tree */
 	tree_rmap_item = stable_tree_search(page, page2, rmap_item);
 	if (tree_rmap_item) {
@@ -1125,7 +1218,8 @@ static void cmp_and_merge_page(struct page *page, struct rmap_item *rmap_item)
 	 * don't want to insert it to the unstable tree, and we don't want to
 	 * waste our time to search if there is something identical to it there.
 	 */
-	checksum = calc_checksum(page);
+	if (!checksum)
+		checksum = calc_checksum(page);
 	if (rmap_item->oldchecksum != checksum) {
 		rmap_item->oldchecksum = checksum;
 		return;
@@ -1321,6 +1415,7 @@ static void ksm_do_scan(unsigned int scan_npages)
 		rmap_item = scan_get_next_rmap_item(&page);
 		if (!rmap_item)
 			return;
+		ksm_pages_scanned++;
 		if (!PageKsm(page) || !in_stable_tree(rmap_item))
 			cmp_and_merge_page(page, rmap_item);
 		else if (page_mapcount(page) == 1) {
@@ -1335,9 +1430,82 @@ static void ksm_do_scan(unsigned int scan_npages)
 	}
 }
 
+/*
+ * A full scan that merges fewer than one in KSM_LOW_YIELD of the pages it
+ * looked at doubles the sleep between batches, up to max_sleep_millisecs;
+ * once the mergeable areas have settled, most of what a scan finds was
+ * merged on the one before.  A better scan, or a new mm registering,
+ * brings ksmd back to sleep_millisecs.
+ */
+#define KSM_LOW_YIELD	64
+
+static void ksm_adapt_sleep(void)
+{
+	static unsigned long last_seqnr, last_saved, last_scanned;
+	unsigned long saved, scanned;
+	unsigned int msecs = ksm_thread_cur_sleep_millisecs;
+
+	if (ksm_scan.seqnr == last_seqnr)
+		return;
+	last_seqnr = ksm_scan.seqnr;
+
+	saved = ksm_pages_sharing + atomic_long_read(&ksm_pages_zero);
+	scanned = ksm_pages_scanned - last_scanned;
+	if (saved > last_saved &&
+	    (saved - last_saved) * KSM_LOW_YIELD >= scanned)
+		msecs = ksm_thread_sleep_millisecs;
+	else if (msecs < ksm_thread_max_sleep_millisecs / 2)
+		msecs *= 2;
+	else
+		msecs = ksm_thread_max_sleep_millisecs;
+	ksm_thread_cur_sleep_millisecs = max(msecs, ksm_thread_sleep_millisecs);
+
+	last_saved = saved;
+	last_scanned = ksm_pages_scanned;
+}
+
+/*
+ * Returns 1 if the CPUs were busy more than busy_percent of the time over
+ * the last second or so, not counting ksmd itself: merging would then take
+ * time from whatever the user is waiting for.
+ */
+static int ksm_cpu_busy(void)
+{
+	static u64 last_wall, last_idle, last_self;
+	static int busy;
+	u64 wall, idle = 0, self, total, free;
+	int cpu;
+
+	if (ksm_busy_percent >= 100)
+		return 0;
+
+	wall = get_jiffies_64();
+	if (last_wall && wall - last_wall < HZ)
+		return busy;
+
+	for_each_online_cpu(cpu) {
+		idle += cputime64_to_jiffies64(kstat_cpu(cpu).cpustat.idle);
+		idle += cputime64_to_jiffies64(kstat_cpu(cpu).cpustat.iowait);
+	}
+	self = div_u64(task_sched_runtime(current), NSEC_PER_SEC / HZ);
+
+	if (last_wall) {
+		total = (wall - last_wall) * num_online_cpus();
+		free = (idle - last_idle) + (self - last_self);
+		busy = total > free &&
+		       (total - free) * 100 > total * ksm_busy_percent;
+	}
+
+	last_wall = wall;
+	last_idle = idle;
+	last_self = self;
+	return busy;
+}
+
 static int ksmd_should_run(void)
 {
-	return (ksm_run & KSM_RUN_MERGE) && !list_empty(&ksm_mm_head.mm_list);
+	return (ksm_run & KSM_RUN_MERGE) && !ksm_screen_off &&
+		!list_empty(&ksm_mm_head.mm_list);
 }
 
 static int ksm_scan_thread(void *nothing)
@@ -1346,13 +1514,15 @@ static int ksm_scan_thread(void *nothing)
 
 	while (!kthread_should_stop()) {
 		mutex_lock(&ksm_thread_mutex);
-		if (ksmd_should_run())
+		if (ksmd_should_run() && !ksm_cpu_busy()) {
 			ksm_do_scan(ksm_thread_pages_to_scan);
+			ksm_adapt_sleep();
+		}
 		mutex_unlock(&ksm_thread_mutex);
 
 		if (ksmd_should_run()) {
 			schedule_timeout_interruptible(
-				msecs_to_jiffies(ksm_thread_sleep_millisecs));
+				msecs_to_jiffies(ksm_thread_cur_sleep_millisecs));
 		} else {
 			wait_event_interruptible(ksm_thread_wait,
 				ksmd_should_run() || kthread_should_stop());
@@ -1429,6 +1599,9 @@ int __ksm_enter(struct mm_struct *mm)
 	set_bit(MMF_VM_MERGEABLE, &mm->flags);
 	atomic_inc(&mm->mm_count);
 
+	/* new areas are worth a scan at full speed */
+	ksm_thread_cur_sleep_millisecs = ksm_thread_sleep_millisecs;
+
 	if (needs_wakeup)
 		wake_up_interruptible(&ksm_thread_wait);
 
@@ -1502,11 +1675,82 @@ static ssize_t sleep_millisecs_store(struct kobject *kobj,
 		return -EINVAL;
 
 	ksm_thread_sleep_millisecs = msecs;
+	ksm_thread_cur_sleep_millisecs = msecs;
 
 	return count;
 }
 KSM_ATTR(sleep_millisecs);
 
+static ssize_t max_sleep_millisecs_show(struct kobject *kobj,
+					struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%u\n", ksm_thread_max_sleep_millisecs);
+}
+
+static ssize_t max_sleep_millisecs_store(struct kobject *kobj,
+					 struct kobj_attribute *attr,
+					 const char *buf, size_t count)
+{
+	unsigned long msecs;
+	int err;
+
+	err = strict_strtoul(buf, 10, &msecs);
+	if (err || msecs > UINT_MAX)
+		return -EINVAL;
+
+	ksm_thread_max_sleep_millisecs = msecs;
+	ksm_thread_cur_sleep_millisecs = ksm_thread_sleep_millisecs;
+
+	return count;
+}
+KSM_ATTR(max_sleep_millisecs);
+
+static ssize_t busy_percent_show(struct kobject *kobj,
+				 struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%u\n", ksm_busy_percent);
+}
+
+static ssize_t busy_percent_store(struct kobject *kobj,
+				  struct kobj_attribute *attr,
+				  const char *buf, size_t count)
+{
+	unsigned long percent;
+	int err;
+
+	err = strict_strtoul(buf, 10, &percent);
+	if (err || percent > 100)
+		return -EINVAL;
+
+	ksm_busy_percent = percent;
+
+	return count;
+}
+KSM_ATTR(busy_percent);
+
+static ssize_t use_zero_pages_show(struct kobject *kobj,
+				   struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%u\n", ksm_use_zero_pages);
+}
+
+static ssize_t use_zero_pages_store(struct kobject *kobj,
+				    struct kobj_attribute *attr,
+				    const char *buf, size_t count)
+{
+	unsigned long enable;
+	int err;
+
+	err = strict_strtoul(buf, 10, &enable);
+	if (err || enable > 1)
+		return -EINVAL;
+
+	ksm_use_zero_pages = enable;
+
+	return count;
+}
+KSM_ATTR(use_zero_pages);
+
 static ssize_t pages_to_scan_show(struct kobject *kobj,
 				  struct kobj_attribute *attr, char *buf)
 {
@@ -1638,6 +1882,28 @@ static ssize_t pages_volatile_show(struct kobject *kobj,
 }
 KSM_ATTR_RO(pages_volatile);
 
+static ssize_t pages_zero_show(struct kobject *kobj,
+			       struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%ld\n", atomic_long_read(&ksm_pages_zero));
+}
+KSM_ATTR_RO(pages_zero);
+
+static ssize_t pages_per_cpu_second_show(struct kobject *kobj,
+					 struct kobj_attribute *attr,
+					 char *buf)
+{
+	u64 runtime = task_sched_runtime(ksm_thread);
+	u64 saved = ksm_pages_sharing + atomic_long_read(&ksm_pages_zero);
+
+	if (!runtime)
+		return sprintf(buf, "0\n");
+	return sprintf(buf, "%llu\n",
+		       (unsigned long long)div64_u64(saved * NSEC_PER_SEC,
+						     runtime));
+}
+KSM_ATTR_RO(pages_per_cpu_second);
+
 static ssize_t full_scans_show(struct kobject *kobj,
 			       struct kobj_attribute *attr, char *buf)
 {
@@ -1647,13 +1913,18 @@ KSM_ATTR_RO(full_scans);
 
 static struct attribute *ksm_attrs[] = {
 	&sleep_millisecs_attr.attr,
+	&max_sleep_millisecs_attr.attr,
 	&pages_to_scan_attr.attr,
+	&busy_percent_attr.attr,
+	&use_zero_pages_attr.attr,
 	&run_attr.attr,
 	&max_kernel_pages_attr.attr,
 	&pages_shared_attr.attr,
 	&pages_sharing_attr.attr,
 	&pages_unshared_attr.attr,
 	&pages_volatile_attr.attr,
+	&pages_zero_attr.attr,
+	&pages_per_cpu_second_attr.attr,
 	&full_scans_attr.attr,
 	NULL,
 };
@@ -1664,12 +1935,36 @@ static struct attribute_group ksm_attr_group = {
 };
 #endif /* CONFIG_SYSFS */
 
+#ifdef CONFIG_HAS_EARLYSUSPEND
+/*
+ * With the screen off, the wakeups and memory traffic of scanning cost
+ * more battery than the merged pages are worth; merge again when the
+ * user is back.
+ */
+static void ksm_early_suspend(struct early_suspend *h)
+{
+	ksm_screen_off = 1;
+}
+
+static void ksm_late_resume(struct early_suspend *h)
+{
+	ksm_screen_off = 0;
+	wake_up_interruptible(&ksm_thread_wait);
+}
+
+static struct early_suspend ksm_early_suspend_desc = {
+	.level = EARLY_SUSPEND_LEVEL_DISABLE_FB,
+	.suspend = ksm_early_suspend,
+	.resume = ksm_late_resume,
+};
+#endif
+
 static int __init ksm_init(void)
 {
-	struct task_struct *ksm_thread;
 	int err;
 
 	ksm_max_kernel_pages = totalram_pages / 4;
+	zero_checksum = calc_checksum(ZERO_PAGE(0));
 
 	err = ksm_slab_init();
 	if (err)
@@ -1698,6 +1993,9 @@ static int __init ksm_init(void)
 
 #endif /* CONFIG_SYSFS */
 
+#ifdef CONFIG_HAS_EARLYSUSPEND
+	register_early_suspend(&ksm_early_suspend_desc);
+#endif
 	return 0;
 
 out_free2:
@@ -56,6 +56,7 @@
 #include <linux/kallsyms.h>
 #include <linux/swapops.h>
 #include <linux/elf.h>
+#include <linux/log2.h>
 
 #include <asm/io.h>
 #include <asm/pgalloc.h>
@@ -631,12 +632,66 @@ copy_one_pte(struct mm_struct *dst_mm, struct mm_struct *src_mm,
 		get_page(page);
 		page_dup_rmap(page);
 		rss[PageAnon(page)]++;
-	}
+	} else if (is_zero_pfn(pte_pfn(pte)))
+		ksm_map_zero_pte(pte);
 
 out_set_pte:
 	set_pte_at(dst_mm, addr, dst_pte, pte);
 }
 
+/*
+ * Skip the ptes of page cache pages in private file mappings on fork,
+ * the child faults them back in from the page cache if it ever touches
+ * them.  Only anonymous pages and swap entries are copied.
+ */
+int sysctl_fork_lazy_file_ptes = 1;
+
+static inline int fork_lazy_file_ptes(struct vm_area_struct *vma)
+{
+	return sysctl_fork_lazy_file_ptes && vma->vm_file &&
+		!(vma->vm_flags & (VM_SHARED | VM_HUGETLB | VM_NONLINEAR |
+				   VM_PFNMAP | VM_MIXEDMAP | VM_INSERTPAGE));
+}
+
+static inline int fork_skips_pte(struct vm_area_struct *vma,
+		unsigned long addr, pte_t pte)
+{
+	struct page *page;
+
+	if (pte_none(pte))
+		return 1;
+	if (!pte_present(pte))
+		return 0;
+	page = vm_normal_page(vma, addr, pte);
+	return page && !PageAnon(page);
+}
+
+/*
+ * Returns 0 if the child can do without this part of the page table
+ * altogether.  As mmap_sem is held for writing, no pte can turn from
+ * skippable into one that must be copied once the lock is dropped: that
+ * takes a fault.
+ */
+static int pte_range_needs_copy(struct mm_struct *src_mm, pmd_t *src_pmd,
+		struct vm_area_struct *vma, unsigned long addr,
+		unsigned long end)
+{
+	pte_t *orig_pte, *pte;
+	spinlock_t *ptl;
+	int ret = 0;
+
+	orig_pte = pte = pte_offset_map_lock(src_mm, src_pmd, addr, &ptl);
+	do {
+		if (!fork_skips_pte(vma, addr, *pte)) {
+			ret = 1;
+			break;
+		}
+	} while (pte++, addr += PAGE_SIZE, addr != end);
+	pte_unmap_unlock(orig_pte, ptl);
+
+	return ret;
+}
+
 static int copy_pte_range(struct mm_struct *dst_mm, struct mm_struct *src_mm,
 		pmd_t *dst_pmd, pmd_t *src_pmd, struct vm_area_struct *vma,
 		unsigned long addr, unsigned long end)
@@ -644,9 +699,13 @@ static int copy_pte_range(struct mm_struct *dst_mm, struct mm_struct *src_mm,
 	pte_t *orig_src_pte, *orig_dst_pte;
 	pte_t *src_pte, *dst_pte;
 	spinlock_t *src_ptl, *dst_ptl;
+	int lazy = fork_lazy_file_ptes(vma);
 	int progress = 0;
 	int rss[2];
 
+	if (lazy && !pte_range_needs_copy(src_mm, src_pmd, vma, addr, end))
+		return 0;
+
 again:
 	rss[1] = rss[0] = 0;
 	dst_pte = pte_alloc_map_lock(dst_mm, dst_pmd, addr, &dst_ptl);
@@ -670,7 +729,8 @@ again:
 			    spin_needbreak(src_ptl) || spin_needbreak(dst_ptl))
 				break;
 		}
-		if (pte_none(*src_pte)) {
+		if (pte_none(*src_pte) ||
+		    (lazy && fork_skips_pte(vma, addr, *src_pte))) {
 			progress++;
 			continue;
 		}
@@ -842,8 +902,10 @@ static unsigned long zap_pte_range(struct mmu_gather *tlb,
 			ptent = ptep_get_and_clear_full(mm, addr, pte,
 							tlb->fullmm);
 			tlb_remove_tlb_entry(tlb, pte, addr);
-			if (unlikely(!page))
+			if (unlikely(!page)) {
+				ksm_unmap_zero_pte(ptent);
 				continue;
+			}
 			if (unlikely(details) && details->nonlinear_vma
 			    && linear_page_index(details->nonlinear_vma,
 						addr) != page->index)
@@ -2152,8 +2214,10 @@ gotten:
 				dec_mm_counter(mm, file_rss);
 				inc_mm_counter(mm, anon_rss);
 			}
-		} else
+		} else {
+			ksm_unmap_zero_pte(orig_pte);
 			inc_mm_counter(mm, anon_rss);
+		}
 		flush_cache_page(vma, address, pte_pfn(orig_pte));
 		entry = mk_pte(new_page, vma->vm_page_prot);
 		entry = maybe_mkwrite(pte_mkdirty(entry), vma);
@@ -2875,14 +2939,116 @@ unwritable_page:
 	return ret;
 }
 
+/*
+ * Install a pte for a page cache page that needs no C-O-W and is not
+ * written to.  The caller holds the pte lock, the page lock and a
+ * reference on the page, which becomes the reference of the mapping.
+ */
+void do_set_pte(struct vm_area_struct *vma, unsigned long address,
+		struct page *page, pte_t *pte)
+{
+	pte_t entry;
+
+	flush_icache_page(vma, page);
+	entry = mk_pte(page, vma->vm_page_prot);
+	inc_mm_counter(vma->vm_mm, file_rss);
+	page_add_file_rmap(page);
+	set_pte_at(vma->vm_mm, address, pte, entry);
+
+	/* no need to invalidate: a not-present page won't be cached */
+	update_mmu_cache(vma, address, entry);
+}
+
+/*
+ * Number of pages, a power of two, mapped around a read fault on a file
+ * mapping if they are already in the page cache.  1 turns it off.
+ */
+int sysctl_fault_around_pages = FAULT_AROUND_PAGES_MAX;
+
+int fault_around_sysctl_handler(struct ctl_table *table, int write,
+	void __user *buffer, size_t *length, loff_t *ppos)
+{
+	struct ctl_table t = *table;
+	int pages = sysctl_fault_around_pages;
+	int ret;
+
+	/* parse into a copy, faults must never see a non power of two */
+	t.data = &pages;
+	ret = proc_dointvec_minmax(&t, write, buffer, length, ppos);
+	if (!ret && write)
+		sysctl_fault_around_pages = rounddown_pow_of_two(pages);
+	return ret;
+}
+
+/*
+ * Let ->map_pages() map whatever is already uptodate in the page cache
+ * in a naturally aligned window of @pages around the faulting address,
+ * clipped to the vma.  The window is no larger than a page table page,
+ * so it never crosses a pmd.
+ *
+ * Returns 1 if the faulting address got mapped along the way, so there
+ * is no need to call ->fault() at all.
+ */
+static int do_fault_around(struct mm_struct *mm, struct vm_area_struct *vma,
+		unsigned long address, pmd_t *pmd, pgoff_t pgoff,
+		unsigned int flags, pte_t orig_pte, int pages)
+{
+	unsigned long start_addr, end_addr;
+	struct vm_fault vmf;
+	spinlock_t *ptl;
+	pte_t *pte;
+	int off, ret;
+
+	start_addr = address & ~((unsigned long)pages * PAGE_SIZE - 1);
+	end_addr = start_addr + pages * PAGE_SIZE;
+	start_addr = max(start_addr, vma->vm_start);
+	end_addr = min(end_addr, vma->vm_end);
+	off = (address - start_addr) >> PAGE_SHIFT;
+
+	vmf.virtual_address = (void __user *)start_addr;
+	vmf.pgoff = pgoff - off;
+	vmf.max_pgoff = vmf.pgoff + ((end_addr - start_addr) >> PAGE_SHIFT) - 1;
+	vmf.flags = flags;
+	vmf.page = NULL;
+
+	pte = pte_offset_map_lock(mm, pmd, start_addr, &ptl);
+	vmf.pte = pte;
+	/* somebody else handled the fault, let the access retry */
+	if (unlikely(!pte_same(pte[off], orig_pte))) {
+		pte_unmap_unlock(pte, ptl);
+		return 1;
+	}
+	vma->vm_ops->map_pages(vma, &vmf);
+	ret = !pte_none(pte[off]);
+	pte_unmap_unlock(pte, ptl);
+
+	if (ret)
+		count_vm_event(PGFAULTAROUND_HIT);
+	return ret;
+}
+
 static int do_linear_fault(struct mm_struct *mm, struct vm_area_struct *vma,
 		unsigned long address, pte_t *page_table, pmd_t *pmd,
 		unsigned int flags, pte_t orig_pte)
 {
 	pgoff_t pgoff = (((address & PAGE_MASK)
 			- vma->vm_start) >> PAGE_SHIFT) + vma->vm_pgoff;
+	int pages = ACCESS_ONCE(sysctl_fault_around_pages);
 
 	pte_unmap(page_table);
+
+	/*
+	 * On a read fault, map the neighbouring pages as well if they are
+	 * cached already: that is cheap under the one pte lock, and it
+	 * saves the minor faults a sequential walk would take on them.
+	 */
+	if (!(flags & FAULT_FLAG_WRITE) && vma->vm_ops->map_pages &&
+	    pages > 1) {
+		if (do_fault_around(mm, vma, address, pmd, pgoff, flags,
+				    orig_pte, pages))
+			return 0;
+	}
+
 	return __do_fault(mm, vma, address, pmd, pgoff, flags, orig_pte);
 }
 
@@ -0,0 +1,598 @@
+/*
+ * mm/ra_trace.c - record and replay file readahead
+ *
+ * Boot and application start-up read a scattered but very repeatable set
+ * of pages from many files. Readahead only sees one access at a time, so
+ * on flash that turns into a long series of small synchronous reads.
+ *
+ * While recording, every page cache page looked up by read() or by a
+ * file fault is noted as (file, page range). The trace is read back from
+ * /proc/readahead/trace, stored by userspace, and on a later boot written
+ * to /proc/readahead/replay, which opens the files and submits all of the
+ * ranges as one sorted, merged batch of readahead before they are needed.
+ *
+ * See Documentation/vm/readahead-trace.txt
+ */
+
+#include <linux/kernel.h>
+#include <linux/ctype.h>
+#include <linux/module.h>
+#include <linux/fs.h>
+#include <linux/file.h>
+#include <linux/mm.h>
+#include <linux/pagemap.h>
+#include <linux/path.h>
+#include <linux/namei.h>
+#include <linux/slab.h>
+#include <linux/vmalloc.h>
+#include <linux/hash.h>
+#include <linux/sort.h>
+#include <linux/proc_fs.h>
+#include <linux/seq_file.h>
+#include <linux/spinlock.h>
+#include <linux/mutex.h>
+#include <linux/sched.h>
+#include <linux/uaccess.h>
+
+#define RA_TRACE_HASH_BITS	8
+#define RA_TRACE_MAX_RANGES	16384
+
+struct ra_trace_range {
+	pgoff_t start;
+	unsigned long nr;
+};
+
+struct ra_trace_file {
+	struct hlist_node hash;
+	struct list_head list;		/* in order of first access */
+	struct address_space *mapping;
+	struct path path;
+	unsigned int nr_ranges;
+	unsigned int max_ranges;
+	struct ra_trace_range *ranges;
+};
+
+int ra_trace_recording __read_mostly;
+
+static DEFINE_SPINLOCK(ra_trace_lock);
+static DEFINE_MUTEX(ra_trace_mutex);	/* serialises start/stop/dump */
+static pid_t ra_trace_tgid;		/* 0 records every task */
+static struct hlist_head ra_trace_hash[1 << RA_TRACE_HASH_BITS];
+static LIST_HEAD(ra_trace_files);
+static unsigned int ra_trace_nr_files;
+static unsigned int ra_trace_nr_ranges;
+static unsigned int ra_trace_dropped;
+
+static struct ra_trace_file *ra_trace_lookup(struct address_space *mapping)
+{
+	struct hlist_head *head;
+	struct hlist_node *node;
+	struct ra_trace_file *tf;
+
+	head = &ra_trace_hash[hash_ptr(mapping, RA_TRACE_HASH_BITS)];
+	hlist_for_each_entry(tf, node, head, hash)
+		if (tf->mapping == mapping)
+			return tf;
+	return NULL;
+}
+
+/*
+ * Called for each page index read through @filp while recording. Accesses
+ * are mostly sequential within a file, so it is enough to extend the last
+ * range; duplicates and overlaps are sorted out when recording stops.
+ */
+void __ra_trace_record(struct file *filp, pgoff_t index)
+{
+	struct address_space *mapping = filp->f_mapping;
+	struct ra_trace_file *tf;
+	struct ra_trace_range *r;
+
+	if (ra_trace_tgid && current->tgid != ra_trace_tgid)
+		return;
+
+	spin_lock(&ra_trace_lock);
+	if (!ra_trace_recording)
+		goto out;
+
+	if (ra_trace_nr_ranges >= RA_TRACE_MAX_RANGES)
+		goto drop;
+
+	tf = ra_trace_lookup(mapping);
+	if (!tf) {
+		tf = kzalloc(sizeof(*tf), GFP_NOWAIT | __GFP_NOWARN);
+		if (!tf)
+			goto drop;
+		tf->mapping = mapping;
+		tf->path = filp->f_path;
+		path_get(&tf->path);
+		hlist_add_head(&tf->hash, &ra_trace_hash[hash_ptr(mapping,
+					RA_TRACE_HASH_BITS)]);
+		list_add_tail(&tf->list, &ra_trace_files);
+		ra_trace_nr_files++;
+	}
+
+	if (tf->nr_ranges) {
+		r = &tf->ranges[tf->nr_ranges - 1];
+		if (index >= r->start && index <= r->start + r->nr) {
+			if (index == r->start + r->nr)
+				r->nr++;
+			goto out;
+		}
+	}
+
+	if (tf->nr_ranges == tf->max_ranges) {
+		unsigned int max = tf->max_ranges ? tf->max_ranges * 2 : 8;
+
+		r = krealloc(tf->ranges, max * sizeof(*r),
+			     GFP_NOWAIT | __GFP_NOWARN);
+		if (!r)
+			goto drop;
+		tf->ranges = r;
+		tf->max_ranges = max;
+	}
+
+	r = &tf->ranges[tf->nr_ranges++];
+	r->start = index;
+	r->nr = 1;
+	ra_trace_nr_ranges++;
+out:
+	spin_unlock(&ra_trace_lock);
+	return;
+drop:
+	ra_trace_dropped++;
+	spin_unlock(&ra_trace_lock);
+}
+
+static int ra_range_cmp(const void *a, const void *b)
+{
+	const struct ra_trace_range *ra = a, *rb = b;
+
+	if (ra->start != rb->start)
+		return ra->start < rb->start ? -1 : 1;
+	return 0;
+}
+
+/* sort @r and merge overlapping or adjacent ranges, returning the new count */
+static unsigned int ra_range_merge(struct ra_trace_range *r, unsigned int nr)
+{
+	unsigned int i, n = 0;
+
+	if (!nr)
+		return 0;
+
+	sort(r, nr, sizeof(*r), ra_range_cmp, NULL);
+	for (i = 1; i < nr; i++) {
+		if (r[i].start <= r[n].start + r[n].nr) {
+			pgoff_t end = max(r[n].start + r[n].nr,
+					  r[i].start + r[i].nr);
+			r[n].nr = end - r[n].start;
+		} else {
+			r[++n] = r[i];
+		}
+	}
+	return n + 1;
+}
+
+/* caller holds ra_trace_mutex with recording stopped */
+static void ra_trace_clear(void)
+{
+	struct ra_trace_file *tf, *next;
+	LIST_HEAD(files);
+
+	spin_lock(&ra_trace_lock);
+	list_splice_init(&ra_trace_files, &files);
+	list_for_each_entry(tf, &files, list)
+		hlist_del(&tf->hash);
+	ra_trace_nr_files = 0;
+	ra_trace_nr_ranges = 0;
+	ra_trace_dropped = 0;
+	spin_unlock(&ra_trace_lock);
+
+	list_for_each_entry_safe(tf, next, &files, list) {
+		path_put(&tf->path);
+		kfree(tf->ranges);
+		kfree(tf);
+	}
+}
+
+static void ra_trace_start(pid_t tgid)
+{
+	ra_trace_clear();
+
+	spin_lock(&ra_trace_lock);
+	ra_trace_tgid = tgid;
+	ra_trace_recording = 1;
+	spin_unlock(&ra_trace_lock);
+}
+
+static void ra_trace_stop(void)
+{
+	struct ra_trace_file *tf;
+
+	spin_lock(&ra_trace_lock);
+	ra_trace_recording = 0;
+	spin_unlock(&ra_trace_lock);
+
+	/* nothing else touches the ranges once recording is off */
+	ra_trace_nr_ranges = 0;
+	list_for_each_entry(tf, &ra_trace_files, list) {
+		tf->nr_ranges = ra_range_merge(tf->ranges, tf->nr_ranges);
+		ra_trace_nr_ranges += tf->nr_ranges;
+	}
+}
+
+/*
+ * /proc/readahead/record
+ */
+static int ra_record_show(struct seq_file *m, void *v)
+{
+	seq_printf(m, "%s tgid=%d files=%u ranges=%u dropped=%u\n",
+		   ra_trace_recording ? "recording" : "stopped",
+		   ra_trace_tgid, ra_trace_nr_files, ra_trace_nr_ranges,
+		   ra_trace_dropped);
+	return 0;
+}
+
+static int ra_record_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, ra_record_show, NULL);
+}
+
+static ssize_t ra_record_write(struct file *file, const char __user *buf,
+			       size_t count, loff_t *ppos)
+{
+	char cmd[32], *p;
+	pid_t tgid = 0;
+	ssize_t ret = count;
+
+	if (count >= sizeof(cmd))
+		return -EINVAL;
+	if (copy_from_user(cmd, buf, count))
+		return -EFAULT;
+	cmd[count] = '\0';
+	p = strstrip(cmd);
+
+	mutex_lock(&ra_trace_mutex);
+	if (!strncmp(p, "start", 5)) {
+		p += 5;
+		if (*p) {
+			tgid = simple_strtol(p, &p, 10);
+			if (*p || tgid < 0) {
+				ret = -EINVAL;
+				goto out;
+			}
+		}
+		ra_trace_start(tgid);
+	} else if (!strcmp(p, "stop")) {
+		if (ra_trace_recording)
+			ra_trace_stop();
+	} else if (!strcmp(p, "clear")) {
+		if (!ra_trace_recording)
+			ra_trace_clear();
+	} else {
+		ret = -EINVAL;
+	}
+out:
+	mutex_unlock(&ra_trace_mutex);
+	return ret;
+}
+
+static const struct file_operations ra_record_fops = {
+	.open		= ra_record_open,
+	.read		= seq_read,
+	.write		= ra_record_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+/*
+ * /proc/readahead/trace: one "start nr path" line per range, files in
+ * order of first access and ranges sorted within each file.
+ */
+static void *ra_trace_seq_start(struct seq_file *m, loff_t *pos)
+{
+	struct ra_trace_file *tf;
+	loff_t n = *pos;
+
+	mutex_lock(&ra_trace_mutex);
+	if (ra_trace_recording)
+		return NULL;
+	list_for_each_entry(tf, &ra_trace_files, list) {
+		if (n < tf->nr_ranges) {
+			m->private = tf;
+			return &tf->ranges[n];
+		}
+		n -= tf->nr_ranges;
+	}
+	return NULL;
+}
+
+static void *ra_trace_seq_next(struct seq_file *m, void *v, loff_t *pos)
+{
+	struct ra_trace_file *tf = m->private;
+	struct ra_trace_range *r = v;
+
+	++*pos;
+	if (++r < tf->ranges + tf->nr_ranges)
+		return r;
+
+	list_for_each_entry_continue(tf, &ra_trace_files, list) {
+		if (tf->nr_ranges) {
+			m->private = tf;
+			return tf->ranges;
+		}
+	}
+	return NULL;
+}
+
+static void ra_trace_seq_stop(struct seq_file *m, void *v)
+{
+	mutex_unlock(&ra_trace_mutex);
+}
+
+static int ra_trace_seq_show(struct seq_file *m, void *v)
+{
+	struct ra_trace_file *tf = m->private;
+	struct ra_trace_range *r = v;
+
+	seq_printf(m, "%lu %lu ", r->start, r->nr);
+	seq_path(m, &tf->path, "\n\\");
+	seq_putc(m, '\n');
+	return 0;
+}
+
+static const struct seq_operations ra_trace_seq_ops = {
+	.start	= ra_trace_seq_start,
+	.next	= ra_trace_seq_next,
+	.stop	= ra_trace_seq_stop,
+	.show	= ra_trace_seq_show,
+};
+
+static int ra_trace_open(struct inode *inode, struct file *file)
+{
+	/* the ranges are only sorted and stable once recording stopped */
+	if (ra_trace_recording)
+		return -EBUSY;
+	return seq_open(file, &ra_trace_seq_ops);
+}
+
+static const struct file_operations ra_trace_fops = {
+	.open		= ra_trace_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= seq_release,
+};
+
+/*
+ * /proc/readahead/replay: takes a trace in the format above. Files are
+ * opened as the lines arrive; the readahead is issued on close, with all
+ * ranges sorted by device, inode and offset and merged.
+ */
+struct ra_replay_range {
+	struct file *filp;
+	pgoff_t start;
+	unsigned long nr;
+};
+
+struct ra_replay {
+	struct ra_replay_range *ranges;
+	unsigned int nr_ranges;
+	struct file **files;
+	unsigned int nr_files;
+	unsigned int max_files;
+	char *last_path;
+	int len;
+	char line[PATH_MAX + 48];
+};
+
+/* undo the octal escapes seq_path() puts in the path */
+static void ra_unescape(char *s)
+{
+	char *d = s;
+
+	while (*s) {
+		if (s[0] == '\\' && s[1] >= '0' && s[1] <= '3' &&
+		    s[2] >= '0' && s[2] <= '7' && s[3] >= '0' && s[3] <= '7') {
+			*d++ = ((s[1] - '0') << 6) | ((s[2] - '0') << 3) |
+			       (s[3] - '0');
+			s += 4;
+		} else {
+			*d++ = *s++;
+		}
+	}
+	*d = '\0';
+}
+
+static struct file *ra_replay_file(struct ra_replay *rp, const char *path)
+{
+	struct file *filp;
+
+	if (rp->last_path && !strcmp(rp->last_path, path))
+		return rp->files[rp->nr_files - 1];
+
+	if (rp->nr_files == rp->max_files) {
+		unsigned int max = rp->max_files ? rp->max_files * 2 : 64;
+		struct file **files;
+
+		files = krealloc(rp->files, max * sizeof(*files), GFP_KERNEL);
+		if (!files)
+			return ERR_PTR(-ENOMEM);
+		rp->files = files;
+		rp->max_files = max;
+	}
+
+	filp = filp_open(path, O_RDONLY | O_LARGEFILE, 0);
+	if (IS_ERR(filp))
+		return filp;
+
+	kfree(rp->last_path);
+	rp->last_path = kstrdup(path, GFP_KERNEL);
+	rp->files[rp->nr_files++] = filp;
+	return filp;
+}
+
+static int ra_replay_line(struct ra_replay *rp, char *line)
+{
+	struct ra_replay_range *r;
+	struct file *filp;
+	unsigned long start, nr;
+	char *p = line;
+
+	while (isspace(*p))
+		p++;
+	if (!*p)
+		return 0;
+
+	start = simple_strtoul(p, &p, 10);
+	if (*p++ != ' ')
+		return -EINVAL;
+	nr = simple_strtoul(p, &p, 10);
+	if (*p++ != ' ' || *p != '/' || !nr)
+		return -EINVAL;
+	ra_unescape(p);
+
+	if (rp->nr_ranges >= RA_TRACE_MAX_RANGES)
+		return -ENOSPC;
+
+	/* files that went away since the trace was taken are skipped */
+	filp = ra_replay_file(rp, p);
+	if (IS_ERR(filp))
+		return PTR_ERR(filp) == -ENOMEM ? -ENOMEM : 0;
+
+	r = &rp->ranges[rp->nr_ranges++];
+	r->filp = filp;
+	r->start = start;
+	r->nr = nr;
+	return 0;
+}
+
+static int ra_replay_cmp(const void *a, const void *b)
+{
+	const struct ra_replay_range *ra = a, *rb = b;
+	struct inode *ia = ra->filp->f_mapping->host;
+	struct inode *ib = rb->filp->f_mapping->host;
+
+	if (ia->i_sb->s_dev != ib->i_sb->s_dev)
+		return ia->i_sb->s_dev < ib->i_sb->s_dev ? -1 : 1;
+	if (ia->i_ino != ib->i_ino)
+		return ia->i_ino < ib->i_ino ? -1 : 1;
+	if (ra->start != rb->start)
+		return ra->start < rb->start ? -1 : 1;
+	return 0;
+}
+
+static void ra_replay_submit(struct ra_replay *rp)
+{
+	struct ra_replay_range *r = rp->ranges;
+	unsigned int i, n = 0;
+
+	if (!rp->nr_ranges)
+		return;
+
+	sort(r, rp->nr_ranges, sizeof(*r), ra_replay_cmp, NULL);
+	for (i = 1; i < rp->nr_ranges; i++) {
+		if (r[i].filp->f_mapping == r[n].filp->f_mapping &&
+		    r[i].start <= r[n].start + r[n].nr) {
+			pgoff_t end = max(r[n].start + r[n].nr,
+					  r[i].start + r[i].nr);
+			r[n].nr = end - r[n].start;
+		} else {
+			r[++n] = r[i];
+		}
+	}
+
+	for (i = 0; i <= n; i++) {
+		force_page_cache_readahead(r[i].filp->f_mapping, r[i].filp,
+					   r[i].start, r[i].nr);
+		cond_resched();
+	}
+}
+
+static int ra_replay_open(struct inode *inode, struct file *file)
+{
+	struct ra_replay *rp;
+
+	rp = kzalloc(sizeof(*rp), GFP_KERNEL);
+	if (!rp)
+		return -ENOMEM;
+	rp->ranges = vmalloc(RA_TRACE_MAX_RANGES * sizeof(*rp->ranges));
+	if (!rp->ranges) {
+		kfree(rp);
+		return -ENOMEM;
+	}
+	file->private_data = rp;
+	return 0;
+}
+
+static ssize_t ra_replay_write(struct file *file, const char __user *buf,
+			       size_t count, loff_t *ppos)
+{
+	struct ra_replay *rp = file->private_data;
+	size_t done = 0;
+	char *eol;
+	int ret;
+
+	while (done < count) {
+		size_t n = min(count - done, sizeof(rp->line) - 1 - rp->len);
+
+		if (!n)
+			return -ENAMETOOLONG;
+		if (copy_from_user(rp->line + rp->len, buf + done, n))
+			return -EFAULT;
+		rp->len += n;
+		done += n;
+		rp->line[rp->len] = '\0';
+
+		while ((eol = strchr(rp->line, '\n'))) {
+			*eol++ = '\0';
+			ret = ra_replay_line(rp, rp->line);
+			rp->len -= eol - rp->line;
+			memmove(rp->line, eol, rp->len + 1);
+			if (ret)
+				return ret;
+		}
+	}
+	return count;
+}
+
+static int ra_replay_release(struct inode *inode, struct file *file)
+{
+	struct ra_replay *rp = file->private_data;
+	unsigned int i;
+
+	if (rp->len)
+		ra_replay_line(rp, rp->line);
+	ra_replay_submit(rp);
+
+	for (i = 0; i < rp->nr_files; i++)
+		fput(rp->files[i]);
+	kfree(rp->files);
+	kfree(rp->last_path);
+	vfree(rp->ranges);
+	kfree(rp);
+	return 0;
+}
+
+static const struct file_operations ra_replay_fops = {
+	.open		= ra_replay_open,
+	.write		= ra_replay_write,
+	.release	= ra_replay_release,
+};
+
+static int __init ra_trace_init(void)
+{
+	struct proc_dir_entry *dir;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(ra_trace_hash); i++)
+		INIT_HLIST_HEAD(&ra_trace_hash[i]);
+
+	dir = proc_mkdir("readahead", NULL);
+	if (!dir)
+		return -ENOMEM;
+	proc_create("record", S_IRUSR | S_IWUSR, dir, &ra_record_fops);
+	proc_create("trace", S_IRUSR, dir, &ra_trace_fops);
+	proc_create("replay", S_IWUSR, dir, &ra_replay_fops);
+	return 0;
+}
+module_init(ra_trace_init);
@@ -1032,6 +1032,9 @@ static int try_to_unmap_anon(struct page *page, enum ttu_flags flags)
 				continue;  /* must visit all unlocked vmas */
 			ret = SWAP_MLOCK;  /* saw at least one mlocked vma */
 		} else {
+			if (PAGE_MIGRATION && TTU_ACTION(flags) == TTU_MIGRATION &&
+			    is_vma_temporary_stack(vma))
+				continue;
 			ret = try_to_unmap_one(page, vma, flags);
 			if (ret == SWAP_FAIL || !page_mapped(page))
 				break;
@@ -15,6 +15,8 @@
 #include <linux/cpu.h>
 #include <linux/vmstat.h>
 #include <linux/sched.h>
+#include <linux/math64.h>
+#include <linux/compaction.h>
 
 #ifdef CONFIG_VM_EVENT_COUNTERS
 DEFINE_PER_CPU(struct vm_event_state, vm_event_states) = {{0}};
@@ -376,6 +378,41 @@ void zone_statistics(struct zone *preferred_zone, struct zone *z)
 }
 #endif
 
+#ifdef CONFIG_COMPACTION
+/*
+ * The fragmentation index tells whether an allocation of a given order
+ * that failed did so for lack of memory or because the free memory is
+ * fragmented.  It lies between 0 and 1000: towards 0 there is simply too
+ * little free memory and only reclaim helps, towards 1000 there is plenty
+ * but in blocks too small, which is when compaction is worth running.
+ * -1000 means a block of the order is free and the allocation would only
+ * fail on the watermarks.
+ */
+int fragmentation_index(struct zone *zone, unsigned int order)
+{
+	unsigned long free_pages = 0, free_blocks = 0, suitable = 0;
+	unsigned long requested = 1UL << order;
+	unsigned int o;
+
+	for (o = 0; o < MAX_ORDER; o++) {
+		unsigned long blocks = zone->free_area[o].nr_free;
+
+		free_blocks += blocks;
+		free_pages += blocks << o;
+		if (o >= order)
+			suitable += blocks << (o - order);
+	}
+
+	if (!free_blocks)
+		return 0;
+	if (suitable)
+		return -1000;
+
+	return 1000 - div_u64(1000 + div_u64(free_pages * 1000ULL, requested),
+			      free_blocks);
+}
+#endif
+
 #ifdef CONFIG_PROC_FS
 #include <linux/proc_fs.h>
 #include <linux/seq_file.h>
@@ -670,6 +707,8 @@ static const char * const vmstat_text[] = {
 
 	"pgfault",
 	"pgmajfault",
+	"pgfaultaround",
+	"pgfaultaround_hit",
 
 	TEXTS_FOR_ZONES("pgrefill")
 	TEXTS_FOR_ZONES("pgsteal")
@@ -687,6 +726,8 @@ static const char * const vmstat_text[] = {
 	"allocstall",
 
 	"pgrotated",
+	"workingset_refault",
+	"workingset_activate",
 #ifdef CONFIG_HUGETLB_PAGE
 	"htlb_buddy_alloc_success",
 	"htlb_buddy_alloc_fail",
@@ -699,6 +740,14 @@ static const char * const vmstat_text[] = {
 	"unevictable_pgs_cleared",
 	"unevictable_pgs_stranded",
 	"unevictable_pgs_mlockfreed",
+#ifdef CONFIG_COMPACTION
+	"compact_blocks_moved",
+	"compact_pages_moved",
+	"compact_pagemigrate_failed",
+	"compact_stall",
+	"compact_fail",
+	"compact_success",
+#endif
 #endif
 };
 
@@ -0,0 +1,248 @@
+/*
+ * Workingset detection benchmark
+ *
+ * Models a user switching between apps: each app is a file of app_kb,
+ * and using an app reads its file passes times.  The first hot apps are
+ * the ones the user keeps coming back to; every other app is used once
+ * per round, always followed by a return to one of the hot apps.  All the
+ * apps together are meant to be larger than memory, the hot ones to fit.
+ *
+ * Before each use the module counts how much of the app is still in the
+ * page cache, and per round it prints that for the hot and the cold apps
+ * along with the workingset_refault and workingset_activate counters.
+ * Unless app_kb is given, the apps are sized so that all of them together
+ * take one and a half times the memory of the machine.  A good working
+ * set detection keeps the hot apps resident however much the cold ones
+ * churn; vm.workingset_detection=0 gives the numbers without it:
+ *
+ *	sysctl -w vm.workingset_detection=0
+ *	insmod workingset-test.ko dir=/data/local/tmp apps=12 hot=3
+ *	sysctl -w vm.workingset_detection=1
+ *	insmod workingset-test.ko dir=/data/local/tmp apps=12 hot=3
+ *	rm /data/local/tmp/wstest.*
+ *
+ * The benchmark runs at load time and the load then fails with -EAGAIN,
+ * so nothing stays loaded between runs.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2
+ * of the License.
+ */
+
+#include <linux/fs.h>
+#include <linux/file.h>
+#include <linux/hrtimer.h>
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/moduleparam.h>
+#include <linux/pagemap.h>
+#include <linux/sched.h>
+#include <linux/slab.h>
+#include <linux/uaccess.h>
+#include <linux/vmstat.h>
+
+#define PRINT_PREF KERN_INFO "workingset_test: "
+
+static char *dir = "/data/local/tmp";
+module_param(dir, charp, S_IRUGO);
+MODULE_PARM_DESC(dir, "Directory for the app files");
+
+static unsigned int apps = 12;
+module_param(apps, uint, S_IRUGO);
+MODULE_PARM_DESC(apps, "Number of apps");
+
+static unsigned int hot = 3;
+module_param(hot, uint, S_IRUGO);
+MODULE_PARM_DESC(hot, "Number of apps the user keeps returning to");
+
+static unsigned int app_kb;
+module_param(app_kb, uint, S_IRUGO);
+MODULE_PARM_DESC(app_kb, "Working set of one app in KiB "
+		 "(default: all apps take 1.5 times memory)");
+
+static unsigned int passes = 2;
+module_param(passes, uint, S_IRUGO);
+MODULE_PARM_DESC(passes, "Reads of the working set per use");
+
+static unsigned int rounds = 5;
+module_param(rounds, uint, S_IRUGO);
+MODULE_PARM_DESC(rounds, "Number of rounds through all apps");
+
+#define BUF_SIZE	(16 * 1024)
+
+static struct file **files;
+static char *buf;
+
+struct residency {
+	unsigned long resident;
+	unsigned long total;
+};
+
+static int create_app(unsigned int i)
+{
+	char name[128];
+	struct file *file;
+	loff_t pos = 0;
+	mm_segment_t old_fs;
+	unsigned long left = (unsigned long)app_kb * 1024;
+	int err = 0;
+
+	snprintf(name, sizeof(name), "%s/wstest.%u", dir, i);
+	file = filp_open(name, O_RDWR | O_CREAT | O_TRUNC | O_LARGEFILE, 0600);
+	if (IS_ERR(file)) {
+		printk(PRINT_PREF "cannot create %s: %ld\n", name,
+		       PTR_ERR(file));
+		return PTR_ERR(file);
+	}
+
+	memset(buf, i + 1, BUF_SIZE);
+	old_fs = get_fs();
+	set_fs(KERNEL_DS);
+	while (left) {
+		size_t len = min_t(unsigned long, left, BUF_SIZE);
+		ssize_t ret = vfs_write(file, (char __user *)buf, len, &pos);
+
+		if (ret != len) {
+			err = ret < 0 ? ret : -ENOSPC;
+			break;
+		}
+		left -= len;
+	}
+	set_fs(old_fs);
+
+	if (!err)
+		err = vfs_fsync(file, file->f_path.dentry, 0);
+	if (err) {
+		printk(PRINT_PREF "cannot write %s: %d\n", name, err);
+		filp_close(file, NULL);
+		return err;
+	}
+
+	/* start out cold */
+	invalidate_mapping_pages(file->f_mapping, 0, -1);
+	files[i] = file;
+	return 0;
+}
+
+static void count_resident(struct file *file, struct residency *r)
+{
+	struct address_space *mapping = file->f_mapping;
+	pgoff_t index, end;
+
+	end = ((unsigned long)app_kb * 1024) >> PAGE_CACHE_SHIFT;
+
+	for (index = 0; index < end; index++) {
+		struct page *page = find_get_page(mapping, index);
+
+		if (page) {
+			r->resident++;
+			page_cache_release(page);
+		}
+	}
+	r->total += end;
+}
+
+static int use_app(unsigned int i, struct residency *r)
+{
+	unsigned long size = (unsigned long)app_kb * 1024;
+	unsigned int pass;
+	loff_t off;
+
+	count_resident(files[i], r);
+
+	for (pass = 0; pass < passes; pass++) {
+		for (off = 0; off < size; off += BUF_SIZE) {
+			int ret = kernel_read(files[i], off, buf, BUF_SIZE);
+
+			if (ret < 0)
+				return ret;
+			if (fatal_signal_pending(current))
+				return -EINTR;
+			cond_resched();
+		}
+	}
+	return 0;
+}
+
+static unsigned int percent(struct residency *r)
+{
+	return r->total ? r->resident * 100 / r->total : 0;
+}
+
+static int run_round(unsigned int round)
+{
+	unsigned long before[NR_VM_EVENT_ITEMS], after[NR_VM_EVENT_ITEMS];
+	struct residency hot_r = { 0, 0 }, cold_r = { 0, 0 };
+	ktime_t t0 = ktime_get();
+	unsigned int i;
+	int err;
+
+	all_vm_events(before);
+
+	for (i = hot; i < apps; i++) {
+		err = use_app(i % hot, &hot_r);
+		if (!err)
+			err = use_app(i, &cold_r);
+		if (err)
+			return err;
+	}
+
+	all_vm_events(after);
+
+	printk(PRINT_PREF "round %u: resident hot %u%% cold %u%%, "
+	       "%lu refaults, %lu activations, %llu ms\n", round,
+	       percent(&hot_r), percent(&cold_r),
+	       after[WORKINGSET_REFAULT] - before[WORKINGSET_REFAULT],
+	       after[WORKINGSET_ACTIVATE] - before[WORKINGSET_ACTIVATE],
+	       (unsigned long long)div_u64(ktime_to_ns(ktime_sub(ktime_get(),
+							t0)), NSEC_PER_MSEC));
+	return 0;
+}
+
+static int __init workingset_test_init(void)
+{
+	unsigned int i;
+	int err = 0;
+
+	if (!hot || hot >= apps)
+		return -EINVAL;
+	if (!app_kb)
+		app_kb = (totalram_pages << (PAGE_SHIFT - 10)) * 3 / 2 / apps;
+
+	files = kcalloc(apps, sizeof(*files), GFP_KERNEL);
+	buf = kmalloc(BUF_SIZE, GFP_KERNEL);
+	if (!files || !buf) {
+		err = -ENOMEM;
+		goto out;
+	}
+
+	printk(PRINT_PREF "%u apps of %u KiB, %u hot, %u rounds\n",
+	       apps, app_kb, hot, rounds);
+
+	for (i = 0; i < apps; i++) {
+		err = create_app(i);
+		if (err)
+			goto out;
+	}
+
+	for (i = 1; i <= rounds; i++) {
+		err = run_round(i);
+		if (err)
+			break;
+	}
+
+ out:
+	if (files) {
+		for (i = 0; i < apps; i++)
+			if (files[i])
+				filp_close(files[i], NULL);
+	}
+	kfree(files);
+	kfree(buf);
+	return err ? err : -EAGAIN;
+}
+
+module_init(workingset_test_init);
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("Workingset detection benchmark");
@@ -0,0 +1,170 @@
+/*
+ * Workingset detection
+ *
+ * When a page cache page is reclaimed, a shadow entry recording when it
+ * happened is left behind.  If the page is read back in before the shadow
+ * is overwritten, the number of pages evicted or activated in between -
+ * the refault distance - tells how much more memory the page would have
+ * needed to stay resident.  When that distance is no larger than the
+ * active file list, the page belongs to the working set and is put on
+ * the active list right away, instead of starting over on the inactive
+ * list and being evicted again before its second access is noticed.
+ *
+ * The page cache radix tree of this kernel can only hold pages, so the
+ * shadows live in a fixed size hash table indexed by mapping and offset,
+ * about one slot per page of memory.  A slot holds a few bits of the
+ * hash as a signature, the zone and the eviction counter.  Newer
+ * evictions overwrite older ones, and a shadow that outlives its file
+ * can at worst activate an unrelated page once; both only cost accuracy.
+ *
+ * The vm.workingset_detection sysctl turns it off, so that its effect on a
+ * workload can be measured against the same kernel.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2
+ * of the License.
+ */
+#include <linux/mm.h>
+#include <linux/mmzone.h>
+#include <linux/swap.h>
+#include <linux/jhash.h>
+#include <linux/bootmem.h>
+#include <linux/vmstat.h>
+#include <linux/init.h>
+
+#define SHADOW_VALID		1UL
+#define SHADOW_SIG_BITS		8
+#define SHADOW_ZONE_BITS	(NODES_SHIFT + ZONES_SHIFT)
+#define EVICTION_SHIFT		(1 + SHADOW_SIG_BITS + SHADOW_ZONE_BITS)
+#define EVICTION_MASK		(~0UL >> EVICTION_SHIFT)
+
+int sysctl_workingset_detection __read_mostly = 1;
+
+static unsigned long *shadow_table __read_mostly;
+static unsigned int shadow_shift __read_mostly;
+static unsigned int shadow_mask __read_mostly;
+
+static unsigned long *shadow_slot(struct address_space *mapping,
+				  pgoff_t index, unsigned long *sig)
+{
+	u32 hash = jhash_2words((u32)(unsigned long)mapping, (u32)index, 0);
+
+	*sig = hash >> (32 - SHADOW_SIG_BITS);
+	return &shadow_table[hash & shadow_mask];
+}
+
+static unsigned long pack_shadow(unsigned long eviction, struct zone *zone,
+				 unsigned long sig)
+{
+	eviction = (eviction << NODES_SHIFT) | zone_to_nid(zone);
+	eviction = (eviction << ZONES_SHIFT) | zone_idx(zone);
+	eviction = (eviction << SHADOW_SIG_BITS) | sig;
+	return (eviction << 1) | SHADOW_VALID;
+}
+
+static void unpack_shadow(unsigned long entry, struct zone **zone,
+			  unsigned long *eviction, unsigned long *sig)
+{
+	int zid, nid;
+
+	entry >>= 1;
+	*sig = entry & ((1UL << SHADOW_SIG_BITS) - 1);
+	entry >>= SHADOW_SIG_BITS;
+	zid = entry & ((1UL << ZONES_SHIFT) - 1);
+	entry >>= ZONES_SHIFT;
+	nid = entry & ((1UL << NODES_SHIFT) - 1);
+	entry >>= NODES_SHIFT;
+
+	*zone = NODE_DATA(nid)->node_zones + zid;
+	*eviction = entry;
+}
+
+/**
+ * workingset_eviction - note the eviction of a page from memory
+ * @mapping: address space the page was backing
+ * @page: the page being evicted
+ *
+ * Called from page reclaim with the mapping's tree_lock held, just
+ * before @page leaves the page cache.
+ */
+void workingset_eviction(struct address_space *mapping, struct page *page)
+{
+	struct zone *zone = page_zone(page);
+	unsigned long eviction, sig, *slot;
+
+	if (!shadow_table || !sysctl_workingset_detection)
+		return;
+
+	eviction = atomic_long_inc_return(&zone->inactive_age);
+	slot = shadow_slot(mapping, page->index, &sig);
+	*slot = pack_shadow(eviction & EVICTION_MASK, zone, sig);
+}
+
+/**
+ * workingset_refault - evaluate the refault of a previously evicted page
+ * @mapping: address space the page is read into
+ * @index: offset of the page in @mapping
+ *
+ * Consumes the shadow entry left by the eviction of the page, if there
+ * still is one, and calculates the refault distance.
+ *
+ * Returns %true if the page should be activated, %false otherwise.
+ */
+bool workingset_refault(struct address_space *mapping, pgoff_t index)
+{
+	unsigned long entry, eviction, refault, sig, entry_sig;
+	unsigned long *slot;
+	struct zone *zone;
+
+	if (!shadow_table || !sysctl_workingset_detection)
+		return false;
+
+	slot = shadow_slot(mapping, index, &sig);
+	entry = *slot;
+	if (!(entry & SHADOW_VALID))
+		return false;
+	unpack_shadow(entry, &zone, &eviction, &entry_sig);
+	if (entry_sig != sig)
+		return false;
+	/* a racing eviction may have reused the slot, leave it be then */
+	if (cmpxchg(slot, entry, 0) != entry)
+		return false;
+
+	refault = atomic_long_read(&zone->inactive_age);
+
+	/*
+	 * The masked subtraction copes with the counter wrapping.  A
+	 * shadow that outlives a whole wrap reports a distance that is
+	 * too short; the page is then activated needlessly, and reclaim
+	 * sorts that out like any other misprediction.
+	 */
+	count_vm_event(WORKINGSET_REFAULT);
+	if (((refault - eviction) & EVICTION_MASK) <=
+	    zone_page_state(zone, NR_ACTIVE_FILE)) {
+		count_vm_event(WORKINGSET_ACTIVATE);
+		return true;
+	}
+	return false;
+}
+
+/**
+ * workingset_activation - note a page activation
+ * @page: page that is being activated
+ */
+void workingset_activation(struct page *page)
+{
+	atomic_long_inc(&page_zone(page)->inactive_age);
+}
+
+static int __init workingset_init(void)
+{
+	/* one shadow slot per page of low memory */
+	shadow_table = alloc_large_system_hash("Workingset shadow",
+					       sizeof(unsigned long), 0,
+					       PAGE_SHIFT, 0, &shadow_shift,
+					       &shadow_mask, 0);
+	memset(shadow_table, 0, sizeof(unsigned long) << shadow_shift);
+	return 0;
+}
+core_initcall(workingset_init);
@@ -22,6 +22,7 @@
 
 #include <linux/delay.h>
 #include <linux/earlysuspend.h>
+#include <linux/sensor-poll.h>
 
 #include "main.h"
 #include "L_dev.h"
@@ -35,7 +36,8 @@
 
 // ryun MADC CHANNEL
 #define TWL4030_MADC_CHANNEL_LIGHT	    2
-#define DEFAULT_POLLING_INTERVAL	    100 // ryun 20100124 set 500ms for test. // Archer_LSJ DB17 : 500 => 300 => 100
+// ms; 100 was taken as jiffies before the shared poller, 781 ms at HZ=128
+#define DEFAULT_POLLING_INTERVAL	    781 // ryun 20100124 set 500ms for test. // Archer_LSJ DB17 : 500 => 300 => 100
 
 /*Data Structures*/
 /**************************************************************/
@@ -92,8 +94,6 @@ static int get_illum_lvl(u32, u16 *);
 
 /**************************************************************/
 
-static struct workqueue_struct *light_wq;
-
 /*Light sensor device structure*/
 /**************************************************************/
 static L_device_t L_dev =
@@ -154,10 +154,13 @@ static int lcdBrightnessCount = 0;
 
 // static DECLARE_WAIT_QUEUE_HEAD(lightadc_work);
 
-/*work struct*/
-//static struct work_struct L_ws;
-static void L_dev_work_func (struct work_struct *);
-static DECLARE_DELAYED_WORK(L_ws, L_dev_work_func);
+/*sampled by the shared sensor poller, polling_time is in ms*/
+static void L_dev_poll_func(struct sensor_poll_client *, ktime_t);
+static struct sensor_poll_client L_poll_client =
+{
+    .name = "light",
+    .poll = L_dev_poll_func,
+};
 #ifdef CONFIG_HAS_EARLYSUSPEND
 static int L_dev_early_suspend(struct early_suspend* handler);
 static int L_dev_early_resume(struct early_suspend* handler);
@@ -217,12 +220,6 @@ int L_dev_init(void)
         failed(2);
     }
 
-    // ryun 20091028 init workqueue
-    INIT_DELAYED_WORK(&L_ws, (void (*) (struct work_struct *))L_dev_work_func);
-    light_wq = create_singlethread_workqueue("light_wq");
-    if (!light_wq)
-        return -ENOMEM;
-
 #ifdef CONFIG_HAS_EARLYSUSPEND
     L_dev.early_suspend.level = EARLY_SUSPEND_LEVEL_BLANK_SCREEN + 1 ;
     L_dev.early_suspend.suspend = (void *)L_dev_early_suspend;
@@ -241,6 +238,8 @@ int L_dev_exit(void)
 
     trace_in();
 
+    sensor_poll_stop(&L_poll_client);
+
     LOCK();
 
     // [[ ryun
@@ -259,9 +258,6 @@ int L_dev_exit(void)
 
     input_unregister_device(L_dev.inputdevice);	
 
-    if (light_wq)
-        destroy_workqueue(light_wq);
-
     UNLOCK();
 
     trace_out();
@@ -278,8 +274,6 @@ static int L_dev_early_suspend(struct early_suspend* handler)
     if(L_dev.saved_polling_state == L_SYSFS_POLLING_ON)
     {
         debug("[light] L_dev_suspend(void)\n");
-        flush_work(&L_ws);
-        cancel_delayed_work_sync(&L_ws);
         L_dev_polling_stop();
         L_dev.saved_polling_state = L_SYSFS_POLLING_ON;
         L_dev.cur_polling_state = L_SYSFS_POLLING_OFF;
@@ -316,6 +310,17 @@ int L_dev_suspend(void)
 
     trace_in();
 
+#ifndef CONFIG_HAS_EARLYSUSPEND
+    /*not under L_dev.lock, the poller takes it with its own mutex held*/
+    if(L_dev.saved_polling_state == L_SYSFS_POLLING_ON)
+    {
+        debug("[light] L_dev_suspend(void)\n");
+        L_dev_polling_stop();	
+        L_dev.saved_polling_state = L_SYSFS_POLLING_ON;
+        L_dev.cur_polling_state = L_SYSFS_POLLING_OFF;
+    }
+#endif
+
     LOCK();   
 
     if( L_dev.device_state == NOT_OPERATIONAL )
@@ -325,17 +330,6 @@ int L_dev_suspend(void)
     }
     else if( L_dev.ldo_state == OPERATIONAL )
     {
-#ifndef CONFIG_HAS_EARLYSUSPEND
-        if(L_dev.saved_polling_state == L_SYSFS_POLLING_ON)
-        {
-            debug("[light] L_dev_suspend(void)\n");
-            flush_work(&L_ws);
-            cancel_delayed_work_sync(&L_ws);
-            L_dev_polling_stop();	
-            L_dev.saved_polling_state = L_SYSFS_POLLING_ON;
-            L_dev.cur_polling_state = L_SYSFS_POLLING_OFF;
-        }
-#endif
 #if 0
         // [[ ryun
         //resource_release(L_dev.t2_vintana2_ldo);
@@ -359,6 +353,7 @@ int L_dev_suspend(void)
 int L_dev_resume(void)
 {
     int ret = 0;
+    int start_polling = 0;
 
     trace_in();
     LOCK();   
@@ -393,15 +388,19 @@ int L_dev_resume(void)
         debug("[light] resume!! L_dev.cur_polling_state=%d, L_dev.saved_polling_state=%d \n", L_dev.cur_polling_state, L_dev.saved_polling_state);
         if(L_dev.cur_polling_state == L_SYSFS_POLLING_OFF
         && L_dev.saved_polling_state == L_SYSFS_POLLING_ON)
-        {
-            debug("[light] L_dev_resume() : L_dev_polling_start() L_dev.polling_time = %d ms \n", L_dev.polling_time);
-            L_dev.saved_polling_state = L_SYSFS_POLLING_OFF;
-            L_dev_polling_start();
-            L_dev.cur_polling_state = L_SYSFS_POLLING_ON;
-        }
+            start_polling = 1;
 #endif
     }
     UNLOCK(); 
+
+    /*not under L_dev.lock, the poller takes it with its own mutex held*/
+    if(start_polling)
+    {
+        debug("[light] L_dev_resume() : L_dev_polling_start() L_dev.polling_time = %d ms \n", L_dev.polling_time);
+        L_dev.saved_polling_state = L_SYSFS_POLLING_OFF;
+        L_dev_polling_start();
+        L_dev.cur_polling_state = L_SYSFS_POLLING_ON;
+    }
     trace_out();
     return ret;
 }
@@ -607,9 +606,8 @@ int L_dev_polling_start(void)
 		return L_dev.saved_polling_state;
 	}
     
-//	schedule_delayed_work(&L_ws, L_dev.polling_time);
-	cancel_delayed_work_sync(&L_ws);
-	queue_delayed_work(light_wq, &L_ws, L_dev.polling_time);
+	L_poll_client.interval = L_dev.polling_time;
+	sensor_poll_start(&L_poll_client);
 
  	 L_dev.saved_polling_state = L_SYSFS_POLLING_ON;
 	 return L_dev.saved_polling_state;
@@ -624,8 +622,7 @@ int L_dev_polling_stop(void)
 		return L_dev.saved_polling_state;
 	}
 
-	flush_work(&L_ws);
-	cancel_delayed_work_sync(&L_ws);
+	sensor_poll_stop(&L_poll_client);
 
 	L_dev.saved_polling_state = L_SYSFS_POLLING_OFF;
 	return L_dev.saved_polling_state;
@@ -651,17 +648,18 @@ unsigned long L_dev_get_polling_interval( void )
 void L_dev_set_polling_interval(unsigned long interval)
 {
 	L_dev.polling_time = interval;
+	sensor_poll_set_interval(&L_poll_client, interval);
 }
 #endif	// ryun 20091212 for OSCAR
 
 
-static void L_dev_work_func (struct work_struct *unused)
+static void L_dev_poll_func(struct sensor_poll_client *client, ktime_t stamp)
 {
 	u32 adc_val;
 
 	trace_in() ;
 
-	debug("[light] L_dev_work_func(), L_dev.saved_polling_state= %d\n", L_dev.saved_polling_state);
+	debug("[light] L_dev_poll_func(), L_dev.saved_polling_state= %d\n", L_dev.saved_polling_state);
     if( !(L_dev.saved_polling_state) )
 //	if(L_dev.op_state)
 	{
@@ -682,15 +680,9 @@ static void L_dev_work_func (struct work_struct *unused)
 			input_report_abs(L_dev.inputdevice, ABS_MISC, adc_val);
 			input_sync(L_dev.inputdevice);
 			L_dev.prev_adc_level = adc_level;
-			debug("[light] L_dev_work_func() light output...adc_val = %d ", adc_val);
+			debug("[light] L_dev_poll_func() light output...adc_val = %d ", adc_val);
 		}
 	}
 
-	// debug("[light] schedule_delayed_work(&L_ws, DEFAULT_POLLING_INTERVAL=%d ms);", DEFAULT_POLLING_INTERVAL);
-	// cancel_delayed_work_sync(&L_ws);
-	// schedule_delayed_work(&L_ws, L_dev.polling_time);	// ryun 20091030 
-
-	queue_delayed_work(light_wq, &L_ws, L_dev.polling_time);
-
 	trace_out() ;
 }
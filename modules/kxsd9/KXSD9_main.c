@@ -24,6 +24,7 @@
 #include <linux/timer.h>
 #include <linux/delay.h>
 #include <linux/earlysuspend.h>
+#include <linux/sensor-poll.h>
 
 #include "KXSD9_sysfs.h"
 #include "KXSD9_i2c_drv.h"
@@ -75,8 +76,6 @@ void (*KXSD9_report_func)( KXSD9_acc_t* ) ;
 
 KXSD9_module_param_t *KXSD9_main_getparam( void ) ;
 
-static struct workqueue_struct* accel_wq ;
-
 /*file operatons*/
 static int KXSD9_open (struct inode *, struct file *);
 static int KXSD9_release (struct inode *, struct file *);
@@ -84,9 +83,13 @@ static int KXSD9_ioctl(struct inode *, struct file *, unsigned int,  unsigned lo
 static ssize_t KXSD9_read(struct file *filp, char *buf, size_t count, loff_t *ofs);
 static unsigned int KXSD9_poll(struct file *filp, struct poll_table_struct *pwait);
 
-/*work struct*/
-static void work_function( struct work_struct* ) ;
-static DECLARE_DELAYED_WORK( KXSD9_ws, work_function ) ;
+/*sampled by the shared sensor poller*/
+static void KXSD9_poll_func( struct sensor_poll_client*, ktime_t ) ;
+static struct sensor_poll_client KXSD9_poll_client =
+{
+    .name= "accel",
+    .poll= KXSD9_poll_func,
+};
 
 /*input device, for input_report_abs()*/
 static struct input_dev* input_dev ;
@@ -490,7 +493,7 @@ static int KXSD9_release (struct inode *inode, struct file *filp)
     return 0;
 }
 
-void work_function( struct work_struct* unused )
+static void KXSD9_poll_func( struct sensor_poll_client* client, ktime_t stamp )
 {
     KXSD9_acc_t *acc = NULL;
     
@@ -507,7 +510,7 @@ void work_function( struct work_struct* unused )
     
     if( acc == NULL ) 
     {
-        printk("%s: work_function: acc is NULL\n", __FUNCTION__ );	
+        printk("%s: KXSD9_poll_func: acc is NULL\n", __FUNCTION__ );	
     }
 
     KXSD9_report_func( acc ) ;
@@ -517,8 +520,6 @@ void work_function( struct work_struct* unused )
         kfree(acc);
     }
 
-    queue_delayed_work( accel_wq, &KXSD9_ws, msecs_to_jiffies(KXSD9_timer.polling_time) ) ;
-
     trace_out() ;
 }
 
@@ -775,8 +776,8 @@ int KXSD9_timer_enable( unsigned long timeout )
 
     KXSD9_timer.polling_time= timeout ;
 
-    cancel_delayed_work_sync( &KXSD9_ws ) ;
-    queue_delayed_work( accel_wq, &KXSD9_ws, msecs_to_jiffies(KXSD9_timer.polling_time) ) ;
+    KXSD9_poll_client.interval= KXSD9_timer.polling_time ;
+    sensor_poll_start( &KXSD9_poll_client ) ;
     
     KXSD9_timer.current_timer_state= TIMER_ON ;
 
@@ -797,8 +798,7 @@ int KXSD9_timer_disable( void )
         return KXSD9_timer.current_timer_state ;
     }   
 
-    flush_work( (struct work_struct *)&KXSD9_ws ) ;
-    cancel_delayed_work_sync( &KXSD9_ws ) ;
+    sensor_poll_stop( &KXSD9_poll_client ) ;
 
     KXSD9_timer.current_timer_state= TIMER_OFF ;
 
@@ -808,15 +808,6 @@ int KXSD9_timer_disable( void )
     return KXSD9_timer.current_timer_state ;
 }
 
-void KXSD9_timer_timeout( unsigned long dataAddr )
-{
-    trace_in() ;
-
-    schedule_delayed_work( &KXSD9_ws, 0 ) ;
-
-    trace_out() ;
-}
-
 unsigned long KXSD9_timer_get_polling_time( void )
 {
     return KXSD9_timer.polling_time ;
@@ -834,6 +825,7 @@ void KXSD9_timer_set_polling_time( int timeout )
     {
         KXSD9_timer.polling_time= DEFAULT_POLLING_INTERVAL ;
     }
+    sensor_poll_set_interval( &KXSD9_poll_client, KXSD9_timer.polling_time ) ;
     printk("%s: delay= %d\n", __FUNCTION__, (int)KXSD9_timer.polling_time );
 
     trace_out() ;
@@ -1067,14 +1059,6 @@ int __init KXSD9_driver_init(void)
     }
     */
 
-    INIT_DELAYED_WORK( &KXSD9_ws, (void(*)(struct work_struct*))work_function ) ;
-    accel_wq= create_singlethread_workqueue( "accel_wq" ) ;
-    if( accel_wq < 0 )
-    {
-      	printk( "%s, Can't create_singlethread_workqueue, ret= %d\n", __FUNCTION__, (int)accel_wq ) ;
-      	goto MISC_DREG ;
-    }
-
 #ifndef CONFIG_MACH_OSCAR
     if( (ret= KXSD9_sysfs_init( KXSD9_misc_device.this_device )) < 0 )
 #else
@@ -1122,6 +1106,8 @@ void __exit KXSD9_driver_exit(void)
 {
     trace_in() ;
 
+    sensor_poll_stop( &KXSD9_poll_client ) ;
+
     /*Delete the i2c driver*/
     KXSD9_i2c_drv_exit();
 
@@ -1133,8 +1119,6 @@ void __exit KXSD9_driver_exit(void)
     
     input_unregister_device( input_dev ) ;
 
-    destroy_workqueue( accel_wq ) ;
-
     /*misc device deregistration*/
     misc_deregister(&KXSD9_misc_device);
 
@@ -76,8 +76,6 @@ extern KXSD9_module_param_t* KXSD9_main_getparam( void ) ;
 
 extern void (*KXSD9_report_func)( KXSD9_acc_t* ) ; 
 
-extern void KXSD9_timer_timeout( unsigned long ) ;
-
 extern int  KXSD9_timer_init( void ) ;
 extern int  KXSD9_timer_exit( void ) ;
 
@@ -47,6 +47,7 @@
 #define TINYFSR_PROC_DIR	"tinyFSR"
 
 extern struct semaphore fsr_mutex;
+extern int (*sec_stl_delete)(dev_t dev, u32 start, u32 nums, u32 b_size);
 
 FSRVolSpec *fsr_get_vol_spec(u32 volume);
 FSRPartI   *fsr_get_part_spec(u32 volume);
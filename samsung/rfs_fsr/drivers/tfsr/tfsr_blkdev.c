@@ -20,6 +20,9 @@
 #include <linux/fs.h>
 #include <linux/version.h>
 #include <linux/proc_fs.h>
+#include <linux/blkdev.h>
+#include <linux/genhd.h>
+#include <linux/moduleparam.h>
 #if LINUX_VERSION_CODE >= KERNEL_VERSION(2, 6, 15)
 #include <linux/platform_device.h>
 #else
@@ -142,6 +145,157 @@ static int bml_transfer(u32 volume, u32 partno, const struct request *req)
 	return 1;
 }
 
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(2, 6, 31)
+/*
+ * Discard for the STL block devices
+ *
+ * Filesystems live on the STL devices (major BLK_DEVICE_STL), whose
+ * sectors the STL maps onto flash pages.  The BML partitions here are raw
+ * and read only, so discards have to be taken from the STL devices.  The
+ * STL driver is not in this tree and its queues cannot discard, so once
+ * it is loaded, writing 1 to the stl_discard parameter makes its queues
+ * accept discards and takes the discard bios off them before they reach
+ * the driver.  Each range goes to the STL's delete hook with the STL
+ * device and 512 byte units, as RFS calls it for its freed clusters.
+ */
+
+/* the largest STL page; partial pages at either end keep their data */
+#define STL_DISCARD_ALIGN	(MAX_PAGE_SIZE >> SECTOR_BITS)
+
+static make_request_fn *stl_make_request;
+static int stl_discard;
+
+/**
+ * hand a discard bio on an STL device to the STL's delete
+ * @param q             : STL device queue
+ * @param bio           : bio submitted to the STL device
+ * @return              0, or what the STL's make_request function returns
+ *
+ * The delete runs when the bio is submitted, ahead of requests still
+ * queued.  Filesystems only discard blocks they have no I/O in flight
+ * to, so a barrier discard needs no draining.
+ */
+static int stl_discard_request(struct request_queue *q, struct bio *bio)
+{
+	sector_t first, last;
+	int error = 0;
+
+	if (!bio_rw_flagged(bio, BIO_RW_DISCARD))
+	{
+		return stl_make_request(q, bio);
+	}
+
+	first = ALIGN(bio->bi_sector, (sector_t) STL_DISCARD_ALIGN);
+	last = (bio->bi_sector + bio_sectors(bio)) &
+		~((sector_t) STL_DISCARD_ALIGN - 1);
+
+	if (NULL == sec_stl_delete)
+	{
+		error = -EOPNOTSUPP;
+	}
+	else if (first < last)
+	{
+		DEBUG(DL3,"TINY[I]: delete %u sectors at %u\n",
+			(u32) (last - first), (u32) first);
+
+		if (sec_stl_delete(disk_devt(bio->bi_bdev->bd_disk),
+			(u32) first, (u32) (last - first), SECTOR_SIZE))
+		{
+			ERRPRINTK("TINY: delete error at %u\n", (u32) first);
+			error = -EIO;
+		}
+	}
+
+	bio_endio(bio, error);
+	return 0;
+}
+
+/**
+ * let an STL device queue accept discards
+ * @param q             : STL device queue
+ * @return              0 on success, otherwise on error
+ */
+static int stl_discard_setup(struct request_queue *q)
+{
+	if (q->make_request_fn == stl_discard_request)
+	{
+		return 0;
+	}
+
+	/* all STL devices come from the same driver */
+	if (stl_make_request && q->make_request_fn != stl_make_request)
+	{
+		return -EINVAL;
+	}
+	stl_make_request = q->make_request_fn;
+
+	blk_queue_max_discard_sectors(q,
+		(UINT_MAX >> SECTOR_BITS) & ~(STL_DISCARD_ALIGN - 1));
+	q->make_request_fn = stl_discard_request;
+
+	spin_lock_irq(q->queue_lock);
+	queue_flag_set(QUEUE_FLAG_DISCARD, q);
+	spin_unlock_irq(q->queue_lock);
+
+	return 0;
+}
+
+/**
+ * set up discard on every STL device registered so far
+ * @param val           : "1"
+ * @param kp            : the stl_discard parameter
+ * @return              0 on success, otherwise on error
+ */
+static int stl_discard_set(const char *val, struct kernel_param *kp)
+{
+	struct gendisk *disk;
+	struct module *owner;
+	u32 volume, partno;
+	int part, count = 0;
+
+	if (simple_strtoul(val, NULL, 0) != 1)
+	{
+		return -EINVAL;
+	}
+
+	for (volume = 0; volume < FSR_MAX_VOLUMES; volume++)
+	{
+		for (partno = 0; partno < PARTITION_MASK; partno++)
+		{
+			disk = get_gendisk(MKDEV(BLK_DEVICE_STL,
+				fsr_minor(volume, partno)), &part);
+			if (NULL == disk)
+			{
+				continue;
+			}
+
+			owner = disk->fops->owner;
+			if (0 == part && 0 == stl_discard_setup(disk->queue))
+			{
+				count++;
+			}
+			put_disk(disk);
+			module_put(owner);
+		}
+	}
+
+	if (0 == count)
+	{
+		return -ENODEV;
+	}
+
+	printk(KERN_INFO "TinyFSR: discard on %d STL devices\n", count);
+	stl_discard = count;
+
+	return 0;
+}
+
+module_param_call(stl_discard, stl_discard_set, param_get_int,
+		  &stl_discard, 0644);
+MODULE_PARM_DESC(stl_discard, "Write 1 once the STL is loaded to pass "
+		 "discards on its devices to the STL");
+#endif
+
 /**
  * request function which is do read/write sector
  * @param rq    : request queue which is created by blk_init_queue()
@@ -0,0 +1,423 @@
+/*
+ * cmm_test: userspace test of the DSP bridge shared memory allocator
+ *
+ * Builds drivers/dsp/bridge/pmgr/cmm.c as a userspace program on top of
+ * lib/rbtree.c, registers an anonymous mapping as a shared memory segment
+ * and runs random allocations and frees through cmm_calloc_buf() and
+ * cmm_free_buf().  After every operation the allocator's trees and bins
+ * are checked:
+ *
+ *	- free and in-use blocks tile the segment exactly, in address order,
+ *	  and no two free blocks are adjacent (coalescing is complete);
+ *	- every free block is in the bin tree for its size, the bin trees
+ *	  are ordered by size and the bin bitmap matches the non-empty bins;
+ *	- every allocation got the block the allocator promises: the
+ *	  smallest fitting block of the request's own bin, else the smallest
+ *	  block of the next non-empty bin, lowest address first on ties.
+ *
+ * Every allocated buffer is filled with a pattern that is checked when it
+ * is freed, so overlapping allocations are caught as well.
+ *
+ * With -t the checks are skipped and the program times the random run and
+ * an allocation that has to pass over many smaller free blocks of its own
+ * bin.
+ *
+ * Released under the General Public License (GPL).
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/mman.h>
+
+#include "rbtree.c"
+#include "cmm.c"
+
+#define SEG_PA		0x87000000u
+#define SEG_SIZE	(16u << 20)
+#define MAX_LIVE	4096
+
+struct live {
+	void *pa;
+	u32 size;
+	u8 fill;
+};
+
+static struct task_struct test_task = { 1 };
+struct task_struct *current = &test_task;
+struct device *bridge;
+
+struct dev_object *dev_get_first(void)
+{
+	return NULL;
+}
+
+dsp_status dev_get_cmm_mgr(struct dev_object *hdev_obj,
+			   struct cmm_object **phMgr)
+{
+	return -EPERM;
+}
+
+dsp_status proc_get_dev_object(void *hprocessor,
+			       struct dev_object **phDevObject)
+{
+	return -EPERM;
+}
+
+static struct cmm_object *mgr;
+static struct cmm_allocator *sma;
+static u8 *seg_va;
+static u32 seg_id;
+
+static struct live live[MAX_LIVE];
+static int nr_live;
+
+static unsigned long nr_ops = 200000;
+static unsigned int seed = 1;
+static int timing;
+
+static void usage(void)
+{
+	printf(
+"cmm_test [options]\n"
+"          -n ops          number of random operations (200000)\n"
+"          -r seed         seed of the random operations (1)\n"
+"          -t              skip the checks and report timings\n"
+	);
+}
+
+static void die(unsigned long nr, const char *msg)
+{
+	fprintf(stderr, "op %lu: %s\n", nr, msg);
+	exit(1);
+}
+
+static double now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void seg_create(void)
+{
+	struct cmm_mgrattrs attrs = { 16 };
+	void *va;
+
+	/* the CMM keeps virtual addresses in 32 bits */
+	va = mmap((void *)0x40000000, SEG_SIZE, PROT_READ | PROT_WRITE,
+		  MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (va == MAP_FAILED || (unsigned long)va + SEG_SIZE > 0xffffffffUL)
+		die(0, "cannot map the segment below 4 GiB");
+	seg_va = va;
+
+	cmm_init();
+	if (DSP_FAILED(cmm_create(&mgr, NULL, &attrs)))
+		die(0, "cmm_create failed");
+	if (DSP_FAILED(cmm_register_gppsm_seg(mgr, SEG_PA, SEG_SIZE, 0,
+					      CMM_ADDTODSPPA, 0, 0, &seg_id,
+					      (u32)(unsigned long)seg_va)))
+		die(0, "cmm_register_gppsm_seg failed");
+	sma = get_allocator(mgr, seg_id);
+}
+
+static void seg_destroy(void)
+{
+	if (DSP_FAILED(cmm_destroy(mgr, true)))
+		die(0, "cmm_destroy failed");
+	cmm_exit();
+	munmap(seg_va, SEG_SIZE);
+}
+
+static u32 round_size(u32 usize)
+{
+	return ((usize - 1) & ~(mgr->ul_min_block_size - 1)) +
+		mgr->ul_min_block_size;
+}
+
+static u8 *pa_to_va(void *pa)
+{
+	return seg_va + ((u32)(unsigned long)pa - SEG_PA);
+}
+
+/* The free block a request of usize bytes must be given, by brute force */
+static struct cmm_mnode *expected_block(u32 usize)
+{
+	struct cmm_mnode *own = NULL;
+	struct cmm_mnode *next = NULL;
+	struct cmm_mnode *node;
+	struct rb_node *rb;
+	int bin = SIZE_TO_BIN(usize);
+	int next_bin = CMM_NUM_BINS;
+	int nbin;
+
+	/* address order, so the first of equal sizes is kept */
+	for (rb = rb_first(&sma->free_tree); rb; rb = rb_next(rb)) {
+		node = rb_entry(rb, struct cmm_mnode, rb_link);
+		nbin = SIZE_TO_BIN(node->ul_size);
+		if (nbin == bin && node->ul_size >= usize) {
+			if (!own || node->ul_size < own->ul_size)
+				own = node;
+		} else if (nbin > bin && nbin <= next_bin) {
+			if (nbin < next_bin || node->ul_size < next->ul_size)
+				next = node;
+			next_bin = nbin;
+		}
+	}
+	return own ? own : next;
+}
+
+static void check_bin(unsigned long nr, int bin, u32 *count)
+{
+	struct cmm_mnode *node;
+	struct rb_node *rb;
+	u32 prev_size = 0;
+	u32 prev_pa = 0;
+
+	for (rb = rb_first(&sma->free_bins[bin]); rb; rb = rb_next(rb)) {
+		node = rb_entry(rb, struct cmm_mnode, size_link);
+		if (SIZE_TO_BIN(node->ul_size) != bin)
+			die(nr, "free block in the wrong bin");
+		if (node->ul_size < prev_size ||
+		    (node->ul_size == prev_size && node->dw_pa < prev_pa))
+			die(nr, "bin tree out of order");
+		if (find_node(&sma->free_tree, node->dw_pa) != node)
+			die(nr, "binned block missing from the free tree");
+		prev_size = node->ul_size;
+		prev_pa = node->dw_pa;
+		(*count)++;
+	}
+	if (!!(sma->bin_map & (1UL << bin)) != !RB_EMPTY_ROOT(
+					&sma->free_bins[bin]))
+		die(nr, "bin bitmap does not match the bins");
+}
+
+static void check_allocator(unsigned long nr)
+{
+	struct rb_node *f = rb_first(&sma->free_tree);
+	struct rb_node *u = rb_first(&sma->in_use_tree);
+	struct cmm_mnode *node;
+	struct cmm_mnode *prev_free = NULL;
+	u32 pa = SEG_PA;
+	u32 nr_free = 0;
+	u32 nr_binned = 0;
+	u32 nr_used = 0;
+	int bin;
+
+	while (f || u) {
+		struct cmm_mnode *fn = f ?
+			rb_entry(f, struct cmm_mnode, rb_link) : NULL;
+		struct cmm_mnode *un = u ?
+			rb_entry(u, struct cmm_mnode, rb_link) : NULL;
+
+		if (fn && (!un || fn->dw_pa < un->dw_pa)) {
+			node = fn;
+			if (prev_free && NEXT_PA(prev_free) == node->dw_pa)
+				die(nr, "adjacent free blocks not coalesced");
+			prev_free = node;
+			f = rb_next(f);
+			nr_free++;
+		} else {
+			node = un;
+			prev_free = NULL;
+			u = rb_next(u);
+			nr_used++;
+		}
+		if (node->dw_pa != pa)
+			die(nr, "blocks do not tile the segment");
+		if (node->dw_va != (u32)(unsigned long)pa_to_va(
+						(void *)(unsigned long)pa))
+			die(nr, "block virtual address does not match");
+		pa += node->ul_size;
+	}
+	if (pa != SEG_PA + SEG_SIZE)
+		die(nr, "blocks do not cover the segment");
+	if (nr_used != sma->ul_in_use_cnt || nr_used != (u32)nr_live)
+		die(nr, "in-use count is wrong");
+
+	for (bin = 0; bin < CMM_NUM_BINS; bin++)
+		check_bin(nr, bin, &nr_binned);
+	if (nr_binned != nr_free)
+		die(nr, "free blocks missing from the bins");
+}
+
+static u32 random_size(void)
+{
+	switch (rand() % 8) {
+	case 0:
+		return 1 + rand() % (256 << 10);
+	case 1:
+	case 2:
+		return 1 + rand() % (16 << 10);
+	default:
+		return 1 + rand() % 512;
+	}
+}
+
+static int do_alloc(unsigned long nr, u32 usize)
+{
+	struct cmm_mnode *want = NULL;
+	struct live *l;
+	void *va;
+	void *pa;
+	u32 i;
+
+	if (!timing)
+		want = expected_block(round_size(usize));
+	pa = cmm_calloc_buf(mgr, usize, NULL, &va);
+	if (!pa) {
+		if (want)
+			die(nr, "allocation failed although a block fitted");
+		return 0;
+	}
+
+	l = &live[nr_live++];
+	l->pa = pa;
+	l->size = usize;
+	if (timing)
+		return 1;
+
+	if (!want || (u32)(unsigned long)pa != want->dw_pa)
+		die(nr, "allocation did not get the expected block");
+	if (va != pa_to_va(pa))
+		die(nr, "wrong virtual address returned");
+	for (i = 0; i < usize; i++)
+		if (((u8 *)va)[i])
+			die(nr, "buffer not cleared");
+
+	l->fill = nr | 1;
+	memset(va, l->fill, usize);
+	return 1;
+}
+
+static void do_free(unsigned long nr, int i)
+{
+	struct live *l = &live[i];
+	u8 *va = pa_to_va(l->pa);
+	u32 j;
+
+	if (!timing)
+		for (j = 0; j < l->size; j++)
+			if (va[j] != l->fill)
+				die(nr, "buffer overwritten by another one");
+	if (DSP_FAILED(cmm_free_buf(mgr, l->pa, seg_id)))
+		die(nr, "cmm_free_buf failed");
+	*l = live[--nr_live];
+}
+
+static void random_run(void)
+{
+	double t, alloc_ns = 0, free_ns = 0;
+	unsigned long nr, nr_alloc = 0, nr_free = 0, failed = 0;
+
+	seg_create();
+	srand(seed);
+	for (nr = 1; nr <= nr_ops; nr++) {
+		t = now_ns();
+		/* about 9 MiB of the 16 MiB segment in use once settled */
+		if (rand() % MAX_LIVE >= nr_live * 4) {
+			if (!do_alloc(nr, random_size()))
+				failed++;
+			alloc_ns += now_ns() - t;
+			nr_alloc++;
+		} else {
+			do_free(nr, rand() % nr_live);
+			free_ns += now_ns() - t;
+			nr_free++;
+		}
+		if (!timing)
+			check_allocator(nr);
+	}
+	while (nr_live)
+		do_free(nr, 0);
+	if (!timing) {
+		check_allocator(nr);
+		if (sma->free_tree.rb_node->rb_left ||
+		    sma->free_tree.rb_node->rb_right)
+			die(nr, "segment not whole after freeing everything");
+	}
+	seg_destroy();
+
+	printf("random: %lu allocations (%lu failed), %lu frees\n",
+	       nr_alloc, failed, nr_free);
+	if (timing)
+		printf("random: %.0f ns per allocation, %.0f ns per free\n",
+		       alloc_ns / nr_alloc, free_ns / nr_free);
+}
+
+/*
+ * Leave nr_small free 4 KiB blocks and one free 8000 byte block, all in
+ * the same bin and kept apart by small allocations, and time allocating
+ * 8000 bytes.  The smaller blocks are freed last, so a first-fit walk of
+ * the bin meets all of them first.
+ */
+static double bin_walk(int nr_small)
+{
+	static void *small[MAX_LIVE], *guard[MAX_LIVE];
+	void *big, *big_guard, *pa;
+	double t;
+	int i;
+
+	seg_create();
+	big = cmm_calloc_buf(mgr, 8000, NULL, NULL);
+	big_guard = cmm_calloc_buf(mgr, 16, NULL, NULL);
+	for (i = 0; i < nr_small; i++) {
+		small[i] = cmm_calloc_buf(mgr, 4096, NULL, NULL);
+		guard[i] = cmm_calloc_buf(mgr, 16, NULL, NULL);
+	}
+	cmm_free_buf(mgr, big, seg_id);
+	for (i = 0; i < nr_small; i++)
+		cmm_free_buf(mgr, small[i], seg_id);
+
+	t = now_ns();
+	pa = cmm_calloc_buf(mgr, 8000, NULL, NULL);
+	t = now_ns() - t;
+	if (pa != big)
+		die(0, "bin walk did not get the 8000 byte block");
+
+	(void)big_guard;
+	(void)guard;
+	seg_destroy();
+	return t;
+}
+
+int main(int argc, char **argv)
+{
+	static const int sizes[] = { 10, 100, 1000, 4000 };
+	double t;
+	int i, j, c;
+
+	while ((c = getopt(argc, argv, "n:r:th")) != -1) {
+		switch (c) {
+		case 'n':
+			nr_ops = strtoul(optarg, NULL, 0);
+			break;
+		case 'r':
+			seed = strtoul(optarg, NULL, 0);
+			break;
+		case 't':
+			timing = 1;
+			break;
+		default:
+			usage();
+			return c != 'h';
+		}
+	}
+
+	random_run();
+	if (!timing)
+		return 0;
+
+	for (i = 0; i < (int)(sizeof(sizes) / sizeof(sizes[0])); i++) {
+		t = 0;
+		for (j = 0; j < 20; j++)
+			t += bin_walk(sizes[i]);
+		printf("bin walk: %4d smaller blocks, %.0f ns per allocation\n",
+		       sizes[i], t / 20);
+	}
+	return 0;
+}
@@ -0,0 +1 @@
+/* Nothing from the configuration manager is used by the CMM */
@@ -0,0 +1,14 @@
+/* The status type of the bridge API, from the full dbdefs.h */
+
+#ifndef _CMM_SHIM_DBDEFS_H
+#define _CMM_SHIM_DBDEFS_H
+
+#include <dspbridge/std.h>
+#include <dspbridge/dbtype.h>
+
+#define DSP_SUCCEEDED(Status)	likely((s32)(Status) >= 0)
+#define DSP_FAILED(Status)	unlikely((s32)(Status) < 0)
+
+typedef u32 dsp_status;
+
+#endif
@@ -0,0 +1,13 @@
+/* Device manager calls made by cmm_get_handle(), provided by the test */
+
+#ifndef _CMM_SHIM_DEV_H
+#define _CMM_SHIM_DEV_H
+
+#include <dspbridge/devdefs.h>
+#include <dspbridge/cmmdefs.h>
+
+extern struct dev_object *dev_get_first(void);
+extern dsp_status dev_get_cmm_mgr(struct dev_object *hdev_obj,
+				  struct cmm_object **phMgr);
+
+#endif
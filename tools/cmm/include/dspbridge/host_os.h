@@ -0,0 +1,32 @@
+/*
+ * Host OS services for the shared memory manager: allocation, locking,
+ * the current process and debug output.
+ */
+
+#ifndef _CMM_SHIM_HOST_OS_H
+#define _CMM_SHIM_HOST_OS_H
+
+#include <linux/kernel.h>
+#include <dspbridge/dbtype.h>
+
+#define PAGE_SIZE		4096
+
+#define GFP_KERNEL		0
+#define kzalloc(size, flags)	calloc(1, size)
+#define kfree(ptr)		free(ptr)
+
+/* the test runs from a single thread */
+struct mutex { int unused; };
+#define mutex_init(m)		do { } while (0)
+#define mutex_destroy(m)	do { } while (0)
+#define mutex_lock(m)		do { } while (0)
+#define mutex_unlock(m)		do { } while (0)
+
+struct task_struct { u32 tgid; };
+extern struct task_struct *current;
+
+struct device;
+extern struct device *bridge;
+#define dev_dbg(dev, fmt, ...)	do { } while (0)
+
+#endif
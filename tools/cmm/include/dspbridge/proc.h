@@ -0,0 +1,14 @@
+/* Processor manager calls made by cmm_get_handle(), provided by the test */
+
+#ifndef _CMM_SHIM_PROC_H
+#define _CMM_SHIM_PROC_H
+
+#include <dspbridge/devdefs.h>
+
+extern dsp_status proc_get_dev_object(void *hprocessor,
+				      struct dev_object **phDevObject);
+
+/* shared memory is mapped by the test itself */
+#define MEM_UNMAP_LINEAR_ADDRESS(pBaseAddr) {}
+
+#endif
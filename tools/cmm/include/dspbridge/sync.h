@@ -0,0 +1 @@
+/* Nothing from the synchronization services is used by the CMM */
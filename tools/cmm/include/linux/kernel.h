@@ -0,0 +1,57 @@
+/*
+ * Minimal userspace stand-ins for the kernel interfaces the DSP bridge
+ * shared memory manager and lib/rbtree.c use.
+ */
+
+#ifndef _CMM_SHIM_KERNEL_H
+#define _CMM_SHIM_KERNEL_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <linux/types.h>
+
+#define likely(x)		__builtin_expect(!!(x), 1)
+#define unlikely(x)		__builtin_expect(!!(x), 0)
+
+#define container_of(ptr, type, member) \
+	((type *)((char *)(ptr) - offsetof(type, member)))
+
+#define pr_err(fmt, ...)	fprintf(stderr, fmt, ##__VA_ARGS__)
+
+#define EXPORT_SYMBOL(sym)
+
+#define BITS_PER_LONG		(8 * (int)sizeof(long))
+
+static inline int fls(int x)
+{
+	return x ? 32 - __builtin_clz((unsigned int)x) : 0;
+}
+
+static inline void __set_bit(int nr, unsigned long *addr)
+{
+	*addr |= 1UL << nr;
+}
+
+static inline void __clear_bit(int nr, unsigned long *addr)
+{
+	*addr &= ~(1UL << nr);
+}
+
+/* only ever called on a single word here */
+static inline unsigned long find_next_bit(const unsigned long *addr,
+					  unsigned long size,
+					  unsigned long offset)
+{
+	unsigned long word;
+
+	if (offset >= size)
+		return size;
+	word = *addr & (~0UL << offset);
+	if (size < BITS_PER_LONG)
+		word &= (1UL << size) - 1;
+	return word ? (unsigned long)__builtin_ctzl(word) : size;
+}
+
+#endif
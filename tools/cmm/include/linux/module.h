@@ -0,0 +1,6 @@
+#ifndef _CMM_SHIM_MODULE_H
+#define _CMM_SHIM_MODULE_H
+
+#include <linux/kernel.h>
+
+#endif
@@ -0,0 +1,2 @@
+/* The real rbtree, built on the kernel.h and stddef.h stand-ins */
+#include "../../../../include/linux/rbtree.h"
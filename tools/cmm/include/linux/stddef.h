@@ -0,0 +1,6 @@
+#ifndef _CMM_SHIM_STDDEF_H
+#define _CMM_SHIM_STDDEF_H
+
+#include <stddef.h>
+
+#endif
@@ -0,0 +1,20 @@
+/*
+ * Minimal userspace stand-ins for the kernel interfaces the DSP bridge
+ * shared memory manager uses, so cmm_test can build it off-target.
+ */
+
+#ifndef _CMM_SHIM_TYPES_H
+#define _CMM_SHIM_TYPES_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef uint8_t u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef int8_t s8;
+typedef int16_t s16;
+typedef int32_t s32;
+
+#endif
@@ -0,0 +1,64 @@
+#!/bin/sh
+#
+# Read latency under writeback, per IO scheduler.
+#
+# For each scheduler, a buffered streaming writer fills the second half of
+# the device while a reader issues 4 KiB O_DIRECT random reads in the first
+# half. fio reports the reader's completion latency and the writer's
+# bandwidth. The flash scheduler should give lower read latency than cfq
+# and deadline for about the same write bandwidth.
+#
+# The device must go through a request queue, or the scheduler is never
+# used: an MMC card, a tfsr STL disk or a scsi_debug disk
+# ("modprobe scsi_debug dev_size_mb=256" gives a RAM backed one). brd and
+# ramzswap bypass the elevator, so all schedulers look the same on them.
+# Everything on the device is overwritten.
+#
+# Needs fio.
+#
+# usage: flash-bench.sh <disk> [seconds] [schedulers]
+#	e.g. flash-bench.sh mmcblk0 30 "noop deadline cfq flash"
+
+set -e
+
+DEV=${1:?usage: flash-bench.sh <disk> [seconds] [schedulers]}
+TIME=${2:-30}
+SCHEDS=${3:-"noop deadline cfq flash"}
+
+Q=/sys/block/$DEV/queue
+SIZE=$(($(cat /sys/block/$DEV/size) * 512))
+HALF=$((SIZE / 2))
+
+if [ ! -w $Q/scheduler ]; then
+	echo "$DEV has no request queue" >&2
+	exit 1
+fi
+OLD=$(sed 's/.*\[\(.*\)\].*/\1/' $Q/scheduler)
+
+for s in $SCHEDS; do
+	if ! echo $s > $Q/scheduler 2>/dev/null; then
+		echo "$s: not available"
+		continue
+	fi
+	sync
+	echo 3 > /proc/sys/vm/drop_caches
+
+	echo "== $s"
+	fio --minimal --terse-version=3 --filename=/dev/$DEV \
+		--time_based --runtime=$TIME \
+		--name=writer --rw=write --bs=1M --offset=$HALF \
+		--size=$HALF --ioengine=sync --end_fsync=1 \
+		--name=reader --rw=randread --bs=4k --size=$HALF \
+		--direct=1 --ioengine=sync |
+	awk -F';' '
+		# terse v3: read clat is fields 14-17 (us), write bw is 48
+		$3 == "reader" {
+			printf "read latency:   min %d avg %.0f max %d us\n",
+				$14, $16, $15
+		}
+		$3 == "writer" {
+			printf "write bandwidth: %d KiB/s\n", $48
+		}'
+done
+
+echo $OLD > $Q/scheduler
@@ -0,0 +1,108 @@
+/*
+ * Minimal userspace stand-ins for the kernel interfaces the tiler container
+ * managers use, so tcm_replay can build them off-target.
+ */
+
+#ifndef _TCM_SHIM_KERNEL_H
+#define _TCM_SHIM_KERNEL_H
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef uint8_t u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef int16_t s16;
+typedef int32_t s32;
+
+#define GFP_KERNEL	0
+#define kmalloc(size, flags)	malloc(size)
+#define kzalloc(size, flags)	calloc(1, size)
+#define kfree(ptr)		free(ptr)
+
+/* allocations are replayed from a single thread */
+struct mutex { int unused; };
+#define mutex_init(m)		do { } while (0)
+#define mutex_destroy(m)	do { } while (0)
+#define mutex_lock(m)		do { } while (0)
+#define mutex_unlock(m)		do { } while (0)
+
+/* the allocator's debug and error messages would swamp the timings */
+#define KERN_ERR	""
+#define KERN_NOTICE	""
+static inline int printk(const char *fmt, ...)
+{
+	return 0;
+}
+
+#define EXPORT_SYMBOL(sym)
+#define MODULE_LICENSE(str)
+#define MODULE_AUTHOR(str)
+#define MODULE_DESCRIPTION(str)
+
+#define roundup(x, y)		((((x) + ((y) - 1)) / (y)) * (y))
+#define min_t(type, x, y)	((type)(x) < (type)(y) ? (type)(x) : (type)(y))
+
+#define BITS_PER_LONG		(8 * (int)sizeof(long))
+#define BITS_TO_LONGS(nr)	(((nr) + BITS_PER_LONG - 1) / BITS_PER_LONG)
+#define BIT_WORD(nr)		((nr) / BITS_PER_LONG)
+#define BIT_MASK(nr)		(1UL << ((nr) % BITS_PER_LONG))
+
+static inline int test_bit(unsigned long nr, const unsigned long *addr)
+{
+	return (addr[BIT_WORD(nr)] & BIT_MASK(nr)) != 0;
+}
+
+static inline void __set_bit(unsigned long nr, unsigned long *addr)
+{
+	addr[BIT_WORD(nr)] |= BIT_MASK(nr);
+}
+
+static inline void __clear_bit(unsigned long nr, unsigned long *addr)
+{
+	addr[BIT_WORD(nr)] &= ~BIT_MASK(nr);
+}
+
+static inline unsigned long hweight_long(unsigned long w)
+{
+	return __builtin_popcountl(w);
+}
+
+static inline unsigned long find_next_bit(const unsigned long *addr,
+					  unsigned long size,
+					  unsigned long offset)
+{
+	unsigned long word;
+
+	while (offset < size) {
+		word = addr[BIT_WORD(offset)] >> (offset % BITS_PER_LONG);
+		if (word) {
+			offset += __builtin_ctzl(word);
+			return offset < size ? offset : size;
+		}
+		offset = (BIT_WORD(offset) + 1) * BITS_PER_LONG;
+	}
+	return size;
+}
+
+static inline unsigned long find_last_bit(const unsigned long *addr,
+					  unsigned long size)
+{
+	unsigned long idx = size, word;
+
+	while (idx) {
+		word = addr[BIT_WORD(idx - 1)];
+		if ((idx % BITS_PER_LONG) != 0)
+			word &= BIT_MASK(idx) - 1;
+		if (word)
+			return BIT_WORD(idx - 1) * BITS_PER_LONG +
+				BITS_PER_LONG - 1 - __builtin_clzl(word);
+		idx = BIT_WORD(idx - 1) * BITS_PER_LONG;
+	}
+	return size;
+}
+
+#endif
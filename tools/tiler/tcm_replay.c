@@ -0,0 +1,570 @@
+/*
+ * tcm_replay: replay tiler container allocation traces against SiTA
+ *
+ * Builds drivers/media/video/tiler/tcm/tcm_sita.c as a userspace program
+ * and runs a trace of 1D/2D reservations and frees through it, either read
+ * from a file or generated from a seed.  Every returned area is checked
+ * against a private occupancy map, and the program reports the time spent
+ * per operation, how often a reservation failed although a suitable free
+ * area existed, and how fragmented the free space was over the run.
+ *
+ * Trace format, one operation per line, '#' starts a comment:
+ *
+ *	2d <id> <width> <height> <align>	align is 0, 32 or 64 slots
+ *	1d <id> <slots>
+ *	free <id>
+ *
+ * Ids are small integers naming an area until it is freed.  Freeing an id
+ * whose reservation failed is allowed and does nothing, so generated traces
+ * do not depend on the allocator they are replayed against.
+ *
+ * Released under the General Public License (GPL).
+ */
+
+#define _POSIX_C_SOURCE 200112L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+#include "tcm_sita.c"
+
+#define MAX_IDS		4096
+
+enum op_kind { OP_2D, OP_1D, OP_FREE };
+
+struct op {
+	enum op_kind kind;
+	int id;
+	u16 width;
+	u16 height;
+	u16 align;		/* stride in slots: 1, 32 or 64 */
+	u32 slots;
+};
+
+struct op_stats {
+	unsigned long count;
+	unsigned long failed;
+	unsigned long failed_fit;	/* failed though a free area existed */
+	double ns;
+	double max_ns;
+};
+
+static u16 width = 256, height = 128;
+static struct tcm_pt div_pt = { 192, 96 };
+static int verbose;
+
+static struct tcm_area areas[MAX_IDS];
+static u16 *owner;			/* id + 1 of each slot, 0 when free */
+static u32 used;
+
+static struct op_stats st_2d, st_1d, st_free;
+
+static unsigned long samples;
+static double sum_util, sum_frag_2d, sum_frag_1d;
+
+static void usage(void)
+{
+	printf(
+"tcm_replay [options] [trace-file|-]\n"
+"            -W width        container width in slots (256)\n"
+"            -H height       container height in slots (128)\n"
+"            -x x -y y       SiTA division point (192, 96)\n"
+"            -n ops          length of a generated trace (100000)\n"
+"            -r seed         seed of a generated trace (1)\n"
+"            -o file         write the generated trace to file\n"
+"            -s interval     sample fragmentation every interval ops (100)\n"
+"            -v              print the area returned for every op\n"
+"Without a trace file, a random trace is generated and replayed.\n"
+	);
+}
+
+static void die(unsigned long nr, const char *msg)
+{
+	fprintf(stderr, "tcm_replay: op %lu: %s\n", nr, msg);
+	exit(1);
+}
+
+/*
+ * Random traces
+ */
+
+static unsigned long long rnd_state;
+
+static u32 rnd(u32 n)
+{
+	/* xorshift64*, so traces are the same everywhere for a seed */
+	rnd_state ^= rnd_state >> 12;
+	rnd_state ^= rnd_state << 25;
+	rnd_state ^= rnd_state >> 27;
+	return (u32)((rnd_state * 2685821657736338717ULL) >> 32) % n;
+}
+
+/*
+ * Request mostly buffer-sized areas with the odd large one.  Frees get more
+ * likely as the requested pages approach the container size, independent
+ * of which reservations actually succeed.
+ */
+static struct op *gen_trace(unsigned long nr_ops, unsigned long long seed)
+{
+	static u32 pages[MAX_IDS];
+	struct op *ops = calloc(nr_ops, sizeof(*ops));
+	int live[MAX_IDS], nr_live = 0, free_ids[MAX_IDS], nr_free;
+	u32 requested = 0, total = (u32)width * height;
+	unsigned long i;
+	int j, big;
+
+	if (!ops) {
+		perror("calloc");
+		exit(1);
+	}
+
+	rnd_state = seed ? seed : 1;
+	for (nr_free = 0; nr_free < MAX_IDS; nr_free++)
+		free_ids[nr_free] = MAX_IDS - 1 - nr_free;
+
+	for (i = 0; i < nr_ops; i++) {
+		struct op *op = &ops[i];
+
+		if (nr_live && (nr_free == 0 ||
+		    rnd(1000) < 100 + 800ULL * requested / total)) {
+			j = rnd(nr_live);
+			op->kind = OP_FREE;
+			op->id = live[j];
+			live[j] = live[--nr_live];
+			free_ids[nr_free++] = op->id;
+			requested -= pages[op->id];
+			continue;
+		}
+
+		op->id = free_ids[--nr_free];
+		live[nr_live++] = op->id;
+		big = rnd(10) == 0;
+
+		if (rnd(10) < 6) {
+			op->kind = OP_2D;
+			op->width = 1 + rnd(big ? width / 2 : 32);
+			op->height = 1 + rnd(big ? height / 2 : 32);
+			op->align = rnd(3) ? 32 : 64;
+			pages[op->id] = op->width * op->height;
+		} else {
+			op->kind = OP_1D;
+			op->slots = 1 + rnd(big ? 2048 : 256);
+			pages[op->id] = op->slots;
+		}
+		requested += pages[op->id];
+	}
+	return ops;
+}
+
+static void write_trace(const char *path, struct op *ops, unsigned long nr)
+{
+	FILE *f = fopen(path, "w");
+	unsigned long i;
+
+	if (!f) {
+		perror(path);
+		exit(1);
+	}
+	for (i = 0; i < nr; i++) {
+		if (ops[i].kind == OP_2D)
+			fprintf(f, "2d %d %u %u %u\n", ops[i].id, ops[i].width,
+				ops[i].height, ops[i].align == 1 ?
+				0 : ops[i].align);
+		else if (ops[i].kind == OP_1D)
+			fprintf(f, "1d %d %u\n", ops[i].id, ops[i].slots);
+		else
+			fprintf(f, "free %d\n", ops[i].id);
+	}
+	fclose(f);
+}
+
+static struct op *read_trace(const char *path, unsigned long *nr_ops)
+{
+	FILE *f = strcmp(path, "-") ? fopen(path, "r") : stdin;
+	unsigned long nr = 0, size = 0, line = 0;
+	struct op *ops = NULL;
+	char buf[256], kind[16];
+	unsigned int a, b, c;
+	int id, n;
+
+	if (!f) {
+		perror(path);
+		exit(1);
+	}
+
+	while (fgets(buf, sizeof(buf), f)) {
+		struct op op = { 0 };
+
+		line++;
+		id = 0;
+		n = sscanf(buf, "%15s %d %u %u %u", kind, &id, &a, &b, &c);
+		if (n <= 0 || kind[0] == '#')
+			continue;
+
+		if (id < 0 || id >= MAX_IDS)
+			n = 0;
+		op.id = id;
+		if (!strcmp(kind, "2d") && n == 5 &&
+		    (c == 0 || c == 32 || c == 64)) {
+			op.kind = OP_2D;
+			op.width = a;
+			op.height = b;
+			op.align = c ? c : 1;
+		} else if (!strcmp(kind, "1d") && n == 3) {
+			op.kind = OP_1D;
+			op.slots = a;
+		} else if (!strcmp(kind, "free") && n == 2) {
+			op.kind = OP_FREE;
+		} else {
+			fprintf(stderr, "%s:%lu: bad line\n", path, line);
+			exit(1);
+		}
+
+		if (nr == size) {
+			size = size ? 2 * size : 1024;
+			ops = realloc(ops, size * sizeof(*ops));
+			if (!ops) {
+				perror("realloc");
+				exit(1);
+			}
+		}
+		ops[nr++] = op;
+	}
+
+	if (f != stdin)
+		fclose(f);
+	*nr_ops = nr;
+	return ops;
+}
+
+/*
+ * Free space analysis on the private occupancy map
+ */
+
+/* the largest free rectangle, by a histogram sweep over the rows */
+static u32 largest_free_rect(void)
+{
+	static u16 *col_h, *stack;
+	u32 best = 0, area;
+	int x, y, top, h, left;
+
+	if (!col_h) {
+		col_h = calloc(width + 1, sizeof(*col_h));
+		stack = calloc(width + 1, sizeof(*stack));
+		if (!col_h || !stack) {
+			perror("calloc");
+			exit(1);
+		}
+	}
+	memset(col_h, 0, (width + 1) * sizeof(*col_h));
+
+	for (y = 0; y < height; y++) {
+		for (x = 0; x < width; x++)
+			col_h[x] = owner[y * width + x] ? 0 : col_h[x] + 1;
+
+		top = 0;
+		for (x = 0; x <= width; x++) {
+			while (top && col_h[stack[top - 1]] >= col_h[x]) {
+				h = col_h[stack[--top]];
+				left = top ? stack[top - 1] + 1 : 0;
+				area = (u32)h * (x - left);
+				if (area > best)
+					best = area;
+			}
+			stack[top++] = x;
+		}
+	}
+	return best;
+}
+
+/* the longest run of free slots in raster order */
+static u32 largest_free_run(void)
+{
+	u32 i, run = 0, best = 0, total = (u32)width * height;
+
+	for (i = 0; i < total; i++) {
+		run = owner[i] ? 0 : run + 1;
+		if (run > best)
+			best = run;
+	}
+	return best;
+}
+
+/* is there a free w x h area whose left edge is on the stride? */
+static bool fits_2d(u16 w, u16 h, u16 stride)
+{
+	int x, y, xx, yy;
+
+	for (y = 0; y + h <= height; y++)
+		for (x = 0; x + w <= width; x += stride) {
+			for (yy = y; yy < y + h; yy++)
+				for (xx = x; xx < x + w; xx++)
+					if (owner[yy * width + xx])
+						goto busy;
+			return true;
+busy:
+			;
+		}
+	return false;
+}
+
+static void sample(void)
+{
+	u32 total = (u32)width * height, free_slots = total - used;
+
+	samples++;
+	sum_util += (double)used / total;
+	if (free_slots) {
+		sum_frag_2d += 1.0 - (double)largest_free_rect() / free_slots;
+		sum_frag_1d += 1.0 - (double)largest_free_run() / free_slots;
+	}
+}
+
+/*
+ * Replay
+ */
+
+static double now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void account(struct op_stats *st, double ns, int failed)
+{
+	st->count++;
+	st->ns += ns;
+	if (ns > st->max_ns)
+		st->max_ns = ns;
+	if (failed)
+		st->failed++;
+}
+
+/* check a reserved area against the request and mark it in the map */
+static void claim(unsigned long nr, struct op *op, struct tcm_area *area)
+{
+	int x, y, x0, x1;
+
+	if (area->tcm == NULL || !tcm_area_is_valid(area))
+		die(nr, "invalid area returned");
+
+	if (op->kind == OP_2D) {
+		if (area->type != TCM_2D ||
+		    area->p1.x - area->p0.x + 1 != op->width ||
+		    area->p1.y - area->p0.y + 1 != op->height)
+			die(nr, "2D area of the wrong size");
+		if (area->p0.x % op->align)
+			die(nr, "2D area not on the requested alignment");
+	} else if (area->type != TCM_1D || tcm_sizeof(*area) != op->slots) {
+		die(nr, "1D area of the wrong size");
+	}
+
+	for (y = area->p0.y; y <= area->p1.y; y++) {
+		if (area->type == TCM_2D) {
+			x0 = area->p0.x;
+			x1 = area->p1.x;
+		} else {
+			x0 = y == area->p0.y ? area->p0.x : 0;
+			x1 = y == area->p1.y ? area->p1.x : width - 1;
+		}
+		for (x = x0; x <= x1; x++) {
+			if (owner[y * width + x])
+				die(nr, "area overlaps a reserved one");
+			owner[y * width + x] = op->id + 1;
+			used++;
+		}
+	}
+}
+
+static void release(struct tcm_area *area)
+{
+	u32 i, first = area->p0.y * width + area->p0.x;
+	u32 last = area->p1.y * width + area->p1.x;
+
+	for (i = first; i <= last; i++) {
+		if (area->type == TCM_2D &&
+		    (i % width < area->p0.x || i % width > area->p1.x))
+			continue;
+		owner[i] = 0;
+		used--;
+	}
+}
+
+static void replay(struct tcm *tcm, struct op *ops, unsigned long nr_ops,
+		   unsigned long interval)
+{
+	static const u8 align_of[65] = { [1] = ALIGN_NONE, [32] = ALIGN_32,
+					 [64] = ALIGN_64 };
+	struct tcm_area *area, saved;
+	unsigned long i;
+	double t;
+	s32 ret;
+
+	for (i = 0; i < nr_ops; i++) {
+		struct op *op = &ops[i];
+
+		area = &areas[op->id];
+		if (op->kind != OP_FREE && area->tcm)
+			die(i, "id reserved again before it was freed");
+
+		switch (op->kind) {
+		case OP_2D:
+			t = now_ns();
+			ret = tcm_reserve_2d(tcm, op->width, op->height,
+					     align_of[op->align], area);
+			account(&st_2d, now_ns() - t, ret != 0);
+			if (ret == 0)
+				claim(i, op, area);
+			else if (fits_2d(op->width, op->height, op->align))
+				st_2d.failed_fit++;
+			break;
+
+		case OP_1D:
+			t = now_ns();
+			ret = tcm_reserve_1d(tcm, op->slots, area);
+			account(&st_1d, now_ns() - t, ret != 0);
+			if (ret == 0)
+				claim(i, op, area);
+			else if (largest_free_run() >= op->slots)
+				st_1d.failed_fit++;
+			break;
+
+		case OP_FREE:
+			if (!area->tcm)
+				break;
+			saved = *area;
+			t = now_ns();
+			ret = tcm_free(area);
+			account(&st_free, now_ns() - t, ret != 0);
+			if (ret)
+				die(i, "free failed");
+			release(&saved);
+			break;
+		}
+
+		if (verbose) {
+			if (op->kind == OP_FREE)
+				printf("%lu free %d\n", i, op->id);
+			else if (area->tcm)
+				printf("%lu %s %d " AREA_FMT "\n", i,
+				       op->kind == OP_2D ? "2d" : "1d",
+				       op->id, AREA(area));
+			else
+				printf("%lu %s %d failed\n", i,
+				       op->kind == OP_2D ? "2d" : "1d", op->id);
+		}
+
+		if (interval && (i + 1) % interval == 0)
+			sample();
+	}
+}
+
+static void show(const char *name, struct op_stats *st, int reserve)
+{
+	if (!st->count)
+		return;
+	printf("%-10s %8lu ops %8.0f ns avg %8.0f ns max", name, st->count,
+	       st->ns / st->count, st->max_ns);
+	if (reserve)
+		printf("  %lu failed, %lu of them with a free area",
+		       st->failed, st->failed_fit);
+	printf("\n");
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned long nr_ops = 100000, interval = 100;
+	unsigned long long seed = 1;
+	const char *out = NULL;
+	struct op *ops;
+	struct tcm *tcm;
+	int c, id;
+
+	while ((c = getopt(argc, argv, "W:H:x:y:n:r:o:s:vh")) != -1) {
+		switch (c) {
+		case 'W':
+			width = atoi(optarg);
+			break;
+		case 'H':
+			height = atoi(optarg);
+			break;
+		case 'x':
+			div_pt.x = atoi(optarg);
+			break;
+		case 'y':
+			div_pt.y = atoi(optarg);
+			break;
+		case 'n':
+			nr_ops = strtoul(optarg, NULL, 0);
+			break;
+		case 'r':
+			seed = strtoull(optarg, NULL, 0);
+			break;
+		case 'o':
+			out = optarg;
+			break;
+		case 's':
+			interval = strtoul(optarg, NULL, 0);
+			break;
+		case 'v':
+			verbose = 1;
+			break;
+		default:
+			usage();
+			return c == 'h' ? 0 : 1;
+		}
+	}
+
+	/* tcm_sizeof() counts slots in a u16 */
+	if (!width || !height || (u32)width * height > 65535) {
+		fprintf(stderr, "tcm_replay: bad container size\n");
+		return 1;
+	}
+
+	if (optind < argc)
+		ops = read_trace(argv[optind], &nr_ops);
+	else
+		ops = gen_trace(nr_ops, seed);
+	if (out)
+		write_trace(out, ops, nr_ops);
+
+	owner = calloc((u32)width * height, sizeof(*owner));
+	tcm = sita_init(width, height, &div_pt);
+	if (!owner || !tcm) {
+		fprintf(stderr, "tcm_replay: cannot set up the container\n");
+		return 1;
+	}
+
+	replay(tcm, ops, nr_ops, interval);
+
+	printf("container  %ux%u, division point (%u, %u), %lu ops\n",
+	       width, height, div_pt.x, div_pt.y, nr_ops);
+	show("2D", &st_2d, 1);
+	show("1D", &st_1d, 1);
+	show("free", &st_free, 0);
+	if (samples)
+		printf("free space %lu samples: %.1f%% used, fragmentation "
+		       "%.1f%% 2D, %.1f%% 1D\n", samples,
+		       100 * sum_util / samples, 100 * sum_frag_2d / samples,
+		       100 * sum_frag_1d / samples);
+
+	for (id = 0; id < MAX_IDS; id++) {
+		if (areas[id].tcm) {
+			struct tcm_area saved = areas[id];
+
+			if (tcm_free(&areas[id]))
+				die(nr_ops, "free at exit failed");
+			release(&saved);
+		}
+	}
+	if (used)
+		die(nr_ops, "slots left reserved at exit");
+	tcm_deinit(tcm);
+	free(owner);
+	free(ops);
+	return 0;
+}
@@ -0,0 +1,97 @@
+#!/bin/sh
+#
+# YAFFS2 power-cut test on nandsim.
+#
+# Each round mounts a freshly erased simulated NAND, leaves a clean
+# checkpoint behind, then writes, renames and deletes files with small
+# writes that go through the short-op cache and calls sync.  The flash is
+# copied right after the sync, which is what a power cut at that point
+# would leave.  The copy is written back to the erased flash and mounted,
+# and the files must be exactly those seen after the sync.
+#
+# The rounds write from 1 to 48 eraseblocks, below and above the checkpoint
+# lag, so both the catch-up and the rewritten-checkpoint mounts are covered.
+# The log line at the end of each round says which one was used.
+#
+# Needs nandsim and yaffs as modules or built in, mtdblock, mtdchar and
+# flash_erase and nandwrite from mtd-utils.  Inband tags keep everything in
+# the main area, so dd is enough to take the copy.
+#
+# usage: powercut.sh [lag]	(yaffs_checkpoint_lag, default 16)
+
+set -e
+
+LAG=${1:-16}
+MNT=/tmp/yaffs-powercut
+IMG=/tmp/yaffs-powercut.img
+BLOCK=131072
+
+modprobe nandsim first_id_byte=0xec second_id_byte=0xa1 \
+	third_id_byte=0x00 fourth_id_byte=0x15
+modprobe yaffs 2>/dev/null || true
+echo "$LAG" > /sys/module/yaffs/parameters/yaffs_checkpoint_lag
+
+MTD=$(sed -n 's/^mtd\([0-9]*\):.*"NAND simulator partition 0"$/\1/p' /proc/mtd)
+mkdir -p $MNT
+
+do_mount() {
+	mount -t yaffs2 -o inband-tags /dev/mtdblock$MTD $MNT
+}
+
+# Name and checksum of everything on the filesystem
+listing() {
+	(cd $MNT && find . -type f | sort | xargs -r md5sum)
+}
+
+fail=0
+for blocks in 1 4 15 17 48; do
+	flash_erase -q /dev/mtd$MTD 0 0
+	do_mount
+	mkdir $MNT/dir
+	for i in 1 2 3 4; do
+		dd if=/dev/urandom of=$MNT/dir/base$i bs=4096 count=16 2>/dev/null
+	done
+	umount $MNT
+	do_mount
+
+	# Writes smaller than a chunk sit in the short-op cache until synced
+	dd if=/dev/urandom of=$MNT/dir/small bs=100 \
+		count=$((blocks * BLOCK / 100)) 2>/dev/null
+	echo "appended after the bulk write" >> $MNT/dir/base1
+	mv $MNT/dir/base2 $MNT/renamed
+	rm $MNT/dir/base3
+	dd if=/dev/urandom of=$MNT/dir/base4 bs=10 count=3 conv=notrunc \
+		2>/dev/null
+	sync
+
+	listing > $IMG.expect
+	dmesg -c > /dev/null
+	dd if=/dev/mtd$MTD of=$IMG bs=$BLOCK 2>/dev/null
+
+	umount $MNT
+	flash_erase -q /dev/mtd$MTD 0 0
+	nandwrite -q -p /dev/mtd$MTD $IMG
+	do_mount
+	listing > $IMG.got
+	umount $MNT
+
+	if dmesg | grep -q "catch-up failed"; then
+		how="full scan after a failed catch-up"
+	elif dmesg | grep -q "isCheckpointed 1"; then
+		how="checkpoint"
+	else
+		how="full scan"
+	fi
+
+	if cmp -s $IMG.expect $IMG.got; then
+		echo "$blocks blocks: ok, mounted from $how"
+	else
+		echo "$blocks blocks: FAILED, mounted from $how"
+		diff $IMG.expect $IMG.got || true
+		fail=1
+	fi
+done
+
+rm -f $IMG $IMG.expect $IMG.got
+rmmod nandsim
+exit $fail